@@ -23,5 +23,11 @@ if(DEFINED DEV_MODE)
 else()
 endif()
 
+# Timeline tracing of kernels and communication (splatt --trace)
+if(DEFINED USE_TRACE)
+  message("Building with tracing support.")
+  add_definitions(-DSPLATT_USE_TRACE=${USE_TRACE})
+endif()
+
 include(cmake/warnings.cmake)
 
@@ -8,6 +8,38 @@
 if (${CMAKE_SYSTEM_NAME} MATCHES "Linux")
   # timing library
   set(SPLATT_LIBS ${SPLATT_LIBS} rt)
+
+  # hardware counters via perf_event_open (--perf)
+  include(CheckIncludeFile)
+  check_include_file(linux/perf_event.h SPLATT_HAVE_PERF_EVENT)
+  if (SPLATT_HAVE_PERF_EVENT)
+    add_definitions(-DSPLATT_USE_PERFCTR=1)
+  endif()
+
+  # NUMA memory policies and page queries via mbind/move_pages
+  check_include_file(linux/mempolicy.h SPLATT_HAVE_MEMPOLICY)
+  if (SPLATT_HAVE_MEMPOLICY)
+    add_definitions(-DSPLATT_USE_NUMA=1)
+  endif()
+
+  # huge pages for large allocations via madvise/MAP_HUGETLB
+  include(CheckSymbolExists)
+  set(CMAKE_REQUIRED_DEFINITIONS -D_GNU_SOURCE)
+  check_symbol_exists(MADV_HUGEPAGE sys/mman.h SPLATT_HAVE_MADV_HUGEPAGE)
+  check_symbol_exists(MAP_HUGETLB sys/mman.h SPLATT_HAVE_MAP_HUGETLB)
+  unset(CMAKE_REQUIRED_DEFINITIONS)
+  if (SPLATT_HAVE_MADV_HUGEPAGE AND SPLATT_HAVE_MAP_HUGETLB)
+    add_definitions(-DSPLATT_USE_HUGEPAGES=1)
+  endif()
+
+  # binding threads to CPUs via sched_setaffinity (--bind)
+  set(CMAKE_REQUIRED_DEFINITIONS -D_GNU_SOURCE)
+  check_symbol_exists(sched_setaffinity sched.h SPLATT_HAVE_SETAFFINITY)
+  check_symbol_exists(sched_getcpu sched.h SPLATT_HAVE_GETCPU)
+  unset(CMAKE_REQUIRED_DEFINITIONS)
+  if (SPLATT_HAVE_SETAFFINITY AND SPLATT_HAVE_GETCPU)
+    add_definitions(-DSPLATT_USE_AFFINITY=1)
+  endif()
 endif()
 
 # OSX
@@ -42,6 +42,8 @@
 #include "splatt/api_factorization.h"
 #include "splatt/api_kernels.h"
 #include "splatt/api_kruskal.h"
+#include "splatt/api_memory.h"
+#include "splatt/api_metrics.h"
 #include "splatt/api_mpi.h"
 #include "splatt/api_options.h"
 #include "splatt/api_version.h"
@@ -45,6 +45,23 @@ int splatt_cpd_als(
     splatt_kruskal * factored);
 
 
+/**
+* @brief Register a function to call after each CPD iteration. The callback
+*        sees the iteration, fit, timings, and current model, and its return
+*        value decides whether the factorization continues. With MPI, every
+*        rank calls it with the rows it owns and the factorization stops when
+*        any rank asks to.
+*
+*        SPLATT_OPTION_TIMELIMIT is checked before the callback is called.
+*
+* @param callback The function to call, or NULL to remove it.
+* @param data A pointer passed to each call of 'callback'.
+*/
+void splatt_cpd_set_callback(
+    splatt_cpd_callback callback,
+    void * data);
+
+
 /** @} */
 
 
@@ -47,6 +47,9 @@ typedef struct
   splatt_idx_t * tile_partition[SPLATT_MAX_NMODES];
   /** @brief A thread partitioning of the slices in each CSF. NULL if tiled. */
   splatt_idx_t * tree_partition[SPLATT_MAX_NMODES];
+  /** @brief The work-stealing scheduler of each mode, which replaces the
+   *         static partitions. NULL unless SPLATT_OPTION_STEAL is set. */
+  struct splatt_steal_sched * steal[SPLATT_MAX_NMODES];
 
   /*
    * Privatization information. Privatizing a mode replicates the output matrix
@@ -0,0 +1,80 @@
+/**
+* @file api_memory.h
+* @brief Functions for querying the memory allocated by SPLATT.
+* @author Shaden Smith <shaden@cs.umn.edu>
+* @version 2.0.0
+* @date 2016-05-10
+*/
+
+
+
+#ifndef SPLATT_SPLATT_MEMORY_H
+#define SPLATT_SPLATT_MEMORY_H
+
+
+/*
+ * MEMORY API
+ */
+
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/**
+\defgroup api_memory_list List of functions for \splatt memory accounting.
+@{
+*/
+
+
+/**
+* @brief Report the memory currently and maximally allocated by SPLATT. Only
+*        memory which SPLATT allocates internally is counted; memory which is
+*        later handed to the user (e.g., factor matrices in a splatt_kruskal)
+*        is counted until it is freed with the matching SPLATT function.
+*
+* @param[out] usage The usage to fill.
+*/
+void splatt_mem_query(
+    splatt_mem_usage * const usage);
+
+
+/**
+* @brief Reset all high-water marks to the memory currently allocated.
+*/
+void splatt_mem_reset_peak(void);
+
+
+/**
+* @brief Return a short, human-readable name for a subsystem, e.g., "csf".
+*
+* @param tag The subsystem.
+*
+* @return A static string.
+*/
+char const * splatt_mem_tag_name(
+    splatt_mem_tag const tag);
+
+/**
+* @brief Back allocations of at least 'min_bytes' with 2MB pages, which cuts
+*        TLB misses when gathering rows of large factor matrices. Allocations
+*        which are already live are unaffected. splatt_mem_query() reports
+*        how much memory the kernel actually backed with huge pages.
+*
+* @param policy How to obtain huge pages.
+* @param min_bytes The smallest allocation to back with huge pages.
+*/
+void splatt_mem_set_hugepages(
+    splatt_hugepage_type const policy,
+    uint64_t const min_bytes);
+
+/** @} */
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,89 @@
+/**
+* @file api_metrics.h
+* @brief Functions for reading the timers and statistics recorded by SPLATT.
+* @author Shaden Smith <shaden@cs.umn.edu>
+* @version 2.0.0
+* @date 2016-05-10
+*/
+
+
+
+#ifndef SPLATT_SPLATT_METRICS_H
+#define SPLATT_SPLATT_METRICS_H
+
+
+/*
+ * METRICS API
+ */
+
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/**
+\defgroup api_metrics_list List of functions for \splatt metrics.
+@{
+*/
+
+
+/**
+* @brief Start recording metrics. Nothing is recorded until this is called.
+*        Recorded metrics include all timers, the fit and time of each CPD
+*        iteration, per-mode and per-thread MTTKRP times, privatization
+*        decisions, CSF storage, and MPI communication volumes.
+*/
+void splatt_metrics_enable(void);
+
+
+/**
+* @brief Stop recording metrics. Metrics already recorded are kept.
+*/
+void splatt_metrics_disable(void);
+
+
+/**
+* @brief Return the number of metrics recorded so far.
+*/
+splatt_idx_t splatt_metrics_count(void);
+
+
+/**
+* @brief Return the recorded metrics, in the order they were recorded. The
+*        array has splatt_metrics_count() entries and is invalidated by any
+*        other SPLATT call.
+*
+* @return The metrics array, or NULL if none have been recorded.
+*/
+splatt_metric const * splatt_metrics_get(void);
+
+
+/**
+* @brief Discard all recorded metrics.
+*/
+void splatt_metrics_clear(void);
+
+
+/**
+* @brief Write all recorded metrics to a file. The current value of each
+*        timer is recorded first.
+*
+* @param fname The file to write to.
+* @param format The file format.
+*
+* @return SPLATT error code. SPLATT_SUCCESS on success.
+*/
+int splatt_metrics_write(
+    char const * const fname,
+    splatt_metrics_format const format);
+
+/** @} */
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -45,6 +45,72 @@ typedef struct splatt_kruskal
 
 
 
+/**
+* @brief One measurement recorded by SPLATT, such as a timer, the fit of an
+*        iteration, or the bytes exchanged among ranks. Indices which do not
+*        apply to the measurement are -1.
+*/
+typedef struct splatt_metric
+{
+  /** @brief The component which recorded the metric, e.g., "timer" or "cpd".
+   *         Points to static storage. */
+  char const * group;
+
+  /** @brief What was measured, e.g., "fit". Points to static storage. */
+  char const * name;
+
+  /** @brief The iteration (0-indexed), or -1. */
+  int iteration;
+
+  /** @brief The tensor mode (0-indexed), or -1. */
+  int mode;
+
+  /** @brief The thread, or -1. */
+  int thread;
+
+  /** @brief The measured value. Times are in seconds and sizes in bytes. */
+  double value;
+} splatt_metric;
+
+
+
+/**
+* @brief Memory allocated by SPLATT, in bytes, overall and for each subsystem.
+*        Peaks are high-water marks since the start of the program or the
+*        last call to splatt_mem_reset_peak().
+*/
+typedef struct splatt_mem_usage
+{
+  /** @brief Bytes currently allocated by each subsystem. */
+  uint64_t live[SPLATT_MEM_NTAGS];
+
+  /** @brief The most bytes ever allocated at once by each subsystem. */
+  uint64_t peak[SPLATT_MEM_NTAGS];
+
+  /** @brief The number of allocations made by each subsystem. */
+  uint64_t nallocs[SPLATT_MEM_NTAGS];
+
+  /** @brief Bytes currently allocated in total. */
+  uint64_t total_live;
+
+  /** @brief The most bytes ever allocated at once in total. This is usually
+   *         less than the sum of the subsystem peaks. */
+  uint64_t total_peak;
+
+  /** @brief Bytes mapped so far for allocations which asked for huge pages.
+   *         See splatt_mem_set_hugepages(). */
+  uint64_t huge_mapped;
+
+  /** @brief The part of huge_mapped which the kernel backed with huge pages,
+   *         measured when each allocation was freed (or now, if it is live). */
+  uint64_t huge_backed;
+
+  /** @brief Allocations which asked for huge pages and got regular pages. */
+  uint64_t huge_fallbacks;
+} splatt_mem_usage;
+
+
+
 /**
 * @brief The sparsity pattern of a CSF (sub-)tensor.
 */
@@ -69,6 +135,67 @@ typedef struct
 
 
 
+/**
+* @brief The state of a CPD after one iteration, as passed to a
+*        splatt_cpd_callback. The factors and lambda are the current model:
+*        the columns of the factors are normalized and lambda holds their
+*        scales. They are only valid for the duration of the callback.
+*/
+typedef struct splatt_cpd_progress
+{
+  /** @brief The iteration which just finished (0-indexed). */
+  splatt_idx_t iteration;
+
+  /** @brief The fit of the current model, in [0,1]. */
+  double fit;
+
+  /** @brief The seconds spent on this iteration. */
+  double seconds;
+
+  /** @brief The seconds spent on all iterations so far. */
+  double elapsed;
+
+  /** @brief The seconds spent on each mode during this iteration. */
+  double mode_seconds[SPLATT_MAX_NMODES];
+
+  /** @brief The rank of the decomposition. */
+  splatt_idx_t rank;
+
+  /** @brief The number of modes in the tensor. */
+  splatt_idx_t nmodes;
+
+  /** @brief The number of rows of each factor visible to this process. With
+   *         MPI, these are the rows owned by this rank. */
+  splatt_idx_t dims[SPLATT_MAX_NMODES];
+
+  /** @brief The global index of the first row of each factor. This is 0
+   *         unless factors are distributed with MPI. Distributed rows are
+   *         numbered in the distributed (permuted) order; the permutation
+   *         of the decomposition maps them back to tensor indices. */
+  splatt_idx_t row_start[SPLATT_MAX_NMODES];
+
+  /** @brief The row-major matrix factors for each mode. */
+  splatt_val_t const * factors[SPLATT_MAX_NMODES];
+
+  /** @brief The scale of each column. */
+  splatt_val_t const * lambda;
+} splatt_cpd_progress;
+
+
+/**
+* @brief A function which is called after each CPD iteration.
+*
+* @param progress The state of the factorization.
+* @param data The pointer given to splatt_cpd_set_callback().
+*
+* @return SPLATT_CPD_CONTINUE or SPLATT_CPD_STOP (splatt_cpd_action).
+*/
+typedef int (* splatt_cpd_callback)(
+    splatt_cpd_progress const * const progress,
+    void * data);
+
+
+
 /**
 * @brief CSF tensors are the compressed storage format for performing fast
 *        tensor computations in the SPLATT library.
@@ -0,0 +1,303 @@
+/**
+* @file types_config.h
+* @brief Primitive data types used by SPLATT. This will be copied to types.h
+*        by CMake.
+* @author Shaden Smith <shaden@cs.umn.edu>
+* @version 2.0.0
+* @date 2017-01-08
+*/
+
+
+
+#ifndef SPLATT_SPLATT_TYPES_H
+#define SPLATT_SPLATT_TYPES_H
+
+
+
+
+/******************************************************************************
+ * INCLUDES
+ *****************************************************************************/
+
+
+#include <inttypes.h>
+#include <float.h>
+
+
+
+
+/******************************************************************************
+ * TYPES
+ *****************************************************************************/
+
+/* These values are configured by CMake and can be altered by supplying flags
+ * to 'configure'. Default index and value widths are 64 bits. Changing these
+ * values to 32 will decrease memory consumption at the cost of precision and
+ * maximum supported tensor size. */
+
+#define SPLATT_IDX_TYPEWIDTH 64
+#define SPLATT_VAL_TYPEWIDTH 64
+
+/* Type for BLAS/LAPACK integers. This is usually int32_t, but needs to be
+ * int64_t when linking against 64b BLAS (e.g., Matlab's MKL). */
+#define SPLATT_BLAS_INTWIDTH 32
+
+
+
+/* Set type constants based on width. */
+#if   SPLATT_IDX_TYPEWIDTH == 32
+  typedef uint32_t splatt_idx_t;
+  #define SPLATT_IDX_MAX UINT32_MAX
+  #define SPLATT_PF_IDX PRIu32
+  #define SPLATT_MPI_IDX MPI_UINT32_T
+
+#elif SPLATT_IDX_TYPEWIDTH == 64
+  typedef uint64_t splatt_idx_t;
+  #define SPLATT_IDX_MAX UINT64_MAX
+  #define SPLATT_PF_IDX PRIu64
+  #define SPLATT_MPI_IDX MPI_UINT64_T
+#else
+  #error "*** Incorrect user-supplied value of SPLATT_IDX_TYPEWIDTH ***"
+#endif
+
+
+#if   SPLATT_VAL_TYPEWIDTH == 32
+  typedef float splatt_val_t;
+  #define SPLATT_VAL_MIN FLT_MIN
+  #define SPLATT_VAL_MAX FLT_MAX
+  #define SPLATT_PF_VAL "f"
+  #define SPLATT_MPI_VAL MPI_FLOAT
+
+#elif SPLATT_VAL_TYPEWIDTH == 64
+  typedef double splatt_val_t;
+  #define SPLATT_VAL_MIN DBL_MIN
+  #define SPLATT_VAL_MAX DBL_MAX
+  #define SPLATT_PF_VAL "f"
+  #define SPLATT_MPI_VAL MPI_DOUBLE
+
+#else
+  #error "*** Incorrect user-supplied value of SPLATT_VAL_TYPEWIDTH ***"
+#endif
+
+
+#if   SPLATT_BLAS_INTWIDTH == 32
+  typedef int32_t splatt_blas_int;
+#elif SPLATT_BLAS_INTWIDTH == 64
+  typedef int64_t splatt_blas_int;
+#else
+  #error "*** Incorrect user-supplied value of SPLATT_BLAS_INTWIDTH ***"
+#endif
+
+
+
+
+/******************************************************************************
+ * ENUMS
+ *****************************************************************************/
+
+
+/**
+* @brief Enum for defining SPLATT options. Use the splatt_default_opts() and
+*        splatt_free_opts() functions to initialize and free an options array.
+*/
+typedef enum
+{
+  /* high level options */
+  SPLATT_OPTION_NTHREADS,   /* Number of OpenMP threads to use. */
+  SPLATT_OPTION_TOLERANCE,  /* Threshold for convergence. */
+  SPLATT_OPTION_REGULARIZE, /* Regularization parameter. */
+  SPLATT_OPTION_NITER,      /* Maximum number of iterations to perform. */
+  SPLATT_OPTION_VERBOSITY,  /* Verbosity level */
+
+  /* low level options */
+  SPLATT_OPTION_RANDSEED,   /* Random number seed */
+  SPLATT_OPTION_CSF_ALLOC,  /* How many (and which) tensors to allocate. */
+  SPLATT_OPTION_TILE,       /* Use cache tiling during MTTKRP. */
+  SPLATT_OPTION_TILELEVEL,  /* How many levels of the CSF are tiled? */
+  SPLATT_OPTION_PRIVTHRESH, /* Threshold for privatizing a mode. */
+
+  SPLATT_OPTION_DECOMP,     /* Decomposition to use on distributed systems */
+  SPLATT_OPTION_COMM,       /* Communication pattern to use */
+  SPLATT_OPTION_REPLTHRESH, /* Threshold for replicating a mode across ranks */
+  SPLATT_OPTION_NODE_REDUCE,/* Reduce within shared-memory nodes first */
+  SPLATT_OPTION_FUSE_REDUCE,/* Fuse Gram/norm/fit reductions per mode */
+  SPLATT_OPTION_COMM_THREADS,/* Threads exchange rows with their own peers */
+  SPLATT_OPTION_COMM_PRECISION,/* Precision of exchanged factor rows */
+  SPLATT_OPTION_COMM_DELTA, /* Only send rows which changed more than this */
+  SPLATT_OPTION_REBALANCE,  /* Iterations before rebalancing nonzeros */
+  SPLATT_OPTION_TIMELIMIT,  /* Wall-clock budget of the CPD, in seconds */
+  SPLATT_OPTION_NUMA,       /* Placement of memory on NUMA nodes */
+  SPLATT_OPTION_TEAM,       /* Run ALS iterations in one persistent team */
+  SPLATT_OPTION_AFFINITY,   /* Binding of threads to CPUs */
+  SPLATT_OPTION_STEAL,      /* Balance MTTKRP with work stealing */
+
+  SPLATT_OPTION_NOPTIONS    /* Gives the size of the options array. */
+} splatt_option_type;
+
+
+/**
+* @brief Return codes used by SPLATT.
+*/
+typedef enum
+{
+  SPLATT_SUCCESS = 1,     /* Successful SPLATT API call. */
+  SPLATT_ERROR_BADINPUT,  /* SPLATT found an issue with the input.
+                             Try splatt-check to debug. */
+  SPLATT_ERROR_NOMEMORY   /* SPLATT did not have enough memory to complete.
+                             Try using fewer factors, a smaller tensor, or
+                             recompile with less precision. */
+} splatt_error_type;
+
+
+/**
+* @brief Verbosity levels used by SPLATT.
+*/
+typedef enum
+{
+  SPLATT_VERBOSITY_NONE, /* Nothing written to STDOUT. */
+  SPLATT_VERBOSITY_LOW,  /* Only headers/footers and high-level timing. */
+  SPLATT_VERBOSITY_HIGH, /* Timers for all modes. */
+  SPLATT_VERBOSITY_MAX   /* All output, including detailed timers. */
+} splatt_verbosity_type;
+
+
+/**
+* @brief Types of tiling used by SPLATT.
+*/
+typedef enum
+{
+  SPLATT_NOTILE,
+  SPLATT_DENSETILE,
+  /* DEPRECATED - pending CSF implementations */
+  SPLATT_SYNCTILE,
+  SPLATT_COOPTILE,
+} splatt_tile_type;
+
+
+/**
+* @brief Types of CSF allocation available.
+*/
+typedef enum
+{
+  SPLATT_CSF_ONEMODE, /** Only allocate one CSF for factorization. */
+  SPLATT_CSF_TWOMODE, /** Allocate one for the smallest and largest modes. */
+  SPLATT_CSF_ALLMODE, /** Allocate one CSF for every mode. */
+} splatt_csf_type;
+
+
+/**
+* @brief Tensor decomposition schemes.
+*/
+typedef enum
+{
+  /** @brief Coarse-grained decomposition is using a separate 1D decomposition
+   *         for each mode. */
+  SPLATT_DECOMP_COARSE,
+  /** @brief Medium-grained decomposition is an 'nmodes'-dimensional
+   *         decomposition. */
+  SPLATT_DECOMP_MEDIUM,
+  /** @brief Fine-grained decomposition distributes work at the nonzero level.
+   *         NOTE: requires a partitioning on the nonzeros. */
+  SPLATT_DECOMP_FINE
+} splatt_decomp_type;
+
+
+/**
+* @brief Communication pattern type. We support point-to-point, all-to-all
+*        (vectorized), and neighborhood collectives over a graph of only the
+*        ranks that exchange rows.
+*/
+typedef enum
+{
+  SPLATT_COMM_POINT2POINT,
+  SPLATT_COMM_ALL2ALL,
+  SPLATT_COMM_NEIGHBOR
+} splatt_comm_type;
+
+
+/**
+* @brief Precision of the factor rows exchanged among ranks. Reduced precisions
+*        trade accuracy of the messages for fewer bytes on the wire.
+*/
+typedef enum
+{
+  SPLATT_PRECISION_FULL, /** Send val_t as-is. */
+  SPLATT_PRECISION_FP32, /** Round to IEEE single precision. */
+  SPLATT_PRECISION_BF16  /** Round to bfloat16 (8-bit exponent, 7-bit mantissa). */
+} splatt_precision_type;
+
+
+/**
+* @brief File formats for the metrics recorded by SPLATT.
+*/
+typedef enum
+{
+  SPLATT_METRICS_JSON, /** One object with an array of metric records. */
+  SPLATT_METRICS_CSV   /** One row per metric, with a header. */
+} splatt_metrics_format;
+
+
+/**
+* @brief The subsystems whose memory usage SPLATT tracks separately.
+*/
+typedef enum
+{
+  SPLATT_MEM_OTHER,     /** Anything not covered below. */
+  SPLATT_MEM_IO,        /** Coordinate tensors, as read from file. */
+  SPLATT_MEM_SORT,      /** Sorting temporaries. */
+  SPLATT_MEM_CSF,       /** CSF tensors and their tiles. */
+  SPLATT_MEM_MTTKRP_WS, /** MTTKRP workspaces, privatization buffers, and
+                            thread scratch. */
+  SPLATT_MEM_MATRICES,  /** Factor matrices and other dense matrices. */
+  SPLATT_MEM_MPI,       /** Communication buffers and distribution data. */
+  SPLATT_MEM_NTAGS
+} splatt_mem_tag;
+
+
+/**
+* @brief How large allocations are backed by huge pages.
+*/
+typedef enum
+{
+  SPLATT_HUGEPAGE_OFF,    /** Regular pages only. */
+  SPLATT_HUGEPAGE_THP,    /** Transparent huge pages via madvise(). */
+  SPLATT_HUGEPAGE_HUGETLB /** Explicit pages from the hugetlbfs pool, falling
+                              back to transparent huge pages. */
+} splatt_hugepage_type;
+
+
+/**
+* @brief Placement of CSF tensors, factor matrices, and thread scratch on the
+*        NUMA nodes of a shared-memory machine.
+*/
+typedef enum
+{
+  SPLATT_NUMA_OFF,  /** Leave pages wherever they are first touched. */
+  SPLATT_NUMA_AUTO, /** Place memory if the machine has several NUMA nodes. */
+  SPLATT_NUMA_ON    /** Always place memory, even on a single node. */
+} splatt_numa_type;
+
+
+/**
+* @brief How OpenMP threads are bound to the CPUs of a shared-memory machine.
+*/
+typedef enum
+{
+  SPLATT_AFFINITY_NONE,    /** Leave binding to the OpenMP runtime. */
+  SPLATT_AFFINITY_COMPACT, /** Fill the hardware threads of each core first. */
+  SPLATT_AFFINITY_SCATTER, /** Spread threads evenly over packages and nodes. */
+  SPLATT_AFFINITY_CORES    /** One thread per physical core, skipping SMT. */
+} splatt_affinity_type;
+
+
+/**
+* @brief What a CPD progress callback asks the factorization to do next.
+*/
+typedef enum
+{
+  SPLATT_CPD_CONTINUE, /** Keep iterating. */
+  SPLATT_CPD_STOP      /** Stop after this iteration, as if converged. */
+} splatt_cpd_action;
+
+
+#endif
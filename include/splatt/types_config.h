@@ -118,6 +118,18 @@ typedef enum
 
   SPLATT_OPTION_DECOMP,     /* Decomposition to use on distributed systems */
   SPLATT_OPTION_COMM,       /* Communication pattern to use */
+  SPLATT_OPTION_REPLTHRESH, /* Threshold for replicating a mode across ranks */
+  SPLATT_OPTION_NODE_REDUCE,/* Reduce within shared-memory nodes first */
+  SPLATT_OPTION_FUSE_REDUCE,/* Fuse Gram/norm/fit reductions per mode */
+  SPLATT_OPTION_COMM_THREADS,/* Threads exchange rows with their own peers */
+  SPLATT_OPTION_COMM_PRECISION,/* Precision of exchanged factor rows */
+  SPLATT_OPTION_COMM_DELTA, /* Only send rows which changed more than this */
+  SPLATT_OPTION_REBALANCE,  /* Iterations before rebalancing nonzeros */
+  SPLATT_OPTION_TIMELIMIT,  /* Wall-clock budget of the CPD, in seconds */
+  SPLATT_OPTION_NUMA,       /* Placement of memory on NUMA nodes */
+  SPLATT_OPTION_TEAM,       /* Run ALS iterations in one persistent team */
+  SPLATT_OPTION_AFFINITY,   /* Binding of threads to CPUs */
+  SPLATT_OPTION_STEAL,      /* Balance MTTKRP with work stealing */
 
   SPLATT_OPTION_NOPTIONS    /* Gives the size of the options array. */
 } splatt_option_type;
@@ -191,14 +203,101 @@ typedef enum
 
 
 /**
-* @brief Communication pattern type. We support point-to-point, and all-to-all
-*        (vectorized).
+* @brief Communication pattern type. We support point-to-point, all-to-all
+*        (vectorized), and neighborhood collectives over a graph of only the
+*        ranks that exchange rows.
 */
 typedef enum
 {
   SPLATT_COMM_POINT2POINT,
-  SPLATT_COMM_ALL2ALL
+  SPLATT_COMM_ALL2ALL,
+  SPLATT_COMM_NEIGHBOR
 } splatt_comm_type;
 
 
+/**
+* @brief Precision of the factor rows exchanged among ranks. Reduced precisions
+*        trade accuracy of the messages for fewer bytes on the wire.
+*/
+typedef enum
+{
+  SPLATT_PRECISION_FULL, /** Send val_t as-is. */
+  SPLATT_PRECISION_FP32, /** Round to IEEE single precision. */
+  SPLATT_PRECISION_BF16  /** Round to bfloat16 (8-bit exponent, 7-bit mantissa). */
+} splatt_precision_type;
+
+
+/**
+* @brief File formats for the metrics recorded by SPLATT.
+*/
+typedef enum
+{
+  SPLATT_METRICS_JSON, /** One object with an array of metric records. */
+  SPLATT_METRICS_CSV   /** One row per metric, with a header. */
+} splatt_metrics_format;
+
+
+/**
+* @brief The subsystems whose memory usage SPLATT tracks separately.
+*/
+typedef enum
+{
+  SPLATT_MEM_OTHER,     /** Anything not covered below. */
+  SPLATT_MEM_IO,        /** Coordinate tensors, as read from file. */
+  SPLATT_MEM_SORT,      /** Sorting temporaries. */
+  SPLATT_MEM_CSF,       /** CSF tensors and their tiles. */
+  SPLATT_MEM_MTTKRP_WS, /** MTTKRP workspaces, privatization buffers, and
+                            thread scratch. */
+  SPLATT_MEM_MATRICES,  /** Factor matrices and other dense matrices. */
+  SPLATT_MEM_MPI,       /** Communication buffers and distribution data. */
+  SPLATT_MEM_NTAGS
+} splatt_mem_tag;
+
+
+/**
+* @brief How large allocations are backed by huge pages.
+*/
+typedef enum
+{
+  SPLATT_HUGEPAGE_OFF,    /** Regular pages only. */
+  SPLATT_HUGEPAGE_THP,    /** Transparent huge pages via madvise(). */
+  SPLATT_HUGEPAGE_HUGETLB /** Explicit pages from the hugetlbfs pool, falling
+                              back to transparent huge pages. */
+} splatt_hugepage_type;
+
+
+/**
+* @brief Placement of CSF tensors, factor matrices, and thread scratch on the
+*        NUMA nodes of a shared-memory machine.
+*/
+typedef enum
+{
+  SPLATT_NUMA_OFF,  /** Leave pages wherever they are first touched. */
+  SPLATT_NUMA_AUTO, /** Place memory if the machine has several NUMA nodes. */
+  SPLATT_NUMA_ON    /** Always place memory, even on a single node. */
+} splatt_numa_type;
+
+
+/**
+* @brief How OpenMP threads are bound to the CPUs of a shared-memory machine.
+*/
+typedef enum
+{
+  SPLATT_AFFINITY_NONE,    /** Leave binding to the OpenMP runtime. */
+  SPLATT_AFFINITY_COMPACT, /** Fill the hardware threads of each core first. */
+  SPLATT_AFFINITY_SCATTER, /** Spread threads evenly over packages and nodes. */
+  SPLATT_AFFINITY_CORES    /** One thread per physical core, skipping SMT. */
+} splatt_affinity_type;
+
+
+/**
+* @brief What a CPD progress callback asks the factorization to do next.
+*/
+typedef enum
+{
+  SPLATT_CPD_CONTINUE, /** Keep iterating. */
+  SPLATT_CPD_STOP      /** Stop after this iteration, as if converged. */
+} splatt_cpd_action;
+
+
 #endif
@@ -0,0 +1,371 @@
+/******************************************************************************
+ * INCLUDES
+ *****************************************************************************/
+#include "affinity.h"
+#include "placement.h"
+#include "thd_info.h"
+
+#ifdef SPLATT_USE_AFFINITY
+#include <sched.h>
+#include <dirent.h>
+#endif
+
+
+/******************************************************************************
+ * PRIVATE STRUCTURES
+ *****************************************************************************/
+
+/* threads per line of the binding report */
+#define AFFINITY_PER_LINE 8
+
+/* read once, on first use */
+static affinity_topology topo;
+static bool topo_read = false;
+
+#ifdef SPLATT_USE_AFFINITY
+/* the last binding which was applied */
+static splatt_affinity_type bound_policy = SPLATT_AFFINITY_NONE;
+static int bound_nthreads = 0;
+#endif
+
+static char const * const policy_names[] = {
+  "NONE", "COMPACT", "SCATTER", "CORES"
+};
+
+
+
+/******************************************************************************
+ * PRIVATE FUNCTIONS
+ *****************************************************************************/
+
+/**
+* @brief Order CPUs by package, node, core, and finally OS id.
+*/
+static int p_cpu_cmp(
+    void const * a,
+    void const * b)
+{
+  affinity_cpu const * const x = a;
+  affinity_cpu const * const y = b;
+  if(x->package != y->package) {
+    return (x->package < y->package) ? -1 : 1;
+  }
+  if(x->node != y->node) {
+    return (x->node < y->node) ? -1 : 1;
+  }
+  if(x->core != y->core) {
+    return (x->core < y->core) ? -1 : 1;
+  }
+  return (x->cpu < y->cpu) ? -1 : (x->cpu > y->cpu);
+}
+
+
+#ifdef SPLATT_USE_AFFINITY
+
+/**
+* @brief Read one integer from a sysfs file of CPU 'cpu'.
+*
+* @return The value, or -1 if the file cannot be read.
+*/
+static int p_read_cpu_int(
+    int const cpu,
+    char const * const file)
+{
+  char path[256];
+  snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/%s", cpu, file);
+
+  int val = -1;
+  FILE * fin = fopen(path, "r");
+  if(fin != NULL) {
+    if(fscanf(fin, "%d", &val) != 1) {
+      val = -1;
+    }
+    fclose(fin);
+  }
+  return val;
+}
+
+
+/**
+* @brief Find the NUMA node of a CPU from its 'nodeN' link in sysfs.
+*
+* @return The node, or 0 if it has none.
+*/
+static int p_read_cpu_node(
+    int const cpu)
+{
+  char path[256];
+  snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d", cpu);
+
+  int node = 0;
+  DIR * dir = opendir(path);
+  if(dir != NULL) {
+    struct dirent * ent;
+    while((ent = readdir(dir)) != NULL) {
+      if(sscanf(ent->d_name, "node%d", &node) == 1) {
+        break;
+      }
+      node = 0;
+    }
+    closedir(dir);
+  }
+  return node;
+}
+
+#endif
+
+
+/**
+* @brief Fill 'topo' with the CPUs the process may use, sorted with
+*        p_cpu_cmp(), and count its cores, packages, and nodes.
+*/
+static void p_read_topology(void)
+{
+#ifdef SPLATT_USE_AFFINITY
+  cpu_set_t allowed;
+  CPU_ZERO(&allowed);
+  if(sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+    CPU_ZERO(&allowed);
+  }
+
+  topo.ncpus = CPU_COUNT(&allowed);
+  topo.cpus = splatt_malloc(SS_MAX(topo.ncpus, 1) * sizeof(*topo.cpus));
+  int n = 0;
+  for(int c=0; c < CPU_SETSIZE && n < topo.ncpus; ++c) {
+    if(!CPU_ISSET(c, &allowed)) {
+      continue;
+    }
+    affinity_cpu * const cpu = &(topo.cpus[n++]);
+    cpu->cpu = c;
+    cpu->package = SS_MAX(p_read_cpu_int(c, "topology/physical_package_id"),0);
+    cpu->core = p_read_cpu_int(c, "topology/core_id");
+    cpu->node = p_read_cpu_node(c);
+    /* without topology, every CPU is its own core */
+    if(cpu->core < 0) {
+      cpu->core = c;
+    }
+  }
+#else
+  topo.ncpus = 0;
+  topo.cpus = splatt_malloc(1 * sizeof(*topo.cpus));
+#endif
+
+  if(topo.ncpus == 0) {
+    topo.ncpus = 1;
+    topo.cpus[0].cpu = 0;
+    topo.cpus[0].package = 0;
+    topo.cpus[0].node = 0;
+    topo.cpus[0].core = 0;
+  }
+
+  qsort(topo.cpus, topo.ncpus, sizeof(*topo.cpus), p_cpu_cmp);
+
+  topo.ncores = 0;
+  topo.npackages = 0;
+  topo.nnodes = SS_MAX(numa_nnodes(), 1);
+  for(int c=0; c < topo.ncpus; ++c) {
+    affinity_cpu * const cpu = &(topo.cpus[c]);
+    affinity_cpu const * const prev = (c > 0) ? cpu - 1 : NULL;
+    if(prev != NULL && prev->package == cpu->package &&
+        prev->core == cpu->core) {
+      cpu->smt = prev->smt + 1;
+    } else {
+      cpu->smt = 0;
+      ++topo.ncores;
+    }
+    if(prev == NULL || prev->package != cpu->package) {
+      ++topo.npackages;
+    }
+  }
+}
+
+
+/**
+* @brief Write the CPUs of topo.cpus[start:end] into 'list', with the first
+*        hardware thread of every core before any second one.
+*
+* @return The number of cores in the range.
+*/
+static int p_cores_first(
+    int const start,
+    int const end,
+    int * const list)
+{
+  int n = 0;
+  int ncores = 0;
+  for(int smt=0; n < end - start; ++smt) {
+    for(int c=start; c < end; ++c) {
+      if(topo.cpus[c].smt == smt) {
+        list[n++] = topo.cpus[c].cpu;
+        if(smt == 0) {
+          ++ncores;
+        }
+      }
+    }
+  }
+  return ncores;
+}
+
+
+
+/******************************************************************************
+ * PUBLIC FUNCTIONS
+ *****************************************************************************/
+
+affinity_topology const * affinity_topo(void)
+{
+  if(!topo_read) {
+    p_read_topology();
+    topo_read = true;
+  }
+  return &topo;
+}
+
+
+int affinity_order(
+    splatt_affinity_type const policy,
+    int const nthreads,
+    int * const cpus)
+{
+  affinity_topo();
+  int const ncpus = topo.ncpus;
+  int * list = splatt_malloc(ncpus * sizeof(*list));
+  int shared = 0;
+
+  switch(policy) {
+  case SPLATT_AFFINITY_COMPACT:
+    for(int t=0; t < nthreads; ++t) {
+      cpus[t] = topo.cpus[t % ncpus].cpu;
+    }
+    shared = SS_MAX(nthreads - ncpus, 0);
+    break;
+
+  case SPLATT_AFFINITY_CORES: {
+    int const ncores = p_cores_first(0, ncpus, list);
+    for(int t=0; t < nthreads; ++t) {
+      cpus[t] = list[t % ncpus];
+    }
+    shared = SS_MAX(nthreads - ncores, 0);
+    break;
+  }
+
+  case SPLATT_AFFINITY_SCATTER: {
+    /* each (package, node) pair is a contiguous range of topo.cpus */
+    int ndomains = 0;
+    for(int c=0; c < ncpus; ++c) {
+      if(c == 0 || topo.cpus[c].package != topo.cpus[c-1].package ||
+          topo.cpus[c].node != topo.cpus[c-1].node) {
+        ++ndomains;
+      }
+    }
+
+    int t = 0;
+    int d = 0;
+    int start = 0;
+    while(start < ncpus) {
+      int end = start + 1;
+      while(end < ncpus && topo.cpus[end].package == topo.cpus[start].package
+          && topo.cpus[end].node == topo.cpus[start].node) {
+        ++end;
+      }
+
+      /* consecutive threads stay in the same domain */
+      int const mine = (nthreads / ndomains) + (d < nthreads % ndomains);
+      int const ncores = p_cores_first(start, end, list);
+      for(int i=0; i < mine; ++i) {
+        cpus[t++] = list[i % (end - start)];
+      }
+      shared += SS_MAX(mine - ncores, 0);
+
+      ++d;
+      start = end;
+    }
+    break;
+  }
+
+  default:
+    fprintf(stderr, "SPLATT: affinity policy '%d' not recognized.\n", policy);
+    abort();
+  }
+
+  splatt_free(list);
+  return shared;
+}
+
+
+void affinity_bind(
+    double const * const opts)
+{
+#ifdef SPLATT_USE_AFFINITY
+  splatt_affinity_type const policy =
+      (splatt_affinity_type) opts[SPLATT_OPTION_AFFINITY];
+  int const nthreads = (int) opts[SPLATT_OPTION_NTHREADS];
+  if(policy == SPLATT_AFFINITY_NONE ||
+      (policy == bound_policy && nthreads == bound_nthreads)) {
+    return;
+  }
+
+  int * cpus = splatt_malloc(nthreads * sizeof(*cpus));
+  int const shared = affinity_order(policy, nthreads, cpus);
+  if(shared > 0) {
+    fprintf(stderr, "SPLATT: %d of %d threads share a core with another.\n",
+        shared, nthreads);
+  }
+
+  int failed = 0;
+  #pragma omp parallel num_threads(nthreads) reduction(+:failed)
+  {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpus[splatt_omp_get_thread_num()], &set);
+    if(sched_setaffinity(0, sizeof(set), &set) != 0) {
+      failed = 1;
+    }
+  }
+  if(failed > 0) {
+    fprintf(stderr, "SPLATT: could not bind %d threads.\n", failed);
+  }
+
+  splatt_free(cpus);
+  bound_policy = policy;
+  bound_nthreads = nthreads;
+#endif
+}
+
+
+void affinity_report(
+    double const * const opts)
+{
+  splatt_affinity_type const policy =
+      (splatt_affinity_type) opts[SPLATT_OPTION_AFFINITY];
+  int const nthreads = (int) opts[SPLATT_OPTION_NTHREADS];
+  affinity_topology const * const t = affinity_topo();
+
+  printf("Thread affinity ------------------------------------------------\n");
+  printf("CPUS=%d CORES=%d PACKAGES=%d NODES=%d\n", t->ncpus, t->ncores,
+      t->npackages, t->nnodes);
+
+  printf("BIND=%s\n", policy_names[policy]);
+
+#ifdef SPLATT_USE_AFFINITY
+
+  /* where the threads are now, whether or not we bound them */
+  int * cpus = splatt_malloc(nthreads * sizeof(*cpus));
+  #pragma omp parallel num_threads(nthreads)
+  cpus[splatt_omp_get_thread_num()] = sched_getcpu();
+
+  for(int i=0; i < nthreads; ++i) {
+    if(i % AFFINITY_PER_LINE == 0) {
+      printf("%s  THREAD->CPU:", (i > 0) ? "\n" : "");
+    }
+    printf(" %d->%d", i, cpus[i]);
+  }
+  printf("\n");
+  splatt_free(cpus);
+#else
+  if(policy != SPLATT_AFFINITY_NONE) {
+    printf("  thread affinity is not supported on this platform\n");
+  }
+#endif
+  printf("\n");
+}
@@ -0,0 +1,105 @@
+#ifndef SPLATT_AFFINITY_H
+#define SPLATT_AFFINITY_H
+
+
+/******************************************************************************
+ * INCLUDES
+ *****************************************************************************/
+#include "base.h"
+
+
+/******************************************************************************
+ * STRUCTURES
+ *****************************************************************************/
+
+/**
+* @brief Where one logical CPU sits in the machine.
+*/
+typedef struct
+{
+  int cpu;     /** The OS id of the CPU. */
+  int package; /** The socket holding it. */
+  int node;    /** Its NUMA node. */
+  int core;    /** Its physical core, unique within the package. */
+  int smt;     /** Its rank among the hardware threads of its core. */
+} affinity_cpu;
+
+
+/**
+* @brief The CPUs the process may run on, sorted so that neighbours share a
+*        core, then a NUMA node, then a package.
+*/
+typedef struct
+{
+  int ncpus;
+  int ncores;
+  int npackages;
+  int nnodes;
+  affinity_cpu * cpus;
+} affinity_topology;
+
+
+
+/******************************************************************************
+ * PUBLIC FUNCTIONS
+ *****************************************************************************/
+
+#define affinity_topo splatt_affinity_topo
+/**
+* @brief Return the topology of the CPUs which the process was allowed to run
+*        on when it was first queried. It is read from sysfs once and must not
+*        be freed. Without sysfs, every CPU is its own core on one package.
+*/
+affinity_topology const * affinity_topo(void);
+
+
+#define affinity_order splatt_affinity_order
+/**
+* @brief Choose the CPU of each thread so that consecutive threads, which own
+*        neighbouring slices and tiles, share caches and packages.
+*
+*        SPLATT_AFFINITY_COMPACT fills the hardware threads of a core, then
+*        the cores of a node and package. SPLATT_AFFINITY_CORES uses one
+*        hardware thread per core. SPLATT_AFFINITY_SCATTER spreads threads
+*        evenly over the (package, node) pairs, one per core first, keeping
+*        consecutive threads on the same pair.
+*
+* @param policy The placement policy, which must not be SPLATT_AFFINITY_NONE.
+* @param nthreads The number of threads.
+* @param[out] cpus The OS CPU id of each thread, of length 'nthreads'.
+*
+* @return The number of threads which had to share a core or CPU because
+*         there were not enough of them.
+*/
+int affinity_order(
+    splatt_affinity_type const policy,
+    int const nthreads,
+    int * const cpus);
+
+
+#define affinity_bind splatt_affinity_bind
+/**
+* @brief Bind the OpenMP threads to CPUs according to SPLATT_OPTION_AFFINITY.
+*        This does nothing for SPLATT_AFFINITY_NONE, when the threads are
+*        already bound the same way, or on platforms without thread affinity.
+*
+*        NOTE: this must be called outside of a parallel region.
+*
+* @param opts SPLATT options.
+*/
+void affinity_bind(
+    double const * const opts);
+
+
+#define affinity_report splatt_affinity_report
+/**
+* @brief Print the topology and the CPU which each thread runs on.
+*
+*        NOTE: this must be called outside of a parallel region.
+*
+* @param opts SPLATT options.
+*/
+void affinity_report(
+    double const * const opts);
+
+#endif
@@ -7,6 +7,53 @@
 
 /* for `posix_memalign()` errors */
 #include <errno.h>
+#include <stdint.h>
+
+#ifdef SPLATT_USE_HUGEPAGES
+#include <sys/mman.h>
+#endif
+
+
+
+/******************************************************************************
+ * PRIVATE STRUCTURES
+ *****************************************************************************/
+
+/**
+* @brief One live allocation. Allocations are kept in an open-addressing hash
+*        table keyed by their address, because splatt_free() is not told the
+*        size of what it frees.
+*/
+typedef struct
+{
+  uintptr_t ptr;  /** The address, or 0 if the slot is empty. */
+  uint64_t bytes;
+  splatt_mem_tag tag;
+  splatt_hugepage_type huge; /** How the memory was mapped, or
+                                 SPLATT_HUGEPAGE_OFF if by posix_memalign(). */
+  uint64_t map_bytes;        /** The length of a huge page mapping. */
+} mem_entry;
+
+static mem_entry * mem_table = NULL;
+static size_t mem_table_size = 0;  /* always a power of two */
+static size_t mem_table_count = 0;
+
+static splatt_mem_tag mem_cur_tag = SPLATT_MEM_OTHER;
+static splatt_mem_usage mem_usage;
+
+/* the size of the huge pages we ask for */
+#define MEM_HUGE_BYTES (2UL * 1024UL * 1024UL)
+
+static splatt_hugepage_type mem_huge_policy = SPLATT_HUGEPAGE_OFF;
+static size_t mem_huge_min = 16UL * 1024UL * 1024UL;
+/* live bytes mapped from the hugetlbfs pool, which are always huge */
+static uint64_t mem_hugetlb_live = 0;
+/* huge page bytes of allocations which have already been freed */
+static uint64_t mem_huge_freed_backed = 0;
+
+static char const * const mem_tag_names[] = {
+  "other", "io", "sort", "csf", "mttkrp_ws", "matrices", "mpi"
+};
 
 
 
@@ -31,10 +78,348 @@ int splatt_version_subminor(void)
 }
 
 
+void splatt_mem_query(
+    splatt_mem_usage * const usage)
+{
+  #pragma omp critical(splatt_mem)
+  {
+    *usage = mem_usage;
+  }
+  usage->huge_backed = mem_huge_backed();
+}
+
+
+void splatt_mem_set_hugepages(
+    splatt_hugepage_type const policy,
+    uint64_t const min_bytes)
+{
+  #pragma omp critical(splatt_mem)
+  {
+    mem_huge_policy = policy;
+    mem_huge_min = (size_t) min_bytes;
+  }
+}
+
+
+void splatt_mem_reset_peak(void)
+{
+  #pragma omp critical(splatt_mem)
+  {
+    for(int t=0; t < SPLATT_MEM_NTAGS; ++t) {
+      mem_usage.peak[t] = mem_usage.live[t];
+    }
+    mem_usage.total_peak = mem_usage.total_live;
+  }
+}
+
+
+char const * splatt_mem_tag_name(
+    splatt_mem_tag const tag)
+{
+  if(tag < 0 || tag >= SPLATT_MEM_NTAGS) {
+    return "unknown";
+  }
+  return mem_tag_names[tag];
+}
+
+
 
 
 
 
+/******************************************************************************
+ * PRIVATE FUNCTIONS
+ *****************************************************************************/
+
+static inline size_t p_mem_hash(
+    uintptr_t const ptr)
+{
+  /* allocations are 64-byte aligned, so the low bits carry no information */
+  return (size_t) (((uint64_t) (ptr >> 6)) * 0x9e3779b97f4a7c15ULL);
+}
+
+
+/**
+* @brief Return the slot of 'ptr', or the empty slot where it would go.
+*/
+static size_t p_mem_find(
+    uintptr_t const ptr)
+{
+  size_t const mask = mem_table_size - 1;
+  size_t slot = p_mem_hash(ptr) & mask;
+  while(mem_table[slot].ptr != 0 && mem_table[slot].ptr != ptr) {
+    slot = (slot + 1) & mask;
+  }
+  return slot;
+}
+
+
+/**
+* @brief Double the size of the table (or create it), keeping the load factor
+*        at most one half.
+*
+* @return Whether the table was resized. On failure the old table is kept.
+*/
+static bool p_mem_grow(void)
+{
+  size_t const newsize = (mem_table_size == 0) ? 1024 : 2 * mem_table_size;
+  mem_entry * newtable = calloc(newsize, sizeof(*newtable));
+  if(newtable == NULL) {
+    return false;
+  }
+
+  mem_entry * const old = mem_table;
+  size_t const oldsize = mem_table_size;
+  mem_table = newtable;
+  mem_table_size = newsize;
+  for(size_t i=0; i < oldsize; ++i) {
+    if(old[i].ptr != 0) {
+      mem_table[p_mem_find(old[i].ptr)] = old[i];
+    }
+  }
+  free(old);
+  return true;
+}
+
+
+static void p_mem_charge(
+    splatt_mem_tag const tag,
+    uint64_t const bytes)
+{
+  mem_usage.live[tag] += bytes;
+  mem_usage.total_live += bytes;
+  mem_usage.peak[tag] = SS_MAX(mem_usage.peak[tag], mem_usage.live[tag]);
+  mem_usage.total_peak = SS_MAX(mem_usage.total_peak, mem_usage.total_live);
+}
+
+
+static void p_mem_release(
+    splatt_mem_tag const tag,
+    uint64_t const bytes)
+{
+  mem_usage.live[tag] -= bytes;
+  mem_usage.total_live -= bytes;
+}
+
+
+/**
+* @brief Remove the entry in 'slot', shifting back any entries of the same
+*        probe sequence so that lookups never stop early.
+*/
+static void p_mem_remove(
+    size_t slot)
+{
+  size_t const mask = mem_table_size - 1;
+  size_t next = (slot + 1) & mask;
+  while(mem_table[next].ptr != 0) {
+    size_t const home = p_mem_hash(mem_table[next].ptr) & mask;
+    /* can the entry in 'next' move back to 'slot'? */
+    if(((next - home) & mask) >= ((next - slot) & mask)) {
+      mem_table[slot] = mem_table[next];
+      slot = next;
+    }
+    next = (next + 1) & mask;
+  }
+  mem_table[slot].ptr = 0;
+  --mem_table_count;
+}
+
+
+/**
+* @brief Record a new allocation.
+*
+* @param ptr The allocation.
+* @param bytes The bytes requested.
+* @param huge How the allocation was mapped.
+* @param map_bytes The length of the mapping, if 'huge' is not
+*                  SPLATT_HUGEPAGE_OFF.
+*
+* @return Whether the allocation is tracked. Untracked allocations cannot be
+*         told apart from posix_memalign() memory when they are freed.
+*/
+static bool p_mem_track(
+    void const * const ptr,
+    uint64_t const bytes,
+    splatt_hugepage_type const huge,
+    uint64_t const map_bytes)
+{
+  bool tracked = false;
+  #pragma omp critical(splatt_mem)
+  {
+    if(2 * (mem_table_count + 1) <= mem_table_size || p_mem_grow()) {
+      size_t const slot = p_mem_find((uintptr_t) ptr);
+      /* a stale entry can be left by memory given to realloc() */
+      if(mem_table[slot].ptr != 0) {
+        p_mem_release(mem_table[slot].tag, mem_table[slot].bytes);
+      } else {
+        ++mem_table_count;
+      }
+      mem_table[slot].ptr = (uintptr_t) ptr;
+      mem_table[slot].bytes = bytes;
+      mem_table[slot].tag = mem_cur_tag;
+      mem_table[slot].huge = huge;
+      mem_table[slot].map_bytes = map_bytes;
+      p_mem_charge(mem_cur_tag, bytes);
+      ++mem_usage.nallocs[mem_cur_tag];
+      if(huge != SPLATT_HUGEPAGE_OFF) {
+        mem_usage.huge_mapped += map_bytes;
+      }
+      if(huge == SPLATT_HUGEPAGE_HUGETLB) {
+        mem_hugetlb_live += map_bytes;
+      }
+      tracked = true;
+    }
+  }
+  return tracked;
+}
+
+
+/**
+* @brief Forget an allocation.
+*
+* @param ptr The allocation.
+* @param[out] huge How the allocation was mapped.
+* @param[out] map_bytes The length of its mapping if it was mapped for huge
+*                       pages, and 0 otherwise.
+*/
+static void p_mem_untrack(
+    void const * const ptr,
+    splatt_hugepage_type * const huge,
+    uint64_t * const map_bytes)
+{
+  *huge = SPLATT_HUGEPAGE_OFF;
+  *map_bytes = 0;
+  #pragma omp critical(splatt_mem)
+  {
+    if(mem_table_size > 0) {
+      size_t const slot = p_mem_find((uintptr_t) ptr);
+      if(mem_table[slot].ptr != 0) {
+        p_mem_release(mem_table[slot].tag, mem_table[slot].bytes);
+        *huge = mem_table[slot].huge;
+        if(*huge != SPLATT_HUGEPAGE_OFF) {
+          *map_bytes = mem_table[slot].map_bytes;
+        }
+        if(*huge == SPLATT_HUGEPAGE_HUGETLB) {
+          mem_hugetlb_live -= mem_table[slot].map_bytes;
+          mem_huge_freed_backed += mem_table[slot].map_bytes;
+        }
+        p_mem_remove(slot);
+      }
+    }
+  }
+}
+
+
+#ifdef SPLATT_USE_HUGEPAGES
+
+/**
+* @brief Map memory for a large allocation and ask for it to be backed by
+*        huge pages, according to the current policy.
+*
+* @param bytes The bytes requested.
+*
+* @return The allocation, or NULL if no mapping could be made and the caller
+*         should fall back to regular pages.
+*/
+static void * p_huge_alloc(
+    size_t const bytes)
+{
+  size_t const len = (bytes + MEM_HUGE_BYTES - 1) & ~(MEM_HUGE_BYTES - 1);
+  splatt_hugepage_type huge = mem_huge_policy;
+  void * ptr = NULL;
+
+  if(huge == SPLATT_HUGEPAGE_HUGETLB) {
+    ptr = mmap(NULL, len, PROT_READ | PROT_WRITE,
+        MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if(ptr == MAP_FAILED) {
+      /* the pool is empty or not configured */
+      ptr = NULL;
+      huge = SPLATT_HUGEPAGE_THP;
+      #pragma omp critical(splatt_mem)
+      ++mem_usage.huge_fallbacks;
+    }
+  }
+
+  if(ptr == NULL) {
+    /* over-allocate so that the region can be trimmed to a huge boundary */
+    char * const raw = mmap(NULL, len + MEM_HUGE_BYTES, PROT_READ | PROT_WRITE,
+        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if(raw == MAP_FAILED) {
+      #pragma omp critical(splatt_mem)
+      ++mem_usage.huge_fallbacks;
+      return NULL;
+    }
+    uintptr_t const aligned = ((uintptr_t) raw + MEM_HUGE_BYTES - 1) &
+        ~(MEM_HUGE_BYTES - 1);
+    size_t const head = aligned - (uintptr_t) raw;
+    if(head > 0) {
+      munmap(raw, head);
+    }
+    if(MEM_HUGE_BYTES - head > 0) {
+      munmap((char *) aligned + len, MEM_HUGE_BYTES - head);
+    }
+    ptr = (void *) aligned;
+
+    /* THP may be disabled, which only shows up in huge_backed */
+    madvise(ptr, len, MADV_HUGEPAGE);
+  }
+
+  if(!p_mem_track(ptr, bytes, huge, len)) {
+    munmap(ptr, len);
+    return NULL;
+  }
+  return ptr;
+}
+
+
+/**
+* @brief Sum the transparent huge pages of the mappings which hold 'nranges'
+*        huge allocations, as reported by /proc/self/smaps.
+*
+* @param starts The first byte of each allocation.
+* @param ends One past the last byte of each allocation.
+* @param nranges The number of allocations.
+*
+* @return The bytes backed by transparent huge pages.
+*/
+static uint64_t p_thp_backed(
+    uintptr_t const * const starts,
+    uintptr_t const * const ends,
+    size_t const nranges)
+{
+  FILE * fin = fopen("/proc/self/smaps", "r");
+  if(fin == NULL) {
+    return 0;
+  }
+
+  uint64_t backed = 0;
+  bool ours = false;
+  char line[512];
+  while(fgets(line, sizeof(line), fin) != NULL) {
+    unsigned long lo;
+    unsigned long hi;
+    unsigned long kb;
+    /* each mapping starts with its address range */
+    if(sscanf(line, "%lx-%lx ", &lo, &hi) == 2) {
+      ours = false;
+      for(size_t r=0; r < nranges; ++r) {
+        if(starts[r] < hi && ends[r] > lo) {
+          ours = true;
+          break;
+        }
+      }
+    } else if(ours && sscanf(line, "AnonHugePages: %lu kB", &kb) == 1) {
+      backed += (uint64_t) kb * 1024;
+    }
+  }
+  fclose(fin);
+  return backed;
+}
+
+#endif
+
+
+
 /******************************************************************************
  * PUBLIC FUNCTIONS
  *****************************************************************************/
@@ -43,6 +428,19 @@ void * splatt_malloc(
     size_t const bytes)
 {
   void * ptr;
+
+  if(mem_huge_policy != SPLATT_HUGEPAGE_OFF && bytes >= mem_huge_min) {
+#ifdef SPLATT_USE_HUGEPAGES
+    ptr = p_huge_alloc(bytes);
+    if(ptr != NULL) {
+      return ptr;
+    }
+#else
+    #pragma omp critical(splatt_mem)
+    ++mem_usage.huge_fallbacks;
+#endif
+  }
+
   int const success = posix_memalign(&ptr, 64, bytes);
 
   if(success != 0) {
@@ -61,6 +459,8 @@ void * splatt_malloc(
     }
 
     ptr = NULL;
+  } else {
+    p_mem_track(ptr, bytes, SPLATT_HUGEPAGE_OFF, 0);
   }
 
   return ptr;
@@ -70,7 +470,128 @@ void * splatt_malloc(
 void splatt_free(
     void * ptr)
 {
+  if(ptr == NULL) {
+    return;
+  }
+
+  splatt_hugepage_type huge;
+  uint64_t map_bytes;
+  p_mem_untrack(ptr, &huge, &map_bytes);
+#ifdef SPLATT_USE_HUGEPAGES
+  if(map_bytes > 0) {
+    /* the pages are as touched as they will ever be */
+    if(huge == SPLATT_HUGEPAGE_THP) {
+      uintptr_t const start = (uintptr_t) ptr;
+      uintptr_t const end = start + map_bytes;
+      uint64_t const backed = p_thp_backed(&start, &end, 1);
+      #pragma omp critical(splatt_mem)
+      mem_huge_freed_backed += backed;
+    }
+    munmap(ptr, map_bytes);
+    return;
+  }
+#endif
   free(ptr);
 }
 
 
+splatt_mem_tag mem_tag_begin(
+    splatt_mem_tag const tag)
+{
+  splatt_mem_tag const prev = mem_cur_tag;
+  mem_cur_tag = tag;
+  return prev;
+}
+
+
+void mem_tag_end(
+    splatt_mem_tag const prev)
+{
+  mem_cur_tag = prev;
+}
+
+
+splatt_mem_tag mem_tag_of(
+    void const * const ptr)
+{
+  splatt_mem_tag tag = SPLATT_MEM_OTHER;
+  #pragma omp critical(splatt_mem)
+  {
+    if(mem_table_size > 0 && ptr != NULL) {
+      size_t const slot = p_mem_find((uintptr_t) ptr);
+      if(mem_table[slot].ptr != 0) {
+        tag = mem_table[slot].tag;
+      }
+    }
+  }
+  return tag;
+}
+
+
+size_t mem_bytes_of(
+    void const * const ptr)
+{
+  size_t bytes = 0;
+  #pragma omp critical(splatt_mem)
+  {
+    if(mem_table_size > 0 && ptr != NULL) {
+      size_t const slot = p_mem_find((uintptr_t) ptr);
+      if(mem_table[slot].ptr != 0) {
+        bytes = mem_table[slot].bytes;
+      }
+    }
+  }
+  return bytes;
+}
+
+
+void mem_retag(
+    void const * const ptr,
+    splatt_mem_tag const tag)
+{
+  #pragma omp critical(splatt_mem)
+  {
+    if(mem_table_size > 0 && ptr != NULL) {
+      size_t const slot = p_mem_find((uintptr_t) ptr);
+      if(mem_table[slot].ptr != 0) {
+        p_mem_release(mem_table[slot].tag, mem_table[slot].bytes);
+        mem_table[slot].tag = tag;
+        p_mem_charge(tag, mem_table[slot].bytes);
+      }
+    }
+  }
+}
+
+
+uint64_t mem_huge_backed(void)
+{
+  uint64_t backed = 0;
+#ifdef SPLATT_USE_HUGEPAGES
+  /* copy the transparent huge page ranges, then read smaps unlocked */
+  uintptr_t * starts = NULL;
+  uintptr_t * ends = NULL;
+  size_t nranges = 0;
+  #pragma omp critical(splatt_mem)
+  {
+    backed = mem_huge_freed_backed + mem_hugetlb_live;
+    if(mem_usage.huge_mapped > 0) {
+      starts = malloc(mem_table_count * sizeof(*starts));
+      ends = malloc(mem_table_count * sizeof(*ends));
+      for(size_t s=0; s < mem_table_size && starts != NULL && ends != NULL;
+          ++s) {
+        if(mem_table[s].ptr != 0 && mem_table[s].huge == SPLATT_HUGEPAGE_THP) {
+          starts[nranges] = mem_table[s].ptr;
+          ends[nranges] = mem_table[s].ptr + mem_table[s].map_bytes;
+          ++nranges;
+        }
+      }
+    }
+  }
+  if(nranges > 0) {
+    backed += p_thp_backed(starts, ends, nranges);
+  }
+  free(starts);
+  free(ends);
+#endif
+  return backed;
+}
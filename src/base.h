@@ -37,6 +37,7 @@ static double const DEFAULT_TOL = 1e-5;
 static idx_t const DEFAULT_NFACTORS = 10;
 static idx_t const DEFAULT_ITS = 50;
 static idx_t const DEFAULT_MPI_DISTRIBUTION = MAX_NMODES+1;
+static idx_t const AUTO_MPI_DISTRIBUTION = MAX_NMODES+2;
 
 #define SPLATT_MPI_FINE (MAX_NMODES + 1)
 
@@ -69,4 +70,82 @@ void splatt_free(
     void * ptr);
 
 
+
+/******************************************************************************
+ * MEMORY ACCOUNTING
+ *****************************************************************************/
+
+/*
+ * Every splatt_malloc() is charged to the subsystem which is current at the
+ * time of the allocation, and is released from it by splatt_free(). Memory
+ * from splatt_malloc() must therefore be released with splatt_free() and not
+ * free(). Subsystems are switched from serial code, and allocations made by
+ * threads inside a parallel region are charged to the subsystem which was
+ * current when the region began.
+ */
+
+#define mem_tag_begin splatt_mem_tag_begin
+/**
+* @brief Charge subsequent allocations to subsystem 'tag'.
+*
+* @param tag The subsystem which now owns allocations.
+*
+* @return The previous subsystem, to be passed to mem_tag_end().
+*/
+splatt_mem_tag mem_tag_begin(
+    splatt_mem_tag const tag);
+
+
+#define mem_tag_end splatt_mem_tag_end
+/**
+* @brief Restore the subsystem which was current before mem_tag_begin().
+*
+* @param prev The value returned by mem_tag_begin().
+*/
+void mem_tag_end(
+    splatt_mem_tag const prev);
+
+
+#define mem_tag_of splatt_mem_tag_of
+/**
+* @brief Return the subsystem which owns the allocation 'ptr', or
+*        SPLATT_MEM_OTHER if 'ptr' was not allocated by splatt_malloc().
+*/
+splatt_mem_tag mem_tag_of(
+    void const * const ptr);
+
+
+#define mem_bytes_of splatt_mem_bytes_of
+/**
+* @brief Return the size of the allocation 'ptr', or 0 if 'ptr' was not
+*        allocated by splatt_malloc().
+*/
+size_t mem_bytes_of(
+    void const * const ptr);
+
+
+#define mem_huge_backed splatt_mem_huge_backed
+/**
+* @brief Return how many bytes of the allocations which asked for huge pages
+*        were backed by them, counting freed allocations as they were when
+*        freed. Transparent huge pages are read from /proc/self/smaps, so
+*        this is not cheap.
+*/
+uint64_t mem_huge_backed(void);
+
+
+#define mem_retag splatt_mem_retag
+/**
+* @brief Move the allocation 'ptr' to another subsystem. This is used when a
+*        temporary buffer is swapped in to become part of a longer-lived
+*        structure.
+*
+* @param ptr An allocation from splatt_malloc().
+* @param tag The subsystem which now owns 'ptr'.
+*/
+void mem_retag(
+    void const * const ptr,
+    splatt_mem_tag const tag);
+
+
 #endif
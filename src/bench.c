@@ -14,6 +14,106 @@
 #include "tile.h"
 #include "stats.h"
 #include "util.h"
+#include "csf.h"
+#include "metrics.h"
+#include "model.h"
+#include "mutex_pool.h"
+
+#include <math.h>
+
+
+/******************************************************************************
+ * PRIVATE STRUCTURES
+ *****************************************************************************/
+
+/* STREAM triad array length and repetitions (best is reported) */
+#define BENCH_STREAM_LEN (1 << 23)
+#define BENCH_STREAM_REPS 5
+
+/* rank, rows, and passes of the flop-rate calibration, which stays in L1 */
+#define BENCH_FLOP_RANK 16
+#define BENCH_FLOP_ROWS 64
+#define BENCH_FLOP_REPS (1 << 16)
+
+/* lock and unlock pairs of the lock calibration */
+#define BENCH_LOCK_REPS (1 << 22)
+
+/******************************************************************************
+ * PRIVATE FUNCTIONS
+ *****************************************************************************/
+
+/**
+* @brief Model an MTTKRP over a coordinate tensor. Every nonzero reads its
+*        indices, value, and (nmodes-1) factor rows, and read-modify-writes
+*        one output row. This is also used for the GigaTensor and Tensor
+*        Toolbox kernels, which traverse the same coordinate data.
+*/
+static model_cost p_model_coord(
+  sptensor_t const * const tt,
+  idx_t const nfactors)
+{
+  double const nnz = (double) tt->nnz;
+  double const F = (double) nfactors;
+  idx_t const nmodes = tt->nmodes;
+
+  model_cost model;
+  model.flops = nnz * F * nmodes;
+  model.bytes = nnz * (nmodes * sizeof(idx_t) + sizeof(val_t));
+  model.bytes += nnz * (nmodes - 1) * F * sizeof(val_t);
+  model.bytes += 2. * nnz * F * sizeof(val_t);
+  return model;
+}
+
+
+/**
+* @brief Print the per-mode model along with the roofline bound it implies.
+*/
+static void p_print_models(
+  model_cost const * const models,
+  idx_t const nmodes,
+  double const peak_bw)
+{
+  printf("MTTKRP-MODEL:\n");
+  for(idx_t m=0; m < nmodes; ++m) {
+    double const ai = models[m].flops / models[m].bytes;
+    printf("  mode %"SPLATT_PF_IDX" %0.3f GFLOP  %0.3f GB  AI=%0.3f FLOP/B",
+        m+1, models[m].flops / 1e9, models[m].bytes / 1e9, ai);
+    if(peak_bw > 0.) {
+      printf("  bound=%0.2f GFLOP/s", ai * peak_bw);
+    }
+    printf("\n");
+  }
+  printf("\n");
+}
+
+
+/**
+* @brief Print and record the time of one mode, with the achieved rates if a
+*        model is available. Iterations are numbered across thread counts.
+*/
+static void p_print_mode(
+  char const * const alg,
+  idx_t const iteration,
+  idx_t const mode,
+  double const seconds,
+  model_cost const * const model,
+  double const peak_bw)
+{
+  printf("  mode %" SPLATT_PF_IDX " %0.3fs", mode+1, seconds);
+  metrics_record(alg, "seconds", iteration, mode, -1, seconds);
+  if(model != NULL && seconds > 0.) {
+    double const gbs = model->bytes / seconds / 1e9;
+    double const gflops = model->flops / seconds / 1e9;
+    printf("  %0.2f GFLOP/s  %0.2f GB/s", gflops, gbs);
+    metrics_record(alg, "gflops", iteration, mode, -1, gflops);
+    metrics_record(alg, "gbps", iteration, mode, -1, gbs);
+    if(peak_bw > 0.) {
+      printf(" (%0.1f%% of STREAM)", 100. * gbs / peak_bw);
+    }
+  }
+  printf("\n");
+}
+
 
 static void p_log_mat(
   char const * const ofname,
@@ -43,10 +143,206 @@ static void p_shuffle_mats(
   }
 }
 
+static char const * const csf_names[] = {
+  [SPLATT_CSF_ONEMODE] = "one",
+  [SPLATT_CSF_TWOMODE] = "two",
+  [SPLATT_CSF_ALLMODE] = "all",
+};
+
+static char const * const tile_names[] = {
+  [SPLATT_NOTILE]    = "none",
+  [SPLATT_DENSETILE] = "dense",
+};
+
+
+/**
+* @brief Look up 'name' in a table of names, returning its index or -1.
+*/
+static int p_find_name(
+  char const * const name,
+  char const * const * const names,
+  int const nnames)
+{
+  for(int i=0; i < nnames; ++i) {
+    if(names[i] != NULL && strcmp(name, names[i]) == 0) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+
+static int p_cmp_dbl(
+  void const * a,
+  void const * b)
+{
+  double const x = *((double const *) a);
+  double const y = *((double const *) b);
+  return (x > y) - (x < y);
+}
+
+
+/**
+* @brief Return quantile 'q' of a sorted list, interpolating between samples.
+*/
+static double p_quantile(
+  double const * const sorted,
+  idx_t const n,
+  double const q)
+{
+  double const pos = q * (double) (n - 1);
+  idx_t const lo = (idx_t) pos;
+  idx_t const hi = SS_MIN(lo + 1, n - 1);
+  return sorted[lo] + ((pos - (double) lo) * (sorted[hi] - sorted[lo]));
+}
+
+
+static bool p_same_config(
+  bench_config const * const a,
+  bench_config const * const b)
+{
+  return a->csf == b->csf && a->tile == b->tile &&
+      a->tilelevel == b->tilelevel && a->rank == b->rank &&
+      a->nthreads == b->nthreads &&
+      fabs(a->privthresh - b->privthresh) <= 1e-9;
+}
+
+
+static void p_print_config(
+  bench_config const * const config)
+{
+  printf("  csf=%-3s tile=%-5s lvl=%"SPLATT_PF_IDX" priv=%-6g rank=%-4"
+      SPLATT_PF_IDX" thds=%-3"SPLATT_PF_IDX,
+      csf_names[config->csf], tile_names[config->tile], config->tilelevel,
+      config->privthresh, config->rank, config->nthreads);
+}
+
+
 
 /******************************************************************************
  * PUBLIC FUNCTIONS
  *****************************************************************************/
+double bench_stream(
+  idx_t const nthreads)
+{
+  idx_t const N = BENCH_STREAM_LEN;
+  double * const a = splatt_malloc(N * sizeof(*a));
+  double * const b = splatt_malloc(N * sizeof(*b));
+  double * const c = splatt_malloc(N * sizeof(*c));
+
+  splatt_omp_set_num_threads(nthreads);
+
+  /* first-touch with the same schedule as the triad */
+  #pragma omp parallel for schedule(static)
+  for(idx_t i=0; i < N; ++i) {
+    a[i] = 0.;
+    b[i] = 1.;
+    c[i] = 2.;
+  }
+
+  double const scalar = 3.;
+  double best = 0.;
+  sp_timer_t triad;
+  for(idx_t r=0; r < BENCH_STREAM_REPS; ++r) {
+    timer_fstart(&triad);
+    #pragma omp parallel for schedule(static)
+    for(idx_t i=0; i < N; ++i) {
+      a[i] = b[i] + scalar * c[i];
+    }
+    timer_stop(&triad);
+
+    /* STREAM convention: two reads and one write, no write-allocate */
+    double const bw = 3. * N * sizeof(*a) / triad.seconds;
+    best = SS_MAX(best, bw);
+  }
+
+  splatt_free(a);
+  splatt_free(b);
+  splatt_free(c);
+
+  return best / 1e9;
+}
+
+
+void bench_summarize(
+  double * const times,
+  idx_t const ntimes,
+  double * const median,
+  double * const q1,
+  double * const q3)
+{
+  if(ntimes == 0) {
+    *median = *q1 = *q3 = 0.;
+    return;
+  }
+  qsort(times, ntimes, sizeof(*times), p_cmp_dbl);
+  *median = p_quantile(times, ntimes, 0.5);
+  *q1 = p_quantile(times, ntimes, 0.25);
+  *q3 = p_quantile(times, ntimes, 0.75);
+}
+
+
+void bench_machine(
+  idx_t const nthreads,
+  double const stream_bw,
+  model_machine * const machine)
+{
+  model_default_machine(machine);
+  if(stream_bw > 0.) {
+    machine->bandwidth = stream_bw;
+    machine->thread_bw = (nthreads > 1) ? bench_stream(1) : stream_bw;
+  }
+
+  splatt_omp_set_num_threads(1);
+  sp_timer_t timer;
+
+  /* scale-and-accumulate of cache-resident rows, the inner loop of MTTKRP */
+  idx_t const F = BENCH_FLOP_RANK;
+  val_t * const rows = splatt_malloc(BENCH_FLOP_ROWS * F * sizeof(*rows));
+  val_t acc[BENCH_FLOP_RANK];
+  for(idx_t i=0; i < BENCH_FLOP_ROWS * F; ++i) {
+    rows[i] = 1. / (val_t) (i + 1);
+  }
+  for(idx_t f=0; f < F; ++f) {
+    acc[f] = 0.;
+  }
+  timer_fstart(&timer);
+  for(idx_t r=0; r < BENCH_FLOP_REPS; ++r) {
+    val_t const scale = 1. / (val_t) (r + 1);
+    for(idx_t i=0; i < BENCH_FLOP_ROWS; ++i) {
+      val_t const * const restrict row = rows + (i * F);
+      for(idx_t f=0; f < F; ++f) {
+        acc[f] += scale * row[f];
+      }
+    }
+  }
+  timer_stop(&timer);
+  double const flops = 2. * BENCH_FLOP_REPS * BENCH_FLOP_ROWS * F;
+  machine->gflops = flops / timer.seconds / 1e9;
+
+  /* keep the accumulation from being optimized away */
+  val_t sum = 0.;
+  for(idx_t f=0; f < F; ++f) {
+    sum += acc[f];
+  }
+  if(sum < 0.) {
+    printf("%f\n", sum);
+  }
+  splatt_free(rows);
+
+  /* uncontended locks over the pool, as in the locked MTTKRP kernels */
+  mutex_pool * pool = mutex_alloc();
+  timer_fstart(&timer);
+  for(idx_t i=0; i < BENCH_LOCK_REPS; ++i) {
+    mutex_set_lock(pool, (int) i);
+    mutex_unset_lock(pool, (int) i);
+  }
+  timer_stop(&timer);
+  machine->lock_ns = timer.seconds * 1e9 / BENCH_LOCK_REPS;
+  mutex_free(pool);
+}
+
+
 void bench_splatt(
   sptensor_t * const tt,
   matrix_t ** mats,
@@ -80,6 +376,16 @@ void bench_splatt(
   printf("SPLATT-STORAGE: %s\n\n", bstr);
   free(bstr);
 
+  /* analytic cost of each mode; the output is always the root */
+  model_cost models[MAX_NMODES];
+  for(idx_t m=0; m < tt->nmodes; ++m) {
+    idx_t const nfibs[3] = {ft[m].nslcs, ft[m].nfibs, ft[m].nnz};
+    models[m].flops = 0.;
+    models[m].bytes = 0.;
+    model_tree(nfibs, 3, 0, mats[0]->J, models + m);
+  }
+  p_print_models(models, tt->nmodes, opts->stream_bw);
+
   timer_start(&timers[TIMER_SPLATT]);
 
   /* for each # threads */
@@ -97,7 +403,8 @@ void bench_splatt(
         timer_fstart(&modetime);
         mttkrp_splatt(ft + m, mats, m, thds, nthreads);
         timer_stop(&modetime);
-        printf("  mode %" SPLATT_PF_IDX " %0.3fs\n", m+1, modetime.seconds);
+        p_print_mode("bench-splatt", (t * niters) + i, m, modetime.seconds,
+            models + m, opts->stream_bw);
         if(opts->write && t == 0 && i == 0) {
           idx_t oldI = mats[MAX_NMODES]->I;
           mats[MAX_NMODES]->I = tt->dims[m];
@@ -169,6 +476,19 @@ void bench_csf(
   stats_csf(cs);
   printf("\n");
 
+  /* analytic cost of each mode, summed over tiles */
+  model_cost models[MAX_NMODES];
+  for(idx_t m=0; m < tt->nmodes; ++m) {
+    idx_t const outdepth = csf_mode_to_depth(cs, m);
+    models[m].flops = 0.;
+    models[m].bytes = 0.;
+    for(idx_t tile=0; tile < cs->ntiles; ++tile) {
+      model_tree(cs->pt[tile].nfibs, cs->nmodes, outdepth, nfactors,
+          models + m);
+    }
+  }
+  p_print_models(models, tt->nmodes, opts->stream_bw);
+
   timer_start(&timers[TIMER_MISC]);
 
   /* for each # threads */
@@ -190,7 +510,8 @@ void bench_csf(
         timer_fstart(&modetime);
         mttkrp_csf(cs, mats, m, thds, ws, cpd_opts);
         timer_stop(&modetime);
-        printf("  mode %" SPLATT_PF_IDX " %0.3fs\n", m+1, modetime.seconds);
+        p_print_mode("bench-csf", (t * niters) + i, m, modetime.seconds,
+            models + m, opts->stream_bw);
         if(opts->write && t == nruns-1 && i == 0) {
           idx_t oldI = mats[MAX_NMODES]->I;
           mats[MAX_NMODES]->I = tt->dims[m];
@@ -217,7 +538,7 @@ void bench_csf(
   /* clean up */
   csf_free(cs, cpd_opts);
   thd_free(thds, threads[nruns-1]);
-  free(cpd_opts);
+  splatt_free(cpd_opts);
 
   /* fix any matrices that we shuffled */
   p_shuffle_mats(mats, opts->perm->iperms, tt->nmodes);
@@ -251,6 +572,12 @@ void bench_giga(
   }
   colmats[MAX_NMODES] = mat_mkcol(mats[MAX_NMODES]);
 
+  model_cost models[MAX_NMODES];
+  for(idx_t m=0; m < tt->nmodes; ++m) {
+    models[m] = p_model_coord(tt, mats[0]->J);
+  }
+  p_print_models(models, tt->nmodes, opts->stream_bw);
+
   timer_start(&timers[TIMER_GIGA]);
   for(idx_t t=0; t < nruns; ++t) {
     idx_t const nthreads = threads[t];
@@ -265,7 +592,8 @@ void bench_giga(
         timer_fstart(&modetime);
         mttkrp_giga(unfolds[m], colmats, m, scratch);
         timer_stop(&modetime);
-        printf("  mode %"SPLATT_PF_IDX" %0.3fs\n", m+1, modetime.seconds);
+        p_print_mode("bench-giga", (t * niters) + i, m, modetime.seconds,
+            models + m, opts->stream_bw);
         if(opts->write && t == 0 && i == 0) {
           colmats[MAX_NMODES]->I = tt->dims[m];
           sprintf(matname, "giga_mode%"SPLATT_PF_IDX".mat", m+1);
@@ -291,7 +619,7 @@ void bench_giga(
     mat_free(colmats[m]);
   }
   mat_free(colmats[MAX_NMODES]);
-  free(scratch);
+  splatt_free(scratch);
 
   /* fix any matrices that we shuffled */
   p_shuffle_mats(mats, opts->perm->iperms, tt->nmodes);
@@ -321,6 +649,12 @@ void bench_coord(
   printf("COORD-STORAGE: %s\n\n", bstr);
   free(bstr);
 
+  model_cost models[MAX_NMODES];
+  for(idx_t m=0; m < tt->nmodes; ++m) {
+    models[m] = p_model_coord(tt, nfactors);
+  }
+  p_print_models(models, tt->nmodes, opts->stream_bw);
+
   timer_start(&timers[TIMER_MISC]);
 
   /* for each # threads */
@@ -338,7 +672,8 @@ void bench_coord(
         timer_fstart(&modetime);
         mttkrp_stream(tt, mats, m);
         timer_stop(&modetime);
-        printf("  mode %" SPLATT_PF_IDX " %0.3fs\n", m+1, modetime.seconds);
+        p_print_mode("bench-coord", (t * niters) + i, m, modetime.seconds,
+            models + m, opts->stream_bw);
         if(opts->write && t == 0 && i == 0) {
           idx_t oldI = mats[MAX_NMODES]->I;
           mats[MAX_NMODES]->I = tt->dims[m];
@@ -387,6 +722,12 @@ void bench_ttbox(
   printf("** TTBOX **\n");
   val_t * scratch = (val_t *) splatt_malloc(tt->nnz * sizeof(val_t));
 
+  model_cost models[MAX_NMODES];
+  for(idx_t m=0; m < tt->nmodes; ++m) {
+    models[m] = p_model_coord(tt, mats[0]->J);
+  }
+  p_print_models(models, tt->nmodes, opts->stream_bw);
+
   timer_start(&timers[TIMER_TTBOX]);
   for(idx_t t=0; t < nruns; ++t) {
     idx_t const nthreads = threads[t];
@@ -401,7 +742,8 @@ void bench_ttbox(
         timer_fstart(&modetime);
         mttkrp_ttbox(tt, colmats, m, scratch);
         timer_stop(&modetime);
-        printf("  mode %"SPLATT_PF_IDX" %0.3fs\n", m+1, modetime.seconds);
+        p_print_mode("bench-ttbox", (t * niters) + i, m, modetime.seconds,
+            models + m, opts->stream_bw);
         if(opts->write && t == 0 && i == 0) {
           colmats[MAX_NMODES]->I = tt->dims[m];
           sprintf(matname, "ttbox_mode%"SPLATT_PF_IDX".mat", m+1);
@@ -423,7 +765,7 @@ void bench_ttbox(
   timer_stop(&timers[TIMER_TTBOX]);
 
   thd_free(thds, threads[nruns-1]);
-  free(scratch);
+  splatt_free(scratch);
   for(idx_t m=0; m < tt->nmodes; ++m) {
     mat_free(colmats[m]);
   }
@@ -434,3 +776,264 @@ void bench_ttbox(
 }
 
 
+void bench_matrix(
+  sptensor_t * const tt,
+  bench_config const * const configs,
+  idx_t const nconfigs,
+  idx_t const warmup,
+  idx_t const trials,
+  model_machine const * const machine,
+  bench_result * const results)
+{
+  idx_t const nmodes = tt->nmodes;
+
+  idx_t maxthreads = 1;
+  idx_t maxrank = 1;
+  for(idx_t c=0; c < nconfigs; ++c) {
+    maxthreads = SS_MAX(maxthreads, configs[c].nthreads);
+    maxrank = SS_MAX(maxrank, configs[c].rank);
+  }
+
+  /* add 64 bytes to avoid false sharing */
+  thd_info * thds = thd_init(maxthreads, 3,
+    (maxrank * maxrank * sizeof(val_t)) + 64,
+    TILE_SIZES[0] * maxrank * sizeof(val_t) + 64,
+    (nmodes * maxrank * sizeof(val_t)) + 64);
+
+  idx_t maxdim = 0;
+  for(idx_t m=0; m < nmodes; ++m) {
+    maxdim = SS_MAX(maxdim, tt->dims[m]);
+  }
+
+  double * const times = splatt_malloc(SS_MAX(trials, 1) * sizeof(*times));
+  double * cpd_opts = splatt_default_opts();
+  splatt_csf * cs = NULL;
+  matrix_t * mats[MAX_NMODES+1];
+  idx_t matrank = 0;
+
+  printf("** CSF MATRIX **\n");
+  printf("WARMUP=%"SPLATT_PF_IDX" TRIALS=%"SPLATT_PF_IDX"\n", warmup, trials);
+
+  timer_start(&timers[TIMER_MISC]);
+  for(idx_t c=0; c < nconfigs; ++c) {
+    bench_config const * const config = configs + c;
+
+    /* rebuild the CSF only when its structure changes */
+    bench_config const * const prev = (c > 0) ? configs + c - 1 : NULL;
+    if(prev == NULL || prev->csf != config->csf || prev->tile != config->tile
+        || prev->tilelevel != config->tilelevel) {
+      if(cs != NULL) {
+        csf_free(cs, cpd_opts);
+      }
+      cpd_opts[SPLATT_OPTION_CSF_ALLOC] = config->csf;
+      cpd_opts[SPLATT_OPTION_TILE] = config->tile;
+      cpd_opts[SPLATT_OPTION_TILELEVEL] = SS_MAX(config->tilelevel, 1);
+      cs = csf_alloc(tt, cpd_opts);
+    }
+
+    if(config->rank != matrank) {
+      if(matrank > 0) {
+        for(idx_t m=0; m < nmodes; ++m) {
+          mat_free(mats[m]);
+        }
+        mat_free(mats[MAX_NMODES]);
+      }
+      for(idx_t m=0; m < nmodes; ++m) {
+        mats[m] = mat_rand(tt->dims[m], config->rank);
+      }
+      mats[MAX_NMODES] = mat_alloc(maxdim, config->rank);
+      matrank = config->rank;
+    }
+
+    cpd_opts[SPLATT_OPTION_PRIVTHRESH] = config->privthresh;
+    cpd_opts[SPLATT_OPTION_NTHREADS] = config->nthreads;
+    splatt_omp_set_num_threads(config->nthreads);
+    splatt_mttkrp_ws * ws = splatt_mttkrp_alloc_ws(cs, config->rank, cpd_opts);
+
+    sp_timer_t sweep;
+    for(idx_t i=0; i < warmup + trials; ++i) {
+      timer_fstart(&sweep);
+      for(idx_t m=0; m < nmodes; ++m) {
+        mttkrp_csf(cs, mats, m, thds, ws, cpd_opts);
+      }
+      timer_stop(&sweep);
+      if(i >= warmup) {
+        times[i - warmup] = sweep.seconds;
+      }
+    }
+    splatt_mttkrp_free_ws(ws);
+
+    bench_result * const res = results + c;
+    res->config = *config;
+    bench_summarize(times, trials, &(res->median), &(res->q1), &(res->q3));
+
+    p_print_config(config);
+    printf("  median=%0.4fs  IQR=%0.4fs", res->median, res->q3 - res->q1);
+    metrics_record("bench-matrix", "median", c, -1, -1, res->median);
+    metrics_record("bench-matrix", "iqr", c, -1, -1, res->q3 - res->q1);
+    if(machine != NULL) {
+      model_mode models[MAX_NMODES];
+      model_mttkrp(cs, config->rank, cpd_opts, machine, models);
+      double predicted = 0.;
+      for(idx_t m=0; m < nmodes; ++m) {
+        predicted += models[m].seconds;
+      }
+      printf("  model=%0.4fs", predicted);
+      metrics_record("bench-matrix", "model", c, -1, -1, predicted);
+    }
+    printf("\n");
+  }
+  timer_stop(&timers[TIMER_MISC]);
+
+  if(cs != NULL) {
+    csf_free(cs, cpd_opts);
+  }
+  if(matrank > 0) {
+    for(idx_t m=0; m < nmodes; ++m) {
+      mat_free(mats[m]);
+    }
+    mat_free(mats[MAX_NMODES]);
+  }
+  thd_free(thds, maxthreads);
+  splatt_free(times);
+  splatt_free(cpd_opts);
+}
+
+
+int bench_write_results(
+  char const * const fname,
+  sptensor_t const * const tt,
+  bench_result const * const results,
+  idx_t const nresults)
+{
+  FILE * fout = fopen(fname, "w");
+  if(fout == NULL) {
+    fprintf(stderr, "SPLATT ERROR: failed to open '%s'\n", fname);
+    return SPLATT_ERROR_BADINPUT;
+  }
+
+  fprintf(fout, "# splatt bench matrix\n");
+  fprintf(fout, "# nnz %"SPLATT_PF_IDX"\n", tt->nnz);
+  fprintf(fout, "# csf tile tilelevel privthresh rank threads median q1 q3\n");
+  for(idx_t r=0; r < nresults; ++r) {
+    bench_config const * const config = &(results[r].config);
+    fprintf(fout, "%s %s %"SPLATT_PF_IDX" %g %"SPLATT_PF_IDX" %"
+        SPLATT_PF_IDX" %0.9e %0.9e %0.9e\n",
+        csf_names[config->csf], tile_names[config->tile], config->tilelevel,
+        config->privthresh, config->rank, config->nthreads,
+        results[r].median, results[r].q1, results[r].q3);
+  }
+
+  fclose(fout);
+  return SPLATT_SUCCESS;
+}
+
+
+bench_result * bench_read_results(
+  char const * const fname,
+  sptensor_t const * const tt,
+  idx_t * const nresults)
+{
+  FILE * fin = fopen(fname, "r");
+  if(fin == NULL) {
+    fprintf(stderr, "SPLATT ERROR: failed to open '%s'\n", fname);
+    return NULL;
+  }
+
+  idx_t cap = 16;
+  idx_t n = 0;
+  bench_result * results = malloc(cap * sizeof(*results));
+
+  char * line = NULL;
+  size_t len = 0;
+  idx_t lineno = 0;
+  while(getline(&line, &len, fin) != -1) {
+    ++lineno;
+    unsigned long long nnz;
+    if(sscanf(line, "# nnz %llu", &nnz) == 1) {
+      if((idx_t) nnz != tt->nnz) {
+        fprintf(stderr, "SPLATT: baseline '%s' was recorded on a tensor with "
+            "%llu nonzeros, not %"SPLATT_PF_IDX".\n", fname, nnz, tt->nnz);
+      }
+      continue;
+    }
+    if(line[0] == '#' || line[0] == '\n') {
+      continue;
+    }
+
+    char csf[16];
+    char tile[16];
+    unsigned long long lvl, rank, nthreads;
+    bench_result res;
+    if(sscanf(line, "%15s %15s %llu %lf %llu %llu %lf %lf %lf", csf, tile,
+          &lvl, &(res.config.privthresh), &rank, &nthreads, &(res.median),
+          &(res.q1), &(res.q3)) != 9 ||
+        p_find_name(csf, csf_names, SPLATT_CSF_ALLMODE+1) < 0 ||
+        p_find_name(tile, tile_names, SPLATT_DENSETILE+1) < 0) {
+      fprintf(stderr, "SPLATT ERROR: '%s' line %"SPLATT_PF_IDX" is not a "
+          "benchmark result.\n", fname, lineno);
+      free(results);
+      results = NULL;
+      break;
+    }
+    res.config.csf = p_find_name(csf, csf_names, SPLATT_CSF_ALLMODE+1);
+    res.config.tile = p_find_name(tile, tile_names, SPLATT_DENSETILE+1);
+    res.config.tilelevel = (idx_t) lvl;
+    res.config.rank = (idx_t) rank;
+    res.config.nthreads = (idx_t) nthreads;
+
+    if(n == cap) {
+      cap *= 2;
+      results = realloc(results, cap * sizeof(*results));
+    }
+    results[n++] = res;
+  }
+
+  free(line);
+  fclose(fin);
+
+  *nresults = n;
+  return results;
+}
+
+
+idx_t bench_compare(
+  bench_result const * const results,
+  idx_t const nresults,
+  bench_result const * const baseline,
+  idx_t const nbaseline,
+  double const tolerance)
+{
+  idx_t nregress = 0;
+
+  printf("Baseline comparison (tolerance %0.1f%%) ----------------------\n",
+      100. * tolerance);
+  for(idx_t r=0; r < nresults; ++r) {
+    bench_result const * base = NULL;
+    for(idx_t b=0; b < nbaseline; ++b) {
+      if(p_same_config(&(results[r].config), &(baseline[b].config))) {
+        base = baseline + b;
+        break;
+      }
+    }
+
+    p_print_config(&(results[r].config));
+    if(base == NULL || base->median <= 0.) {
+      printf("  %0.4fs  (no baseline)\n", results[r].median);
+      continue;
+    }
+
+    double const change = (results[r].median / base->median) - 1.;
+    printf("  %0.4fs vs %0.4fs  %+6.1f%%", results[r].median, base->median,
+        100. * change);
+    if(change > tolerance) {
+      printf("  REGRESSION");
+      ++nregress;
+    }
+    printf("\n");
+    metrics_record("bench-matrix", "change", r, -1, -1, change);
+  }
+
+  printf("%"SPLATT_PF_IDX" REGRESSIONS\n", nregress);
+  return nregress;
+}
@@ -9,6 +9,7 @@
 #include "matrix.h"
 #include "sptensor.h"
 #include "reorder.h"
+#include "model.h"
 
 
 
@@ -23,13 +24,165 @@ typedef struct
   int write;
   int tile;
   permutation_t * perm;
+  double stream_bw; /** STREAM triad bandwidth in GB/s, or 0 if unknown */
 } bench_opts;
 
 
+/**
+* @brief One point in a benchmark matrix: a CSF configuration to time.
+*/
+typedef struct
+{
+  splatt_csf_type csf;
+  splatt_tile_type tile;
+  idx_t tilelevel;      /** Tiled levels. 0 if 'tile' is SPLATT_NOTILE. */
+  double privthresh;
+  idx_t rank;
+  idx_t nthreads;
+} bench_config;
+
+
+/**
+* @brief Summary of the trials of one configuration. Times are of one sweep of
+*        MTTKRP over every mode.
+*/
+typedef struct
+{
+  bench_config config;
+  double median;
+  double q1;        /** First quartile. */
+  double q3;        /** Third quartile. */
+} bench_result;
+
+
 
 /******************************************************************************
  * PUBLIC FUNCTIONS
  *****************************************************************************/
+/**
+* @brief Measure sustainable memory bandwidth with a STREAM triad. This is
+*        the peak that benchmarked kernels are compared against.
+*
+* @param nthreads The number of threads to use.
+*
+* @return The best observed bandwidth, in GB/s.
+*/
+double bench_stream(
+  idx_t const nthreads);
+
+/**
+* @brief Summarize the times of repeated trials by their median and
+*        quartiles. All are zero if there are no trials.
+*
+* @param times The time of each trial. These are sorted.
+* @param ntimes The number of trials.
+* @param[out] median The median time.
+* @param[out] q1 The first quartile.
+* @param[out] q3 The third quartile.
+*/
+void bench_summarize(
+  double * const times,
+  idx_t const ntimes,
+  double * const median,
+  double * const q1,
+  double * const q3);
+
+/**
+* @brief Calibrate the parameters of model_mttkrp() on this machine. The
+*        bandwidths come from STREAM, the flop rate from accumulating
+*        cache-resident rows, and the lock cost from an uncontended mutex
+*        pool. Anything not measured keeps its default.
+*
+* @param nthreads The number of threads 'stream_bw' was measured with.
+* @param stream_bw The STREAM bandwidth, or 0 to skip the bandwidths.
+* @param[out] machine The calibrated machine.
+*/
+void bench_machine(
+  idx_t const nthreads,
+  double const stream_bw,
+  model_machine * const machine);
+
+/**
+* @brief Time CSF MTTKRP for each configuration in a benchmark matrix. Each
+*        configuration is run 'warmup' untimed sweeps and then 'trials' timed
+*        ones. The CSF is reused between neighboring configurations which
+*        only differ in rank, privatization, or threads, so order 'configs'
+*        with those varying fastest. If 'machine' is given, the time predicted
+*        by model_mttkrp() is printed next to each median to validate it.
+*
+* @param tt The tensor to benchmark.
+* @param configs The configurations to run.
+* @param nconfigs The number of configurations.
+* @param warmup Untimed sweeps before each configuration.
+* @param trials Timed sweeps of each configuration.
+* @param machine The machine to model, or NULL.
+* @param[out] results The summary of each configuration, in order.
+*/
+void bench_matrix(
+  sptensor_t * const tt,
+  bench_config const * const configs,
+  idx_t const nconfigs,
+  idx_t const warmup,
+  idx_t const trials,
+  model_machine const * const machine,
+  bench_result * const results);
+
+
+/**
+* @brief Save benchmark matrix results so a later run can compare against
+*        them.
+*
+* @param fname The file to write.
+* @param tt The benchmarked tensor, recorded to catch mismatched baselines.
+* @param results The results to save.
+* @param nresults The number of results.
+*
+* @return SPLATT_SUCCESS, or SPLATT_ERROR_BADINPUT if the file cannot be
+*         written.
+*/
+int bench_write_results(
+  char const * const fname,
+  sptensor_t const * const tt,
+  bench_result const * const results,
+  idx_t const nresults);
+
+
+/**
+* @brief Read results written by bench_write_results().
+*
+* @param fname The file to read.
+* @param tt The tensor being benchmarked now. A warning is printed if the
+*           baseline was recorded on a different one.
+* @param[out] nresults The number of results read.
+*
+* @return The results (free with free()), or NULL on error.
+*/
+bench_result * bench_read_results(
+  char const * const fname,
+  sptensor_t const * const tt,
+  idx_t * const nresults);
+
+
+/**
+* @brief Print each result next to the baseline of the same configuration and
+*        flag those whose median is more than 'tolerance' slower.
+*
+* @param results The new results.
+* @param nresults The number of new results.
+* @param baseline The baseline results.
+* @param nbaseline The number of baseline results.
+* @param tolerance The allowed relative slowdown, e.g., 0.05 for 5%.
+*
+* @return The number of regressions.
+*/
+idx_t bench_compare(
+  bench_result const * const results,
+  idx_t const nresults,
+  bench_result const * const baseline,
+  idx_t const nbaseline,
+  double const tolerance);
+
+
 void bench_splatt(
   sptensor_t * const tt,
   matrix_t ** mats,
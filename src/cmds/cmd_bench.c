@@ -6,6 +6,7 @@
 #include "../bench.h"
 #include "../stats.h"
 #include "../reorder.h"
+#include "../metrics.h"
 
 
 
@@ -21,6 +22,7 @@ static char bench_doc[] =
   "  giga\t\tGigaTensor algorithm adapted from the MapReduce paradigm\n"
   "  coord\t\tStream through a coordinate tensor\n"
   "  ttbox\t\tTensor-Vector products as done by Tensor Toolbox\n"
+  "  matrix\tCSF over a grid of configurations, with repeated trials\n"
   "Available reordering algorithms are:\n"
   "  graph\t\t\tReorder based on the partitioning of a mode-independent graph\n"
   "  hgraph\t\tReorder based on the partitioning of a hypergraph\n"
@@ -34,6 +36,7 @@ typedef enum
   ALG_DFACTO,
   ALG_TTBOX,
   ALG_COORD,
+  ALG_MATRIX,
   ALG_ERR,
   ALG_NALGS
 } splatt_algs;
@@ -50,6 +53,9 @@ static void (*bench_funcs[ALG_NALGS]) (sptensor_t * const tt,
     [ALG_TTBOX]  = bench_ttbox
   };
 
+/* longest list accepted by a grid option */
+#define BENCH_MAXLIST 32
+
 typedef struct
 {
   char * ifname;
@@ -65,25 +71,153 @@ typedef struct
   int write;
   int tile;
   idx_t permmode;
+  int stream;
+
+  /* benchmark matrix */
+  idx_t nthreadlist;
+  idx_t threadlist[BENCH_MAXLIST];
+  idx_t nranks;
+  idx_t ranks[BENCH_MAXLIST];
+  idx_t ncsfs;
+  splatt_csf_type csfs[BENCH_MAXLIST];
+  idx_t ntilings;
+  splatt_tile_type tilings[BENCH_MAXLIST];
+  idx_t ntilelevels;
+  idx_t tilelevels[BENCH_MAXLIST];
+  idx_t nprivs;
+  double privs[BENCH_MAXLIST];
+  idx_t warmup;
+  idx_t trials;
+  char * savefname;
+  char * basefname;
+  double tolerance;
 } bench_args;
 
+#define TT_TOLERANCE 245
+#define TT_COMPARE 246
+#define TT_SAVE 247
+#define TT_WARMUP 248
+#define TT_TRIALS 249
+#define TT_PRIV 250
+#define TT_TILELEVEL 251
+#define TT_TILING 252
+#define TT_CSF 253
+#define TT_NOSTREAM 254
 #define TT_TILE 255
 
 static struct argp_option bench_options[] = {
   {"alg", 'a', "ALG", 0, "algorithm to benchmark"},
   {"iters", 'i', "NITERS", 0, "number of iterations to use (default: 5)"},
   {"mode", 'm', "MODE", 0, "mode basis for hgraph reordering (default: 1)"},
-  {"threads", 't', "NTHREADS", 0, "number of threads to use (default: 1)"},
-  {"rank", 'r', "RANK", 0, "rank of decomposition to find (default: 10)"},
+  {"threads", 't', "NTHREADS", 0, "number of threads to use, or a "
+    "comma-separated list of counts to scale over (default: 1)"},
+  {"rank", 'r', "RANK", 0, "rank of decomposition to find (default: 10). "
+    "'matrix' accepts a comma-separated list; other algorithms use the first"},
   {"scale", 's', 0, 0, "scale threads from 1 to NTHREADS (by 2)"},
   {"tile", TT_TILE, 0, 0, "use tiling during SPLATT"},
+  {"nostream", TT_NOSTREAM, 0, 0, "skip the STREAM bandwidth calibration"},
   {"write", 'w', 0, 0, "write results to files ALG_mode<N>.mat (for testing)"},
   {"rtype", 'z', "TYPE", 0, "designate reordering type"},
   {"pfile", 'p', "FILE", 0, "partition file for reordering"},
+  { 0, 0, 0, 0, "Benchmark matrix (-a matrix) options. LIST is comma-separated "
+    "and every combination is run:", 1},
+  {"csf", TT_CSF, "LIST", 0, "CSF allocations {one,two,all} (default: one)"},
+  {"tiling", TT_TILING, "LIST", 0, "tiling {none,dense} (default: dense)"},
+  {"tilelevel", TT_TILELEVEL, "LIST", 0, "number of tiled levels "
+    "(default: 1)"},
+  {"priv", TT_PRIV, "LIST", 0, "privatization thresholds (default: 0.02)"},
+  {"warmup", TT_WARMUP, "N", 0, "untimed sweeps per configuration "
+    "(default: 2)"},
+  {"trials", TT_TRIALS, "N", 0, "timed sweeps per configuration, summarized "
+    "by median and IQR (default: 10)"},
+  {"save", TT_SAVE, "FILE", 0, "save results as a baseline in FILE"},
+  {"compare", TT_COMPARE, "FILE", 0, "compare against the baseline in FILE "
+    "and exit with an error on regressions"},
+  {"tolerance", TT_TOLERANCE, "PCT", 0, "allowed slowdown of the median "
+    "before a regression is flagged (default: 5)"},
   { 0 }
 };
 
 
+/**
+* @brief Split a comma-separated list, calling 'parse' on each item. Returns
+*        the number of items, or 0 if there are too many.
+*/
+static idx_t p_split_list(
+  char const * const arg,
+  void (*parse)(char const * item, idx_t i, void * out, struct argp_state *),
+  void * out,
+  struct argp_state * state)
+{
+  char * copy = strdup(arg);
+  idx_t n = 0;
+  for(char * tok = strtok(copy, ","); tok != NULL; tok = strtok(NULL, ",")) {
+    if(n == BENCH_MAXLIST) {
+      argp_error(state, "more than %d values in '%s'", BENCH_MAXLIST, arg);
+    }
+    parse(tok, n++, out, state);
+  }
+  free(copy);
+  return n;
+}
+
+static void p_parse_idx(
+  char const * item,
+  idx_t i,
+  void * out,
+  struct argp_state * state)
+{
+  int const val = atoi(item);
+  if(val <= 0) {
+    argp_error(state, "'%s' must be a positive integer", item);
+  }
+  ((idx_t *) out)[i] = (idx_t) val;
+}
+
+static void p_parse_dbl(
+  char const * item,
+  idx_t i,
+  void * out,
+  struct argp_state * state)
+{
+  ((double *) out)[i] = atof(item);
+}
+
+static void p_parse_csf(
+  char const * item,
+  idx_t i,
+  void * out,
+  struct argp_state * state)
+{
+  splatt_csf_type * const csfs = out;
+  if(strcmp(item, "one") == 0) {
+    csfs[i] = SPLATT_CSF_ONEMODE;
+  } else if(strcmp(item, "two") == 0) {
+    csfs[i] = SPLATT_CSF_TWOMODE;
+  } else if(strcmp(item, "all") == 0) {
+    csfs[i] = SPLATT_CSF_ALLMODE;
+  } else {
+    argp_error(state, "--csf option '%s' not recognized", item);
+  }
+}
+
+static void p_parse_tiling(
+  char const * item,
+  idx_t i,
+  void * out,
+  struct argp_state * state)
+{
+  splatt_tile_type * const tilings = out;
+  if(strcmp(item, "none") == 0) {
+    tilings[i] = SPLATT_NOTILE;
+  } else if(strcmp(item, "dense") == 0) {
+    tilings[i] = SPLATT_DENSETILE;
+  } else {
+    argp_error(state, "--tiling option '%s' not recognized", item);
+  }
+}
+
+
 static error_t parse_bench_opt(
   int key,
   char * arg,
@@ -104,6 +238,8 @@ static error_t parse_bench_opt(
       args->which[ALG_DFACTO] = 1;
     } else if(strcmp(arg, "ttbox") == 0) {
       args->which[ALG_TTBOX] = 1;
+    } else if(strcmp(arg, "matrix") == 0) {
+      args->which[ALG_MATRIX] = 1;
     } else {
       args->which[ALG_ERR] = 1;
       args->algerr = arg;
@@ -119,13 +255,18 @@ static error_t parse_bench_opt(
     args->pfname = arg;
     break;
   case 'r':
-    args->rank = atoi(arg);
+    args->nranks = p_split_list(arg, p_parse_idx, args->ranks, state);
+    args->rank = args->ranks[0];
     break;
   case 's':
     args->scale = 1;
     break;
   case 't':
-    args->nthreads = atoi(arg);
+    args->nthreadlist = p_split_list(arg, p_parse_idx, args->threadlist, state);
+    args->nthreads = 0;
+    for(idx_t t=0; t < args->nthreadlist; ++t) {
+      args->nthreads = SS_MAX(args->nthreads, args->threadlist[t]);
+    }
     break;
   case 'w':
     args->write = 1;
@@ -146,6 +287,38 @@ static error_t parse_bench_opt(
   case TT_TILE:
     args->tile = SPLATT_SYNCTILE;
     break;
+  case TT_NOSTREAM:
+    args->stream = 0;
+    break;
+
+  case TT_CSF:
+    args->ncsfs = p_split_list(arg, p_parse_csf, args->csfs, state);
+    break;
+  case TT_TILING:
+    args->ntilings = p_split_list(arg, p_parse_tiling, args->tilings, state);
+    break;
+  case TT_TILELEVEL:
+    args->ntilelevels = p_split_list(arg, p_parse_idx, args->tilelevels,
+        state);
+    break;
+  case TT_PRIV:
+    args->nprivs = p_split_list(arg, p_parse_dbl, args->privs, state);
+    break;
+  case TT_WARMUP:
+    args->warmup = atoi(arg);
+    break;
+  case TT_TRIALS:
+    args->trials = atoi(arg);
+    break;
+  case TT_SAVE:
+    args->savefname = arg;
+    break;
+  case TT_COMPARE:
+    args->basefname = arg;
+    break;
+  case TT_TOLERANCE:
+    args->tolerance = atof(arg) / 100.;
+    break;
 
   case ARGP_KEY_ARG:
     if(args->ifname != NULL) {
@@ -167,16 +340,15 @@ static struct argp bench_argp =
   {bench_options, parse_bench_opt, bench_args_doc, bench_doc};
 
 static idx_t * p_mkthreads(
-  idx_t const nthreads,
-  int const scale,
+  bench_args const * const args,
   idx_t * nruns)
 {
   idx_t *tsizes;
   idx_t tcount;
 
-  if(scale) {
+  if(args->scale) {
     tcount = 1;
-    while((idx_t)(1 << tcount) <= nthreads) {
+    while((idx_t)(1 << tcount) <= args->nthreads) {
       ++tcount;
     }
     tsizes = (idx_t *) splatt_malloc(tcount * sizeof(idx_t));
@@ -186,15 +358,128 @@ static idx_t * p_mkthreads(
     }
 
   } else {
-    tcount = 1;
-    tsizes = (idx_t *) splatt_malloc(1 * sizeof(idx_t));
-    tsizes[0] = nthreads;
+    tcount = args->nthreadlist;
+    tsizes = (idx_t *) splatt_malloc(tcount * sizeof(idx_t));
+    for(idx_t t=0; t < tcount; ++t) {
+      tsizes[t] = args->threadlist[t];
+    }
   }
 
   *nruns = tcount;
   return tsizes;
 }
 
+
+/**
+* @brief Expand the grid options into every combination. Threads, privatization
+*        and rank vary fastest so that bench_matrix() can reuse each CSF.
+*        Tile levels are only expanded for tiled configurations.
+*
+* @param args The parsed arguments.
+* @param threads The thread counts to run.
+* @param nthreads The number of thread counts.
+* @param[out] nconfigs The number of configurations.
+*
+* @return The configurations (free with splatt_free()).
+*/
+static bench_config * p_mkconfigs(
+  bench_args const * const args,
+  idx_t const * const threads,
+  idx_t const nthreads,
+  idx_t * const nconfigs)
+{
+  idx_t const maxconfigs = args->ncsfs * args->ntilings * args->ntilelevels *
+      args->nranks * args->nprivs * nthreads;
+  bench_config * configs = splatt_malloc(maxconfigs * sizeof(*configs));
+
+  /* decode i as a mixed-radix number, threads being the lowest digit */
+  idx_t n = 0;
+  for(idx_t i=0; i < maxconfigs; ++i) {
+    idx_t x = i;
+    idx_t const h = x % nthreads;
+    x /= nthreads;
+    idx_t const p = x % args->nprivs;
+    x /= args->nprivs;
+    idx_t const r = x % args->nranks;
+    x /= args->nranks;
+    idx_t const l = x % args->ntilelevels;
+    x /= args->ntilelevels;
+    idx_t const t = x % args->ntilings;
+    idx_t const c = x / args->ntilings;
+
+    if(args->tilings[t] == SPLATT_NOTILE && l > 0) {
+      continue;
+    }
+
+    bench_config * const config = configs + n++;
+    config->csf = args->csfs[c];
+    config->tile = args->tilings[t];
+    config->tilelevel = (config->tile == SPLATT_NOTILE) ?
+        0 : args->tilelevels[l];
+    config->rank = args->ranks[r];
+    config->privthresh = args->privs[p];
+    config->nthreads = threads[h];
+  }
+
+  *nconfigs = n;
+  return configs;
+}
+
+
+/**
+* @brief Run the benchmark matrix, then save and/or compare its results.
+*
+* @return The number of regressions against the baseline, or -1 on error.
+*/
+static int p_run_matrix(
+  sptensor_t * const tt,
+  bench_args const * const args,
+  bench_opts const * const opts)
+{
+  idx_t nconfigs;
+  bench_config * configs = p_mkconfigs(args, opts->threads, opts->nruns,
+      &nconfigs);
+  bench_result * results = splatt_malloc(nconfigs * sizeof(*results));
+
+  /* validate the cost model on a calibrated machine */
+  model_machine machine;
+  bench_machine(args->nthreads, opts->stream_bw, &machine);
+  printf("MODEL-MACHINE: --bw %0.1f --thread-bw %0.1f --gflops %0.2f "
+      "--lock-ns %0.1f\n", machine.bandwidth, machine.thread_bw,
+      machine.gflops, machine.lock_ns);
+
+  bench_matrix(tt, configs, nconfigs, args->warmup, args->trials, &machine,
+      results);
+
+  int ret = 0;
+  if(args->savefname != NULL) {
+    if(bench_write_results(args->savefname, tt, results, nconfigs)
+        != SPLATT_SUCCESS) {
+      ret = -1;
+    } else {
+      printf("SAVED %"SPLATT_PF_IDX" RESULTS TO '%s'\n", nconfigs,
+          args->savefname);
+    }
+  }
+  if(args->basefname != NULL && ret == 0) {
+    idx_t nbase;
+    bench_result * base = bench_read_results(args->basefname, tt, &nbase);
+    if(base == NULL) {
+      ret = -1;
+    } else {
+      printf("\n");
+      ret = (int) bench_compare(results, nconfigs, base, nbase,
+          args->tolerance);
+      free(base);
+    }
+  }
+
+  splatt_free(results);
+  splatt_free(configs);
+  return ret;
+}
+
+
 int splatt_bench(
   int argc,
   char ** argv)
@@ -206,11 +491,29 @@ int splatt_bench(
   args.permerr = NULL;
   args.niters = 5;
   args.nthreads = 1;
+  args.nthreadlist = 1;
+  args.threadlist[0] = 1;
   args.scale = 0;
   args.rank = 10;
+  args.nranks = 1;
+  args.ranks[0] = 10;
+  args.ncsfs = 1;
+  args.csfs[0] = SPLATT_CSF_ONEMODE;
+  args.ntilings = 1;
+  args.tilings[0] = SPLATT_DENSETILE;
+  args.ntilelevels = 1;
+  args.tilelevels[0] = 1;
+  args.nprivs = 1;
+  args.privs[0] = 0.02;
+  args.warmup = 2;
+  args.trials = 10;
+  args.savefname = NULL;
+  args.basefname = NULL;
+  args.tolerance = 0.05;
   args.write = 0;
   args.tile = 0;
   args.permmode = 0;
+  args.stream = 1;
   args.rtype = PERM_ERROR;
   for(int a=0; a < ALG_NALGS; ++a) {
     args.which[a] = 0;
@@ -262,26 +565,45 @@ int splatt_bench(
   }
   mats[MAX_NMODES] = mat_alloc(max_dim, args.rank);
 
-  opts.threads = p_mkthreads(args.nthreads, args.scale, &opts.nruns);
+  opts.threads = p_mkthreads(&args, &opts.nruns);
 
   printf("Benchmarking ---------------------------------------------------\n");
   printf("RANK=%"SPLATT_PF_IDX" ITS=%"SPLATT_PF_IDX"\n", args.rank, args.niters);
 
+  /* calibrate the bandwidth peak with all threads */
+  opts.stream_bw = 0.;
+  if(args.stream) {
+    opts.stream_bw = bench_stream(args.nthreads);
+    printf("STREAM-TRIAD: %0.2f GB/s (%"SPLATT_PF_IDX" threads)\n",
+        opts.stream_bw, args.nthreads);
+    metrics_set("bench", "stream_gbps", -1, -1, -1, opts.stream_bw);
+  }
+
+  int nregress = 0;
   for(int a=0; a < ALG_NALGS; ++a) {
     if(args.which[a]) {
-      bench_funcs[a](tt, mats, &opts);
+      if(a == ALG_MATRIX) {
+        nregress = p_run_matrix(tt, &args, &opts);
+      } else {
+        bench_funcs[a](tt, mats, &opts);
+      }
     }
     printf("\n");
   }
 
   perm_free(opts.perm);
-  free(opts.threads);
+  splatt_free(opts.threads);
   for(idx_t m=0; m < tt->nmodes; ++m) {
     mat_free(mats[m]);
   }
   mat_free(mats[MAX_NMODES]);
   tt_free(tt);
 
+  stats_mem();
+
+  if(nregress != 0) {
+    return EXIT_FAILURE;
+  }
   return EXIT_SUCCESS;
 }
 
@@ -8,6 +8,8 @@
 #include "../stats.h"
 #include "../thd_info.h"
 #include "../cpd.h"
+#include "../perfctr.h"
+#include "../affinity.h"
 
 
 /******************************************************************************
@@ -17,6 +19,13 @@ static char cpd_args_doc[] = "TENSOR";
 static char cpd_doc[] =
   "splatt-cpd -- Compute the CPD of a sparse tensor.\n";
 
+#define TT_STEAL 243
+#define TT_BIND 244
+#define TT_TEAM 245
+#define TT_NUMA 246
+#define TT_TIMELIMIT 247
+#define TT_DRYRUN 248
+#define TT_PERF 249
 #define TT_CSF 250
 #define TT_REG 251
 #define TT_SEED 252
@@ -26,15 +35,30 @@ static char cpd_doc[] =
 static struct argp_option cpd_options[] = {
   {"iters", 'i', "NITERS", 0, "maximum number of iterations to use (default: 50)"},
   {"tol", TT_TOL, "TOLERANCE", 0, "minimum change for convergence (default: 1e-5)"},
+  {"time-limit", TT_TIMELIMIT, "SECONDS", 0, "stop iterating before the "
+                                             "factorization exceeds SECONDS "
+                                             "(default: no limit)"},
   {"reg", TT_REG, "REGULARIZATION", 0, "regularization parameter (default: 0)"},
   {"rank", 'r', "RANK", 0, "rank of decomposition to find (default: 10)"},
   {"threads", 't', "NTHREADS", 0, "number of threads to use (default: #cores)"},
   {"csf", TT_CSF, "#CSF", 0, "how many CSF to use? {one,two,all} default: two"},
   {"tile", TT_TILE, 0, 0, "use tiling during SPLATT"},
+  {"numa", TT_NUMA, "PLACE", 0, "place memory on NUMA nodes? {off,auto,on} "
+                                "default: off"},
+  {"team", TT_TEAM, 0, 0, "keep one thread team for all ALS iterations "
+                          "instead of forking for each kernel"},
+  {"steal", TT_STEAL, 0, 0, "balance MTTKRP by stealing slices and tiles "
+                            "from busy threads"},
+  {"bind", TT_BIND, "POLICY", 0, "bind threads to CPUs? "
+                                 "{none,compact,scatter,cores} default: none"},
   {"nowrite", TT_NOWRITE, 0, 0, "do not write output to file"},
+  {"perf", TT_PERF, 0, 0, "sample hardware counters around MTTKRP and the "
+                         "dense kernels (Linux only)"},
   {"seed", TT_SEED, "SEED", 0, "random seed (default: system time)"},
   {"verbose", 'v', 0, 0, "turn on verbose output (default: no)"},
   {"stem", 's', "PATH", 0, "file stem for factorization output files (default: ./)"},
+  {"dry-run", TT_DRYRUN, 0, 0, "estimate peak memory from the tensor's "
+                               "dimensions and exit without factoring"},
   { 0 }
 };
 
@@ -46,6 +70,7 @@ typedef struct
   int write;       /** do we write output to file? */
   double * opts;   /** splatt_cpd options */
   idx_t nfactors;
+  int dryrun;      /** only estimate memory usage */
 } cpd_cmd_args;
 
 
@@ -62,6 +87,7 @@ static void default_cpd_opts(
   args->ifname    = NULL;
   args->write     = DEFAULT_WRITE;
   args->nfactors  = DEFAULT_NFACTORS;
+  args->dryrun    = 0;
 }
 
 
@@ -93,6 +119,9 @@ static error_t parse_cpd_opt(
   case TT_TOL:
     args->opts[SPLATT_OPTION_TOLERANCE] = atof(arg);
     break;
+  case TT_TIMELIMIT:
+    args->opts[SPLATT_OPTION_TIMELIMIT] = atof(arg);
+    break;
   case TT_REG:
     args->opts[SPLATT_OPTION_REGULARIZE] = atof(arg);
     break;
@@ -129,9 +158,47 @@ static error_t parse_cpd_opt(
     }
     break;
 
+  case TT_NUMA:
+    if(strcmp("off", arg) == 0) {
+      args->opts[SPLATT_OPTION_NUMA] = SPLATT_NUMA_OFF;
+    } else if(strcmp("auto", arg) == 0) {
+      args->opts[SPLATT_OPTION_NUMA] = SPLATT_NUMA_AUTO;
+    } else if(strcmp("on", arg) == 0) {
+      args->opts[SPLATT_OPTION_NUMA] = SPLATT_NUMA_ON;
+    } else {
+      fprintf(stderr, "SPLATT: --numa option '%s' not recognized.\n", arg);
+      argp_usage(state);
+    }
+    break;
+  case TT_TEAM:
+    args->opts[SPLATT_OPTION_TEAM] = 1;
+    break;
+  case TT_STEAL:
+    args->opts[SPLATT_OPTION_STEAL] = 1;
+    break;
+  case TT_BIND:
+    if(strcmp("none", arg) == 0) {
+      args->opts[SPLATT_OPTION_AFFINITY] = SPLATT_AFFINITY_NONE;
+    } else if(strcmp("compact", arg) == 0) {
+      args->opts[SPLATT_OPTION_AFFINITY] = SPLATT_AFFINITY_COMPACT;
+    } else if(strcmp("scatter", arg) == 0) {
+      args->opts[SPLATT_OPTION_AFFINITY] = SPLATT_AFFINITY_SCATTER;
+    } else if(strcmp("cores", arg) == 0) {
+      args->opts[SPLATT_OPTION_AFFINITY] = SPLATT_AFFINITY_CORES;
+    } else {
+      fprintf(stderr, "SPLATT: --bind option '%s' not recognized.\n", arg);
+      argp_usage(state);
+    }
+    break;
+  case TT_PERF:
+    perfctr_init();
+    break;
   case TT_SEED:
     args->opts[SPLATT_OPTION_RANDSEED] = atoi(arg);
     break;
+  case TT_DRYRUN:
+    args->dryrun = 1;
+    break;
 
   case ARGP_KEY_ARG:
     if(args->ifname != NULL) {
@@ -170,13 +237,38 @@ int splatt_cpd_cmd(
 
   print_header();
 
+  if(args.dryrun) {
+    idx_t nmodes;
+    idx_t nnz;
+    idx_t dims[MAX_NMODES];
+    if(tt_read_dims(args.ifname, &nmodes, &nnz, dims) != SPLATT_SUCCESS) {
+      free_cpd_args(&args);
+      return SPLATT_ERROR_BADINPUT;
+    }
+
+    splatt_mem_usage est;
+    cpd_mem_estimate(nmodes, dims, nnz, args.nfactors, args.opts, &est);
+    printf("NNZ=%"SPLATT_PF_IDX" NFACTORS=%"SPLATT_PF_IDX" THREADS=%"
+        SPLATT_PF_IDX"\n\n", nnz, args.nfactors,
+        (idx_t) args.opts[SPLATT_OPTION_NTHREADS]);
+    stats_mem_estimate(&est);
+    free_cpd_args(&args);
+    return EXIT_SUCCESS;
+  }
+
+  /* bind before reading, so that sorting and CSF are built by bound threads */
+  splatt_verbosity_type which_verb = args.opts[SPLATT_OPTION_VERBOSITY];
+  affinity_bind(args.opts);
+  if(which_verb >= SPLATT_VERBOSITY_HIGH) {
+    affinity_report(args.opts);
+  }
+
   tt = tt_read(args.ifname);
   if(tt == NULL) {
     return SPLATT_ERROR_BADINPUT;
   }
 
   /* print basic tensor stats? */
-  splatt_verbosity_type which_verb = args.opts[SPLATT_OPTION_VERBOSITY];
   if(which_verb >= SPLATT_VERBOSITY_LOW) {
     stats_tt(tt, args.ifname, STATS_BASIC, 0, NULL);
   }
@@ -239,6 +331,11 @@ int splatt_cpd_cmd(
   /* free factor matrix allocations */
   splatt_free_kruskal(&factored);
 
+  if(which_verb >= SPLATT_VERBOSITY_LOW) {
+    printf("\n");
+    stats_mem();
+  }
+
   return EXIT_SUCCESS;
 }
 
@@ -0,0 +1,184 @@
+/******************************************************************************
+ * INCLUDES
+ *****************************************************************************/
+#include "splatt_cmds.h"
+#include "../generate.h"
+#include "../io.h"
+#include "../stats.h"
+#include "../timer.h"
+#include "../thd_info.h"
+
+
+/******************************************************************************
+ * SPLATT GENERATE
+ *****************************************************************************/
+static char gen_args_doc[] = "OUTPUT";
+static char gen_doc[] =
+  "splatt-generate -- Generate a synthetic sparse tensor.\n\n"
+  "Indices of each mode follow a Zipf distribution (uniform if SKEW is 0).\n"
+  "With --rank, the tensor is a sum of RANK dense blocks, i.e., a Kruskal\n"
+  "tensor with sparse non-negative factors, so that a CPD of that rank has a\n"
+  "meaningful fit. The same SEED always produces the same tensor, regardless\n"
+  "of the number of threads.\n"
+  "OUTPUT is written in binary if it ends in '.bin' and as text otherwise.\n";
+
+#define TT_NOISE 255
+#define TT_SEED 254
+
+static struct argp_option gen_options[] = {
+  {"dims", 'd', "DIMS", 0, "mode lengths, e.g., 1000x2000x500 (required)"},
+  {"nnz", 'n', "NNZ", 0, "approximate number of nonzeros, e.g., 1e9 "
+    "(required)"},
+  {"skew", 's', "SKEW", 0, "Zipf exponent, either one for all modes or a "
+    "comma-separated list (default: 0)"},
+  {"rank", 'r', "RANK", 0, "rank of the planted Kruskal tensor "
+    "(default: 0, random coordinates and values)"},
+  {"noise", TT_NOISE, "NOISE", 0, "relative Gaussian noise added to planted "
+    "values (default: 0)"},
+  {"seed", TT_SEED, "SEED", 0, "random seed (default: 1)"},
+  {"threads", 't', "NTHREADS", 0, "number of threads to use (default: #cores)"},
+  { 0 }
+};
+
+typedef struct
+{
+  char * ofname;
+  gen_opts opts;
+} gen_args;
+
+
+/**
+* @brief Parse a list such as "100x200x300" or "1.1,0,0.5" into 'vals'.
+*
+* @return The number of values parsed, or 0 on a malformed list.
+*/
+static idx_t p_parse_list(
+  char const * const arg,
+  double * const vals)
+{
+  idx_t nvals = 0;
+  char const * ptr = arg;
+  while(*ptr != '\0') {
+    if(nvals == MAX_NMODES) {
+      return 0;
+    }
+    char * end;
+    vals[nvals++] = strtod(ptr, &end);
+    if(end == ptr) {
+      return 0;
+    }
+    ptr = end;
+    if(*ptr == 'x' || *ptr == ',') {
+      ++ptr;
+    } else if(*ptr != '\0') {
+      return 0;
+    }
+  }
+  return nvals;
+}
+
+
+static error_t parse_gen_opt(
+  int key,
+  char * arg,
+  struct argp_state * state)
+{
+  gen_args * args = state->input;
+  gen_opts * opts = &(args->opts);
+  double vals[MAX_NMODES];
+  idx_t nvals;
+
+  switch(key) {
+  case 'd':
+    nvals = p_parse_list(arg, vals);
+    if(nvals == 0) {
+      argp_error(state, "invalid dimensions '%s'", arg);
+    }
+    opts->nmodes = nvals;
+    for(idx_t m=0; m < nvals; ++m) {
+      opts->dims[m] = (idx_t) vals[m];
+    }
+    break;
+
+  case 'n':
+    opts->nnz = (idx_t) strtod(arg, NULL);
+    break;
+
+  case 's':
+    nvals = p_parse_list(arg, vals);
+    if(nvals == 0) {
+      argp_error(state, "invalid skew '%s'", arg);
+    }
+    for(idx_t m=0; m < MAX_NMODES; ++m) {
+      opts->skew[m] = (nvals == 1) ? vals[0] : (m < nvals ? vals[m] : 0.);
+    }
+    break;
+
+  case 'r':
+    opts->rank = (idx_t) atoi(arg);
+    break;
+  case TT_NOISE:
+    opts->noise = atof(arg);
+    break;
+  case TT_SEED:
+    opts->seed = strtoull(arg, NULL, 10);
+    break;
+  case 't':
+    splatt_omp_set_num_threads(atoi(arg));
+    break;
+
+  case ARGP_KEY_ARG:
+    if(args->ofname != NULL) {
+      argp_usage(state);
+      break;
+    }
+    args->ofname = arg;
+    break;
+  case ARGP_KEY_END:
+    if(args->ofname == NULL || opts->nmodes == 0 || opts->nnz == 0) {
+      argp_usage(state);
+      break;
+    }
+  }
+  return 0;
+}
+
+static struct argp gen_argp =
+  {gen_options, parse_gen_opt, gen_args_doc, gen_doc};
+
+
+int splatt_generate(
+  int argc,
+  char ** argv)
+{
+  gen_args args;
+  args.ofname = NULL;
+  gen_default_opts(&(args.opts));
+  argp_parse(&gen_argp, argc, argv, ARGP_IN_ORDER, 0, &args);
+
+  print_header();
+
+  sp_timer_t timer;
+  timer_fstart(&timer);
+  sptensor_t * tt = tt_generate(&(args.opts));
+  timer_stop(&timer);
+  if(tt == NULL) {
+    return SPLATT_ERROR_BADINPUT;
+  }
+
+  stats_tt(tt, args.ofname, STATS_BASIC, 0, NULL);
+  printf("GENERATED in %0.3fs\n", timer.seconds);
+
+  timer_fstart(&timer);
+  if(get_file_type(args.ofname) == SPLATT_FILE_BIN_COORD) {
+    tt_write_binary(tt, args.ofname);
+  } else {
+    tt_write(tt, args.ofname);
+  }
+  timer_stop(&timer);
+  printf("WROTE '%s' in %0.3fs\n", args.ofname, timer.seconds);
+
+  tt_free(tt);
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,318 @@
+/******************************************************************************
+ * INCLUDES
+ *****************************************************************************/
+#include "splatt_cmds.h"
+#include "../microbench.h"
+#include "../sptensor.h"
+#include "../stats.h"
+#include "../thd_info.h"
+
+
+/******************************************************************************
+ * SPLATT MICROBENCH
+ *****************************************************************************/
+static char mb_args_doc[] = "[TENSOR]";
+static char mb_doc[] =
+  "splatt-microbench -- benchmark the kernels of CPD-ALS in isolation.\n\n"
+  "Kernels are: sort, fptr, csf (sparse tensor construction); ata, solve,\n"
+  "normalize (dense factor updates); reduce (privatized MTTKRP reduction);\n"
+  "partition (chains-on-chains partitioning); and mutex (the lock pool).\n"
+  "SIZE is the nonzeros of the sparse kernels, the rows of the dense ones,\n"
+  "and the items or lock pairs of the others. Sparse kernels run on TENSOR\n"
+  "if it is given, and otherwise on a generated tensor of SIZE nonzeros.\n"
+  "LIST is comma-separated and every combination is run.\n";
+
+/* longest list accepted by an option */
+#define MB_MAXLIST 32
+
+#define TT_TOLERANCE 250
+#define TT_COMPARE 251
+#define TT_SAVE 252
+#define TT_WARMUP 253
+#define TT_TRIALS 254
+#define TT_SEED 255
+
+static struct argp_option mb_options[] = {
+  {"kernel", 'k', "LIST", 0, "kernels to run (default: all)"},
+  {"size", 'n', "LIST", 0, "problem sizes, e.g., 1e6 (default: 1e6)"},
+  {"rank", 'r', "LIST", 0, "ranks of the dense kernels (default: 16)"},
+  {"threads", 't', "LIST", 0, "thread counts (default: 1)"},
+  {"dims", 'd', "DIMS", 0, "mode lengths of generated tensors, e.g., "
+    "1000x2000x500 (default: three modes of SIZE/10)"},
+  {"seed", TT_SEED, "SEED", 0, "random seed of generated inputs (default: 1)"},
+  {"warmup", TT_WARMUP, "N", 0, "untimed runs per kernel (default: 2)"},
+  {"trials", TT_TRIALS, "N", 0, "timed runs per kernel, summarized by "
+    "median and IQR (default: 10)"},
+  {"save", TT_SAVE, "FILE", 0, "save results as a baseline in FILE"},
+  {"compare", TT_COMPARE, "FILE", 0, "compare against the baseline in FILE "
+    "and exit with an error on regressions"},
+  {"tolerance", TT_TOLERANCE, "PCT", 0, "allowed slowdown of the median "
+    "before a regression is flagged (default: 5)"},
+  { 0 }
+};
+
+
+typedef struct
+{
+  char * ifname;
+  idx_t nkernels;
+  microbench_kernel kernels[MB_NKERNELS];
+  idx_t nsizes;
+  idx_t sizes[MB_MAXLIST];
+  idx_t nranks;
+  idx_t ranks[MB_MAXLIST];
+  idx_t nthreads;
+  idx_t threads[MB_MAXLIST];
+  gen_opts gen;
+  idx_t warmup;
+  idx_t trials;
+  char * savefname;
+  char * basefname;
+  double tolerance;
+} mb_args;
+
+
+/**
+* @brief Split a comma-separated list of positive numbers into 'vals'.
+*
+* @return The number of values.
+*/
+static idx_t p_parse_idx_list(
+  char const * const arg,
+  idx_t * const vals,
+  struct argp_state * state)
+{
+  char * copy = strdup(arg);
+  idx_t n = 0;
+  for(char * tok = strtok(copy, ","); tok != NULL; tok = strtok(NULL, ",")) {
+    double const val = strtod(tok, NULL);
+    if(n == MB_MAXLIST) {
+      argp_error(state, "more than %d values in '%s'", MB_MAXLIST, arg);
+    }
+    if(val < 1.) {
+      argp_error(state, "'%s' must be a positive integer", tok);
+    }
+    vals[n++] = (idx_t) val;
+  }
+  free(copy);
+  return n;
+}
+
+
+static error_t parse_mb_opt(
+  int key,
+  char * arg,
+  struct argp_state * state)
+{
+  mb_args * args = state->input;
+  idx_t dims[MB_MAXLIST];
+  char * copy;
+
+  switch(key) {
+  case 'k':
+    args->nkernels = 0;
+    copy = strdup(arg);
+    for(char * tok = strtok(copy, ","); tok != NULL; tok = strtok(NULL, ",")) {
+      microbench_kernel const kernel = microbench_find_kernel(tok);
+      if(kernel == MB_NKERNELS) {
+        argp_error(state, "kernel '%s' not recognized", tok);
+      }
+      if(args->nkernels == MB_NKERNELS) {
+        argp_error(state, "too many kernels in '%s'", arg);
+      }
+      args->kernels[args->nkernels++] = kernel;
+    }
+    free(copy);
+    break;
+  case 'n':
+    args->nsizes = p_parse_idx_list(arg, args->sizes, state);
+    break;
+  case 'r':
+    args->nranks = p_parse_idx_list(arg, args->ranks, state);
+    break;
+  case 't':
+    args->nthreads = p_parse_idx_list(arg, args->threads, state);
+    break;
+  case 'd':
+    /* 'x' separates dimensions */
+    copy = strdup(arg);
+    for(char * c = copy; *c != '\0'; ++c) {
+      if(*c == 'x') {
+        *c = ',';
+      }
+    }
+    args->gen.nmodes = p_parse_idx_list(copy, dims, state);
+    free(copy);
+    if(args->gen.nmodes > MAX_NMODES) {
+      argp_error(state, "more than %"SPLATT_PF_IDX" modes in '%s'",
+          (idx_t) MAX_NMODES, arg);
+    }
+    for(idx_t m=0; m < args->gen.nmodes; ++m) {
+      args->gen.dims[m] = dims[m];
+    }
+    break;
+  case TT_SEED:
+    args->gen.seed = strtoull(arg, NULL, 10);
+    break;
+  case TT_WARMUP:
+    args->warmup = atoi(arg);
+    break;
+  case TT_TRIALS:
+    args->trials = atoi(arg);
+    break;
+  case TT_SAVE:
+    args->savefname = arg;
+    break;
+  case TT_COMPARE:
+    args->basefname = arg;
+    break;
+  case TT_TOLERANCE:
+    args->tolerance = atof(arg) / 100.;
+    break;
+
+  case ARGP_KEY_ARG:
+    if(args->ifname != NULL) {
+      argp_usage(state);
+      break;
+    }
+    args->ifname = arg;
+    break;
+  }
+  return 0;
+}
+
+static struct argp mb_argp =
+  {mb_options, parse_mb_opt, mb_args_doc, mb_doc};
+
+
+/**
+* @brief Expand the options into every combination, threads varying fastest.
+*        Kernels without a rank run once per size, and sparse kernels run once
+*        if a tensor is given.
+*
+* @param args The parsed arguments.
+* @param[out] nconfigs The number of configurations.
+*
+* @return The configurations (free with splatt_free()).
+*/
+static microbench_config * p_mkconfigs(
+  mb_args const * const args,
+  idx_t * const nconfigs)
+{
+  idx_t const maxconfigs = args->nkernels * args->nsizes * args->nranks *
+      args->nthreads;
+  microbench_config * configs = splatt_malloc(maxconfigs * sizeof(*configs));
+
+  idx_t n = 0;
+  for(idx_t k=0; k < args->nkernels; ++k) {
+    microbench_kernel const kernel = args->kernels[k];
+    bool const fixed_size = args->ifname != NULL &&
+        microbench_is_sparse(kernel);
+    idx_t const nsizes = fixed_size ? 1 : args->nsizes;
+    idx_t const nranks = microbench_uses_rank(kernel) ? args->nranks : 1;
+
+    for(idx_t s=0; s < nsizes; ++s) {
+      for(idx_t r=0; r < nranks; ++r) {
+        idx_t const rank = microbench_uses_rank(kernel) ? args->ranks[r] : 0;
+        /* the normal equations are singular with fewer rows than columns */
+        if(kernel == MB_SOLVE && args->sizes[s] < rank) {
+          continue;
+        }
+        for(idx_t t=0; t < args->nthreads; ++t) {
+          microbench_config * const config = configs + n++;
+          config->kernel = kernel;
+          config->size = args->sizes[s];
+          config->rank = rank;
+          config->nthreads = args->threads[t];
+        }
+      }
+    }
+  }
+
+  *nconfigs = n;
+  return configs;
+}
+
+
+int splatt_microbench(
+  int argc,
+  char ** argv)
+{
+  mb_args args;
+  args.ifname = NULL;
+  args.nkernels = MB_NKERNELS;
+  for(idx_t k=0; k < MB_NKERNELS; ++k) {
+    args.kernels[k] = (microbench_kernel) k;
+  }
+  args.nsizes = 1;
+  args.sizes[0] = 1000000;
+  args.nranks = 1;
+  args.ranks[0] = 16;
+  args.nthreads = 1;
+  args.threads[0] = 1;
+  gen_default_opts(&(args.gen));
+  args.warmup = 2;
+  args.trials = 10;
+  args.savefname = NULL;
+  args.basefname = NULL;
+  args.tolerance = 0.05;
+  argp_parse(&mb_argp, argc, argv, ARGP_IN_ORDER, 0, &args);
+
+  print_header();
+
+  sptensor_t * tt = NULL;
+  if(args.ifname != NULL) {
+    tt = tt_read(args.ifname);
+    if(tt == NULL) {
+      return SPLATT_ERROR_BADINPUT;
+    }
+    stats_tt(tt, args.ifname, STATS_BASIC, 0, NULL);
+  }
+
+  /* inputs which are not generated from the seed come from rand() */
+  srand((unsigned int) args.gen.seed);
+
+  idx_t nconfigs;
+  microbench_config * configs = p_mkconfigs(&args, &nconfigs);
+  microbench_result * results = splatt_malloc(nconfigs * sizeof(*results));
+
+  microbench_run(tt, &(args.gen), configs, nconfigs, args.warmup, args.trials,
+      results);
+  printf("\n");
+
+  int ret = EXIT_SUCCESS;
+  if(args.savefname != NULL) {
+    if(microbench_write_results(args.savefname, results, nconfigs)
+        != SPLATT_SUCCESS) {
+      ret = EXIT_FAILURE;
+    } else {
+      printf("SAVED %"SPLATT_PF_IDX" RESULTS TO '%s'\n", nconfigs,
+          args.savefname);
+    }
+  }
+  if(args.basefname != NULL && ret == EXIT_SUCCESS) {
+    idx_t nbase;
+    microbench_result * base = microbench_read_results(args.basefname, &nbase);
+    if(base == NULL) {
+      ret = EXIT_FAILURE;
+    } else {
+      printf("\n");
+      if(microbench_compare(results, nconfigs, base, nbase, args.tolerance)
+          > 0) {
+        ret = EXIT_FAILURE;
+      }
+      free(base);
+    }
+    printf("\n");
+  }
+
+  splatt_free(results);
+  splatt_free(configs);
+  if(tt != NULL) {
+    tt_free(tt);
+  }
+
+  stats_mem();
+
+  return ret;
+}
@@ -4,6 +4,7 @@
  *****************************************************************************/
 #include "splatt_cmds.h"
 #include "../stats.h"
+#include "../model.h"
 
 
 /******************************************************************************
@@ -11,7 +12,10 @@
  *****************************************************************************/
 static char stats_args_doc[] = "TENSOR";
 static char stats_doc[] =
-  "splatt-stats -- Print statistics about a tensor.\n\n";
+  "splatt-stats -- Print statistics about a tensor.\n\n"
+  "With --model, also predict the cost of each MTTKRP mode for a CSF\n"
+  "configuration and one or more thread counts, without running it.\n"
+  "Compare against the 'model' column of 'splatt bench -a matrix'.\n";
 #if 0
   "Mode-independent types are:\n"
   "  basic\t\t\tPrint simple statistics\n"
@@ -20,7 +24,38 @@ static char stats_doc[] =
   "  hparts\t\tAnalyze a hypergraph partitioning\n";
 #endif
 
+#define TT_CACHE 246
+#define TT_LOCKNS 247
+#define TT_GFLOPS 248
+#define TT_THREADBW 249
+#define TT_BW 250
+#define TT_PRIV 251
+#define TT_TILELEVEL 252
+#define TT_TILE 253
+#define TT_CSF 254
+#define TT_MODEL 255
+
+#define STATS_MAXTHREADS 32
+
 static struct argp_option stats_options[] = {
+  {"model", TT_MODEL, 0, 0, "predict the cost of MTTKRP"},
+  { 0, 0, 0, 0, "Model options:", 1},
+  {"threads", 't', "LIST", 0, "comma-separated thread counts to model "
+    "(default: 1)"},
+  {"rank", 'r', "RANK", 0, "rank of decomposition (default: 10)"},
+  {"csf", TT_CSF, "ALLOC", 0, "CSF allocation {one,two,all} (default: two)"},
+  {"tile", TT_TILE, 0, 0, "use dense tiling"},
+  {"tilelevel", TT_TILELEVEL, "N", 0, "number of tiled levels (default: 1)"},
+  {"priv", TT_PRIV, "THRESH", 0, "privatization threshold (default: 0.02)"},
+  {"bw", TT_BW, "GB/s", 0, "memory bandwidth of the machine (default: 40)"},
+  {"thread-bw", TT_THREADBW, "GB/s", 0, "memory bandwidth of one thread "
+    "(default: 10)"},
+  {"gflops", TT_GFLOPS, "GFLOP/s", 0, "floating-point rate of one thread "
+    "(default: 8)"},
+  {"lock-ns", TT_LOCKNS, "NS", 0, "cost of an uncontended lock "
+    "(default: 25)"},
+  {"cache", TT_CACHE, "MB", 0, "cache size of one thread, usually L2 "
+    "(default: 1)"},
   { 0 }
 #if 0
   { "type", 't', "TYPE", 0, "type of analysis" },
@@ -37,8 +72,40 @@ typedef struct
   char * pfname;
   splatt_stats_type type;
   idx_t mode;
+
+  bool model;
+  idx_t rank;
+  idx_t nruns;
+  idx_t threads[STATS_MAXTHREADS];
+  double * opts;
+  model_machine machine;
 } stats_args;
 
+
+/**
+* @brief Parse a comma-separated list of thread counts.
+*/
+static void p_parse_threads(
+  char const * const arg,
+  stats_args * const args,
+  struct argp_state * state)
+{
+  char * copy = strdup(arg);
+  args->nruns = 0;
+  for(char * tok = strtok(copy, ","); tok != NULL; tok = strtok(NULL, ",")) {
+    if(args->nruns == STATS_MAXTHREADS) {
+      argp_error(state, "more than %d thread counts in '%s'",
+          STATS_MAXTHREADS, arg);
+    }
+    int const nthreads = atoi(tok);
+    if(nthreads <= 0) {
+      argp_error(state, "'%s' must be a positive integer", tok);
+    }
+    args->threads[args->nruns++] = (idx_t) nthreads;
+  }
+  free(copy);
+}
+
 static error_t parse_stats_opt(
   int key,
   char * arg,
@@ -51,14 +118,50 @@ static error_t parse_stats_opt(
     break;
 
   case 't':
-    if(strcmp(arg, "basic") == 0) {
-      args->type = STATS_BASIC;
-    } else if(strcmp(arg, "hparts") == 0) {
-      args->type = STATS_HPARTS;
+    p_parse_threads(arg, args, state);
+    break;
+  case 'r':
+    args->rank = (idx_t) atoi(arg);
+    break;
+
+  case TT_MODEL:
+    args->model = true;
+    break;
+  case TT_CSF:
+    if(strcmp(arg, "one") == 0) {
+      args->opts[SPLATT_OPTION_CSF_ALLOC] = SPLATT_CSF_ONEMODE;
+    } else if(strcmp(arg, "two") == 0) {
+      args->opts[SPLATT_OPTION_CSF_ALLOC] = SPLATT_CSF_TWOMODE;
+    } else if(strcmp(arg, "all") == 0) {
+      args->opts[SPLATT_OPTION_CSF_ALLOC] = SPLATT_CSF_ALLMODE;
     } else {
-      args->type = STATS_ERROR;
+      argp_error(state, "--csf option '%s' not recognized", arg);
     }
     break;
+  case TT_TILE:
+    args->opts[SPLATT_OPTION_TILE] = SPLATT_DENSETILE;
+    break;
+  case TT_TILELEVEL:
+    args->opts[SPLATT_OPTION_TILELEVEL] = (double) atoi(arg);
+    break;
+  case TT_PRIV:
+    args->opts[SPLATT_OPTION_PRIVTHRESH] = atof(arg);
+    break;
+  case TT_BW:
+    args->machine.bandwidth = atof(arg);
+    break;
+  case TT_THREADBW:
+    args->machine.thread_bw = atof(arg);
+    break;
+  case TT_GFLOPS:
+    args->machine.gflops = atof(arg);
+    break;
+  case TT_LOCKNS:
+    args->machine.lock_ns = atof(arg);
+    break;
+  case TT_CACHE:
+    args->machine.cache_mb = atof(arg);
+    break;
 
   case 'p':
     args->pfname = arg;
@@ -83,6 +186,56 @@ static error_t parse_stats_opt(
 static struct argp stats_argp =
   {stats_options, parse_stats_opt, stats_args_doc, stats_doc};
 
+
+/**
+* @brief Predict the cost of MTTKRP on 'tt' for each requested thread count.
+*/
+static void p_stats_model(
+  sptensor_t * const tt,
+  stats_args const * const args)
+{
+  static char const * const csf_names[] = {
+    [SPLATT_CSF_ONEMODE] = "ONEMODE",
+    [SPLATT_CSF_TWOMODE] = "TWOMODE",
+    [SPLATT_CSF_ALLMODE] = "ALLMODE",
+  };
+
+  double * const opts = args->opts;
+  model_machine const * const machine = &(args->machine);
+  bool const tiled =
+      (splatt_tile_type) opts[SPLATT_OPTION_TILE] != SPLATT_NOTILE;
+
+  printf("MTTKRP model ---------------------------------------------------\n");
+  printf("RANK=%"SPLATT_PF_IDX" CSF-ALLOC=%s TILE=", args->rank,
+      csf_names[(splatt_csf_type) opts[SPLATT_OPTION_CSF_ALLOC]]);
+  if(tiled) {
+    printf("DENSE TILED-MODES=%"SPLATT_PF_IDX,
+        (idx_t) opts[SPLATT_OPTION_TILELEVEL]);
+  } else {
+    printf("NO");
+  }
+  printf(" PRIV=%0.3f\n", opts[SPLATT_OPTION_PRIVTHRESH]);
+  printf("BW=%0.1fGB/s THREAD-BW=%0.1fGB/s GFLOPS=%0.1f LOCK=%0.0fns "
+      "CACHE=%0.0fMB\n\n", machine->bandwidth, machine->thread_bw,
+      machine->gflops, machine->lock_ns, machine->cache_mb);
+
+  splatt_csf * csf = NULL;
+  for(idx_t r=0; r < args->nruns; ++r) {
+    opts[SPLATT_OPTION_NTHREADS] = (double) args->threads[r];
+
+    /* dense tiles are laid out per thread, so retile for each count */
+    if(csf == NULL || tiled) {
+      if(csf != NULL) {
+        csf_free(csf, opts);
+      }
+      csf = csf_alloc(tt, opts);
+    }
+
+    stats_model(csf, args->rank, opts, machine, r);
+  }
+  csf_free(csf, opts);
+}
+
 int splatt_stats(
   int argc,
   char ** argv)
@@ -92,19 +245,30 @@ int splatt_stats(
   args.pfname = NULL;
   args.type = STATS_BASIC;
   args.mode = 0;
+  args.model = false;
+  args.rank = 10;
+  args.nruns = 1;
+  args.threads[0] = 1;
+  args.opts = splatt_default_opts();
+  model_default_machine(&(args.machine));
   argp_parse(&stats_argp, argc, argv, ARGP_IN_ORDER, 0, &args);
 
   print_header();
 
   sptensor_t * tt = tt_read(args.ifname);
   if(tt == NULL) {
+    splatt_free(args.opts);
     return SPLATT_ERROR_BADINPUT;
   }
   stats_tt(tt, args.ifname, STATS_BASIC, 0, NULL);
   if(args.type != STATS_BASIC) {
     stats_tt(tt, args.ifname, args.type, args.mode, args.pfname);
   }
+  if(args.model) {
+    p_stats_model(tt, &args);
+  }
   tt_free(tt);
+  splatt_free(args.opts);
 
   return EXIT_SUCCESS;
 }
@@ -10,6 +10,7 @@
 #include "../cpd.h"
 #include "../splatt_mpi.h"
 #include "../util.h"
+#include "../perfctr.h"
 
 
 /******************************************************************************
@@ -19,6 +20,18 @@ static char cpd_args_doc[] = "TENSOR";
 static char cpd_doc[] =
   "splatt-cpd -- Compute the CPD of a sparse tensor.\n";
 
+#define TT_REPL 239
+#define TT_NUMA 240
+#define TT_TIMELIMIT 241
+#define TT_PERF 242
+#define TT_REBALANCE 243
+#define TT_DELTA 244
+#define TT_PRECISION 245
+#define TT_COMMTHDS 246
+#define TT_DRYRUN 247
+#define TT_FUSE 248
+#define TT_NODE 249
+#define TT_COMM 250
 #define TT_REG 251
 #define TT_SEED 252
 #define TT_NOWRITE 253
@@ -27,10 +40,15 @@ static char cpd_doc[] =
 static struct argp_option cpd_options[] = {
   {"iters", 'i', "NITERS", 0, "maximum number of iterations to use (default: 50)"},
   {"tol", TT_TOL, "TOLERANCE", 0, "minimum change for convergence (default: 1e-5)"},
+  {"time-limit", TT_TIMELIMIT, "SECONDS", 0, "stop iterating before the "
+                                             "factorization exceeds SECONDS "
+                                             "(default: no limit)"},
   {"reg", TT_REG, "REGULARIZATION", 0, "regularization parameter (default: 0)"},
   {"rank", 'r', "RANK", 0, "rank of decomposition to find (default: 10)"},
   {"threads", 't', "NTHREADS", 0, "number of threads to use (default: #cores)"},
   {"tile", TT_TILE, 0, 0, "use tiling during SPLATT"},
+  {"numa", TT_NUMA, "PLACE", 0, "place memory on NUMA nodes? {off,auto,on} "
+                                "default: off"},
   {"nowrite", TT_NOWRITE, 0, 0, "do not write output to file (default: WRITE)"},
   {"seed", TT_SEED, "SEED", 0, "random seed (default: system time)"},
   {"verbose", 'v', 0, 0, "turn on verbose output (default: no)"},
@@ -39,9 +57,40 @@ static struct argp_option cpd_options[] = {
                                  " and SPLATT will determine a good dimension.\n"
                                  "\t-d 1 to use coarse-grained\n"
                                  "\t-d IxJxK to specify medium-grained (default)\n"
-                                 "\t-d f to use fine-grained (-p required)\n"
+                                 "\t-d f to use fine-grained (-p optional)\n"
+                                 "\t-d auto to choose the cheapest of all of these\n"
                                  },
-  {"partition", 'p', "FILE", 0, "MPI: partitioning file for fine-grained"},
+  {"partition", 'p', "FILE", 0, "MPI: partitioning file for fine-grained "
+                                "(default: built-in streaming partitioner)"},
+  {"comm", TT_COMM, "TYPE", 0, "MPI: row exchange pattern (default: all2all)\n"
+                               "\tp2p for point-to-point\n"
+                               "\tall2all for MPI_Alltoallv\n"
+                               "\tnbr for neighborhood collectives\n"},
+  {"repl", TT_REPL, "FRAC", 0, "MPI: replicate a mode on every rank when its "
+                              "length times #ranks is at most FRAC of the "
+                              "nonzeros (default: 0, off)"},
+  {"node-reduce", TT_NODE, 0, 0, "MPI: reduce through shared memory within "
+                                 "each node before going across nodes"},
+  {"comm-threads", TT_COMMTHDS, 0, 0, "MPI: with --comm=p2p, each thread "
+                                     "packs and exchanges rows with its own "
+                                     "peers (needs MPI_THREAD_MULTIPLE)"},
+  {"comm-precision", TT_PRECISION, "TYPE", 0, "MPI: precision of exchanged "
+                                             "factor rows (default: full)\n"
+                                             "\tfull, fp32, or bf16\n"},
+  {"comm-delta", TT_DELTA, "THRESH", 0, "MPI: only send factor rows whose "
+                                       "relative change since they were last "
+                                       "sent exceeds THRESH (default: 0)"},
+  {"rebalance", TT_REBALANCE, "NITERS", 0, "MPI: after NITERS iterations, move "
+                                          "nonzeros from ranks with slow "
+                                          "MTTKRP to fast ones (default: off)"},
+  {"perf", TT_PERF, 0, 0, "sample hardware counters around MTTKRP and the "
+                         "dense kernels (Linux only)"},
+  {"dry-run", TT_DRYRUN, 0, 0, "estimate peak memory, then distribute the "
+                               "tensor and compare the decomposition model "
+                               "and memory estimate to measurements, but do "
+                               "not factor"},
+  {"fuse", TT_FUSE, 0, 0, "MPI: reduce the Gram matrix, column norms, and fit "
+                         "with one allreduce per mode"},
   { 0 }
 };
 
@@ -55,6 +104,7 @@ typedef struct
   splatt_decomp_type decomp;
   int mpi_dims[MAX_NMODES];
   char * pfname;   /** file that we read the partitioning from */
+  int dryrun;      /** stop after distribution and report the model */
 } cpd_cmd_args;
 
 
@@ -71,6 +121,7 @@ static void default_cpd_opts(
   args->pfname    = NULL;
   args->write     = DEFAULT_WRITE;
   args->nfactors  = DEFAULT_NFACTORS;
+  args->dryrun    = 0;
 
   args->decomp = DEFAULT_MPI_DISTRIBUTION;
   for(idx_t m=0; m < MAX_NMODES; ++m) {
@@ -101,6 +152,9 @@ static error_t parse_cpd_opt(
   case TT_TOL:
     args->opts[SPLATT_OPTION_TOLERANCE] = atof(arg);
     break;
+  case TT_TIMELIMIT:
+    args->opts[SPLATT_OPTION_TIMELIMIT] = atof(arg);
+    break;
   case TT_REG:
     args->opts[SPLATT_OPTION_REGULARIZE] = atof(arg);
     break;
@@ -121,6 +175,11 @@ static error_t parse_cpd_opt(
     args->nfactors = atoi(arg);
     break;
   case 'd':
+    /* let the cost model choose */
+    if(strcmp(arg, "auto") == 0) {
+      args->decomp = AUTO_MPI_DISTRIBUTION;
+      break;
+    }
     /* fine-grained decomp */
     if(arg[0] == 'f') {
       args->opts[SPLATT_OPTION_DECOMP] = SPLATT_DECOMP_FINE;
@@ -146,6 +205,66 @@ static error_t parse_cpd_opt(
   case TT_SEED:
     args->opts[SPLATT_OPTION_RANDSEED] = atoi(arg);
     break;
+  case TT_REPL:
+    args->opts[SPLATT_OPTION_REPLTHRESH] = atof(arg);
+    break;
+  case TT_NODE:
+    args->opts[SPLATT_OPTION_NODE_REDUCE] = 1;
+    break;
+  case TT_COMMTHDS:
+    args->opts[SPLATT_OPTION_COMM_THREADS] = 1;
+    break;
+  case TT_DRYRUN:
+    args->dryrun = 1;
+    break;
+  case TT_PRECISION:
+    if(strcmp(arg, "full") == 0) {
+      args->opts[SPLATT_OPTION_COMM_PRECISION] = SPLATT_PRECISION_FULL;
+    } else if(strcmp(arg, "fp32") == 0) {
+      args->opts[SPLATT_OPTION_COMM_PRECISION] = SPLATT_PRECISION_FP32;
+    } else if(strcmp(arg, "bf16") == 0) {
+      args->opts[SPLATT_OPTION_COMM_PRECISION] = SPLATT_PRECISION_BF16;
+    } else {
+      fprintf(stderr, "SPLATT: unknown communication precision '%s'\n", arg);
+      argp_usage(state);
+    }
+    break;
+  case TT_DELTA:
+    args->opts[SPLATT_OPTION_COMM_DELTA] = atof(arg);
+    break;
+  case TT_REBALANCE:
+    args->opts[SPLATT_OPTION_REBALANCE] = (double) atoi(arg);
+    break;
+  case TT_NUMA:
+    if(strcmp("off", arg) == 0) {
+      args->opts[SPLATT_OPTION_NUMA] = SPLATT_NUMA_OFF;
+    } else if(strcmp("auto", arg) == 0) {
+      args->opts[SPLATT_OPTION_NUMA] = SPLATT_NUMA_AUTO;
+    } else if(strcmp("on", arg) == 0) {
+      args->opts[SPLATT_OPTION_NUMA] = SPLATT_NUMA_ON;
+    } else {
+      fprintf(stderr, "SPLATT: --numa option '%s' not recognized.\n", arg);
+      argp_usage(state);
+    }
+    break;
+  case TT_PERF:
+    perfctr_init();
+    break;
+  case TT_FUSE:
+    args->opts[SPLATT_OPTION_FUSE_REDUCE] = 1;
+    break;
+  case TT_COMM:
+    if(strcmp(arg, "p2p") == 0) {
+      args->opts[SPLATT_OPTION_COMM] = SPLATT_COMM_POINT2POINT;
+    } else if(strcmp(arg, "all2all") == 0) {
+      args->opts[SPLATT_OPTION_COMM] = SPLATT_COMM_ALL2ALL;
+    } else if(strcmp(arg, "nbr") == 0) {
+      args->opts[SPLATT_OPTION_COMM] = SPLATT_COMM_NEIGHBOR;
+    } else {
+      fprintf(stderr, "SPLATT: unknown communication pattern '%s'\n", arg);
+      argp_usage(state);
+    }
+    break;
 
   case ARGP_KEY_ARG:
     if(args->ifname != NULL) {
@@ -159,6 +278,12 @@ static error_t parse_cpd_opt(
       argp_usage(state);
       break;
     }
+    if(args->opts[SPLATT_OPTION_COMM_THREADS] > 0 &&
+        args->opts[SPLATT_OPTION_COMM] != SPLATT_COMM_POINT2POINT) {
+      fprintf(stderr, "SPLATT: --comm-threads requires --comm=p2p\n");
+      argp_usage(state);
+      break;
+    }
   }
   return 0;
 }
@@ -167,6 +292,117 @@ static struct argp cpd_argp =
   {cpd_options, parse_cpd_opt, cpd_args_doc, cpd_doc};
 
 
+/**
+* @brief Allocate the local factor matrices used by MTTKRP, and the MTTKRP
+*        output at mats[MAX_NMODES].
+*
+* @param csf The local tensor.
+* @param rinfo MPI rank information.
+* @param nfactors The rank of the decomposition.
+* @param mats The matrices to allocate.
+*/
+static void p_alloc_local_mats(
+  splatt_csf const * const csf,
+  rank_info const * const rinfo,
+  idx_t const nfactors,
+  matrix_t ** mats)
+{
+  idx_t const nmodes = csf->nmodes;
+  idx_t max_dim = 0;
+  for(idx_t m=0; m < nmodes; ++m) {
+    /* ft[:] have different dimensionalities for 1D but ft[m+1] is guaranteed
+     * to have the full dimensionality
+     * */
+    idx_t dim = csf->dims[m];
+    if(rinfo->decomp == SPLATT_DECOMP_COARSE) {
+      dim = csf[(m+1)%nmodes].dims[m];
+    }
+    max_dim = SS_MAX(max_dim, dim);
+
+    /* for MTTKRP */
+    mats[m] = mat_alloc(dim, nfactors);
+  }
+  mats[MAX_NMODES] = mat_alloc(max_dim, nfactors);
+}
+
+
+
+/**
+* @brief What the rebalancing hook needs from the driver. The hook frees 'tt'
+*        and replaces 'csf' if nonzeros moved.
+*/
+typedef struct
+{
+  sptensor_t * tt;
+  permutation_t * perm;
+  splatt_csf * csf;
+  idx_t nfactors;
+  double const * opts;
+} p_rebalance_state;
+
+
+/**
+* @brief Rebalance the nonzeros with mpi_rebalance() in the middle of the
+*        factorization. This is an mpi_cpd_hook.
+*/
+static splatt_csf const * p_rebalance_hook(
+  matrix_t ** mats,
+  matrix_t ** globmats,
+  rank_info * const rinfo,
+  void * data)
+{
+  p_rebalance_state * const state = data;
+
+  sptensor_t * newtt = mpi_rebalance(state->tt, state->perm, globmats, rinfo,
+      state->nfactors, state->opts);
+  tt_free(state->tt);
+  state->tt = NULL;
+  if(newtt == NULL) {
+    return NULL;
+  }
+  mpi_rank_stats(newtt, rinfo);
+
+  splatt_csf_free(state->csf, state->opts);
+  state->csf = splatt_csf_alloc(newtt, state->opts);
+  tt_free(newtt);
+
+  for(idx_t m=0; m < state->csf->nmodes; ++m) {
+    mat_free(mats[m]);
+  }
+  mat_free(mats[MAX_NMODES]);
+  p_alloc_local_mats(state->csf, rinfo, state->nfactors, mats);
+  return state->csf;
+}
+
+
+/**
+* @brief Estimate the peak memory of each rank before reading the tensor. The
+*        estimate assumes that nonzeros are evenly balanced and, as an upper
+*        bound, that each rank touches every row of the factors.
+*
+* @param args The command arguments.
+* @param npes The number of ranks.
+*/
+static void p_estimate_mem(
+  cpd_cmd_args const * const args,
+  int const npes)
+{
+  idx_t nmodes;
+  idx_t nnz;
+  idx_t dims[MAX_NMODES];
+  if(tt_read_dims(args->ifname, &nmodes, &nnz, dims) != SPLATT_SUCCESS) {
+    return;
+  }
+
+  idx_t const localnnz = (nnz + npes - 1) / npes;
+  splatt_mem_usage est;
+  cpd_mem_estimate(nmodes, dims, localnnz, args->nfactors, args->opts, &est);
+  printf("NNZ/RANK=%"SPLATT_PF_IDX" NFACTORS=%"SPLATT_PF_IDX"\n\n", localnnz,
+      args->nfactors);
+  stats_mem_estimate(&est);
+}
+
+
 
 /******************************************************************************
  * SPLATT-CPD
@@ -189,6 +425,9 @@ int splatt_mpi_cpd_cmd(
   MPI_Comm_rank(MPI_COMM_WORLD, &rinfo.rank);
   MPI_Comm_size(MPI_COMM_WORLD, &rinfo.npes);
 
+  /* bookkeeping which no other subsystem claims is for distribution */
+  splatt_mem_tag const prev_tag = mem_tag_begin(SPLATT_MEM_MPI);
+
   rinfo.decomp = args.decomp;
   for(idx_t d=0; d < MAX_NMODES; ++d) {
     rinfo.dims_3d[d] = SS_MAX(args.mpi_dims[d], 1);
@@ -198,8 +437,13 @@ int splatt_mpi_cpd_cmd(
     print_header();
   }
 
+  if(args.dryrun && rinfo.rank == 0) {
+    p_estimate_mem(&args, rinfo.npes);
+  }
+
   tt = mpi_tt_read(args.ifname, args.pfname, &rinfo);
   if(tt == NULL) {
+    mem_tag_end(prev_tag);
     return SPLATT_ERROR_BADINPUT;
   }
 
@@ -229,18 +473,21 @@ int splatt_mpi_cpd_cmd(
     /* coarse-grained forces us to use ALLMODE. override default opts. */
     args.opts[SPLATT_OPTION_CSF_ALLOC] = SPLATT_CSF_ALLMODE;
 
-    sptensor_t * tt_filtered = tt_alloc(tt->nnz, tt->nmodes);
     for(idx_t m=0; m < tt->nmodes; ++m) {
+      /* building the CSF sorts the filtered tensor and may shrink it */
+      sptensor_t * tt_filtered = tt_alloc(tt->nnz, tt->nmodes);
 
       /* tt has more nonzeros than any of the modes actually need, so we need
        * to filter them first. */
       mpi_filter_tt_1d(m, tt, tt_filtered, rinfo.mat_start[m],
           rinfo.mat_end[m]);
-      assert(tt_filtered->dims[m] == rinfo.mat_end[m] - rinfo.mat_start[m]);
 
-      mpi_cpy_indmap(tt_filtered, &rinfo, m);
+      /* slices of my slab without nonzeros were compressed away, so the
+       * global rows are found through the indmap of tt */
+      mpi_cpy_indmap(tt, &rinfo, m);
 
       mpi_find_owned(tt, m, &rinfo);
+      assert(tt_filtered->dims[m] == rinfo.nowned[m]);
       mpi_compute_ineed(&rinfo, tt, m, args.nfactors, 1);
 
       /* fill csf[m] */
@@ -253,10 +500,9 @@ int splatt_mpi_cpd_cmd(
       if(rinfo.rank == 0) {
         assert(totnnz == rinfo.global_nnz);
       }
+      tt_free(tt_filtered);
     } /* foreach mode */
 
-    tt_free(tt_filtered);
-
   /* 3D distribution is simpler */
   } else {
     /* compress tensor to own local coordinate system */
@@ -279,40 +525,74 @@ int splatt_mpi_cpd_cmd(
   mpi_rank_stats(tt, &rinfo);
 
   idx_t const nmodes = tt->nmodes;
-  tt_free(tt);
+
+  if(args.dryrun) {
+    mpi_decomp_report(tt, &rinfo);
+    mpi_mem_stats(&rinfo);
+    tt_free(tt);
+    splatt_csf_free(csf, args.opts);
+    splatt_free(args.opts);
+    perm_free(perm);
+    rank_free(rinfo, nmodes);
+    mem_tag_end(prev_tag);
+    return EXIT_SUCCESS;
+  }
+
+  /* the local tensor is redistributed after the first iterations */
+  idx_t const niters = (idx_t) args.opts[SPLATT_OPTION_NITER];
+  idx_t const rebal_its = (idx_t) args.opts[SPLATT_OPTION_REBALANCE];
+  bool rebalance = rebal_its > 0 && rebal_its < niters;
+  if(rebalance && rinfo.decomp == SPLATT_DECOMP_COARSE) {
+    if(rinfo.rank == 0) {
+      fprintf(stderr, "SPLATT: rebalancing is not supported with a "
+                      "coarse-grained decomposition.\n");
+    }
+    rebalance = false;
+  }
+  if(!rebalance) {
+    tt_free(tt);
+  }
 
   /* allocate / initialize matrices */
-  idx_t max_dim = 0;
 
   /* M, the result matrix is stored at mats[MAX_NMODES] */
   matrix_t * mats[MAX_NMODES+1];
   matrix_t * globmats[MAX_NMODES];
 
   for(idx_t m=0; m < nmodes; ++m) {
-    /* ft[:] have different dimensionalities for 1D but ft[m+1] is guaranteed
-     * to have the full dimensionality
-     * */
-    idx_t dim = csf->dims[m];
-    if(rinfo.decomp == SPLATT_DECOMP_COARSE) {
-      dim = csf[(m+1)%nmodes].dims[m];
-    }
-    max_dim = SS_MAX(max_dim, dim);
-
     /* actual factor */
     globmats[m] = mpi_mat_rand(m, args.nfactors, perm, &rinfo);
-
-    /* for MTTKRP */
-    mats[m] = mat_alloc(dim, args.nfactors);
   }
-  mats[MAX_NMODES] = mat_alloc(max_dim, args.nfactors);
+  p_alloc_local_mats(csf, &rinfo, args.nfactors, mats);
 
   val_t * lambda = (val_t *) splatt_malloc(args.nfactors * sizeof(val_t));
 
   mpi_cpd_stats(csf, args.nfactors, args.opts, &rinfo);
 
+  /* measure MTTKRP on each rank for a few iterations, then redistribute */
+  p_rebalance_state rstate;
+  mpi_cpd_hook hook;
+  if(rebalance) {
+    rstate.tt = tt;
+    rstate.perm = perm;
+    rstate.csf = csf;
+    rstate.nfactors = args.nfactors;
+    rstate.opts = args.opts;
+    hook.after_its = rebal_its;
+    hook.func = p_rebalance_hook;
+    hook.data = &rstate;
+  }
+
   /* do the factorization! */
   mpi_cpd_als_iterate(csf, mats, globmats, lambda, args.nfactors, &rinfo,
-      args.opts);
+      args.opts, rebalance ? &hook : NULL);
+  if(rebalance) {
+    /* the hook does not run if we converged first */
+    csf = rstate.csf;
+    if(rstate.tt != NULL) {
+      tt_free(rstate.tt);
+    }
+  }
 
   /* free up the ftensor allocations */
   splatt_csf_free(csf, args.opts);
@@ -329,11 +609,19 @@ int splatt_mpi_cpd_cmd(
     mat_free(globmats[m]);
   }
   mat_free(mats[MAX_NMODES]);
-  free(lambda);
-  free(args.opts);
+  splatt_free(lambda);
+  splatt_free(args.opts);
 
   perm_free(perm);
   rank_free(rinfo, nmodes);
+
+  /* report after everything is freed, so that live bytes are only what
+   * outlives the factorization */
+  if(rinfo.rank == 0) {
+    printf("\n");
+  }
+  mpi_mem_stats(&rinfo);
+  mem_tag_end(prev_tag);
   return EXIT_SUCCESS;
 }
 
@@ -5,6 +5,8 @@
 #include "splatt_cmds.h"
 #include "../timer.h"
 #include "../util.h"
+#include "../perfctr.h"
+#include "../trace.h"
 
 #ifdef SPLATT_USE_MPI
 #include <mpi.h>
@@ -68,6 +70,105 @@ static error_t parse_cmd(
 static struct argp cmd_argp = { 0, parse_cmd, cmd_args_doc, cmd_doc };
 
 
+/**
+* @brief Options which are shared by all commands. These may appear anywhere
+*        after the command and are removed before the command parses argv.
+*/
+typedef struct
+{
+  char const * metrics_fname;
+  splatt_metrics_format metrics_format;
+  char const * trace_fname;
+  splatt_hugepage_type hugepages;
+  uint64_t hugepage_min;
+} global_opts;
+
+
+/**
+* @brief Return the value of option 'name' at argv[*a], which is given either
+*        as '--name=VAL' or '--name VAL'. On a match, *a is advanced past any
+*        separate value.
+*/
+static char * p_opt_value(
+  char const * const name,
+  int const argc,
+  char ** argv,
+  int * const a)
+{
+  size_t const len = strlen(name);
+  if(strncmp(argv[*a], name, len) != 0) {
+    return NULL;
+  }
+  if(argv[*a][len] == '=') {
+    return argv[*a] + len + 1;
+  }
+  if(argv[*a][len] == '\0' && *a + 1 < argc) {
+    ++(*a);
+    return argv[*a];
+  }
+  return NULL;
+}
+
+
+/**
+* @brief Extract the global options from argv.
+*
+* @return The new argc, or -1 on an invalid option.
+*/
+static int p_parse_global_opts(
+  int argc,
+  char ** argv,
+  global_opts * const gopts)
+{
+  gopts->metrics_fname = NULL;
+  gopts->metrics_format = SPLATT_METRICS_JSON;
+  gopts->trace_fname = NULL;
+  gopts->hugepages = SPLATT_HUGEPAGE_OFF;
+  gopts->hugepage_min = 16UL * 1024UL * 1024UL;
+
+  int nargs = 0;
+  for(int a=0; a < argc; ++a) {
+    char * val;
+    if((val = p_opt_value("--metrics-out", argc, argv, &a)) != NULL) {
+      gopts->metrics_fname = val;
+    } else if((val = p_opt_value("--trace", argc, argv, &a)) != NULL) {
+      gopts->trace_fname = val;
+    } else if((val = p_opt_value("--hugepages", argc, argv, &a)) != NULL) {
+      if(strcmp(val, "off") == 0) {
+        gopts->hugepages = SPLATT_HUGEPAGE_OFF;
+      } else if(strcmp(val, "thp") == 0) {
+        gopts->hugepages = SPLATT_HUGEPAGE_THP;
+      } else if(strcmp(val, "hugetlb") == 0) {
+        gopts->hugepages = SPLATT_HUGEPAGE_HUGETLB;
+      } else {
+        fprintf(stderr, "SPLATT: unknown huge page mode '%s'\n", val);
+        return -1;
+      }
+    } else if((val = p_opt_value("--hugepage-min", argc, argv, &a)) != NULL) {
+      double const bytes = strtod(val, NULL);
+      if(bytes < 0.) {
+        fprintf(stderr, "SPLATT: --hugepage-min must not be negative\n");
+        return -1;
+      }
+      gopts->hugepage_min = (uint64_t) bytes;
+    } else if((val = p_opt_value("--metrics-format", argc, argv, &a)) != NULL) {
+      if(strcmp(val, "json") == 0) {
+        gopts->metrics_format = SPLATT_METRICS_JSON;
+      } else if(strcmp(val, "csv") == 0) {
+        gopts->metrics_format = SPLATT_METRICS_CSV;
+      } else {
+        fprintf(stderr, "SPLATT: unknown metrics format '%s'\n", val);
+        return -1;
+      }
+    } else {
+      argv[nargs++] = argv[a];
+    }
+  }
+  argv[nargs] = NULL;
+  return nargs;
+}
+
+
 
 /******************************************************************************
  * SPLATT MAIN
@@ -81,7 +182,17 @@ int main(
 
   int rank = 0;
 #ifdef SPLATT_USE_MPI
-  MPI_Init(&argc, &argv);
+  /* Only --comm-threads has threads talking concurrently. MULTIPLE can slow
+   * every message down, so other runs ask for FUNNELED. If the library cannot
+   * provide MPI_THREAD_MULTIPLE, only the master thread talks. */
+  int required = MPI_THREAD_FUNNELED;
+  for(int a=1; a < argc; ++a) {
+    if(strcmp(argv[a], "--comm-threads") == 0) {
+      required = MPI_THREAD_MULTIPLE;
+    }
+  }
+  int provided;
+  MPI_Init_thread(&argc, &argv, required, &provided);
 
   int size;
   MPI_Comm_rank(MPI_COMM_WORLD, &rank);
@@ -94,6 +205,23 @@ int main(
   init_timers();
   timer_start(&timers[TIMER_ALL]);
 
+  /* strip options shared by all commands */
+  global_opts gopts;
+  argc = p_parse_global_opts(argc, argv, &gopts);
+  if(argc < 0) {
+#ifdef SPLATT_USE_MPI
+    MPI_Finalize();
+#endif
+    return SPLATT_ERROR_BADINPUT;
+  }
+  if(gopts.metrics_fname != NULL) {
+    splatt_metrics_enable();
+  }
+  if(gopts.trace_fname != NULL) {
+    trace_init(gopts.trace_fname);
+  }
+  splatt_mem_set_hugepages(gopts.hugepages, gopts.hugepage_min);
+
   /* parse argv[0:1] */
   cmd_struct args;
   int nargs = argc > 1 ? 2 : 1;
@@ -110,8 +238,18 @@ int main(
   timer_stop(&timers[TIMER_ALL]);
   if(rank == 0) {
     report_times();
+    perfctr_report(timer_lvl == TIMER_NTIMERS);
     printf("****************************************************************\n");
   }
+  if(rank == 0 && gopts.metrics_fname != NULL) {
+    splatt_metrics_write(gopts.metrics_fname, gopts.metrics_format);
+  }
+  perfctr_finalize();
+#ifdef SPLATT_USE_MPI
+  trace_finalize(rank, size);
+#else
+  trace_finalize(rank, 1);
+#endif
 
 #ifdef SPLATT_USE_MPI
   MPI_Finalize();
@@ -20,9 +20,19 @@ static char cmd_doc[] =
   "  bench\t\tBenchmark MTTKRP algorithms.\n"
   "  check\t\tCheck a tensor file for correctness.\n"
   "  convert\tConvert a tensor to different formats.\n"
+  "  generate\tGenerate a synthetic tensor.\n"
+  "  microbench\tBenchmark the kernels of CPD in isolation.\n"
   "  reorder\t\tReorder a tensor using one of several methods.\n"
   "  stats\t\tPrint tensor statistics.\n"
-  "  help\t\tPrint this help message.\n";
+  "  help\t\tPrint this help message.\n\n"
+  "Options accepted by every command:\n"
+  "  --metrics-out=FILE\tWrite timers and statistics to FILE.\n"
+  "  --metrics-format=FMT\tFormat of FILE: json (default) or csv.\n"
+  "  --trace=FILE\t\tWrite a timeline of kernels to FILE (Chrome trace\n"
+  "\t\t\tformat, for Perfetto). Requires --with-trace.\n"
+  "  --hugepages=MODE\tBack large arrays with 2MB pages: off (default),\n"
+  "\t\t\tthp (transparent), or hugetlb (reserved pool).\n"
+  "  --hugepage-min=BYTES\tSmallest array given huge pages (default: 16MB).\n";
 
 
 /**
@@ -56,6 +66,8 @@ int splatt_cpd_cmd(int argc, char ** argv);
 int splatt_bench(int argc, char ** argv);
 int splatt_check(int argc, char ** argv);
 int splatt_convert(int argc, char ** argv);
+int splatt_generate(int argc, char ** argv);
+int splatt_microbench(int argc, char ** argv);
 int splatt_reorder(int argc, char ** argv);
 int splatt_stats(int argc, char ** argv);
 
@@ -84,6 +96,8 @@ static cmd_struct const splatt_cmds[] = {
   { "bench", splatt_bench },
   { "check", splatt_check },
   { "convert", splatt_convert },
+  { "generate", splatt_generate },
+  { "microbench", splatt_microbench },
   { "reorder", splatt_reorder },
   { "stats", splatt_stats },
   { "help", NULL},
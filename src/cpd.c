@@ -7,14 +7,28 @@
 #include "cpd.h"
 #include "matrix.h"
 #include "mttkrp.h"
+#include "mutex_pool.h"
 #include "timer.h"
 #include "thd_info.h"
 #include "util.h"
+#include "metrics.h"
+#include "placement.h"
+#include "affinity.h"
 
 #include <math.h>
 
 
 
+/******************************************************************************
+ * PRIVATE STRUCTURES
+ *****************************************************************************/
+
+/* registered with splatt_cpd_set_callback() */
+static splatt_cpd_callback cpd_callback = NULL;
+static void * cpd_callback_data = NULL;
+
+
+
 /******************************************************************************
  * API FUNCTIONS
  *****************************************************************************/
@@ -32,6 +46,8 @@ int splatt_cpd_als(
   rank_info rinfo;
   rinfo.rank = 0;
 
+  affinity_bind(options);
+
   /* allocate factor matrices */
   idx_t maxdim = tensors->dims[argmax_elem(tensors->dims, nmodes)];
   for(idx_t m=0; m < nmodes; ++m) {
@@ -39,7 +55,9 @@ int splatt_cpd_als(
   }
   mats[MAX_NMODES] = mat_alloc(maxdim, nfactors);
 
+  splatt_mem_tag const prev_tag = mem_tag_begin(SPLATT_MEM_MATRICES);
   val_t * lambda = (val_t *) splatt_malloc(nfactors * sizeof(val_t));
+  mem_tag_end(prev_tag);
 
   /* do the factorization! */
   factored->fit = cpd_als_iterate(tensors, mats, lambda, nfactors, &rinfo,
@@ -57,18 +75,27 @@ int splatt_cpd_als(
   /* clean up */
   mat_free(mats[MAX_NMODES]);
   for(idx_t m=0; m < nmodes; ++m) {
-    free(mats[m]); /* just the matrix_t ptr, data is safely in factored */
+    splatt_free(mats[m]); /* just the matrix_t ptr, data is safely in factored */
   }
   return SPLATT_SUCCESS;
 }
 
 
+void splatt_cpd_set_callback(
+    splatt_cpd_callback callback,
+    void * data)
+{
+  cpd_callback = callback;
+  cpd_callback_data = data;
+}
+
+
 void splatt_free_kruskal(
     splatt_kruskal * factored)
 {
-  free(factored->lambda);
+  splatt_free(factored->lambda);
   for(idx_t m=0; m < factored->nmodes; ++m) {
-    free(factored->factors[m]);
+    splatt_free(factored->factors[m]);
   }
 }
 
@@ -96,11 +123,62 @@ static void p_reset_cpd_timers(
   timer_reset(&timers[TIMER_MPI_NORM]);
   timer_reset(&timers[TIMER_MPI_UPDATE]);
   timer_reset(&timers[TIMER_MPI_FIT]);
+  timer_reset(&timers[TIMER_MPI_FUSED]);
   MPI_Barrier(rinfo->comm_3d);
 #endif
 }
 
 
+/**
+* @brief Print the NUMA nodes which hold the CSF tensors, factor matrices, and
+*        thread scratch of a factorization.
+*
+* @param tensors The CSF tensors.
+* @param mats The factor matrices, and the MTTKRP output at MAX_NMODES.
+* @param thds Thread structures.
+* @param ws The MTTKRP workspace.
+* @param nthreads The number of threads.
+*/
+static void p_numa_report(
+  splatt_csf const * const tensors,
+  matrix_t ** mats,
+  thd_info const * const thds,
+  splatt_mttkrp_ws const * const ws,
+  idx_t const nthreads)
+{
+  printf("NUMA placement -------------------------------------------------\n");
+  printf("  NODES=%d\n", numa_nnodes());
+
+  numa_placement placement;
+  memset(&placement, 0, sizeof(placement));
+  for(idx_t c=0; c < ws->num_csf; ++c) {
+    csf_numa_count(tensors + c, nthreads, &placement);
+  }
+  numa_print_placement("CSF", "csf", &placement);
+
+  memset(&placement, 0, sizeof(placement));
+  for(idx_t m=0; m < tensors->nmodes; ++m) {
+    numa_count(mats[m]->vals, mats[m]->I * mats[m]->J * sizeof(val_t),
+        &placement);
+  }
+  numa_count(mats[MAX_NMODES]->vals, mem_bytes_of(mats[MAX_NMODES]->vals),
+      &placement);
+  numa_print_placement("FACTORS", "factors", &placement);
+
+  memset(&placement, 0, sizeof(placement));
+  for(idx_t t=0; t < nthreads; ++t) {
+    for(idx_t s=0; s < thds[t].nscratch; ++s) {
+      numa_count_thread(thds[t].scratch[s], mem_bytes_of(thds[t].scratch[s]),
+          t, nthreads, &placement);
+    }
+    numa_count_thread(ws->privatize_buffer[t],
+        mem_bytes_of(ws->privatize_buffer[t]), t, nthreads, &placement);
+  }
+  numa_print_placement("SCRATCH", "scratch", &placement);
+  printf("\n");
+}
+
+
 /**
 * @brief Find the Frobenius norm squared of a Kruskal tensor. This equivalent
 *        to via computing <X,X>, the inner product of X with itself. We find
@@ -153,24 +231,20 @@ static val_t p_kruskal_norm(
 
 
 /**
-* @brief Compute the inner product of a Kruskal tensor and an unfactored
-*        tensor. Assumes that 'm1' contains the MTTKRP result along the last
-*        mode of the two input tensors. This naturally follows the end of a
-*        CPD iteration.
+* @brief Accumulate the calling thread's share of the inner product of a
+*        Kruskal tensor and an unfactored tensor. This must be called by every
+*        thread of a parallel region.
 *
 * @param nmodes The number of modes in the input tensors.
-* @param rinfo MPI rank information.
 * @param thds OpenMP thread data structures.
 * @param lambda The vector of column norms.
 * @param mats The Kruskal-tensor matrices.
 * @param m1 The result of doing MTTKRP along the last mode.
 *
-* @return The inner product of the two tensors, computed via:
-*         1^T hadamard(mats[nmodes-1], m1) \lambda.
+* @return The calling thread's partial sum.
 */
-static val_t p_tt_kruskal_inner(
+static val_t p_tt_kruskal_partial(
   idx_t const nmodes,
-  rank_info * const rinfo,
   thd_info * const thds,
   val_t const * const restrict lambda,
   matrix_t ** mats,
@@ -183,27 +257,41 @@ static val_t p_tt_kruskal_inner(
   val_t const * const m0 = mats[lastm]->vals;
   val_t const * const mv = m1->vals;
 
-  val_t myinner = 0;
-  #pragma omp parallel reduction(+:myinner)
-  {
-    int const tid = splatt_omp_get_thread_num();
-    val_t * const restrict accumF = (val_t *) thds[tid].scratch[0];
+  int const tid = splatt_omp_get_thread_num();
+  val_t * const restrict accumF = (val_t *) thds[tid].scratch[0];
 
-    for(idx_t r=0; r < rank; ++r) {
-      accumF[r] = 0.;
-    }
+  for(idx_t r=0; r < rank; ++r) {
+    accumF[r] = 0.;
+  }
 
-    #pragma omp for
-    for(idx_t i=0; i < dim; ++i) {
-      for(idx_t r=0; r < rank; ++r) {
-        accumF[r] += m0[r+(i*rank)] * mv[r+(i*rank)];
-      }
-    }
-    /* accumulate everything into 'myinner' */
+  #pragma omp for
+  for(idx_t i=0; i < dim; ++i) {
     for(idx_t r=0; r < rank; ++r) {
-      myinner += accumF[r] * lambda[r];
+      accumF[r] += m0[r+(i*rank)] * mv[r+(i*rank)];
     }
   }
+
+  /* accumulate everything into 'myinner' */
+  val_t myinner = 0;
+  for(idx_t r=0; r < rank; ++r) {
+    myinner += accumF[r] * lambda[r];
+  }
+  return myinner;
+}
+
+
+/**
+* @brief Sum the inner product over MPI ranks.
+*
+* @param myinner This rank's inner product.
+* @param rinfo MPI rank information.
+*
+* @return The global inner product.
+*/
+static val_t p_allreduce_inner(
+  val_t myinner,
+  rank_info * const rinfo)
+{
   val_t inner = 0.;
 
 #ifdef SPLATT_USE_MPI
@@ -218,6 +306,109 @@ static val_t p_tt_kruskal_inner(
 }
 
 
+/**
+* @brief Compute the inner product of a Kruskal tensor and an unfactored
+*        tensor. Assumes that 'm1' contains the MTTKRP result along the last
+*        mode of the two input tensors. This naturally follows the end of a
+*        CPD iteration.
+*
+* @param nmodes The number of modes in the input tensors.
+* @param rinfo MPI rank information.
+* @param thds OpenMP thread data structures.
+* @param lambda The vector of column norms.
+* @param mats The Kruskal-tensor matrices.
+* @param m1 The result of doing MTTKRP along the last mode.
+*
+* @return The inner product of the two tensors, computed via:
+*         1^T hadamard(mats[nmodes-1], m1) \lambda.
+*/
+static val_t p_tt_kruskal_inner(
+  idx_t const nmodes,
+  rank_info * const rinfo,
+  thd_info * const thds,
+  val_t const * const restrict lambda,
+  matrix_t ** mats,
+  matrix_t const * const m1)
+{
+  val_t myinner = 0;
+  #pragma omp parallel reduction(+:myinner)
+  myinner += p_tt_kruskal_partial(nmodes, thds, lambda, mats, m1);
+
+  return p_allreduce_inner(myinner, rinfo);
+}
+
+
+/**
+* @brief Like p_tt_kruskal_inner(), but inside a parallel region. Partial sums
+*        are added in thread order, so the result does not depend on timing.
+*
+*        NOTE: this must be called by every thread of the team.
+*
+* @return The inner product on the master thread, and 0 on the others.
+*/
+static val_t p_tt_kruskal_inner_team(
+  idx_t const nmodes,
+  rank_info * const rinfo,
+  thd_info * const thds,
+  val_t const * const restrict lambda,
+  matrix_t ** mats,
+  matrix_t const * const m1)
+{
+  val_t const mine = p_tt_kruskal_partial(nmodes, thds, lambda, mats, m1);
+
+  /* the scratch is no longer needed, so publish the partial sum in it */
+  int const tid = splatt_omp_get_thread_num();
+  ((val_t *) thds[tid].scratch[0])[0] = mine;
+  #pragma omp barrier
+
+  val_t inner = 0.;
+  #pragma omp master
+  {
+    int const nthreads = splatt_omp_get_num_threads();
+    val_t myinner = 0.;
+    for(int t=0; t < nthreads; ++t) {
+      myinner += ((val_t *) thds[t].scratch[0])[0];
+    }
+    inner = p_allreduce_inner(myinner, rinfo);
+  }
+  return inner;
+}
+
+
+/**
+* @brief Compute the fit of a Kruskal tensor from its inner product with the
+*        input tensor.
+*
+* @param nmodes The number of modes in the input tensors.
+* @param ttnormsq The norm (squared) of the original input tensor, <X,X>.
+* @param lambda The vector of column norms.
+* @param aTa An array of matrices (length MAX_NMODES)containing BtB, CtC, etc.
+* @param inner The inner product of the tensors, <X,Z>.
+*
+* @return The fit.
+*/
+static val_t p_fit_of_inner(
+  idx_t const nmodes,
+  val_t const ttnormsq,
+  val_t const * const restrict lambda,
+  matrix_t ** aTa,
+  val_t const inner)
+{
+  /* First get norm of new model: lambda^T * (hada aTa) * lambda. */
+  val_t const norm_mats = p_kruskal_norm(nmodes, lambda, aTa);
+
+  /*
+   * We actually want sqrt(<X,X> + <Y,Y> - 2<X,Y>), but if the fit is perfect
+   * just make it 0.
+   */
+  val_t residual = ttnormsq + norm_mats - (2 * inner);
+  if(residual > 0.) {
+    residual = sqrt(residual);
+  }
+  return 1 - (residual / sqrt(ttnormsq));
+}
+
+
 /**
 * @brief Compute the fit of a Kruskal tensor, Z, to an input tensor, X. This
 *        is computed via 1 - [sqrt(<X,X> + <Z,Z> - 2<X,Z>) / sqrt(<X,X>)].
@@ -246,22 +437,210 @@ static val_t p_calc_fit(
 {
   timer_start(&timers[TIMER_FIT]);
 
-  /* First get norm of new model: lambda^T * (hada aTa) * lambda. */
-  val_t const norm_mats = p_kruskal_norm(nmodes, lambda, aTa);
-
   /* Compute inner product of tensor with new model */
   val_t const inner = p_tt_kruskal_inner(nmodes, rinfo, thds, lambda, mats,m1);
 
-  /*
-   * We actually want sqrt(<X,X> + <Y,Y> - 2<X,Y>), but if the fit is perfect
-   * just make it 0.
-   */
-  val_t residual = ttnormsq + norm_mats - (2 * inner);
-  if(residual > 0.) {
-    residual = sqrt(residual);
-  }
+  val_t const fit = p_fit_of_inner(nmodes, ttnormsq, lambda, aTa, inner);
   timer_stop(&timers[TIMER_FIT]);
-  return 1 - (residual / sqrt(ttnormsq));
+  return fit;
+}
+
+
+/**
+* @brief Record, print, and report the end of an iteration to the progress
+*        callback, and decide whether to stop.
+*
+* @param it The iteration which ended.
+* @param fit The fit after this iteration.
+* @param[out] oldfit The fit of the previous iteration, updated to 'fit'.
+* @param itertime The time of this iteration.
+* @param modetime The time of each mode in this iteration.
+* @param cpd_start When the factorization started, from monotonic_seconds().
+* @param[out] progress The progress passed to the callback.
+* @param rinfo MPI rank information.
+* @param opts SPLATT options.
+*
+* @return Whether to stop iterating.
+*/
+static bool p_end_iteration(
+  idx_t const it,
+  double const fit,
+  double * const oldfit,
+  sp_timer_t const * const itertime,
+  sp_timer_t const * const modetime,
+  double const cpd_start,
+  splatt_cpd_progress * const progress,
+  rank_info const * const rinfo,
+  double const * const opts)
+{
+  idx_t const nmodes = progress->nmodes;
+
+  metrics_record("cpd", "fit", it, -1, -1, fit);
+  metrics_record("cpd", "seconds", it, -1, -1, itertime->seconds);
+  for(idx_t m=0; m < nmodes; ++m) {
+    metrics_record("cpd", "mode_seconds", it, m, -1, modetime[m].seconds);
+  }
+
+  if(rinfo->rank == 0 &&
+      opts[SPLATT_OPTION_VERBOSITY] > SPLATT_VERBOSITY_NONE) {
+    printf("  its = %3"SPLATT_PF_IDX" (%0.3fs)  fit = %0.5f  delta = %+0.4e\n",
+        it+1, itertime->seconds, fit, fit - *oldfit);
+    if(opts[SPLATT_OPTION_VERBOSITY] > SPLATT_VERBOSITY_LOW) {
+      for(idx_t m=0; m < nmodes; ++m) {
+        printf("     mode = %1"SPLATT_PF_IDX" (%0.3fs)\n", m+1,
+            modetime[m].seconds);
+      }
+    }
+  }
+
+  progress->iteration = it;
+  progress->fit = fit;
+  progress->seconds = itertime->seconds;
+  progress->elapsed = monotonic_seconds() - cpd_start;
+  for(idx_t m=0; m < nmodes; ++m) {
+    progress->mode_seconds[m] = modetime[m].seconds;
+  }
+  if(cpd_should_stop(progress, opts)) {
+    return true;
+  }
+
+  if(fit == 1. || 
+      (it > 0 && fabs(fit - *oldfit) < opts[SPLATT_OPTION_TOLERANCE])) {
+    return true;
+  }
+  *oldfit = fit;
+  return false;
+}
+
+
+/**
+* @brief Run the ALS iterations inside a single parallel region. Each kernel
+*        is called by the whole team and synchronizes with barriers, so
+*        threads are not forked and joined for every step of every mode.
+*
+* @param tensors The CSF tensor(s) to factor.
+* @param mats The factor matrices, and the MTTKRP output at MAX_NMODES.
+* @param lambda The vector of column norms.
+* @param rinfo MPI rank information.
+* @param thds Thread structures, with scratch[1] holding rank*rank values.
+* @param ws The MTTKRP workspace.
+* @param aTa The Gram matrices of each factor, and scratch at MAX_NMODES.
+* @param ttnormsq The norm (squared) of the input tensor.
+* @param cpd_start When the factorization started, from monotonic_seconds().
+* @param[out] progress The progress passed to the callback.
+* @param opts SPLATT options.
+*
+* @return The final fit.
+*/
+static double p_cpd_als_team(
+  splatt_csf const * const tensors,
+  matrix_t ** mats,
+  val_t * const lambda,
+  rank_info * const rinfo,
+  thd_info * const thds,
+  splatt_mttkrp_ws * const ws,
+  matrix_t ** aTa,
+  val_t const ttnormsq,
+  double const cpd_start,
+  splatt_cpd_progress * const progress,
+  double const * const opts)
+{
+  idx_t const nmodes = tensors[0].nmodes;
+  idx_t const niters = (idx_t) opts[SPLATT_OPTION_NITER];
+  val_t const reg = opts[SPLATT_OPTION_REGULARIZE];
+  matrix_t * const m1 = mats[MAX_NMODES];
+
+  /* shared by the team and written only by the master thread */
+  double fit = 0;
+  double oldfit = 0;
+  bool done = false;
+  sp_timer_t itertime;
+  sp_timer_t modetime[MAX_NMODES];
+
+  #pragma omp parallel num_threads(ws->num_threads)
+  {
+    for(idx_t it=0; it < niters && !done; ++it) {
+      #pragma omp master
+      timer_fstart(&itertime);
+
+      for(idx_t m=0; m < nmodes; ++m) {
+        #pragma omp master
+        {
+          timer_fstart(&modetime[m]);
+          timer_start(&timers[TIMER_MTTKRP]);
+        }
+
+        /* M1 = X * (C o B) */
+        mttkrp_csf_team(tensors, mats, m, thds, ws, opts);
+
+        #pragma omp master
+        timer_stop(&timers[TIMER_MTTKRP]);
+
+        /* the solve forms the Gram matrix first, which orders the copy */
+        par_memcpy_team(mats[m]->vals, m1->vals,
+            mats[m]->I * mats[m]->J * sizeof(val_t));
+        mat_solve_normals_team(m, nmodes, aTa, mats[m], reg);
+
+        /* normalize columns and extract lambda */
+        mat_normalize_team(mats[m], lambda,
+            (it == 0) ? MAT_NORM_2 : MAT_NORM_MAX, rinfo, thds);
+
+        /* update A^T*A */
+        mat_aTa_team(mats[m], aTa[m], rinfo, thds);
+
+        #pragma omp master
+        timer_stop(&modetime[m]);
+      } /* foreach mode */
+
+      #pragma omp master
+      timer_start(&timers[TIMER_FIT]);
+      val_t const inner = p_tt_kruskal_inner_team(nmodes, rinfo, thds, lambda,
+          mats, m1);
+      #pragma omp master
+      {
+        fit = p_fit_of_inner(nmodes, ttnormsq, lambda, aTa, inner);
+        timer_stop(&timers[TIMER_FIT]);
+        timer_stop(&itertime);
+
+        done = p_end_iteration(it, fit, &oldfit, &itertime, modetime,
+            cpd_start, progress, rinfo, opts);
+      }
+
+      /* everyone sees 'done' before deciding to continue */
+      #pragma omp barrier
+    }
+  } /* end omp parallel */
+
+  return fit;
+}
+
+
+/**
+* @brief Bound the storage of an untiled CSF tensor. Level l has at most one
+*        fiber per nonzero and at most one per coordinate of the first l+1
+*        modes.
+*
+* @param dims The tensor dimensions.
+* @param nmodes The number of modes.
+* @param nnz The number of nonzeros.
+* @param dim_perm The mode ordering of the CSF.
+*
+* @return An upper bound on the bytes allocated.
+*/
+static size_t p_csf_bytes_bound(
+  idx_t const * const dims,
+  idx_t const nmodes,
+  idx_t const nnz,
+  idx_t const * const dim_perm)
+{
+  size_t bytes = nnz * (sizeof(idx_t) + sizeof(val_t));
+  double nfibs = 1.;
+  for(idx_t l=0; l < nmodes-1; ++l) {
+    nfibs = SS_MIN(nfibs * (double) dims[dim_perm[l]], (double) nnz);
+    /* fptr and fids */
+    bytes += (size_t) ((2. * nfibs) + 1.) * sizeof(idx_t);
+  }
+  return bytes;
 }
 
 
@@ -284,11 +663,22 @@ double cpd_als_iterate(
   splatt_omp_set_num_threads(nthreads);
   thd_info * thds =  thd_init(nthreads, 3,
     (nmodes * nfactors * sizeof(val_t)) + 64,
-    0,
+    /* a persistent team sums per-thread Gram matrices */
+    opts[SPLATT_OPTION_TEAM] ? (nfactors * nfactors * sizeof(val_t)) + 64 : 0,
     (nmodes * nfactors * sizeof(val_t)) + 64);
 
   matrix_t * m1 = mats[MAX_NMODES];
 
+  /* every thread reads factor rows during MTTKRP, so spread them evenly */
+  if(numa_should_place(opts)) {
+    for(idx_t m=0; m < nmodes; ++m) {
+      mats[m]->vals = numa_place_interleaved(mats[m]->vals,
+          mats[m]->I * mats[m]->J * sizeof(val_t), (int) nthreads);
+    }
+    m1->vals = numa_place_interleaved(m1->vals, mem_bytes_of(m1->vals),
+        (int) nthreads);
+  }
+
   /* Initialize first A^T * A mats. We redundantly do the first because it
    * makes communication easier. */
   matrix_t * aTa[MAX_NMODES+1];
@@ -303,6 +693,14 @@ double cpd_als_iterate(
   /* mttkrp workspace */
   splatt_mttkrp_ws * mttkrp_ws = splatt_mttkrp_alloc_ws(tensors,nfactors,opts);
 
+  /* report where pages landed whenever they were placed */
+  if(numa_can_query() &&
+      opts[SPLATT_OPTION_VERBOSITY] > SPLATT_VERBOSITY_NONE &&
+      (numa_should_place(opts) ||
+       opts[SPLATT_OPTION_VERBOSITY] >= SPLATT_VERBOSITY_HIGH)) {
+    p_numa_report(tensors, mats, thds, mttkrp_ws, nthreads);
+  }
+
   /* Compute input tensor norm */
   double oldfit = 0;
   double fit = 0;
@@ -313,65 +711,70 @@ double cpd_als_iterate(
   sp_timer_t itertime;
   sp_timer_t modetime[MAX_NMODES];
   timer_start(&timers[TIMER_CPD]);
+  double const cpd_start = monotonic_seconds();
 
-  idx_t const niters = (idx_t) opts[SPLATT_OPTION_NITER];
-  for(idx_t it=0; it < niters; ++it) {
-    timer_fstart(&itertime);
-    for(idx_t m=0; m < nmodes; ++m) {
-      timer_fstart(&modetime[m]);
-      mats[MAX_NMODES]->I = tensors[0].dims[m];
-      m1->I = mats[m]->I;
+  splatt_cpd_progress progress;
+  progress.rank = nfactors;
+  progress.nmodes = nmodes;
+  progress.lambda = lambda;
+  for(idx_t m=0; m < nmodes; ++m) {
+    progress.dims[m] = mats[m]->I;
+    progress.row_start[m] = 0;
+    progress.factors[m] = mats[m]->vals;
+  }
 
-      /* M1 = X * (C o B) */
-      timer_start(&timers[TIMER_MTTKRP]);
-      mttkrp_csf(tensors, mats, m, thds, mttkrp_ws, opts);
-      timer_stop(&timers[TIMER_MTTKRP]);
+  idx_t const niters = (idx_t) opts[SPLATT_OPTION_NITER];
+  if(opts[SPLATT_OPTION_TEAM]) {
+    fit = p_cpd_als_team(tensors, mats, lambda, rinfo, thds, mttkrp_ws, aTa,
+        ttnormsq, cpd_start, &progress, opts);
+  } else {
+    for(idx_t it=0; it < niters; ++it) {
+      timer_fstart(&itertime);
+      for(idx_t m=0; m < nmodes; ++m) {
+        timer_fstart(&modetime[m]);
+        mats[MAX_NMODES]->I = tensors[0].dims[m];
+        m1->I = mats[m]->I;
+
+        /* M1 = X * (C o B) */
+        timer_start(&timers[TIMER_MTTKRP]);
+        mttkrp_csf(tensors, mats, m, thds, mttkrp_ws, opts);
+        timer_stop(&timers[TIMER_MTTKRP]);
 
 #if 0
-      /* M2 = (CtC .* BtB .* ...)^-1 */
-      calc_gram_inv(m, nmodes, aTa);
-      /* A = M1 * M2 */
-      memset(mats[m]->vals, 0, mats[m]->I * nfactors * sizeof(val_t));
-      mat_matmul(m1, aTa[MAX_NMODES], mats[m]);
+        /* M2 = (CtC .* BtB .* ...)^-1 */
+        calc_gram_inv(m, nmodes, aTa);
+        /* A = M1 * M2 */
+        memset(mats[m]->vals, 0, mats[m]->I * nfactors * sizeof(val_t));
+        mat_matmul(m1, aTa[MAX_NMODES], mats[m]);
 #else
-      par_memcpy(mats[m]->vals, m1->vals, m1->I * nfactors * sizeof(val_t));
-      mat_solve_normals(m, nmodes, aTa, mats[m],
-          opts[SPLATT_OPTION_REGULARIZE]);
+        par_memcpy(mats[m]->vals, m1->vals, m1->I * nfactors * sizeof(val_t));
+        mat_solve_normals(m, nmodes, aTa, mats[m],
+            opts[SPLATT_OPTION_REGULARIZE]);
 #endif
 
-      /* normalize columns and extract lambda */
-      if(it == 0) {
-        mat_normalize(mats[m], lambda, MAT_NORM_2, rinfo, thds, nthreads);
-      } else {
-        mat_normalize(mats[m], lambda, MAT_NORM_MAX, rinfo, thds,nthreads);
-      }
-
-      /* update A^T*A */
-      mat_aTa(mats[m], aTa[m], rinfo, thds, nthreads);
-      timer_stop(&modetime[m]);
-    } /* foreach mode */
-
-    fit = p_calc_fit(nmodes, rinfo, thds, ttnormsq, lambda, mats, m1, aTa);
-    timer_stop(&itertime);
-
-    if(rinfo->rank == 0 &&
-        opts[SPLATT_OPTION_VERBOSITY] > SPLATT_VERBOSITY_NONE) {
-      printf("  its = %3"SPLATT_PF_IDX" (%0.3fs)  fit = %0.5f  delta = %+0.4e\n",
-          it+1, itertime.seconds, fit, fit - oldfit);
-      if(opts[SPLATT_OPTION_VERBOSITY] > SPLATT_VERBOSITY_LOW) {
-        for(idx_t m=0; m < nmodes; ++m) {
-          printf("     mode = %1"SPLATT_PF_IDX" (%0.3fs)\n", m+1,
-              modetime[m].seconds);
+        /* normalize columns and extract lambda */
+        if(it == 0) {
+          mat_normalize(mats[m], lambda, MAT_NORM_2, rinfo, thds, nthreads);
+        } else {
+          mat_normalize(mats[m], lambda, MAT_NORM_MAX, rinfo, thds,nthreads);
         }
+
+        /* update A^T*A */
+        mat_aTa(mats[m], aTa[m], rinfo, thds, nthreads);
+        timer_stop(&modetime[m]);
+      } /* foreach mode */
+
+      fit = p_calc_fit(nmodes, rinfo, thds, ttnormsq, lambda, mats, m1, aTa);
+      timer_stop(&itertime);
+
+      if(p_end_iteration(it, fit, &oldfit, &itertime, modetime, cpd_start,
+            &progress, rinfo, opts)) {
+        break;
       }
     }
-    if(fit == 1. || 
-        (it > 0 && fabs(fit - oldfit) < opts[SPLATT_OPTION_TOLERANCE])) {
-      break;
-    }
-    oldfit = fit;
   }
   timer_stop(&timers[TIMER_CPD]);
+  record_times();
 
   cpd_post_process(nfactors, nmodes, mats, lambda, thds, nthreads, rinfo);
 
@@ -407,7 +810,110 @@ void cpd_post_process(
     }
   }
 
-  free(tmp);
+  splatt_free(tmp);
 }
 
 
+bool cpd_has_stop_rule(
+  double const * const opts)
+{
+  return opts[SPLATT_OPTION_TIMELIMIT] > 0 || cpd_callback != NULL;
+}
+
+
+bool cpd_should_stop(
+  splatt_cpd_progress const * const progress,
+  double const * const opts)
+{
+  double const limit = opts[SPLATT_OPTION_TIMELIMIT];
+  if(limit > 0 && progress->elapsed + progress->seconds > limit) {
+    return true;
+  }
+
+  if(cpd_callback != NULL) {
+    return cpd_callback(progress, cpd_callback_data) != SPLATT_CPD_CONTINUE;
+  }
+  return false;
+}
+
+
+void cpd_mem_estimate(
+  idx_t const nmodes,
+  idx_t const * const dims,
+  idx_t const nnz,
+  idx_t const nfactors,
+  double const * const opts,
+  splatt_mem_usage * const est)
+{
+  memset(est, 0, sizeof(*est));
+
+  idx_t const nthreads = (idx_t) opts[SPLATT_OPTION_NTHREADS];
+  idx_t const maxdim = dims[argmax_elem(dims, nmodes)];
+
+  /* coordinate tensor */
+  size_t const coo = nnz * ((nmodes * sizeof(idx_t)) + sizeof(val_t));
+
+  /* each sort copies all but one mode and keeps per-thread histograms */
+  size_t const sort = (nnz * (((nmodes-1) * sizeof(idx_t)) + sizeof(val_t))) +
+      (((maxdim * nthreads) + 1) * sizeof(idx_t));
+
+  /* CSF representations, following csf_alloc() */
+  idx_t dim_perm[MAX_NMODES];
+  size_t csf = 0;
+  switch((splatt_csf_type) opts[SPLATT_OPTION_CSF_ALLOC]) {
+  case SPLATT_CSF_ONEMODE:
+    csf_find_mode_order(dims, nmodes, CSF_SORTED_SMALLFIRST, 0, dim_perm);
+    csf += p_csf_bytes_bound(dims, nmodes, nnz, dim_perm);
+    break;
+  case SPLATT_CSF_TWOMODE:
+    csf_find_mode_order(dims, nmodes, CSF_SORTED_SMALLFIRST, 0, dim_perm);
+    csf += p_csf_bytes_bound(dims, nmodes, nnz, dim_perm);
+    csf_find_mode_order(dims, nmodes, CSF_SORTED_MINUSONE,
+        dim_perm[nmodes-1], dim_perm);
+    csf += p_csf_bytes_bound(dims, nmodes, nnz, dim_perm);
+    break;
+  case SPLATT_CSF_ALLMODE:
+    for(idx_t m=0; m < nmodes; ++m) {
+      csf_find_mode_order(dims, nmodes, CSF_SORTED_MINUSONE, m, dim_perm);
+      csf += p_csf_bytes_bound(dims, nmodes, nnz, dim_perm);
+    }
+    break;
+  }
+
+  /* factors, the MTTKRP output, Gram matrices, and lambda */
+  size_t mats = ((maxdim * nfactors) + ((nmodes+1) * nfactors * nfactors) +
+      nfactors) * sizeof(val_t);
+  for(idx_t m=0; m < nmodes; ++m) {
+    mats += dims[m] * nfactors * sizeof(val_t);
+  }
+
+  /* privatization buffers and the slice weights used to partition each CSF,
+   * following splatt_mttkrp_alloc_ws(), the scratch of cpd_als_iterate(), and
+   * the lock pool of MTTKRP */
+  idx_t privdim = 0;
+  if(nthreads > 1) {
+    for(idx_t m=0; m < nmodes; ++m) {
+      if((double) (dims[m] * nthreads) <=
+          opts[SPLATT_OPTION_PRIVTHRESH] * (double) nnz) {
+        privdim = SS_MAX(privdim, dims[m]);
+      }
+    }
+  }
+  mutex_pool const * pool = NULL;
+  size_t const ws = (nthreads * privdim * nfactors * sizeof(val_t)) +
+      (maxdim * sizeof(idx_t)) +
+      (nthreads * 2 * ((nmodes * nfactors * sizeof(val_t)) + 64)) +
+      (SPLATT_DEFAULT_NLOCKS * SPLATT_DEFAULT_LOCK_PAD *
+          sizeof(*(pool->locks)));
+
+  est->peak[SPLATT_MEM_IO] = coo;
+  est->peak[SPLATT_MEM_SORT] = sort;
+  est->peak[SPLATT_MEM_CSF] = csf;
+  est->peak[SPLATT_MEM_MATRICES] = mats;
+  est->peak[SPLATT_MEM_MTTKRP_WS] = ws;
+
+  /* the coordinate tensor is freed once the CSF is built */
+  size_t const build = coo + sort + csf;
+  size_t const factor = csf + mats + ws;
+  est->total_peak = SS_MAX(build, factor);
+}
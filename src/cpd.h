@@ -62,4 +62,58 @@ void cpd_post_process(
   idx_t const nthreads,
   rank_info * const rinfo);
 
+
+#define cpd_should_stop splatt_cpd_should_stop
+/**
+* @brief Decide whether a CPD should stop after an iteration, for reasons
+*        other than convergence. The time limit (SPLATT_OPTION_TIMELIMIT) is
+*        exceeded if another iteration as long as the last one would end past
+*        it. Otherwise, the callback registered with splatt_cpd_set_callback()
+*        decides.
+*
+* @param progress The state of the factorization after the iteration.
+* @param opts SPLATT options array.
+*
+* @return true, if the factorization should stop.
+*/
+bool cpd_should_stop(
+  splatt_cpd_progress const * const progress,
+  double const * const opts);
+
+
+#define cpd_has_stop_rule splatt_cpd_has_stop_rule
+/**
+* @brief Return whether cpd_should_stop() can ever return true, i.e., a time
+*        limit is set or a callback is registered. Distributed CPD skips its
+*        stop vote otherwise.
+*
+* @param opts SPLATT options array.
+*/
+bool cpd_has_stop_rule(
+  double const * const opts);
+
+
+#define cpd_mem_estimate splatt_cpd_mem_estimate
+/**
+* @brief Estimate the memory needed to read a tensor, build its CSF, and
+*        factor it with CPD-ALS, without allocating anything. The estimate is
+*        an upper bound: CSF storage assumes the most fibers the dimensions
+*        and nonzero count allow, and tiling is ignored.
+*
+* @param nmodes The number of modes of the tensor.
+* @param dims The dimensions of the tensor.
+* @param nnz The number of nonzeros.
+* @param nfactors The rank of the decomposition.
+* @param opts SPLATT options array.
+* @param[out] est The estimated peak of each subsystem and the overall peak.
+*                 Live bytes and allocation counts are zero.
+*/
+void cpd_mem_estimate(
+  idx_t const nmodes,
+  idx_t const * const dims,
+  idx_t const nnz,
+  idx_t const nfactors,
+  double const * const opts,
+  splatt_mem_usage * const est);
+
 #endif
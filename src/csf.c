@@ -6,7 +6,9 @@
 #include "sort.h"
 #include "tile.h"
 #include "util.h"
+#include "metrics.h"
 #include "thread_partition.h"
+#include "affinity.h"
 
 #include "io.h"
 
@@ -601,6 +603,149 @@ static void p_fill_dim_iperm(
 }
 
 
+/**
+* @brief Find the nodes of each level of a tile which belong to each thread,
+*        given the root slices of each thread.
+*
+* @param csf The CSF tensor.
+* @param tile_id The tile to split.
+* @param parts The first slice of each thread, of length 'nthreads+1'.
+* @param nthreads The number of threads.
+* @param[out] ranges The first node of each thread, 'nthreads+1' per level.
+*/
+static void p_csf_level_ranges(
+  splatt_csf const * const csf,
+  idx_t const tile_id,
+  idx_t const * const parts,
+  idx_t const nthreads,
+  idx_t * const ranges)
+{
+  csf_sparsity const * const pt = csf->pt + tile_id;
+  for(idx_t t=0; t <= nthreads; ++t) {
+    ranges[t] = parts[t];
+  }
+  for(idx_t l=1; l < csf->nmodes; ++l) {
+    idx_t const * const prev = ranges + ((l-1) * (nthreads+1));
+    idx_t * const curr = ranges + (l * (nthreads+1));
+    for(idx_t t=0; t <= nthreads; ++t) {
+      curr[t] = pt->fptr[l-1][prev[t]];
+    }
+  }
+}
+
+
+/**
+* @brief Place or count the pages of one array of a CSF tile.
+*
+* @param arr The array, which is replaced if it is placed.
+* @param offsets The byte ranges of each thread.
+* @param nthreads The number of threads.
+* @param placement The summary to add to, or NULL to place the array.
+*/
+static void p_csf_numa_array(
+  void ** const arr,
+  size_t const * const offsets,
+  idx_t const nthreads,
+  numa_placement * const placement)
+{
+  if(*arr == NULL) {
+    return;
+  }
+  if(placement == NULL) {
+    *arr = numa_place_owned(*arr, offsets, (int) nthreads);
+  } else {
+    numa_count_owned(*arr, offsets, (int) nthreads, placement);
+  }
+}
+
+
+/**
+* @brief Place or count the pages of each array of a CSF tile.
+*
+* @param csf The CSF tensor.
+* @param tile_id The tile.
+* @param parts The first slice of each thread, of length 'nthreads+1'.
+* @param nthreads The number of threads.
+* @param placement The summary to add to, or NULL to place the tile.
+*/
+static void p_csf_numa_tile(
+  splatt_csf * const csf,
+  idx_t const tile_id,
+  idx_t const * const parts,
+  idx_t const nthreads,
+  numa_placement * const placement)
+{
+  csf_sparsity * const pt = csf->pt + tile_id;
+  if(pt->nfibs[0] == 0 || pt->fptr[0] == NULL) {
+    return;
+  }
+
+  idx_t * ranges = splatt_malloc(csf->nmodes * (nthreads+1) * sizeof(*ranges));
+  size_t * offsets = splatt_malloc((nthreads+1) * sizeof(*offsets));
+  p_csf_level_ranges(csf, tile_id, parts, nthreads, ranges);
+
+  for(idx_t l=0; l < csf->nmodes; ++l) {
+    idx_t const * const lr = ranges + (l * (nthreads+1));
+
+    for(idx_t t=0; t <= nthreads; ++t) {
+      offsets[t] = lr[t] * sizeof(**(pt->fids));
+    }
+    p_csf_numa_array((void **) &(pt->fids[l]), offsets, nthreads, placement);
+
+    if(l < csf->nmodes-1) {
+      /* the trailing pointer goes to the last thread */
+      offsets[nthreads] += sizeof(**(pt->fptr));
+      p_csf_numa_array((void **) &(pt->fptr[l]), offsets, nthreads,
+          placement);
+    } else {
+      for(idx_t t=0; t <= nthreads; ++t) {
+        offsets[t] = lr[t] * sizeof(*(pt->vals));
+      }
+      p_csf_numa_array((void **) &(pt->vals), offsets, nthreads, placement);
+    }
+  }
+
+  splatt_free(offsets);
+  splatt_free(ranges);
+}
+
+
+/**
+* @brief Place or count the pages of a CSF tensor, with the owner threads
+*        which MTTKRP uses.
+*
+* @param csf The CSF tensor.
+* @param nthreads The number of threads.
+* @param placement The summary to add to, or NULL to place the tensor.
+*/
+static void p_csf_numa(
+  splatt_csf * const csf,
+  idx_t const nthreads,
+  numa_placement * const placement)
+{
+  if(csf->ntiles == 1) {
+    idx_t * parts = csf_partition_1d(csf, 0, nthreads);
+    p_csf_numa_tile(csf, 0, parts, nthreads, placement);
+    splatt_free(parts);
+    return;
+  }
+
+  /* each tile belongs entirely to one thread */
+  idx_t * tile_parts = csf_partition_tiles_1d(csf, nthreads);
+  idx_t * parts = splatt_malloc((nthreads+1) * sizeof(*parts));
+  for(idx_t owner=0; owner < nthreads; ++owner) {
+    for(idx_t tile=tile_parts[owner]; tile < tile_parts[owner+1]; ++tile) {
+      for(idx_t t=0; t <= nthreads; ++t) {
+        parts[t] = (t <= owner) ? 0 : csf->pt[tile].nfibs[0];
+      }
+      p_csf_numa_tile(csf, tile, parts, nthreads, placement);
+    }
+  }
+  splatt_free(parts);
+  splatt_free(tile_parts);
+}
+
+
 /**
 * @brief Allocate and fill a CSF tensor.
 *
@@ -617,6 +762,8 @@ static void p_mk_csf(
   idx_t const mode,
   double const * const splatt_opts)
 {
+  splatt_mem_tag const prev_tag = mem_tag_begin(SPLATT_MEM_CSF);
+
   ct->nnz = tt->nnz;
   ct->nmodes = tt->nmodes;
 
@@ -641,6 +788,12 @@ static void p_mk_csf(
         ct->which_tile);
     break;
   }
+
+  if(numa_should_place(splatt_opts)) {
+    csf_numa_place(ct, (idx_t) splatt_opts[SPLATT_OPTION_NTHREADS]);
+  }
+
+  mem_tag_end(prev_tag);
 }
 
 /******************************************************************************
@@ -670,7 +823,7 @@ void csf_free(
     csf_free_mode(csf + i);
   }
 
-  free(csf);
+  splatt_free(csf);
 }
 
 
@@ -679,14 +832,14 @@ void csf_free_mode(
 {
   /* free each tile of sparsity pattern */
   for(idx_t t=0; t < csf->ntiles; ++t) {
-    free(csf->pt[t].vals);
-    free(csf->pt[t].fids[csf->nmodes-1]);
+    splatt_free(csf->pt[t].vals);
+    splatt_free(csf->pt[t].fids[csf->nmodes-1]);
     for(idx_t m=0; m < csf->nmodes-1; ++m) {
-      free(csf->pt[t].fptr[m]);
-      free(csf->pt[t].fids[m]);
+      splatt_free(csf->pt[t].fptr[m]);
+      splatt_free(csf->pt[t].fids[m]);
     }
   }
-  free(csf->pt);
+  splatt_free(csf->pt);
 }
 
 
@@ -771,6 +924,10 @@ splatt_csf * csf_alloc(
   sptensor_t * const tt,
   double const * const opts)
 {
+  /* threads first-touch the slices they own, so bind them first */
+  affinity_bind(opts);
+
+  splatt_mem_tag const prev_tag = mem_tag_begin(SPLATT_MEM_CSF);
   splatt_csf * ret = NULL;
 
   double * tmp_opts = NULL;
@@ -799,7 +956,7 @@ splatt_csf * csf_alloc(
     last_mode = csf_depth_to_mode(&(ret[0]), tt->nmodes-1);
     p_mk_csf(ret + 1, tt, CSF_SORTED_MINUSONE, last_mode, tmp_opts);
 
-    free(tmp_opts);
+    splatt_free(tmp_opts);
     break;
 
   case SPLATT_CSF_ALLMODE:
@@ -810,6 +967,12 @@ splatt_csf * csf_alloc(
     break;
   }
 
+  if(metrics_enabled()) {
+    metrics_set("csf", "storage_bytes", -1, -1, -1,
+        (double) csf_storage(ret, opts));
+  }
+
+  mem_tag_end(prev_tag);
   return ret;
 }
 
@@ -893,4 +1056,19 @@ idx_t * csf_partition_tiles_1d(
 }
 
 
+void csf_numa_place(
+    splatt_csf * const csf,
+    idx_t const nthreads)
+{
+  p_csf_numa(csf, nthreads, NULL);
+}
+
 
+void csf_numa_count(
+    splatt_csf const * const csf,
+    idx_t const nthreads,
+    numa_placement * const placement)
+{
+  /* counting leaves the tensor untouched */
+  p_csf_numa((splatt_csf *) csf, nthreads, placement);
+}
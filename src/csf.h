@@ -24,6 +24,7 @@ typedef enum
  *****************************************************************************/
 
 #include "sptensor.h"
+#include "placement.h"
 
 
 /******************************************************************************
@@ -213,6 +214,36 @@ idx_t * csf_partition_tiles_1d(
     idx_t const nparts);
 
 
+#define csf_numa_place splatt_csf_numa_place
+/**
+* @brief Move the arrays of a CSF tensor so that each page is first touched by
+*        the thread which processes it during MTTKRP. Threads own the slices
+*        given by csf_partition_1d(), or the tiles given by
+*        csf_partition_tiles_1d() if the tensor is tiled.
+*
+* @param csf The CSF tensor to place.
+* @param nthreads The number of threads which will process it.
+*/
+void csf_numa_place(
+    splatt_csf * const csf,
+    idx_t const nthreads);
+
+
+#define csf_numa_count splatt_csf_numa_count
+/**
+* @brief Add the pages of a CSF tensor to a placement summary, with the same
+*        owner threads as csf_numa_place().
+*
+* @param csf The CSF tensor to query.
+* @param nthreads The number of threads which process it.
+* @param[out] placement The summary to add to.
+*/
+void csf_numa_count(
+    splatt_csf const * const csf,
+    idx_t const nthreads,
+    numa_placement * const placement);
+
+
 #define csf_count_nnz splatt_csf_count_nnz
 /**
 * @brief Count the nonzeros below a given node in a CSF tensor.
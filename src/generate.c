@@ -0,0 +1,404 @@
+
+
+/******************************************************************************
+ * INCLUDES
+ *****************************************************************************/
+#include "generate.h"
+#include "sort.h"
+#include "thd_info.h"
+
+#include <math.h>
+#include <stdint.h>
+
+
+/******************************************************************************
+ * PRIVATE STRUCTURES
+ *****************************************************************************/
+
+/* nonzeros drawn from each random stream */
+#define GEN_BLOCK (1 << 16)
+
+/* salts which keep the factor and value streams independent */
+#define GEN_FACTOR_SALT 0x6a09e667f3bcc909ULL
+#define GEN_BLOCK_SALT  0xbb67ae8584caa73bULL
+#define GEN_VALUE_SALT  0x3c6ef372fe94f82bULL
+#define GEN_SUPP_SALT   0xa54ff53a5f1d36f1ULL
+
+#define GEN_TWO_PI 6.283185307179586
+
+/**
+* @brief Precomputed state for rejection-inversion sampling of a Zipf
+*        distribution over {1, ..., n} (Hormann & Derflinger, 1996).
+*/
+typedef struct
+{
+  idx_t n;
+  double s;
+  double hx1;
+  double hn;
+  double sdiv;
+} zipf_t;
+
+
+
+/******************************************************************************
+ * PRIVATE FUNCTIONS
+ *****************************************************************************/
+
+/**
+* @brief The SplitMix64 finalizer. Used both as a hash and, by advancing the
+*        input by a constant, as a random stream.
+*/
+static inline uint64_t p_mix(
+    uint64_t z)
+{
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  return z ^ (z >> 31);
+}
+
+
+static inline uint64_t p_next(
+    uint64_t * const state)
+{
+  *state += 0x9e3779b97f4a7c15ULL;
+  return p_mix(*state);
+}
+
+
+/**
+* @brief Map 64 random bits to a double in [0, 1).
+*/
+static inline double p_u01(
+    uint64_t const bits)
+{
+  return (double) (bits >> 11) * (1. / 9007199254740992.);
+}
+
+
+/* log1p(x)/x and expm1(x)/x, accurate near 0 */
+static inline double p_helper1(
+    double const x)
+{
+  if(fabs(x) > 1e-8) {
+    return log1p(x) / x;
+  }
+  return 1. - x * (0.5 - x * (1./3. - 0.25 * x));
+}
+
+static inline double p_helper2(
+    double const x)
+{
+  if(fabs(x) > 1e-8) {
+    return expm1(x) / x;
+  }
+  return 1. + x * 0.5 * (1. + x * (1./3.) * (1. + 0.25 * x));
+}
+
+
+static inline double p_zipf_h(
+    zipf_t const * const z,
+    double const x)
+{
+  return exp(-z->s * log(x));
+}
+
+static inline double p_zipf_hint(
+    zipf_t const * const z,
+    double const x)
+{
+  double const logx = log(x);
+  return p_helper2((1. - z->s) * logx) * logx;
+}
+
+static inline double p_zipf_hinv(
+    zipf_t const * const z,
+    double const x)
+{
+  double t = x * (1. - z->s);
+  if(t < -1.) {
+    t = -1.;
+  }
+  return exp(p_helper1(t) * x);
+}
+
+
+static void p_zipf_init(
+    zipf_t * const z,
+    idx_t const n,
+    double const s)
+{
+  z->n = n;
+  z->s = s;
+  z->hx1 = p_zipf_hint(z, 1.5) - 1.;
+  z->hn = p_zipf_hint(z, (double) n + 0.5);
+  z->sdiv = 2. - p_zipf_hinv(z, p_zipf_hint(z, 2.5) - p_zipf_h(z, 2.));
+}
+
+
+/**
+* @brief Draw an index in [0, n) from either a uniform (s == 0) or Zipf
+*        distribution. Index 0 is the most frequent.
+*/
+static idx_t p_sample_idx(
+    zipf_t const * const z,
+    uint64_t * const state)
+{
+  if(z->s == 0.) {
+    return (idx_t) (p_next(state) % z->n);
+  }
+
+  while(1) {
+    double const u = z->hn + p_u01(p_next(state)) * (z->hx1 - z->hn);
+    double const x = p_zipf_hinv(z, u);
+    double k = floor(x + 0.5);
+    if(k < 1.) {
+      k = 1.;
+    } else if(k > (double) z->n) {
+      k = (double) z->n;
+    }
+    if(k - x <= z->sdiv || u >= p_zipf_hint(z, k + 0.5) - p_zipf_h(z, k)) {
+      return (idx_t) k - 1;
+    }
+  }
+}
+
+
+/**
+* @brief Entry (i, r) of the planted factor of mode 'm'.
+*/
+static inline double p_factor(
+    uint64_t const seed,
+    idx_t const m,
+    idx_t const i,
+    idx_t const r,
+    idx_t const rank)
+{
+  uint64_t const key = ((uint64_t) i * rank) + r;
+  return p_u01(p_mix(seed ^ (GEN_FACTOR_SALT * (m+1)) ^ p_mix(key)));
+}
+
+
+/**
+* @brief A standard normal deviate via Box-Muller.
+*/
+static inline double p_gaussian(
+    uint64_t * const state)
+{
+  double const u1 = 1. - p_u01(p_next(state)); /* (0, 1] */
+  double const u2 = p_u01(p_next(state));
+  return sqrt(-2. * log(u1)) * cos(GEN_TWO_PI * u2);
+}
+
+
+static bool p_check_opts(
+    gen_opts const * const opts)
+{
+  if(opts->nmodes < 1 || opts->nmodes > MAX_NMODES) {
+    fprintf(stderr, "SPLATT ERROR: cannot generate a tensor with %"
+        SPLATT_PF_IDX" modes (max %"SPLATT_PF_IDX").\n", opts->nmodes,
+        (idx_t) MAX_NMODES);
+    return false;
+  }
+  for(idx_t m=0; m < opts->nmodes; ++m) {
+    if(opts->dims[m] == 0) {
+      fprintf(stderr, "SPLATT ERROR: dimension of mode %"SPLATT_PF_IDX
+          " must be positive.\n", m+1);
+      return false;
+    }
+    if(opts->skew[m] < 0.) {
+      fprintf(stderr, "SPLATT ERROR: skew of mode %"SPLATT_PF_IDX
+          " must be non-negative.\n", m+1);
+      return false;
+    }
+  }
+  if(opts->nnz == 0) {
+    fprintf(stderr, "SPLATT ERROR: number of nonzeros must be positive.\n");
+    return false;
+  }
+  if(opts->noise < 0.) {
+    fprintf(stderr, "SPLATT ERROR: noise must be non-negative.\n");
+    return false;
+  }
+  return true;
+}
+
+
+/**
+* @brief Draw 'opts->nnz' coordinates independently and give each a uniform
+*        random value.
+*/
+static sptensor_t * p_gen_random(
+    gen_opts const * const opts,
+    zipf_t const * const zipf)
+{
+  idx_t const nmodes = opts->nmodes;
+  idx_t const nnz = opts->nnz;
+  uint64_t const seed = opts->seed;
+
+  sptensor_t * tt = tt_alloc(nnz, nmodes);
+
+  idx_t const nblocks = (nnz + GEN_BLOCK - 1) / GEN_BLOCK;
+
+  #pragma omp parallel for schedule(dynamic, 1)
+  for(idx_t b=0; b < nblocks; ++b) {
+    uint64_t state = p_mix(seed ^ (GEN_BLOCK_SALT * (b+1)));
+
+    idx_t const start = b * GEN_BLOCK;
+    idx_t const end = SS_MIN(start + GEN_BLOCK, nnz);
+    for(idx_t n=start; n < end; ++n) {
+      for(idx_t m=0; m < nmodes; ++m) {
+        tt->ind[m][n] = p_sample_idx(zipf + m, &state);
+      }
+      tt->vals[n] = (val_t) p_u01(p_next(&state));
+    }
+  }
+
+  return tt;
+}
+
+
+/**
+* @brief Build a Kruskal tensor whose factor columns are sparse. Column r of
+*        factor m is nonzero on a support drawn from the Zipf distribution of
+*        mode m, so component r is a dense block over the product of its
+*        supports. Block sizes are chosen so that their sum is about
+*        'opts->nnz'. Blocks are emitted one after another; overlapping
+*        coordinates are summed later by tt_remove_dups(), which makes the
+*        result exactly the Kruskal tensor (plus noise).
+*/
+static sptensor_t * p_gen_planted(
+    gen_opts const * const opts,
+    zipf_t const * const zipf)
+{
+  idx_t const nmodes = opts->nmodes;
+  idx_t const rank = opts->rank;
+  uint64_t const seed = opts->seed;
+
+  /* scale each mode equally so a block holds nnz/rank coordinates */
+  double logvol = 0.;
+  for(idx_t m=0; m < nmodes; ++m) {
+    logvol += log((double) opts->dims[m]);
+  }
+  double const target = (double) opts->nnz / (double) rank;
+  double const scale = exp((log(target) - logvol) / (double) nmodes);
+
+  idx_t ** supp = splatt_malloc(rank * nmodes * sizeof(*supp));
+  idx_t * nsupp = splatt_malloc(rank * nmodes * sizeof(*nsupp));
+  idx_t * offsets = splatt_malloc((rank+1) * sizeof(*offsets));
+
+  offsets[0] = 0;
+  for(idx_t r=0; r < rank; ++r) {
+    idx_t bsize = 1;
+    for(idx_t m=0; m < nmodes; ++m) {
+      idx_t const s = (r * nmodes) + m;
+      double const want = scale * (double) opts->dims[m];
+      idx_t const len = SS_MAX(1, SS_MIN(opts->dims[m], (idx_t) (want + 0.5)));
+
+      uint64_t state = p_mix(seed ^ (GEN_SUPP_SALT * (s+1)));
+      supp[s] = splatt_malloc(len * sizeof(**supp));
+      for(idx_t i=0; i < len; ++i) {
+        supp[s][i] = p_sample_idx(zipf + m, &state);
+      }
+
+      /* skewed draws repeat, so keep only the distinct indices */
+      quicksort(supp[s], len);
+      idx_t uniq = 1;
+      for(idx_t i=1; i < len; ++i) {
+        if(supp[s][i] != supp[s][uniq-1]) {
+          supp[s][uniq++] = supp[s][i];
+        }
+      }
+      nsupp[s] = uniq;
+      bsize *= uniq;
+    }
+    offsets[r+1] = offsets[r] + bsize;
+  }
+
+  sptensor_t * tt = tt_alloc(offsets[rank], nmodes);
+
+  for(idx_t r=0; r < rank; ++r) {
+    idx_t const * const ns = nsupp + (r * nmodes);
+    idx_t ** const rsupp = supp + (r * nmodes);
+    idx_t const bsize = offsets[r+1] - offsets[r];
+
+    #pragma omp parallel for schedule(static)
+    for(idx_t e=0; e < bsize; ++e) {
+      idx_t const n = offsets[r] + e;
+
+      /* last mode varies fastest */
+      idx_t left = e;
+      double v = 1.;
+      for(idx_t m=nmodes; m-- > 0; ) {
+        idx_t const i = rsupp[m][left % ns[m]];
+        left /= ns[m];
+        tt->ind[m][n] = i;
+        v *= p_factor(seed, m, i, r, rank);
+      }
+
+      if(opts->noise > 0.) {
+        uint64_t state = p_mix(seed ^ (GEN_VALUE_SALT * (n+1)));
+        v *= 1. + (opts->noise * p_gaussian(&state));
+      }
+      tt->vals[n] = (val_t) v;
+    }
+  }
+
+  for(idx_t s=0; s < rank * nmodes; ++s) {
+    splatt_free(supp[s]);
+  }
+  splatt_free(supp);
+  splatt_free(nsupp);
+  splatt_free(offsets);
+
+  return tt;
+}
+
+
+
+/******************************************************************************
+ * PUBLIC FUNCTIONS
+ *****************************************************************************/
+
+void gen_default_opts(
+  gen_opts * const opts)
+{
+  opts->nmodes = 0;
+  opts->nnz = 0;
+  for(idx_t m=0; m < MAX_NMODES; ++m) {
+    opts->dims[m] = 0;
+    opts->skew[m] = 0.;
+  }
+  opts->rank = 0;
+  opts->noise = 0.;
+  opts->seed = 1;
+}
+
+
+sptensor_t * tt_generate(
+  gen_opts const * const opts)
+{
+  if(!p_check_opts(opts)) {
+    return NULL;
+  }
+
+  zipf_t zipf[MAX_NMODES];
+  for(idx_t m=0; m < opts->nmodes; ++m) {
+    p_zipf_init(zipf + m, opts->dims[m], opts->skew[m]);
+  }
+
+  sptensor_t * tt;
+  if(opts->rank > 0) {
+    tt = p_gen_planted(opts, zipf);
+  } else {
+    tt = p_gen_random(opts, zipf);
+  }
+  for(idx_t m=0; m < opts->nmodes; ++m) {
+    tt->dims[m] = opts->dims[m];
+  }
+
+  /* merge repeated coordinates, which are common under heavy skew */
+  tt_remove_dups(tt);
+
+  return tt;
+}
@@ -0,0 +1,71 @@
+#ifndef SPLATT_GENERATE_H
+#define SPLATT_GENERATE_H
+
+
+/******************************************************************************
+ * INCLUDES
+ *****************************************************************************/
+#include "base.h"
+#include "sptensor.h"
+
+
+/******************************************************************************
+ * STRUCTURES
+ *****************************************************************************/
+
+/**
+* @brief Parameters of a synthetic tensor.
+*/
+typedef struct
+{
+  idx_t nmodes;             /** The number of modes to generate. */
+  idx_t dims[MAX_NMODES];   /** The dimension of each mode. */
+  idx_t nnz;                /** The number of nonzeros to aim for. Repeated
+                                coordinates are merged, so the final count
+                                is approximate. */
+  double skew[MAX_NMODES];  /** Zipf exponent of each mode. 0 is uniform. */
+  idx_t rank;               /** Rank of the planted Kruskal tensor. 0 gives
+                                uniform random values instead. */
+  double noise;             /** Relative Gaussian noise added to the planted
+                                values. */
+  uint64_t seed;            /** Seed of the generator. */
+} gen_opts;
+
+
+/******************************************************************************
+ * PUBLIC FUNCTIONS
+ *****************************************************************************/
+
+#define gen_default_opts splatt_gen_default_opts
+/**
+* @brief Fill 'opts' with defaults: uniform indices, random values, no noise,
+*        and seed 1. Dimensions and nnz are left zero.
+*
+* @param opts The options to initialize.
+*/
+void gen_default_opts(
+  gen_opts * const opts);
+
+
+#define tt_generate splatt_tt_generate
+/**
+* @brief Generate a synthetic sparse tensor. Nonzeros are drawn in parallel
+*        from fixed-size blocks that each have their own random stream, so the
+*        result depends only on 'opts' and not on the number of threads.
+*
+*        Indices of each mode follow a Zipf distribution with exponent
+*        opts->skew[m]. If opts->rank > 0, the tensor is instead an exact
+*        Kruskal tensor with sparse non-negative factors: each component is a
+*        dense block whose indices are drawn from the same Zipf distributions.
+*        Its values are perturbed by relative Gaussian noise of magnitude
+*        opts->noise. Factor values are never stored; each entry is hashed
+*        from the seed when needed.
+*
+* @param opts The tensor parameters.
+*
+* @return The generated tensor, or NULL if 'opts' is invalid.
+*/
+sptensor_t * tt_generate(
+  gen_opts const * const opts);
+
+#endif
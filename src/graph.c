@@ -627,10 +627,10 @@ void hgraph_free(
   hgraph_t * hg)
 {
   free(hg->eptr);
-  free(hg->eind);
-  free(hg->vwts);
-  free(hg->hewts);
-  free(hg);
+  splatt_free(hg->eind);
+  splatt_free(hg->vwts);
+  splatt_free(hg->hewts);
+  splatt_free(hg);
 }
 
 
@@ -712,11 +712,11 @@ splatt_graph * graph_alloc(
 void graph_free(
     splatt_graph * graph)
 {
-  free(graph->eptr);
-  free(graph->eind);
-  free(graph->vwgts);
-  free(graph->ewgts);
-  free(graph);
+  splatt_free(graph->eptr);
+  splatt_free(graph->eind);
+  splatt_free(graph->vwgts);
+  splatt_free(graph->ewgts);
+  splatt_free(graph);
 }
 
 
@@ -784,12 +784,12 @@ idx_t * patoh_part(
   }
 
   PaToH_Free();
-  free(vwts);
-  free(hwts);
-  free(eptr);
-  free(eind);
-  free(pvec);
-  free(pwts);
+  splatt_free(vwts);
+  splatt_free(hwts);
+  splatt_free(eptr);
+  splatt_free(eind);
+  splatt_free(pvec);
+  splatt_free(pwts);
 
   return parts;
 }
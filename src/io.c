@@ -217,7 +217,7 @@ int splatt_load(
   *vals = tt->vals;
   *inds = tt->ind;
 
-  free(tt);
+  splatt_free(tt);
 
   return SPLATT_SUCCESS;
 }
@@ -270,6 +270,38 @@ sptensor_t * tt_read_binary_file(
 }
 
 
+int tt_read_dims(
+  char const * const fname,
+  idx_t * const outnmodes,
+  idx_t * const outnnz,
+  idx_t * const outdims)
+{
+  FILE * fin;
+  if((fin = fopen(fname, "r")) == NULL) {
+    fprintf(stderr, "SPLATT ERROR: failed to open '%s'\n", fname);
+    return SPLATT_ERROR_BADINPUT;
+  }
+
+  idx_t offsets[MAX_NMODES];
+  switch(get_file_type(fname)) {
+    case SPLATT_FILE_TEXT_COORD:
+      tt_get_dims(fin, outnmodes, outnnz, outdims, offsets);
+      break;
+    case SPLATT_FILE_BIN_COORD:
+      tt_get_dims_binary(fin, outnmodes, outnnz, outdims);
+      break;
+  }
+  fclose(fin);
+
+  if(*outnmodes > MAX_NMODES) {
+    fprintf(stderr, "SPLATT ERROR: maximum %"SPLATT_PF_IDX" modes supported. "
+                    "Found %"SPLATT_PF_IDX".\n", (idx_t) MAX_NMODES, *outnmodes);
+    return SPLATT_ERROR_BADINPUT;
+  }
+  return SPLATT_SUCCESS;
+}
+
+
 void tt_get_dims(
     FILE * fin,
     idx_t * const outnmodes,
@@ -348,6 +380,26 @@ void tt_get_dims(
 }
 
 
+void tt_get_dims_binary(
+    FILE * fin,
+    idx_t * const outnmodes,
+    idx_t * const outnnz,
+    idx_t * outdims)
+{
+  bin_header header;
+  read_binary_header(fin, &header);
+
+  idx_t nmodes = 0;
+  fill_binary_idx(&nmodes, 1, &header, fin);
+  *outnmodes = nmodes;
+  if(nmodes > MAX_NMODES) {
+    return;
+  }
+  fill_binary_idx(outdims, nmodes, &header, fin);
+  fill_binary_idx(outnnz, 1, &header, fin);
+}
+
+
 void tt_write(
   sptensor_t const * const tt,
   char const * const fname)
@@ -792,7 +844,7 @@ idx_t * part_read(
   for(idx_t i=0; i < nvtxs; ++i) {
     if((ret = fscanf(pfile, "%"SPLATT_PF_IDX, &(arr[i]))) == 0) {
       fprintf(stderr, "SPLATT ERROR: not enough elements in '%s'\n", ifname);
-      free(arr);
+      splatt_free(arr);
       return NULL;
     }
     if(arr[i] > *nparts) {
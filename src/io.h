@@ -165,6 +165,25 @@ sptensor_t * tt_read_file(
 sptensor_t * tt_read_binary_file(
   char const * const fname);
 
+#define tt_read_dims splatt_tt_read_dims
+/**
+* @brief Find the number of modes, nonzeros, and dimensions of a tensor file
+*        without reading its nonzeros into memory. Binary files only need
+*        their header to be read; text files are scanned once.
+*
+* @param fname The file to inspect.
+* @param[out] outnmodes The number of modes.
+* @param[out] outnnz The number of nonzeros.
+* @param[out] outdims The dimensions, which must have room for MAX_NMODES.
+*
+* @return SPLATT_SUCCESS, or SPLATT_ERROR_BADINPUT if the file cannot be read.
+*/
+int tt_read_dims(
+  char const * const fname,
+  idx_t * const outnmodes,
+  idx_t * const outnnz,
+  idx_t * const outdims);
+
 #define tt_write_file splatt_tt_write_file
 void tt_write_file(
   sptensor_t const * const tt,
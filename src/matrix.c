@@ -7,6 +7,8 @@
 #include "matrix.h"
 #include "util.h"
 #include "timer.h"
+#include "perfctr.h"
+#include "trace.h"
 #include "splatt_lapack.h"
 #include <math.h>
 
@@ -18,7 +20,8 @@
  *****************************************************************************/
 
 /**
-* @brief Form the Gram matrix from A^T * A.
+* @brief Form the Gram matrix from A^T * A. This must be called by every
+*        thread of a parallel region.
 *
 * @param[out] neq_matrix The matrix to fill.
 * @param aTa The individual Gram matrices.
@@ -38,52 +41,53 @@ static void p_form_gram(
 
   /* form upper-triangual normal equations */
   val_t * const restrict neqs = neq_matrix->vals;
-  #pragma omp parallel
-  {
-    /* first initialize with 1s */
-    #pragma omp for schedule(static, 1)
-    for(splatt_blas_int i=0; i < N; ++i) {
-      neqs[i+(i*N)] = 1. + reg;
-      for(splatt_blas_int j=0; j < N; ++j) {
-        neqs[j+(i*N)] = 1.;
-      }
+  /* first initialize with 1s */
+  #pragma omp for schedule(static, 1)
+  for(splatt_blas_int i=0; i < N; ++i) {
+    neqs[i+(i*N)] = 1. + reg;
+    for(splatt_blas_int j=0; j < N; ++j) {
+      neqs[j+(i*N)] = 1.;
     }
+  }
 
-    /* now Hadamard product all (A^T * A) matrices */
-    for(idx_t m=0; m < nmodes; ++m) {
-      if(m == mode) {
-        continue;
-      }
-
-      val_t const * const restrict mat = aTa[m]->vals;
-      #pragma omp for schedule(static, 1)
-      for(splatt_blas_int i=0; i < N; ++i) {
-        /* 
-         * `mat` is symmetric but stored upper right triangular, so be careful
-         * to only access that.
-         */
-
-        /* copy upper triangle */
-        for(splatt_blas_int j=i; j < N; ++j) {
-          neqs[j+(i*N)] *= mat[j+(i*N)];
-        }
-      }
-    } /* foreach mode */
-
-    #pragma omp barrier
+  /* now Hadamard product all (A^T * A) matrices */
+  for(idx_t m=0; m < nmodes; ++m) {
+    if(m == mode) {
+      continue;
+    }
 
-    /* now copy lower triangular */
+    val_t const * const restrict mat = aTa[m]->vals;
     #pragma omp for schedule(static, 1)
     for(splatt_blas_int i=0; i < N; ++i) {
-      for(splatt_blas_int j=0; j < i; ++j) {
-        neqs[j+(i*N)] = neqs[i+(j*N)];
+      /* 
+       * `mat` is symmetric but stored upper right triangular, so be careful
+       * to only access that.
+       */
+
+      /* copy upper triangle */
+      for(splatt_blas_int j=i; j < N; ++j) {
+        neqs[j+(i*N)] *= mat[j+(i*N)];
       }
     }
-  } /* omp parallel */
+  } /* foreach mode */
+
+  #pragma omp barrier
+
+  /* now copy lower triangular */
+  #pragma omp for schedule(static, 1)
+  for(splatt_blas_int i=0; i < N; ++i) {
+    for(splatt_blas_int j=0; j < i; ++j) {
+      neqs[j+(i*N)] = neqs[i+(j*N)];
+    }
+  }
 }
 
 
 
+/**
+* @brief Normalize the columns of A by their 2-norms, which are stored in
+*        'lambda'. This must be called by every thread of a parallel region.
+*/
 static void p_mat_2norm(
   matrix_t * const A,
   val_t * const restrict lambda,
@@ -94,56 +98,63 @@ static void p_mat_2norm(
   idx_t const J = A->J;
   val_t * const restrict vals = A->vals;
 
-  #pragma omp parallel
-  {
-    int const tid = splatt_omp_get_thread_num();
-    val_t * const mylambda = (val_t *) thds[tid].scratch[0];
-    for(idx_t j=0; j < J; ++j) {
-      mylambda[j] = 0;
-    }
+  int const tid = splatt_omp_get_thread_num();
+  val_t * const mylambda = (val_t *) thds[tid].scratch[0];
+  for(idx_t j=0; j < J; ++j) {
+    mylambda[j] = 0;
+  }
 
-    #pragma omp for schedule(static)
-    for(idx_t i=0; i < I; ++i) {
-      for(idx_t j=0; j < J; ++j) {
-        mylambda[j] += vals[j + (i*J)] * vals[j + (i*J)];
-      }
+  #pragma omp for schedule(static)
+  for(idx_t i=0; i < I; ++i) {
+    for(idx_t j=0; j < J; ++j) {
+      mylambda[j] += vals[j + (i*J)] * vals[j + (i*J)];
     }
+  }
 
-    /* do reduction on partial sums */
-    thd_reduce(thds, 0, J, REDUCE_SUM);
+  /* do reduction on partial sums */
+  thd_reduce(thds, 0, J, REDUCE_SUM);
 
-    #pragma omp master
-    {
+  #pragma omp master
+  {
 #ifdef SPLATT_USE_MPI
-      /* now do an MPI reduction to get the global lambda */
+    /* now do an MPI reduction to get the global lambda */
+    if(rinfo != NULL) {
       timer_start(&timers[TIMER_MPI_NORM]);
       timer_start(&timers[TIMER_MPI_COMM]);
-      MPI_Allreduce(mylambda, lambda, J, SPLATT_MPI_VAL, MPI_SUM, rinfo->comm_3d);
+      mpi_node_allreduce(mylambda, lambda, J, SPLATT_MPI_VAL, MPI_SUM,
+          rinfo);
       timer_stop(&timers[TIMER_MPI_COMM]);
       timer_stop(&timers[TIMER_MPI_NORM]);
-#else
+    } else {
       memcpy(lambda, mylambda, J * sizeof(val_t));
-#endif
     }
+#else
+    memcpy(lambda, mylambda, J * sizeof(val_t));
+#endif
+  }
 
-    #pragma omp barrier
+  #pragma omp barrier
 
-    #pragma omp for schedule(static)
-    for(idx_t j=0; j < J; ++j) {
-      lambda[j] = sqrt(lambda[j]);
-    }
+  #pragma omp for schedule(static)
+  for(idx_t j=0; j < J; ++j) {
+    lambda[j] = sqrt(lambda[j]);
+  }
 
-    /* do the normalization */
-    #pragma omp for schedule(static)
-    for(idx_t i=0; i < I; ++i) {
-      for(idx_t j=0; j < J; ++j) {
-        vals[j+(i*J)] /= lambda[j];
-      }
+  /* do the normalization */
+  #pragma omp for schedule(static)
+  for(idx_t i=0; i < I; ++i) {
+    for(idx_t j=0; j < J; ++j) {
+      vals[j+(i*J)] /= lambda[j];
     }
-  } /* end omp for */
+  }
 }
 
 
+/**
+* @brief Normalize the columns of A by their maximum entries (or 1, if
+*        larger), which are stored in 'lambda'. This must be called by every
+*        thread of a parallel region.
+*/
 static void p_mat_maxnorm(
   matrix_t * const A,
   val_t * const restrict lambda,
@@ -154,54 +165,134 @@ static void p_mat_maxnorm(
   idx_t const J = A->J;
   val_t * const restrict vals = A->vals;
 
-  #pragma omp parallel
-  {
-    int const tid = splatt_omp_get_thread_num();
-    val_t * const mylambda = (val_t *) thds[tid].scratch[0];
-    for(idx_t j=0; j < J; ++j) {
-      mylambda[j] = 0;
-    }
+  int const tid = splatt_omp_get_thread_num();
+  val_t * const mylambda = (val_t *) thds[tid].scratch[0];
+  for(idx_t j=0; j < J; ++j) {
+    mylambda[j] = 0;
+  }
 
-    #pragma omp for schedule(static)
-    for(idx_t i=0; i < I; ++i) {
-      for(idx_t j=0; j < J; ++j) {
-        mylambda[j] = SS_MAX(mylambda[j], vals[j+(i*J)]);
-      }
+  #pragma omp for schedule(static)
+  for(idx_t i=0; i < I; ++i) {
+    for(idx_t j=0; j < J; ++j) {
+      mylambda[j] = SS_MAX(mylambda[j], vals[j+(i*J)]);
     }
+  }
 
-    /* do reduction on partial maxes */
-    thd_reduce(thds, 0, J, REDUCE_MAX);
+  /* do reduction on partial maxes */
+  thd_reduce(thds, 0, J, REDUCE_MAX);
 
-    #pragma omp master
-    {
+  #pragma omp master
+  {
 #ifdef SPLATT_USE_MPI
-      /* now do an MPI reduction to get the global lambda */
+    /* now do an MPI reduction to get the global lambda */
+    if(rinfo != NULL) {
       timer_start(&timers[TIMER_MPI_NORM]);
       timer_start(&timers[TIMER_MPI_COMM]);
-      MPI_Allreduce(mylambda, lambda, J, SPLATT_MPI_VAL, MPI_MAX, rinfo->comm_3d);
+      mpi_node_allreduce(mylambda, lambda, J, SPLATT_MPI_VAL, MPI_MAX,
+          rinfo);
       timer_stop(&timers[TIMER_MPI_COMM]);
       timer_stop(&timers[TIMER_MPI_NORM]);
-#else
+    } else {
       memcpy(lambda, mylambda, J * sizeof(val_t));
+    }
+#else
+    memcpy(lambda, mylambda, J * sizeof(val_t));
 #endif
 
-    }
+  }
 
-    #pragma omp barrier
+  #pragma omp barrier
 
-    #pragma omp for schedule(static)
+  #pragma omp for schedule(static)
+  for(idx_t j=0; j < J; ++j) {
+    lambda[j] = SS_MAX(lambda[j], 1.);
+  }
+
+  /* do the normalization */
+  #pragma omp for schedule(static)
+  for(idx_t i=0; i < I; ++i) {
     for(idx_t j=0; j < J; ++j) {
-      lambda[j] = SS_MAX(lambda[j], 1.);
+      vals[j+(i*J)] /= lambda[j];
     }
+  }
+}
 
-    /* do the normalization */
-    #pragma omp for schedule(static)
-    for(idx_t i=0; i < I; ++i) {
-      for(idx_t j=0; j < J; ++j) {
-        vals[j+(i*J)] /= lambda[j];
-      }
-    }
-  } /* end omp parallel */
+
+/**
+* @brief Dispatch to the normalization 'which'. This must be called by every
+*        thread of a parallel region.
+*/
+static void p_mat_normalize(
+  matrix_t * const A,
+  val_t * const restrict lambda,
+  splatt_mat_norm const which,
+  rank_info * const rinfo,
+  thd_info * const thds)
+{
+  switch(which) {
+  case MAT_NORM_2:
+    p_mat_2norm(A, lambda, rinfo, thds);
+    break;
+  case MAT_NORM_MAX:
+    p_mat_maxnorm(A, lambda, rinfo, thds);
+    break;
+  default:
+    fprintf(stderr, "SPLATT: mat_normalize supports 2 and MAX only.\n");
+    abort();
+  }
+}
+
+
+/**
+* @brief Solve the normal equations with an SVD, for when the Gram matrix is
+*        not SPD.
+*
+* @param neq_matrix The (freshly formed) Gram matrix, which is overwritten.
+* @param rhs The right-hand side which is overwritten with the solution.
+*/
+static void p_solve_gelss(
+  matrix_t * const neq_matrix,
+  matrix_t * const rhs)
+{
+  splatt_blas_int N = neq_matrix->J;
+  splatt_blas_int lda = N;
+  splatt_blas_int ldb = N;
+  splatt_blas_int nrhs = (splatt_blas_int) rhs->I;
+  splatt_blas_int info;
+  val_t * const neqs = neq_matrix->vals;
+
+  splatt_blas_int effective_rank;
+  val_t * conditions = splatt_malloc(N * sizeof(*conditions));
+
+  /* query worksize */
+  splatt_blas_int lwork = -1;
+
+  val_t rcond = -1.0f;
+
+  val_t work_query;
+  SPLATT_BLAS(gelss)(&N, &N, &nrhs,
+      neqs, &lda,
+      rhs->vals, &ldb,
+      conditions, &rcond, &effective_rank,
+      &work_query, &lwork, &info);
+  lwork = (splatt_blas_int) work_query;
+
+  /* setup workspace */
+  val_t * work = splatt_malloc(lwork * sizeof(*work));
+
+  /* Use an SVD solver */
+  SPLATT_BLAS(gelss)(&N, &N, &nrhs,
+      neqs, &lda,
+      rhs->vals, &ldb,
+      conditions, &rcond, &effective_rank,
+      work, &lwork, &info);
+  if(info) {
+    printf("SPLATT: DGELSS returned %d\n", info);
+  }
+  printf("SPLATT:   DGELSS effective rank: %d\n", effective_rank);
+
+  splatt_free(conditions);
+  splatt_free(work);
 }
 
 
@@ -419,6 +510,8 @@ void mat_aTa(
   idx_t const nthreads)
 {
   timer_start(&timers[TIMER_ATA]);
+  perfctr_start(PERFCTR_ATA);
+  trace_begin("ata", -1);
   /* check matrix dimensions */
   assert(ret->I == ret->J);
   assert(ret->I == A->J);
@@ -443,14 +536,85 @@ void mat_aTa(
       &ldc);
 
 #ifdef SPLATT_USE_MPI
-  timer_start(&timers[TIMER_MPI_ATA]);
-  timer_start(&timers[TIMER_MPI_COMM]);
-  MPI_Allreduce(MPI_IN_PLACE, ret->vals, F * F, SPLATT_MPI_VAL, MPI_SUM,
-      rinfo->comm_3d);
-  timer_stop(&timers[TIMER_MPI_COMM]);
-  timer_stop(&timers[TIMER_MPI_ATA]);
+  if(rinfo != NULL) {
+    timer_start(&timers[TIMER_MPI_ATA]);
+    timer_start(&timers[TIMER_MPI_COMM]);
+    mpi_node_allreduce(ret->vals, ret->vals, F * F, SPLATT_MPI_VAL, MPI_SUM,
+        rinfo);
+    timer_stop(&timers[TIMER_MPI_COMM]);
+    timer_stop(&timers[TIMER_MPI_ATA]);
+  }
 #endif
 
+  trace_end();
+  perfctr_stop(PERFCTR_ATA);
+  timer_stop(&timers[TIMER_ATA]);
+}
+
+
+void mat_aTa_team(
+  matrix_t const * const A,
+  matrix_t * const ret,
+  rank_info * const rinfo,
+  thd_info * const thds)
+{
+  #pragma omp master
+  timer_start(&timers[TIMER_ATA]);
+  perfctr_start_team(PERFCTR_ATA);
+  trace_begin("ata", -1);
+  /* check matrix dimensions */
+  assert(ret->I == ret->J);
+  assert(ret->I == A->J);
+  assert(ret->vals != NULL);
+  assert(A->rowmajor);
+  assert(ret->rowmajor);
+
+  int const tid = splatt_omp_get_thread_num();
+  int const nthreads = splatt_omp_get_num_threads();
+  idx_t const F = A->J;
+  idx_t const start = (A->I * tid) / nthreads;
+  idx_t const stop = (A->I * (tid+1)) / nthreads;
+
+  /* each thread forms the Gram matrix of its own block of rows */
+  val_t * const restrict mine = (val_t *) thds[tid].scratch[1];
+  memset(mine, 0, F * F * sizeof(*mine));
+
+  char uplo = 'L';
+  char trans = 'N'; /* actually do A * A' due to row-major ordering */
+  splatt_blas_int N = (splatt_blas_int) F;
+  splatt_blas_int K = (splatt_blas_int) (stop - start);
+  splatt_blas_int lda = N;
+  splatt_blas_int ldc = N;
+  val_t alpha = 1.;
+  val_t beta = 0.;
+
+  if(K > 0) {
+    SPLATT_BLAS(syrk)(&uplo, &trans, &N, &K, &alpha, A->vals + (start * F),
+        &lda, &beta, mine, &ldc);
+  }
+
+  /* sum the partial Gram matrices into thread 0's */
+  thd_reduce(thds, 1, F * F, REDUCE_SUM);
+
+  #pragma omp master
+  {
+    memcpy(ret->vals, thds[0].scratch[1], F * F * sizeof(*ret->vals));
+#ifdef SPLATT_USE_MPI
+    if(rinfo != NULL) {
+      timer_start(&timers[TIMER_MPI_ATA]);
+      timer_start(&timers[TIMER_MPI_COMM]);
+      mpi_node_allreduce(ret->vals, ret->vals, F * F, SPLATT_MPI_VAL, MPI_SUM,
+          rinfo);
+      timer_stop(&timers[TIMER_MPI_COMM]);
+      timer_stop(&timers[TIMER_MPI_ATA]);
+    }
+#endif
+  }
+  #pragma omp barrier
+
+  trace_end();
+  perfctr_stop_team(PERFCTR_ATA);
+  #pragma omp master
   timer_stop(&timers[TIMER_ATA]);
 }
 
@@ -509,18 +673,35 @@ void mat_normalize(
   timer_start(&timers[TIMER_MATNORM]);
 
   splatt_omp_set_num_threads(nthreads);
+  perfctr_start(PERFCTR_MATNORM);
+  trace_begin("normalize", -1);
 
-  switch(which) {
-  case MAT_NORM_2:
-    p_mat_2norm(A, lambda, rinfo, thds);
-    break;
-  case MAT_NORM_MAX:
-    p_mat_maxnorm(A, lambda, rinfo, thds);
-    break;
-  default:
-    fprintf(stderr, "SPLATT: mat_normalize supports 2 and MAX only.\n");
-    abort();
-  }
+  #pragma omp parallel
+  p_mat_normalize(A, lambda, which, rinfo, thds);
+
+  trace_end();
+  perfctr_stop(PERFCTR_MATNORM);
+  timer_stop(&timers[TIMER_MATNORM]);
+}
+
+
+void mat_normalize_team(
+  matrix_t * const A,
+  val_t * const restrict lambda,
+  splatt_mat_norm const which,
+  rank_info * const rinfo,
+  thd_info * const thds)
+{
+  #pragma omp master
+  timer_start(&timers[TIMER_MATNORM]);
+  perfctr_start_team(PERFCTR_MATNORM);
+  trace_begin("normalize", -1);
+
+  p_mat_normalize(A, lambda, which, rinfo, thds);
+
+  trace_end();
+  perfctr_stop_team(PERFCTR_MATNORM);
+  #pragma omp master
   timer_stop(&timers[TIMER_MATNORM]);
 }
 
@@ -534,10 +715,13 @@ void mat_solve_normals(
   val_t const reg)
 {
   timer_start(&timers[TIMER_INV]);
+  perfctr_start(PERFCTR_INV);
+  trace_begin("solve", mode);
 
   /* nfactors */
   splatt_blas_int N = aTa[0]->J;
 
+  #pragma omp parallel
   p_form_gram(aTa[MAX_NMODES], aTa, mode, nmodes, reg);
 
   splatt_blas_int info;
@@ -566,42 +750,80 @@ void mat_solve_normals(
     }
   } else {
     /* restore gram matrix */
+    #pragma omp parallel
     p_form_gram(aTa[MAX_NMODES], aTa, mode, nmodes, reg);
 
-    splatt_blas_int effective_rank;
-    val_t * conditions = splatt_malloc(N * sizeof(*conditions));
+    p_solve_gelss(aTa[MAX_NMODES], rhs);
+  }
 
-    /* query worksize */
-    splatt_blas_int lwork = -1;
+  trace_end();
+  perfctr_stop(PERFCTR_INV);
+  timer_stop(&timers[TIMER_INV]);
+}
 
-    val_t rcond = -1.0f;
 
-    val_t work_query;
-    SPLATT_BLAS(gelss)(&N, &N, &nrhs,
-        neqs, &lda,
-        rhs->vals, &ldb,
-        conditions, &rcond, &effective_rank,
-        &work_query, &lwork, &info);
-    lwork = (splatt_blas_int) work_query;
+void mat_solve_normals_team(
+  idx_t const mode,
+  idx_t const nmodes,
+  matrix_t * * aTa,
+  matrix_t * rhs,
+  val_t const reg)
+{
+  #pragma omp master
+  timer_start(&timers[TIMER_INV]);
+  perfctr_start_team(PERFCTR_INV);
+  trace_begin("solve", mode);
+
+  /* nfactors */
+  splatt_blas_int N = aTa[0]->J;
+
+  p_form_gram(aTa[MAX_NMODES], aTa, mode, nmodes, reg);
+
+  splatt_blas_int info;
+  char uplo = 'L';
+  splatt_blas_int lda = N;
+  splatt_blas_int ldb = N;
+  splatt_blas_int order = N;
 
-    /* setup workspace */
-    val_t * work = splatt_malloc(lwork * sizeof(*work));
+  val_t * const neqs = aTa[MAX_NMODES]->vals;
 
-    /* Use an SVD solver */
-    SPLATT_BLAS(gelss)(&N, &N, &nrhs,
-        neqs, &lda,
-        rhs->vals, &ldb,
-        conditions, &rcond, &effective_rank,
-        work, &lwork, &info);
+  /* the factorization is tiny, so one thread does it for everyone */
+  bool is_spd = true;
+  #pragma omp single copyprivate(is_spd)
+  {
+    SPLATT_BLAS(potrf)(&uplo, &order, neqs, &lda, &info);
     if(info) {
-      printf("SPLATT: DGELSS returned %d\n", info);
+      fprintf(stderr, "SPLATT: Gram matrix is not SPD. Trying `GELSS`.\n");
+      is_spd = false;
     }
-    printf("SPLATT:   DGELSS effective rank: %d\n", effective_rank);
+  }
+
+  if(is_spd) {
+    /* each thread solves against its own block of rows */
+    int const tid = splatt_omp_get_thread_num();
+    int const nthreads = splatt_omp_get_num_threads();
+    idx_t const start = (rhs->I * tid) / nthreads;
+    idx_t const stop = (rhs->I * (tid+1)) / nthreads;
+    splatt_blas_int nrhs = (splatt_blas_int) (stop - start);
+    if(nrhs > 0) {
+      SPLATT_BLAS(potrs)(&uplo, &order, &nrhs, neqs, &lda,
+          rhs->vals + (start * rhs->J), &ldb, &info);
+      if(info) {
+        fprintf(stderr, "SPLATT: DPOTRS returned %d\n", info);
+      }
+    }
+    #pragma omp barrier
+  } else {
+    /* restore gram matrix */
+    p_form_gram(aTa[MAX_NMODES], aTa, mode, nmodes, reg);
 
-    splatt_free(conditions);
-    splatt_free(work);
+    #pragma omp single
+    p_solve_gelss(aTa[MAX_NMODES], rhs);
   }
 
+  trace_end();
+  perfctr_stop_team(PERFCTR_INV);
+  #pragma omp master
   timer_stop(&timers[TIMER_INV]);
 }
 
@@ -641,11 +863,13 @@ matrix_t * mat_alloc(
   idx_t const nrows,
   idx_t const ncols)
 {
+  splatt_mem_tag const prev_tag = mem_tag_begin(SPLATT_MEM_MATRICES);
   matrix_t * mat = (matrix_t *) splatt_malloc(sizeof(matrix_t));
   mat->I = nrows;
   mat->J = ncols;
   mat->vals = (val_t *) splatt_malloc(nrows * ncols * sizeof(val_t));
   mat->rowmajor = 1;
+  mem_tag_end(prev_tag);
   return mat;
 }
 
@@ -664,8 +888,8 @@ matrix_t * mat_rand(
 void mat_free(
   matrix_t * mat)
 {
-  free(mat->vals);
-  free(mat);
+  splatt_free(mat->vals);
+  splatt_free(mat);
 }
 
 matrix_t * mat_mkrow(
@@ -717,6 +941,7 @@ spmatrix_t * spmat_alloc(
   idx_t const ncols,
   idx_t const nnz)
 {
+  splatt_mem_tag const prev_tag = mem_tag_begin(SPLATT_MEM_MATRICES);
   spmatrix_t * mat = (spmatrix_t*) splatt_malloc(sizeof(spmatrix_t));
   mat->I = nrows;
   mat->J = ncols;
@@ -724,15 +949,16 @@ spmatrix_t * spmat_alloc(
   mat->rowptr = (idx_t*) splatt_malloc((nrows+1) * sizeof(idx_t));
   mat->colind = (idx_t*) splatt_malloc(nnz * sizeof(idx_t));
   mat->vals   = (val_t*) splatt_malloc(nnz * sizeof(val_t));
+  mem_tag_end(prev_tag);
   return mat;
 }
 
 void spmat_free(
   spmatrix_t * mat)
 {
-  free(mat->rowptr);
-  free(mat->colind);
-  free(mat->vals);
-  free(mat);
+  splatt_free(mat->rowptr);
+  splatt_free(mat->colind);
+  splatt_free(mat->vals);
+  splatt_free(mat);
 }
 
@@ -107,6 +107,8 @@ void mat_aTa_hada(
 *
 * @param A The input matrix.
 * @param ret The output matrix, A^T * A.
+* @param rinfo MPI rank information. If NULL, A is not distributed and no
+*              reduction is done.
 * @param thds Data structure for thread scratch space.
 */
 void mat_aTa(
@@ -116,6 +118,26 @@ void mat_aTa(
   thd_info * const thds,
   idx_t const nthreads);
 
+
+#define mat_aTa_team splatt_mat_aTa_team
+/**
+* @brief Compute A^T * A inside a parallel region. Each thread forms the
+*        product of a block of rows, which are then summed.
+*
+*        NOTE: this must be called by every thread of the team.
+*
+* @param A The input matrix.
+* @param ret The output matrix, A^T * A.
+* @param rinfo MPI rank information. If NULL, A is not distributed and no
+*              reduction is done.
+* @param thds Thread structures. scratch[1] of each must hold F*F values.
+*/
+void mat_aTa_team(
+  matrix_t const * const A,
+  matrix_t * const ret,
+  rank_info * const rinfo,
+  thd_info * const thds);
+
 #define calc_gram_inv splatt_calc_gram_inv
 /**
 * @brief Calculate (BtB * CtC * ...)^-1, where * is the Hadamard product. This
@@ -139,6 +161,27 @@ void mat_solve_normals(
   matrix_t * rhs,
   val_t const reg);
 
+
+#define mat_solve_normals_team splatt_mat_solve_normals_team
+/**
+* @brief Like mat_solve_normals(), but inside a parallel region. One thread
+*        factors the Gram matrix and each thread then solves a block of rows.
+*
+*        NOTE: this must be called by every thread of the team.
+*
+* @param mode Which mode we are solving for.
+* @param nmodes The number of modes in the tensor.
+* @param aTa The Gram matrices. aTa[MAX_NMODES] is used as scratch space.
+* @param rhs The right-hand side which is overwritten with the solution.
+* @param reg Regularization parameter (to add to the diagonal).
+*/
+void mat_solve_normals_team(
+  idx_t const mode,
+  idx_t const nmodes,
+  matrix_t * * aTa,
+  matrix_t * rhs,
+  val_t const reg);
+
 #define mat_normalize splatt_mat_normalize
 /**
 * @brief Normalize the columns of A and return the norms in lambda.
@@ -149,6 +192,8 @@ void mat_solve_normals(
 * @param A The matrix to normalize.
 * @param lambda The vector of column norms.
 * @param which Which norm to use.
+* @param rinfo MPI rank information. If NULL, A is not distributed and no
+*              reduction is done.
 */
 void mat_normalize(
   matrix_t * const A,
@@ -159,6 +204,27 @@ void mat_normalize(
   idx_t const nthreads);
 
 
+#define mat_normalize_team splatt_mat_normalize_team
+/**
+* @brief Like mat_normalize(), but inside a parallel region.
+*
+*        NOTE: this must be called by every thread of the team.
+*
+* @param A The matrix to normalize.
+* @param lambda The vector of column norms.
+* @param which Which norm to use.
+* @param rinfo MPI rank information. If NULL, A is not distributed and no
+*              reduction is done.
+* @param thds Thread structures. scratch[0] of each must hold A->J values.
+*/
+void mat_normalize_team(
+  matrix_t * const A,
+  val_t * const restrict lambda,
+  splatt_mat_norm const which,
+  rank_info * const rinfo,
+  thd_info * const thds);
+
+
 #define mat_rand splatt_mat_rand
 /**
 * @brief Return a randomly initialized matrix (from util's rand_val()).
@@ -0,0 +1,355 @@
+
+
+/******************************************************************************
+ * INCLUDES
+ *****************************************************************************/
+#include "metrics.h"
+#include "timer.h"
+
+#include <math.h>
+
+
+/******************************************************************************
+ * PRIVATE STRUCTURES
+ *****************************************************************************/
+
+static bool is_enabled = false;
+static splatt_metric * metrics = NULL;
+static idx_t nmetrics = 0;
+static idx_t max_metrics = 0;
+
+/* open-addressed hash of metric keys; slots hold (index into metrics) + 1,
+ * and 0 marks an empty slot */
+static idx_t * lookup = NULL;
+static idx_t lookup_size = 0;
+
+
+
+/******************************************************************************
+ * PRIVATE FUNCTIONS
+ *****************************************************************************/
+
+/**
+* @brief Hash the key of a metric. Strings are hashed by content so that
+*        equal literals from different translation units collide.
+*/
+static idx_t p_hash(
+    char const * const group,
+    char const * const name,
+    int const iteration,
+    int const mode,
+    int const thread)
+{
+  /* FNV-1a */
+  uint64_t h = 14695981039346656037ULL;
+  for(char const * c = group; *c != '\0'; ++c) {
+    h = (h ^ (unsigned char) *c) * 1099511628211ULL;
+  }
+  h = (h ^ 0xff) * 1099511628211ULL;
+  for(char const * c = name; *c != '\0'; ++c) {
+    h = (h ^ (unsigned char) *c) * 1099511628211ULL;
+  }
+  int const ints[3] = {iteration, mode, thread};
+  for(int i=0; i < 3; ++i) {
+    h = (h ^ (uint32_t) ints[i]) * 1099511628211ULL;
+  }
+  return (idx_t) h;
+}
+
+
+static bool p_matches(
+    splatt_metric const * const m,
+    char const * const group,
+    char const * const name,
+    int const iteration,
+    int const mode,
+    int const thread)
+{
+  return m->iteration == iteration && m->mode == mode &&
+      m->thread == thread && strcmp(m->name, name) == 0 &&
+      strcmp(m->group, group) == 0;
+}
+
+
+/**
+* @brief Return the lookup slot holding a key, or the empty slot where it
+*        would be inserted.
+*/
+static idx_t * p_slot(
+    char const * const group,
+    char const * const name,
+    int const iteration,
+    int const mode,
+    int const thread)
+{
+  idx_t const mask = lookup_size - 1;
+  idx_t s = p_hash(group, name, iteration, mode, thread) & mask;
+  while(lookup[s] != 0) {
+    if(p_matches(metrics + lookup[s] - 1, group, name, iteration, mode,
+        thread)) {
+      break;
+    }
+    s = (s + 1) & mask;
+  }
+  return lookup + s;
+}
+
+
+/**
+* @brief Point the lookup entry of metric 'i' at it. A later metric with the
+*        same key replaces an earlier one, so lookups find the most recent.
+*/
+static void p_index(
+    idx_t const i)
+{
+  splatt_metric const * const m = metrics + i;
+  *p_slot(m->group, m->name, m->iteration, m->mode, m->thread) = i + 1;
+}
+
+
+/**
+* @brief Find the most recent metric matching a key.
+*
+* @return The metric, or NULL if none matches.
+*/
+static splatt_metric * p_find(
+    char const * const group,
+    char const * const name,
+    int const iteration,
+    int const mode,
+    int const thread)
+{
+  if(lookup_size == 0) {
+    return NULL;
+  }
+  idx_t const slot = *p_slot(group, name, iteration, mode, thread);
+  return (slot == 0) ? NULL : metrics + slot - 1;
+}
+
+
+static void p_write_value(
+    FILE * fout,
+    double const value,
+    char const * const nan_str)
+{
+  if(isfinite(value)) {
+    fprintf(fout, "%.12g", value);
+  } else {
+    fprintf(fout, "%s", nan_str);
+  }
+}
+
+
+static void p_write_json(
+    FILE * fout)
+{
+  fprintf(fout, "{\n");
+  fprintf(fout, "  \"version\": \"%d.%d.%d\",\n",
+      SPLATT_VER_MAJOR, SPLATT_VER_MINOR, SPLATT_VER_SUBMINOR);
+  fprintf(fout, "  \"metrics\": [");
+  for(idx_t i=0; i < nmetrics; ++i) {
+    splatt_metric const * const m = metrics + i;
+    fprintf(fout, "%s\n    {\"group\": \"%s\", \"name\": \"%s\"",
+        (i > 0) ? "," : "", m->group, m->name);
+    if(m->iteration >= 0) {
+      fprintf(fout, ", \"iteration\": %d", m->iteration);
+    }
+    if(m->mode >= 0) {
+      fprintf(fout, ", \"mode\": %d", m->mode);
+    }
+    if(m->thread >= 0) {
+      fprintf(fout, ", \"thread\": %d", m->thread);
+    }
+    fprintf(fout, ", \"value\": ");
+    p_write_value(fout, m->value, "null");
+    fprintf(fout, "}");
+  }
+  fprintf(fout, "\n  ]\n}\n");
+}
+
+
+static void p_write_csv(
+    FILE * fout)
+{
+  fprintf(fout, "group,name,iteration,mode,thread,value\n");
+  for(idx_t i=0; i < nmetrics; ++i) {
+    splatt_metric const * const m = metrics + i;
+    fprintf(fout, "%s,%s,", m->group, m->name);
+    if(m->iteration >= 0) {
+      fprintf(fout, "%d", m->iteration);
+    }
+    fprintf(fout, ",");
+    if(m->mode >= 0) {
+      fprintf(fout, "%d", m->mode);
+    }
+    fprintf(fout, ",");
+    if(m->thread >= 0) {
+      fprintf(fout, "%d", m->thread);
+    }
+    fprintf(fout, ",");
+    p_write_value(fout, m->value, "nan");
+    fprintf(fout, "\n");
+  }
+}
+
+
+
+/******************************************************************************
+ * API FUNCTIONS
+ *****************************************************************************/
+
+void splatt_metrics_enable(void)
+{
+  is_enabled = true;
+}
+
+
+void splatt_metrics_disable(void)
+{
+  is_enabled = false;
+}
+
+
+splatt_idx_t splatt_metrics_count(void)
+{
+  return nmetrics;
+}
+
+
+splatt_metric const * splatt_metrics_get(void)
+{
+  return metrics;
+}
+
+
+void splatt_metrics_clear(void)
+{
+  free(metrics);
+  metrics = NULL;
+  nmetrics = 0;
+  max_metrics = 0;
+
+  free(lookup);
+  lookup = NULL;
+  lookup_size = 0;
+}
+
+
+int splatt_metrics_write(
+    char const * const fname,
+    splatt_metrics_format const format)
+{
+  record_times();
+
+  FILE * fout = fopen(fname, "w");
+  if(fout == NULL) {
+    fprintf(stderr, "SPLATT ERROR: failed to open '%s'\n", fname);
+    return SPLATT_ERROR_BADINPUT;
+  }
+
+  switch(format) {
+  case SPLATT_METRICS_JSON:
+    p_write_json(fout);
+    break;
+  case SPLATT_METRICS_CSV:
+    p_write_csv(fout);
+    break;
+  default:
+    fprintf(stderr, "SPLATT ERROR: unknown metrics format %d\n", format);
+    fclose(fout);
+    return SPLATT_ERROR_BADINPUT;
+  }
+
+  fclose(fout);
+  return SPLATT_SUCCESS;
+}
+
+
+
+/******************************************************************************
+ * PUBLIC FUNCTIONS
+ *****************************************************************************/
+
+bool metrics_enabled(void)
+{
+  return is_enabled;
+}
+
+
+void metrics_record(
+    char const * const group,
+    char const * const name,
+    int const iteration,
+    int const mode,
+    int const thread,
+    double const value)
+{
+  if(!is_enabled) {
+    return;
+  }
+
+  if(nmetrics == max_metrics) {
+    max_metrics = SS_MAX(64, 2 * max_metrics);
+    metrics = realloc(metrics, max_metrics * sizeof(*metrics));
+
+    /* keep the lookup at most half full */
+    lookup_size = 2 * max_metrics;
+    free(lookup);
+    lookup = calloc(lookup_size, sizeof(*lookup));
+    for(idx_t i=0; i < nmetrics; ++i) {
+      p_index(i);
+    }
+  }
+
+  splatt_metric * const m = metrics + nmetrics;
+  m->group = group;
+  m->name = name;
+  m->iteration = iteration;
+  m->mode = mode;
+  m->thread = thread;
+  m->value = value;
+  p_index(nmetrics);
+  ++nmetrics;
+}
+
+
+void metrics_set(
+    char const * const group,
+    char const * const name,
+    int const iteration,
+    int const mode,
+    int const thread,
+    double const value)
+{
+  if(!is_enabled) {
+    return;
+  }
+
+  splatt_metric * const m = p_find(group, name, iteration, mode, thread);
+  if(m != NULL) {
+    m->value = value;
+  } else {
+    metrics_record(group, name, iteration, mode, thread, value);
+  }
+}
+
+
+void metrics_accum(
+    char const * const group,
+    char const * const name,
+    int const iteration,
+    int const mode,
+    int const thread,
+    double const value)
+{
+  if(!is_enabled) {
+    return;
+  }
+
+  splatt_metric * const m = p_find(group, name, iteration, mode, thread);
+  if(m != NULL) {
+    m->value += value;
+  } else {
+    metrics_record(group, name, iteration, mode, thread, value);
+  }
+}
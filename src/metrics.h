@@ -0,0 +1,70 @@
+#ifndef SPLATT_METRICS_H
+#define SPLATT_METRICS_H
+
+
+/******************************************************************************
+ * INCLUDES
+ *****************************************************************************/
+#include "base.h"
+
+
+/******************************************************************************
+ * PUBLIC FUNCTIONS
+ *****************************************************************************/
+
+/*
+ * All functions below must be called from serial code. 'group' and 'name'
+ * must point to static storage (e.g., string literals). Pass -1 for any
+ * index that does not apply.
+ */
+
+
+#define metrics_enabled splatt_metrics_enabled
+/**
+* @brief Return whether metrics are being recorded. Use this to skip work
+*        which is only needed to produce a metric.
+*/
+bool metrics_enabled(void);
+
+
+#define metrics_record splatt_metrics_record
+/**
+* @brief Append a new metric.
+*/
+void metrics_record(
+    char const * const group,
+    char const * const name,
+    int const iteration,
+    int const mode,
+    int const thread,
+    double const value);
+
+
+#define metrics_set splatt_metrics_set
+/**
+* @brief Overwrite the value of a metric with the same group, name, and
+*        indices, or append it if none exists.
+*/
+void metrics_set(
+    char const * const group,
+    char const * const name,
+    int const iteration,
+    int const mode,
+    int const thread,
+    double const value);
+
+
+#define metrics_accum splatt_metrics_accum
+/**
+* @brief Add to the value of a metric with the same group, name, and indices,
+*        or append it if none exists.
+*/
+void metrics_accum(
+    char const * const group,
+    char const * const name,
+    int const iteration,
+    int const mode,
+    int const thread,
+    double const value);
+
+#endif
@@ -0,0 +1,654 @@
+
+
+/******************************************************************************
+ * INCLUDES
+ *****************************************************************************/
+#include "microbench.h"
+#include "bench.h"
+#include "csf.h"
+#include "matrix.h"
+#include "metrics.h"
+#include "mttkrp.h"
+#include "mutex_pool.h"
+#include "sort.h"
+#include "thd_info.h"
+#include "thread_partition.h"
+#include "timer.h"
+#include "util.h"
+
+
+/******************************************************************************
+ * PRIVATE STRUCTURES
+ *****************************************************************************/
+
+/* number of modes of the factors whose Grams form the normal equations */
+#define MB_SOLVE_NMODES 3
+
+/* modes of generated tensors whose dimensions are not given */
+#define MB_DEFAULT_NMODES 3
+
+/* largest item weight of the partitioning benchmark */
+#define MB_MAX_WEIGHT 100
+
+static char const * const kernel_names[] = {
+  [MB_SORT]      = "sort",
+  [MB_FPTR]      = "fptr",
+  [MB_CSF]       = "csf",
+  [MB_ATA]       = "ata",
+  [MB_SOLVE]     = "solve",
+  [MB_NORMALIZE] = "normalize",
+  [MB_REDUCE]    = "reduce",
+  [MB_PARTITION] = "partition",
+  [MB_MUTEX]     = "mutex",
+};
+
+/* what SIZE counts, for reporting rates */
+static char const * const kernel_units[] = {
+  [MB_SORT]      = "nnz",
+  [MB_FPTR]      = "nnz",
+  [MB_CSF]       = "nnz",
+  [MB_ATA]       = "rows",
+  [MB_SOLVE]     = "rows",
+  [MB_NORMALIZE] = "rows",
+  [MB_REDUCE]    = "rows",
+  [MB_PARTITION] = "items",
+  [MB_MUTEX]     = "locks",
+};
+
+
+/**
+* @brief The inputs of one microbenchmark. 'orig' holds the pristine copy of
+*        whatever the kernel modifies.
+*/
+typedef struct
+{
+  sptensor_t * tt;
+  sptensor_t * orig_tt;
+  double * csf_opts;
+
+  matrix_t * A;
+  matrix_t * orig_A;
+  matrix_t * aTa[MAX_NMODES+1];
+  val_t * lambda;
+  thd_info * thds;
+
+  splatt_mttkrp_ws ws;
+  val_t * output;
+
+  idx_t * weights;
+  idx_t * orig_weights;
+
+  mutex_pool * pool;
+} mb_inputs;
+
+
+/******************************************************************************
+ * PRIVATE FUNCTIONS
+ *****************************************************************************/
+
+/**
+* @brief Copy the nonzeros of 'src' into 'dest', which has the same shape.
+*/
+static void p_copy_tt(
+  sptensor_t * const dest,
+  sptensor_t const * const src)
+{
+  for(idx_t m=0; m < src->nmodes; ++m) {
+    dest->dims[m] = src->dims[m];
+    par_memcpy(dest->ind[m], src->ind[m], src->nnz * sizeof(**(src->ind)));
+  }
+  par_memcpy(dest->vals, src->vals, src->nnz * sizeof(*(src->vals)));
+}
+
+
+/**
+* @brief Randomly permute the nonzeros of a tensor, so that sorting it is not
+*        helped by the order it was generated or read in.
+*/
+static void p_shuffle_tt(
+  sptensor_t * const tt)
+{
+  for(idx_t n=tt->nnz; n > 1; --n) {
+    idx_t const swap = rand_idx() % n;
+    for(idx_t m=0; m < tt->nmodes; ++m) {
+      idx_t const tmp = tt->ind[m][n-1];
+      tt->ind[m][n-1] = tt->ind[m][swap];
+      tt->ind[m][swap] = tmp;
+    }
+    val_t const tmp = tt->vals[n-1];
+    tt->vals[n-1] = tt->vals[swap];
+    tt->vals[swap] = tmp;
+  }
+}
+
+
+/**
+* @brief Return the shuffled tensor which the sparse kernels of 'config' run
+*        on. The last tensor is kept in '*cached' and reused if its size
+*        matches.
+*/
+static sptensor_t const * p_get_tensor(
+  sptensor_t const * const tt,
+  gen_opts const * const gen,
+  idx_t const size,
+  sptensor_t ** const cached)
+{
+  if(*cached != NULL && (tt != NULL || (*cached)->nnz == size)) {
+    return *cached;
+  }
+  if(*cached != NULL) {
+    tt_free(*cached);
+  }
+
+  if(tt != NULL) {
+    *cached = tt_alloc(tt->nnz, tt->nmodes);
+    p_copy_tt(*cached, tt);
+  } else {
+    gen_opts opts = *gen;
+    opts.nnz = size;
+    if(opts.nmodes == 0) {
+      /* about ten nonzeros per slice */
+      opts.nmodes = MB_DEFAULT_NMODES;
+      for(idx_t m=0; m < opts.nmodes; ++m) {
+        opts.dims[m] = SS_MAX(size / 10, 1);
+      }
+    }
+    *cached = tt_generate(&opts);
+  }
+  if(*cached != NULL) {
+    p_shuffle_tt(*cached);
+  }
+  return *cached;
+}
+
+
+/**
+* @brief Allocate the inputs of a microbenchmark.
+*
+* @return false if the inputs could not be built.
+*/
+static bool p_setup(
+  microbench_config const * const config,
+  sptensor_t const * const sparse,
+  mb_inputs * const in)
+{
+  memset(in, 0, sizeof(*in));
+
+  idx_t const nthreads = config->nthreads;
+  idx_t const size = config->size;
+  idx_t const rank = SS_MAX(config->rank, 1);
+
+  switch(config->kernel) {
+  case MB_SORT:
+  case MB_FPTR:
+  case MB_CSF:
+    if(sparse == NULL) {
+      return false;
+    }
+    in->orig_tt = tt_alloc(sparse->nnz, sparse->nmodes);
+    p_copy_tt(in->orig_tt, sparse);
+    in->tt = tt_alloc(sparse->nnz, sparse->nmodes);
+    p_copy_tt(in->tt, sparse);
+    in->csf_opts = splatt_default_opts();
+    in->csf_opts[SPLATT_OPTION_CSF_ALLOC] = SPLATT_CSF_ONEMODE;
+    in->csf_opts[SPLATT_OPTION_TILE] = SPLATT_NOTILE;
+    in->csf_opts[SPLATT_OPTION_NTHREADS] = nthreads;
+    break;
+
+  case MB_ATA:
+  case MB_SOLVE:
+  case MB_NORMALIZE:
+    in->A = mat_rand(size, rank);
+    in->orig_A = mat_alloc(size, rank);
+    par_memcpy(in->orig_A->vals, in->A->vals, size * rank * sizeof(val_t));
+    in->lambda = splatt_malloc(rank * sizeof(*(in->lambda)));
+    for(idx_t m=0; m < MB_SOLVE_NMODES; ++m) {
+      in->aTa[m] = mat_alloc(rank, rank);
+    }
+    in->aTa[MAX_NMODES] = mat_alloc(rank, rank);
+    /* add 64 bytes to avoid false sharing */
+    in->thds = thd_init(nthreads, 3,
+        (SS_MAX(rank, MB_SOLVE_NMODES) * rank * sizeof(val_t)) + 64,
+        (SS_MAX(rank, MB_SOLVE_NMODES) * rank * sizeof(val_t)) + 64,
+        (SS_MAX(rank, MB_SOLVE_NMODES) * rank * sizeof(val_t)) + 64);
+    if(config->kernel == MB_SOLVE) {
+      /* SPD normal equations from the Grams of random factors */
+      for(idx_t m=0; m < MB_SOLVE_NMODES; ++m) {
+        mat_aTa(in->A, in->aTa[m], NULL, in->thds, nthreads);
+      }
+    }
+    break;
+
+  case MB_REDUCE:
+    in->ws.num_threads = nthreads;
+    in->ws.privatize_buffer =
+        splatt_malloc(nthreads * sizeof(*(in->ws.privatize_buffer)));
+    for(idx_t t=0; t < nthreads; ++t) {
+      in->ws.privatize_buffer[t] = splatt_malloc(size * rank * sizeof(val_t));
+      fill_rand(in->ws.privatize_buffer[t], size * rank);
+    }
+    in->output = splatt_malloc(size * rank * sizeof(*(in->output)));
+    fill_rand(in->output, size * rank);
+    break;
+
+  case MB_PARTITION:
+    in->weights = splatt_malloc(size * sizeof(*(in->weights)));
+    in->orig_weights = splatt_malloc(size * sizeof(*(in->orig_weights)));
+    for(idx_t i=0; i < size; ++i) {
+      in->orig_weights[i] = 1 + (rand_idx() % MB_MAX_WEIGHT);
+    }
+    break;
+
+  case MB_MUTEX:
+    in->pool = mutex_alloc();
+    break;
+
+  case MB_NKERNELS:
+    return false;
+  }
+
+  return true;
+}
+
+
+/**
+* @brief Restore whatever the previous run of a kernel modified. This is not
+*        timed.
+*/
+static void p_restore(
+  microbench_config const * const config,
+  mb_inputs * const in)
+{
+  switch(config->kernel) {
+  case MB_SORT:
+  case MB_CSF:
+    p_copy_tt(in->tt, in->orig_tt);
+    break;
+  case MB_SOLVE:
+    par_memcpy(in->A->vals, in->orig_A->vals,
+        in->A->I * in->A->J * sizeof(val_t));
+    break;
+  case MB_PARTITION:
+    memcpy(in->weights, in->orig_weights,
+        config->size * sizeof(*(in->weights)));
+    break;
+  default:
+    break;
+  }
+}
+
+
+/**
+* @brief Run a kernel once and return its time in seconds.
+*/
+static double p_run_kernel(
+  microbench_config const * const config,
+  mb_inputs * const in)
+{
+  idx_t const nthreads = config->nthreads;
+  idx_t const size = config->size;
+  idx_t const rank = SS_MAX(config->rank, 1);
+
+  sp_timer_t timer;
+  timer_fstart(&timer);
+
+  switch(config->kernel) {
+  case MB_SORT:
+    tt_sort(in->tt, 0, NULL);
+    break;
+
+  case MB_FPTR: {
+    /* the tensor stays sorted after the first run, so the sort inside
+     * csf_alloc() is cheap, and its time is removed anyway */
+    double const sorted = timers[TIMER_SORT].seconds;
+    splatt_csf * cs = csf_alloc(in->tt, in->csf_opts);
+    timer_stop(&timer);
+    timer.seconds -= timers[TIMER_SORT].seconds - sorted;
+    csf_free(cs, in->csf_opts);
+    return timer.seconds;
+  }
+
+  case MB_CSF: {
+    splatt_csf * cs = csf_alloc(in->tt, in->csf_opts);
+    timer_stop(&timer);
+    csf_free(cs, in->csf_opts);
+    return timer.seconds;
+  }
+
+  case MB_ATA:
+    mat_aTa(in->A, in->aTa[0], NULL, in->thds, nthreads);
+    break;
+
+  case MB_SOLVE:
+    mat_solve_normals(0, MB_SOLVE_NMODES, in->aTa, in->A, 0.);
+    break;
+
+  case MB_NORMALIZE:
+    mat_normalize(in->A, in->lambda, MAT_NORM_2, NULL, in->thds, nthreads);
+    break;
+
+  case MB_REDUCE:
+    #pragma omp parallel num_threads(nthreads)
+    {
+      mttkrp_reduce_privatized(&(in->ws), in->output, size, rank);
+    }
+    break;
+
+  case MB_PARTITION: {
+    idx_t bottleneck;
+    idx_t * parts = partition_weighted(in->weights, size, nthreads,
+        &bottleneck);
+    timer_stop(&timer);
+    splatt_free(parts);
+    return timer.seconds;
+  }
+
+  case MB_MUTEX:
+    #pragma omp parallel for schedule(static) num_threads(nthreads)
+    for(idx_t i=0; i < size; ++i) {
+      /* scatter the ids like the rows updated by MTTKRP */
+      int const id = (int) ((i * 2654435761ULL) & 0x7fffffff);
+      mutex_set_lock(in->pool, id);
+      mutex_unset_lock(in->pool, id);
+    }
+    break;
+
+  case MB_NKERNELS:
+    break;
+  }
+
+  timer_stop(&timer);
+  return timer.seconds;
+}
+
+
+static void p_free_inputs(
+  microbench_config const * const config,
+  mb_inputs * const in)
+{
+  if(in->tt != NULL) {
+    tt_free(in->tt);
+    tt_free(in->orig_tt);
+    splatt_free_opts(in->csf_opts);
+  }
+  if(in->A != NULL) {
+    mat_free(in->A);
+    mat_free(in->orig_A);
+    splatt_free(in->lambda);
+    for(idx_t m=0; m < MB_SOLVE_NMODES; ++m) {
+      mat_free(in->aTa[m]);
+    }
+    mat_free(in->aTa[MAX_NMODES]);
+    thd_free(in->thds, config->nthreads);
+  }
+  if(in->output != NULL) {
+    for(idx_t t=0; t < config->nthreads; ++t) {
+      splatt_free(in->ws.privatize_buffer[t]);
+    }
+    splatt_free(in->ws.privatize_buffer);
+    splatt_free(in->output);
+  }
+  if(in->weights != NULL) {
+    splatt_free(in->weights);
+    splatt_free(in->orig_weights);
+  }
+  if(in->pool != NULL) {
+    mutex_free(in->pool);
+  }
+}
+
+
+static bool p_same_config(
+  microbench_config const * const a,
+  microbench_config const * const b)
+{
+  return a->kernel == b->kernel && a->size == b->size &&
+      a->rank == b->rank && a->nthreads == b->nthreads;
+}
+
+
+static void p_print_config(
+  microbench_config const * const config)
+{
+  printf("  kernel=%-9s size=%-10"SPLATT_PF_IDX" rank=%-4"SPLATT_PF_IDX
+      " thds=%-3"SPLATT_PF_IDX, kernel_names[config->kernel], config->size,
+      config->rank, config->nthreads);
+}
+
+
+
+/******************************************************************************
+ * PUBLIC FUNCTIONS
+ *****************************************************************************/
+
+char const * microbench_kernel_name(
+  microbench_kernel const kernel)
+{
+  return kernel_names[kernel];
+}
+
+
+microbench_kernel microbench_find_kernel(
+  char const * const name)
+{
+  for(int k=0; k < MB_NKERNELS; ++k) {
+    if(strcmp(name, kernel_names[k]) == 0) {
+      return (microbench_kernel) k;
+    }
+  }
+  return MB_NKERNELS;
+}
+
+
+bool microbench_uses_rank(
+  microbench_kernel const kernel)
+{
+  switch(kernel) {
+  case MB_ATA:
+  case MB_SOLVE:
+  case MB_NORMALIZE:
+  case MB_REDUCE:
+    return true;
+  default:
+    return false;
+  }
+}
+
+
+bool microbench_is_sparse(
+  microbench_kernel const kernel)
+{
+  return kernel == MB_SORT || kernel == MB_FPTR || kernel == MB_CSF;
+}
+
+
+void microbench_run(
+  sptensor_t const * const tt,
+  gen_opts const * const gen,
+  microbench_config const * const configs,
+  idx_t const nconfigs,
+  idx_t const warmup,
+  idx_t const trials,
+  microbench_result * const results)
+{
+  double * const times = splatt_malloc(SS_MAX(trials, 1) * sizeof(*times));
+  sptensor_t * sparse = NULL;
+
+  printf("** KERNEL MICROBENCHMARKS **\n");
+  printf("WARMUP=%"SPLATT_PF_IDX" TRIALS=%"SPLATT_PF_IDX"\n", warmup, trials);
+
+  timer_start(&timers[TIMER_MISC]);
+  for(idx_t c=0; c < nconfigs; ++c) {
+    microbench_config config = configs[c];
+    microbench_result * const res = results + c;
+
+    sptensor_t const * input = NULL;
+    if(microbench_is_sparse(config.kernel)) {
+      input = p_get_tensor(tt, gen, config.size, &sparse);
+      if(input != NULL) {
+        config.size = input->nnz;
+      }
+    }
+
+    res->config = config;
+    res->median = res->q1 = res->q3 = 0.;
+
+    splatt_omp_set_num_threads(config.nthreads);
+    mb_inputs in;
+    if(!p_setup(&config, input, &in)) {
+      fprintf(stderr, "SPLATT ERROR: could not build the inputs of "
+          "microbenchmark '%s'.\n", kernel_names[config.kernel]);
+      p_free_inputs(&config, &in);
+      continue;
+    }
+
+    for(idx_t i=0; i < warmup + trials; ++i) {
+      p_restore(&config, &in);
+      double const seconds = p_run_kernel(&config, &in);
+      if(i >= warmup) {
+        times[i - warmup] = seconds;
+      }
+    }
+    p_free_inputs(&config, &in);
+
+    bench_summarize(times, trials, &(res->median), &(res->q1), &(res->q3));
+
+    double const rate = (res->median > 0.) ?
+        (double) config.size / res->median / 1e6 : 0.;
+    p_print_config(&config);
+    printf("  median=%0.6fs  IQR=%0.6fs  rate=%0.2fM%s/s\n", res->median,
+        res->q3 - res->q1, rate, kernel_units[config.kernel]);
+    metrics_record("microbench", "median", c, -1, -1, res->median);
+    metrics_record("microbench", "iqr", c, -1, -1, res->q3 - res->q1);
+    metrics_record("microbench", "rate", c, -1, -1, rate * 1e6);
+  }
+  timer_stop(&timers[TIMER_MISC]);
+
+  if(sparse != NULL) {
+    tt_free(sparse);
+  }
+  splatt_free(times);
+}
+
+
+int microbench_write_results(
+  char const * const fname,
+  microbench_result const * const results,
+  idx_t const nresults)
+{
+  FILE * fout = fopen(fname, "w");
+  if(fout == NULL) {
+    fprintf(stderr, "SPLATT ERROR: failed to open '%s'\n", fname);
+    return SPLATT_ERROR_BADINPUT;
+  }
+
+  fprintf(fout, "# splatt microbench\n");
+  fprintf(fout, "# kernel size rank threads median q1 q3\n");
+  for(idx_t r=0; r < nresults; ++r) {
+    microbench_config const * const config = &(results[r].config);
+    fprintf(fout, "%s %"SPLATT_PF_IDX" %"SPLATT_PF_IDX" %"SPLATT_PF_IDX
+        " %0.17e %0.17e %0.17e\n", kernel_names[config->kernel], config->size,
+        config->rank, config->nthreads, results[r].median, results[r].q1,
+        results[r].q3);
+  }
+
+  fclose(fout);
+  return SPLATT_SUCCESS;
+}
+
+
+microbench_result * microbench_read_results(
+  char const * const fname,
+  idx_t * const nresults)
+{
+  FILE * fin = fopen(fname, "r");
+  if(fin == NULL) {
+    fprintf(stderr, "SPLATT ERROR: failed to open '%s'\n", fname);
+    return NULL;
+  }
+
+  idx_t cap = 16;
+  idx_t n = 0;
+  microbench_result * results = malloc(cap * sizeof(*results));
+
+  char * line = NULL;
+  size_t len = 0;
+  idx_t lineno = 0;
+  while(getline(&line, &len, fin) != -1) {
+    ++lineno;
+    if(line[0] == '#' || line[0] == '\n') {
+      continue;
+    }
+
+    char kernel[16];
+    unsigned long long size, rank, nthreads;
+    microbench_result res;
+    if(sscanf(line, "%15s %llu %llu %llu %lf %lf %lf", kernel, &size, &rank,
+          &nthreads, &(res.median), &(res.q1), &(res.q3)) != 7 ||
+        microbench_find_kernel(kernel) == MB_NKERNELS) {
+      fprintf(stderr, "SPLATT ERROR: '%s' line %"SPLATT_PF_IDX" is not a "
+          "microbenchmark result.\n", fname, lineno);
+      free(results);
+      results = NULL;
+      break;
+    }
+    res.config.kernel = microbench_find_kernel(kernel);
+    res.config.size = (idx_t) size;
+    res.config.rank = (idx_t) rank;
+    res.config.nthreads = (idx_t) nthreads;
+
+    if(n == cap) {
+      cap *= 2;
+      results = realloc(results, cap * sizeof(*results));
+    }
+    results[n++] = res;
+  }
+
+  free(line);
+  fclose(fin);
+
+  *nresults = n;
+  return results;
+}
+
+
+idx_t microbench_compare(
+  microbench_result const * const results,
+  idx_t const nresults,
+  microbench_result const * const baseline,
+  idx_t const nbaseline,
+  double const tolerance)
+{
+  idx_t nregress = 0;
+
+  printf("Baseline comparison (tolerance %0.1f%%) ----------------------\n",
+      100. * tolerance);
+  for(idx_t r=0; r < nresults; ++r) {
+    microbench_result const * base = NULL;
+    for(idx_t b=0; b < nbaseline; ++b) {
+      if(p_same_config(&(results[r].config), &(baseline[b].config))) {
+        base = baseline + b;
+        break;
+      }
+    }
+
+    p_print_config(&(results[r].config));
+    if(base == NULL || base->median <= 0.) {
+      printf("  %0.6fs  (no baseline)\n", results[r].median);
+      continue;
+    }
+
+    double const change = (results[r].median / base->median) - 1.;
+    printf("  %0.6fs vs %0.6fs  %+6.1f%%", results[r].median, base->median,
+        100. * change);
+    if(change > tolerance) {
+      printf("  REGRESSION");
+      ++nregress;
+    }
+    printf("\n");
+    metrics_record("microbench", "change", r, -1, -1, change);
+  }
+
+  printf("%"SPLATT_PF_IDX" REGRESSIONS\n", nregress);
+  return nregress;
+}
@@ -0,0 +1,179 @@
+#ifndef SPLATT_MICROBENCH_H
+#define SPLATT_MICROBENCH_H
+
+
+/******************************************************************************
+ * INCLUDES
+ *****************************************************************************/
+#include "base.h"
+#include "sptensor.h"
+#include "generate.h"
+
+
+/******************************************************************************
+ * STRUCTURES
+ *****************************************************************************/
+
+/**
+* @brief The building blocks of CPD-ALS which can be timed in isolation.
+*/
+typedef enum
+{
+  MB_SORT,      /** tt_sort() of a shuffled coordinate tensor. */
+  MB_FPTR,      /** CSF construction of a sorted tensor: the fiber pointers
+                    of each level and the copy of the leaves. */
+  MB_CSF,       /** csf_alloc() of a shuffled tensor, including the sort. */
+  MB_ATA,       /** mat_aTa() of a SIZE x RANK factor. */
+  MB_SOLVE,     /** mat_solve_normals() with SIZE right-hand sides. */
+  MB_NORMALIZE, /** mat_normalize() of a SIZE x RANK factor. */
+  MB_REDUCE,    /** mttkrp_reduce_privatized() of SIZE x RANK outputs. */
+  MB_PARTITION, /** partition_weighted() of SIZE items among threads. */
+  MB_MUTEX,     /** SIZE lock and unlock pairs on a mutex_pool, shared among
+                    threads. */
+  MB_NKERNELS
+} microbench_kernel;
+
+
+/**
+* @brief One microbenchmark to run. SIZE is the number of nonzeros of the
+*        sparse kernels, the rows of the dense kernels, and the items or lock
+*        pairs of the others.
+*/
+typedef struct
+{
+  microbench_kernel kernel;
+  idx_t size;
+  idx_t rank;       /** 0 if the kernel does not use it. */
+  idx_t nthreads;
+} microbench_config;
+
+
+/**
+* @brief Summary of the trials of one microbenchmark.
+*/
+typedef struct
+{
+  microbench_config config;
+  double median;
+  double q1;        /** First quartile. */
+  double q3;        /** Third quartile. */
+} microbench_result;
+
+
+
+/******************************************************************************
+ * PUBLIC FUNCTIONS
+ *****************************************************************************/
+
+#define microbench_kernel_name splatt_microbench_kernel_name
+/**
+* @brief Return the name of a kernel, e.g., "sort".
+*/
+char const * microbench_kernel_name(
+  microbench_kernel const kernel);
+
+
+#define microbench_find_kernel splatt_microbench_find_kernel
+/**
+* @brief Look up a kernel by name.
+*
+* @return The kernel, or MB_NKERNELS if 'name' is not recognized.
+*/
+microbench_kernel microbench_find_kernel(
+  char const * const name);
+
+
+#define microbench_uses_rank splatt_microbench_uses_rank
+/**
+* @brief Does a kernel work on RANK columns?
+*/
+bool microbench_uses_rank(
+  microbench_kernel const kernel);
+
+
+#define microbench_is_sparse splatt_microbench_is_sparse
+/**
+* @brief Does a kernel work on a sparse tensor?
+*/
+bool microbench_is_sparse(
+  microbench_kernel const kernel);
+
+
+#define microbench_run splatt_microbench_run
+/**
+* @brief Time each microbenchmark. Each one has its inputs built untimed, is
+*        run 'warmup' untimed times, and then 'trials' timed times. Inputs
+*        which a kernel modifies are restored between runs without timing.
+*
+* @param tt The tensor for the sparse kernels, or NULL to generate one of
+*           SIZE nonzeros from 'gen'. If given, SIZE is ignored.
+* @param gen How to generate sparse tensors. 'gen->nnz' is ignored. If
+*            'gen->nmodes' is 0, tensors have three modes of length SIZE/10.
+* @param configs The microbenchmarks to run.
+* @param nconfigs The number of microbenchmarks.
+* @param warmup Untimed runs of each microbenchmark.
+* @param trials Timed runs of each microbenchmark.
+* @param[out] results The summary of each microbenchmark, in order.
+*/
+void microbench_run(
+  sptensor_t const * const tt,
+  gen_opts const * const gen,
+  microbench_config const * const configs,
+  idx_t const nconfigs,
+  idx_t const warmup,
+  idx_t const trials,
+  microbench_result * const results);
+
+
+#define microbench_write_results splatt_microbench_write_results
+/**
+* @brief Save microbenchmark results so a later run can compare against them.
+*
+* @param fname The file to write.
+* @param results The results to save.
+* @param nresults The number of results.
+*
+* @return SPLATT_SUCCESS, or SPLATT_ERROR_BADINPUT if the file cannot be
+*         written.
+*/
+int microbench_write_results(
+  char const * const fname,
+  microbench_result const * const results,
+  idx_t const nresults);
+
+
+#define microbench_read_results splatt_microbench_read_results
+/**
+* @brief Read results written by microbench_write_results().
+*
+* @param fname The file to read.
+* @param[out] nresults The number of results read.
+*
+* @return The results (free with free()), or NULL on error.
+*/
+microbench_result * microbench_read_results(
+  char const * const fname,
+  idx_t * const nresults);
+
+
+#define microbench_compare splatt_microbench_compare
+/**
+* @brief Print each result next to the baseline of the same microbenchmark
+*        and flag those whose median is more than 'tolerance' slower.
+*
+* @param results The new results.
+* @param nresults The number of new results.
+* @param baseline The baseline results.
+* @param nbaseline The number of baseline results.
+* @param tolerance The allowed relative slowdown, e.g., 0.05 for 5%.
+*
+* @return The number of regressions.
+*/
+idx_t microbench_compare(
+  microbench_result const * const results,
+  idx_t const nresults,
+  microbench_result const * const baseline,
+  idx_t const nbaseline,
+  double const tolerance);
+
+#endif
@@ -0,0 +1,295 @@
+
+
+/******************************************************************************
+ * INCLUDES
+ *****************************************************************************/
+#include "model.h"
+#include "mttkrp.h"
+#include "mutex_pool.h"
+#include "tile.h"
+
+
+/******************************************************************************
+ * PRIVATE FUNCTIONS
+ *****************************************************************************/
+
+/**
+* @brief Count the nonzeros below the slices [start, end) of a CSF tree.
+*/
+static idx_t p_slices_nnz(
+  csf_sparsity const * const pt,
+  idx_t const nmodes,
+  idx_t start,
+  idx_t end)
+{
+  for(idx_t d=0; d < nmodes-1; ++d) {
+    start = pt->fptr[d][start];
+    end = pt->fptr[d][end];
+  }
+  return end - start;
+}
+
+
+/**
+* @brief Compute the load imbalance of one mode: the nonzeros processed by the
+*        heaviest thread over the mean. This follows the scheduling of
+*        p_schedule_tiles() in mttkrp.c.
+*
+* @param csf The CSF tensor which computes the mode.
+* @param mode The output mode.
+* @param nthreads The number of threads.
+*
+* @return The imbalance, at least 1.
+*/
+static double p_imbalance(
+  splatt_csf const * const csf,
+  idx_t const mode,
+  idx_t const nthreads)
+{
+  idx_t const nmodes = csf->nmodes;
+  double const mean = (double) csf->nnz / (double) nthreads;
+  if(csf->nnz == 0) {
+    return 1.;
+  }
+
+  idx_t heaviest = 0;
+  if(csf->ntiles > 1 && csf->tile_dims[mode] > 1) {
+    /* layers of tiles are scheduled dynamically, so the heaviest thread is
+     * bounded below by the heaviest layer */
+    for(idx_t t=0; t < csf->tile_dims[mode]; ++t) {
+      idx_t layer = 0;
+      idx_t tile_id =
+          get_next_tileid(TILE_BEGIN, csf->tile_dims, nmodes, mode, t);
+      while(tile_id != TILE_END) {
+        layer += csf->pt[tile_id].nfibs[nmodes-1];
+        tile_id = get_next_tileid(tile_id, csf->tile_dims, nmodes, mode, t);
+      }
+      heaviest = SS_MAX(heaviest, layer);
+    }
+
+  } else if(csf->ntiles > 1) {
+    idx_t * parts = csf_partition_tiles_1d(csf, nthreads);
+    for(idx_t t=0; t < nthreads; ++t) {
+      idx_t nnz = 0;
+      for(idx_t tile_id=parts[t]; tile_id < parts[t+1]; ++tile_id) {
+        nnz += csf->pt[tile_id].nfibs[nmodes-1];
+      }
+      heaviest = SS_MAX(heaviest, nnz);
+    }
+    splatt_free(parts);
+
+  } else {
+    idx_t * parts = csf_partition_1d(csf, 0, nthreads);
+    for(idx_t t=0; t < nthreads; ++t) {
+      idx_t const nnz = p_slices_nnz(csf->pt, nmodes, parts[t], parts[t+1]);
+      heaviest = SS_MAX(heaviest, nnz);
+    }
+    splatt_free(parts);
+  }
+
+  return SS_MAX((double) heaviest / mean, 1.);
+}
+
+
+/**
+* @brief Model the kernel of one mode: flops and memory traffic. Rows which
+*        are found in cache are charged once per distinct index instead of
+*        once per node.
+*/
+static void p_model_kernel(
+  splatt_csf const * const csf,
+  idx_t const depth,
+  idx_t const nfactors,
+  idx_t const nthreads,
+  model_machine const * const machine,
+  model_mode * const model)
+{
+  idx_t const nmodes = csf->nmodes;
+
+  idx_t nfibs[MAX_NMODES];
+  for(idx_t l=0; l < nmodes; ++l) {
+    nfibs[l] = 0;
+    for(idx_t t=0; t < csf->ntiles; ++t) {
+      nfibs[l] += csf->pt[t].nfibs[l];
+    }
+  }
+
+  model->cost.flops = 0.;
+  model->cost.bytes = 0.;
+  model_tree(nfibs, nmodes, depth, nfactors, &(model->cost));
+
+  /* the factors compete for the cache, and rows are accessed at random, so
+   * a repeated row hits with the fraction of the factors which fit */
+  double const rowbytes = (double) nfactors * sizeof(val_t);
+  double footprint = 0.;
+  for(idx_t l=0; l < nmodes; ++l) {
+    double const dim = (double) csf->dims[csf_depth_to_mode(csf, l)];
+    if(l == depth && model->sync == MODEL_SYNC_PRIVATIZED) {
+      footprint += dim * rowbytes * (double) nthreads;
+    } else {
+      footprint += dim * rowbytes;
+    }
+  }
+  double const cache = machine->cache_mb * 1024. * 1024.;
+  double const hit = (footprint > 0.) ? SS_MIN(cache / footprint, 1.) : 0.;
+
+  for(idx_t l=0; l < nmodes; ++l) {
+    double const dim = (double) csf->dims[csf_depth_to_mode(csf, l)];
+    if((double) nfibs[l] <= dim) {
+      continue;
+    }
+
+    double const reused = hit * ((double) nfibs[l] - dim) * rowbytes;
+    model->cost.bytes -= (l == depth) ? 2. * reused : reused;
+  }
+}
+
+
+
+/******************************************************************************
+ * PUBLIC FUNCTIONS
+ *****************************************************************************/
+
+void model_default_machine(
+  model_machine * const machine)
+{
+  machine->bandwidth = 40.;
+  machine->thread_bw = 10.;
+  machine->gflops = 8.;
+  machine->lock_ns = 25.;
+  machine->cache_mb = 1.;
+}
+
+
+void model_tree(
+  idx_t const * const nfibs,
+  idx_t const nlevels,
+  idx_t const outdepth,
+  idx_t const nfactors,
+  model_cost * const cost)
+{
+  double const F = (double) nfactors;
+
+  for(idx_t l=0; l < nlevels; ++l) {
+    double const nodes = (double) nfibs[l];
+
+    /* tree structure: ids below the root, pointers above the leaves */
+    if(l > 0) {
+      cost->bytes += nodes * sizeof(idx_t);
+    }
+    if(l < nlevels - 1) {
+      cost->bytes += (nodes + 1) * sizeof(idx_t);
+    }
+
+    if(l == outdepth) {
+      cost->bytes += 2. * nodes * F * sizeof(val_t);
+      cost->flops += nodes * F;
+    } else {
+      cost->bytes += nodes * F * sizeof(val_t);
+      cost->flops += (l > 0 ? 2. : 1.) * nodes * F;
+    }
+  }
+
+  /* nonzero values */
+  cost->bytes += (double) nfibs[nlevels-1] * sizeof(val_t);
+}
+
+
+void model_mttkrp(
+  splatt_csf const * const tensors,
+  idx_t const nfactors,
+  double const * const opts,
+  model_machine const * const machine,
+  model_mode * const modes)
+{
+  idx_t const nmodes = tensors->nmodes;
+#ifdef _OPENMP
+  idx_t const nthreads = (idx_t) opts[SPLATT_OPTION_NTHREADS];
+#else
+  idx_t const nthreads = 1;
+#endif
+
+  double const rowbytes = (double) nfactors * sizeof(val_t);
+  double const bw = SS_MIN(machine->bandwidth,
+      (double) nthreads * machine->thread_bw) * 1e9;
+
+  for(idx_t m=0; m < nmodes; ++m) {
+    model_mode * const model = modes + m;
+
+    /* same mapping as splatt_mttkrp_alloc_ws() */
+    model->csf_id = 0;
+    switch((splatt_csf_type) opts[SPLATT_OPTION_CSF_ALLOC]) {
+    case SPLATT_CSF_ONEMODE:
+      model->csf_id = 0;
+      break;
+    case SPLATT_CSF_TWOMODE:
+      if(csf_mode_to_depth(&(tensors[0]), m) == nmodes-1) {
+        model->csf_id = 1;
+      }
+      break;
+    case SPLATT_CSF_ALLMODE:
+      model->csf_id = m;
+      break;
+    }
+
+    splatt_csf const * const csf = tensors + model->csf_id;
+    model->depth = csf_mode_to_depth(csf, m);
+
+    double const dim = (double) csf->dims[m];
+    model->nlocks = 0.;
+    model->sync_bytes = 0.;
+    if(mttkrp_is_privatized(tensors, m, opts)) {
+      model->sync = MODEL_SYNC_PRIVATIZED;
+      /* each thread clears its buffer; the reduction reads every buffer and
+       * read-modify-writes the output */
+      model->sync_bytes = ((2. * nthreads) + 2.) * dim * rowbytes;
+    } else if(csf->ntiles > 1 && csf->tile_dims[m] > 1) {
+      model->sync = MODEL_SYNC_NONE;
+    } else {
+      model->sync = MODEL_SYNC_LOCKED;
+      for(idx_t t=0; t < csf->ntiles; ++t) {
+        model->nlocks += (double) csf->pt[t].nfibs[model->depth];
+      }
+    }
+
+    p_model_kernel(csf, model->depth, nfactors, nthreads, machine, model);
+    model->imbalance = p_imbalance(csf, m, nthreads);
+
+    /* the heaviest thread does 'share' of the work */
+    double const share = model->imbalance / (double) nthreads;
+    model->compute_sec = model->cost.flops * share / (machine->gflops * 1e9);
+    model->memory_sec = model->cost.bytes * model->imbalance / bw;
+
+    /* mttkrp_csf() clears the output with a single thread */
+    model->memory_sec += dim * rowbytes / (machine->thread_bw * 1e9);
+
+    model->sync_sec = 0.;
+    if(model->sync == MODEL_SYNC_LOCKED) {
+      /* chance that another thread holds the same lock */
+      double const nlocks = SS_MIN(dim, (double) SPLATT_DEFAULT_NLOCKS);
+      double const contention = (double) (nthreads - 1) / nlocks;
+      model->sync_sec = model->nlocks * share * machine->lock_ns * 1e-9 *
+          (1. + contention);
+    } else if(model->sync == MODEL_SYNC_PRIVATIZED) {
+      model->sync_sec = model->sync_bytes / bw;
+    }
+
+    model->seconds = SS_MAX(model->compute_sec, model->memory_sec) +
+        model->sync_sec;
+  }
+}
+
+
+char const * model_sync_name(
+  model_sync const sync)
+{
+  switch(sync) {
+  case MODEL_SYNC_NONE:
+    return "tiled";
+  case MODEL_SYNC_LOCKED:
+    return "locked";
+  case MODEL_SYNC_PRIVATIZED:
+    return "privatized";
+  }
+  return "unknown";
+}
@@ -0,0 +1,144 @@
+#ifndef SPLATT_MODEL_H
+#define SPLATT_MODEL_H
+
+
+/******************************************************************************
+ * INCLUDES
+ *****************************************************************************/
+#include "base.h"
+#include "csf.h"
+
+
+/******************************************************************************
+ * STRUCTURES
+ *****************************************************************************/
+
+/**
+* @brief Analytic cost of one MTTKRP. 'bytes' is the traffic of the kernel's
+*        access stream, assuming no reuse of factor rows between nodes.
+*/
+typedef struct
+{
+  double flops;
+  double bytes;
+} model_cost;
+
+
+/**
+* @brief The machine parameters which a predicted MTTKRP time depends on.
+*/
+typedef struct
+{
+  double bandwidth;   /** Sustained memory bandwidth of all threads, GB/s. */
+  double thread_bw;   /** Memory bandwidth one thread can sustain, GB/s. */
+  double gflops;      /** Floating-point rate of one thread, GFLOP/s. */
+  double lock_ns;     /** Cost of one uncontended lock and unlock, ns. */
+  double cache_mb;    /** Cache of one thread, MB. Factor rows are accessed
+                          at random, so reuse is found in the private cache
+                          (L2) rather than the shared last level. */
+} model_machine;
+
+
+/**
+* @brief How threads avoid races on the output of one MTTKRP mode.
+*/
+typedef enum
+{
+  MODEL_SYNC_NONE,        /** Tiles along the output mode are disjoint. */
+  MODEL_SYNC_LOCKED,      /** Each output row update takes a lock. */
+  MODEL_SYNC_PRIVATIZED   /** Thread-local outputs, then a reduction. */
+} model_sync;
+
+
+/**
+* @brief The predicted cost of MTTKRP for one mode.
+*/
+typedef struct
+{
+  idx_t csf_id;         /** The CSF tensor which computes this mode. */
+  idx_t depth;          /** The depth of the mode in that tensor. */
+  model_sync sync;
+  model_cost cost;      /** Work and memory traffic of the kernel, after
+                            factor reuse in cache. */
+  double nlocks;        /** Lock acquisitions, if 'sync' is LOCKED. */
+  double sync_bytes;    /** Traffic of clearing and reducing the thread-local
+                            outputs, if 'sync' is PRIVATIZED. */
+  double imbalance;     /** Nonzeros of the heaviest thread over the mean. */
+
+  double compute_sec;   /** Time of the heaviest thread's floating-point. */
+  double memory_sec;    /** Time of the heaviest thread's memory traffic. */
+  double sync_sec;      /** Time spent on locks or the reduction. */
+  double seconds;       /** Predicted time of the mode. */
+} model_mode;
+
+
+
+/******************************************************************************
+ * PUBLIC FUNCTIONS
+ *****************************************************************************/
+
+#define model_default_machine splatt_model_default_machine
+/**
+* @brief Fill 'machine' with the parameters of a typical multi-core node.
+*
+* @param machine The parameters to initialize.
+*/
+void model_default_machine(
+  model_machine * const machine);
+
+
+#define model_tree splatt_model_tree
+/**
+* @brief Model an MTTKRP over a compressed tree (CSF or the 3-level SPLATT
+*        format). Each non-root node reads its index and one factor row and
+*        scales-and-accumulates it into its parent. Nodes at the output depth
+*        instead read-modify-write a row of the output.
+*
+* @param nfibs The number of nodes at each level.
+* @param nlevels The number of levels.
+* @param outdepth The level of the output mode.
+* @param nfactors The rank of the decomposition.
+* @param cost The cost to add to.
+*/
+void model_tree(
+  idx_t const * const nfibs,
+  idx_t const nlevels,
+  idx_t const outdepth,
+  idx_t const nfactors,
+  model_cost * const cost);
+
+
+#define model_mttkrp splatt_model_mttkrp
+/**
+* @brief Predict the cost of mttkrp_csf() for every mode without running it.
+*        The configuration is read from 'opts' exactly as
+*        splatt_mttkrp_alloc_ws() does: CSF allocation, tiling, threads, and
+*        privatization threshold. Threads are balanced with the same
+*        csf_partition_1d() and csf_partition_tiles_1d() partitionings that
+*        the kernels use.
+*
+*        The time of each mode is that of its heaviest thread, which is the
+*        larger of its floating-point and memory time, plus synchronization.
+*
+* @param tensors The CSF tensor(s), allocated with 'opts'.
+* @param nfactors The rank of the decomposition.
+* @param opts SPLATT options.
+* @param machine The machine to model.
+* @param[out] modes The prediction for each mode, of length nmodes.
+*/
+void model_mttkrp(
+  splatt_csf const * const tensors,
+  idx_t const nfactors,
+  double const * const opts,
+  model_machine const * const machine,
+  model_mode * const modes);
+
+
+#define model_sync_name splatt_model_sync_name
+/**
+* @brief Return a short name for a synchronization type, e.g., "locked".
+*/
+char const * model_sync_name(
+  model_sync const sync);
+
+#endif
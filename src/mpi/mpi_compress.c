@@ -0,0 +1,852 @@
+
+/******************************************************************************
+ * INCLUDES
+ *****************************************************************************/
+#include "../splatt_mpi.h"
+#include "../timer.h"
+
+#include <math.h>
+
+
+/******************************************************************************
+ * PRIVATE DEFINES
+ *****************************************************************************/
+
+/*
+ * A message is a sequence of fixed-size records, one per row:
+ *
+ *   [ slot (uint32) | version (uint32) | F words ]   (updates with a threshold)
+ *   [ F words ]                                      (everything else)
+ *
+ * 'slot' is the row's offset within the sender's block for the receiver, so
+ * the receiver finds it at local2nbr_disp + slot. Untagged messages contain
+ * every row of the block, in order.
+ */
+#define COMPRESS_TAG_BYTES (2 * sizeof(uint32_t))
+
+
+/******************************************************************************
+ * PRIVATE FUNCTIONS
+ *****************************************************************************/
+
+/**
+* @brief Return the number of bytes used to send one value.
+*
+* @param precision The precision of the messages.
+*
+* @return The size of a word on the wire.
+*/
+static inline size_t p_word_size(
+  splatt_precision_type const precision)
+{
+  switch(precision) {
+  case SPLATT_PRECISION_FP32:
+    return sizeof(float);
+  case SPLATT_PRECISION_BF16:
+    return sizeof(uint16_t);
+  default:
+    return sizeof(val_t);
+  }
+}
+
+
+/**
+* @brief Return the number of bytes in one record.
+*
+* @param cmp The compression state.
+* @param tagged Whether records carry a slot and version.
+*
+* @return The record size.
+*/
+static inline size_t p_record_size(
+  mpi_compress const * const cmp,
+  bool const tagged)
+{
+  return (tagged ? COMPRESS_TAG_BYTES : 0) +
+      (cmp->nfactors * p_word_size(cmp->precision));
+}
+
+
+/**
+* @brief Encode one value into 'out'. bfloat16 keeps the upper half of an IEEE
+*        single, rounded to nearest even.
+*
+* @param val The value to encode.
+* @param precision The precision of the messages.
+* @param out The location of the encoded word.
+*/
+static inline void p_encode_word(
+  val_t const val,
+  splatt_precision_type const precision,
+  char * const out)
+{
+  float const single = (float) val;
+  uint32_t bits;
+  uint16_t half;
+
+  switch(precision) {
+  case SPLATT_PRECISION_FP32:
+    memcpy(out, &single, sizeof(single));
+    break;
+  case SPLATT_PRECISION_BF16:
+    memcpy(&bits, &single, sizeof(bits));
+    if(!isnan(single)) {
+      bits += 0x7fff + ((bits >> 16) & 1);
+    }
+    half = (uint16_t) (bits >> 16);
+    memcpy(out, &half, sizeof(half));
+    break;
+  default:
+    memcpy(out, &val, sizeof(val));
+    break;
+  }
+}
+
+
+/**
+* @brief Decode one value which was written by p_encode_word().
+*
+* @param in The location of the encoded word.
+* @param precision The precision of the messages.
+*
+* @return The decoded value.
+*/
+static inline val_t p_decode_word(
+  char const * const in,
+  splatt_precision_type const precision)
+{
+  float single;
+  uint32_t bits;
+  uint16_t half;
+  val_t val;
+
+  switch(precision) {
+  case SPLATT_PRECISION_FP32:
+    memcpy(&single, in, sizeof(single));
+    return (val_t) single;
+  case SPLATT_PRECISION_BF16:
+    memcpy(&half, in, sizeof(half));
+    bits = ((uint32_t) half) << 16;
+    memcpy(&single, &bits, sizeof(single));
+    return (val_t) single;
+  default:
+    memcpy(&val, in, sizeof(val));
+    return val;
+  }
+}
+
+
+/**
+* @brief Round a value to what the receiver of p_encode_word() decodes.
+*
+* @param val The value to round.
+* @param precision The precision of the messages.
+*
+* @return The rounded value.
+*/
+static inline val_t p_round_word(
+  val_t const val,
+  splatt_precision_type const precision)
+{
+  char word[sizeof(val_t)];
+  p_encode_word(val, precision, word);
+  return p_decode_word(word, precision);
+}
+
+
+/**
+* @brief Allocate zeroed memory with splatt_malloc().
+*
+* @param bytes The number of bytes.
+*
+* @return The zeroed allocation.
+*/
+static void * p_zalloc(
+  size_t const bytes)
+{
+  void * ptr = splatt_malloc(bytes);
+  memset(ptr, 0, bytes);
+  return ptr;
+}
+
+
+/**
+* @brief Determine whether a row changed enough to be resent. The change is
+*        measured relative to the largest magnitude in the row.
+*
+* @param row The current row.
+* @param last The row as the receiver last saw it.
+* @param nfactors The length of the rows.
+* @param threshold The relative change which triggers a resend.
+*
+* @return Whether the row must be sent.
+*/
+static inline bool p_row_changed(
+  val_t const * const restrict row,
+  val_t const * const restrict last,
+  idx_t const nfactors,
+  double const threshold)
+{
+  val_t maxdiff = 0;
+  val_t maxval = 0;
+  for(idx_t f=0; f < nfactors; ++f) {
+    maxdiff = SS_MAX(maxdiff, fabs(row[f] - last[f]));
+    maxval = SS_MAX(maxval, fabs(row[f]));
+  }
+  return maxdiff > threshold * maxval;
+}
+
+
+/**
+* @brief Reset the send and receive requests of a layer to MPI_REQUEST_NULL.
+*
+* @param rinfo MPI rank information.
+* @param m The mode of the layer.
+*/
+static void p_null_requests(
+  rank_info * const rinfo,
+  idx_t const m)
+{
+  for(int p=0; p < rinfo->layer_size[m]; ++p) {
+    rinfo->send_reqs[p] = MPI_REQUEST_NULL;
+    rinfo->recv_reqs[p] = MPI_REQUEST_NULL;
+  }
+}
+
+
+/**
+* @brief Restrict the byte counts and displacements of a layer to the
+*        neighbors of rinfo->nbr_comm[m], in the same order as
+*        mpi_nbr_plan_init() lists them.
+*
+* @param rinfo MPI rank information.
+* @param m The mode of the layer.
+*/
+static void p_fill_nbr_counts(
+  rank_info const * const rinfo,
+  idx_t const m)
+{
+  mpi_compress * const cmp = rinfo->compress;
+  int nnbrs = 0;
+  for(int p=0; p < rinfo->layer_size[m]; ++p) {
+    if(rinfo->local2nbr_ptr[m][p] > 0 || rinfo->nbr2globs_ptr[m][p] > 0) {
+      cmp->nbr_peers[nnbrs] = p;
+      cmp->nbr_send_bytes[nnbrs] = cmp->msg_bytes[p];
+      cmp->nbr_send_displs[nnbrs] = cmp->send_displs[p];
+      cmp->nbr_recv_bytes[nnbrs] = cmp->recv_bytes[p];
+      cmp->nbr_recv_displs[nnbrs] = cmp->recv_displs[p];
+      ++nnbrs;
+    }
+  }
+  assert(nnbrs == rinfo->nnbrs[m]);
+}
+
+
+/**
+* @brief Start exchanging the packed blocks of a layer with the pattern given
+*        by SPLATT_OPTION_COMM. cmp->msg_bytes holds the length of each
+*        outgoing block. When blocks may be shorter than their slots, the
+*        collective patterns first exchange the lengths.
+*
+* @param send_ptr The number of slots for each peer I send to (scaled by
+*                 nfactors, like rank_info's ptr arrays).
+* @param send_disp The offset of each outgoing block (also scaled).
+* @param recv_ptr The number of slots for each peer I receive from (scaled).
+* @param recv_disp The offset of each incoming block (also scaled).
+* @param record The size of a record.
+* @param varying Whether blocks may be shorter than their slots.
+* @param rinfo MPI rank information.
+* @param m The mode of the layer.
+*/
+static void p_exchange_begin(
+  int const * const send_ptr,
+  int const * const send_disp,
+  int const * const recv_ptr,
+  int const * const recv_disp,
+  size_t const record,
+  bool const varying,
+  rank_info * const rinfo,
+  idx_t const m)
+{
+  mpi_compress * const cmp = rinfo->compress;
+  idx_t const nfactors = cmp->nfactors;
+  int const lrank = rinfo->layer_rank[m];
+  int const lsize = rinfo->layer_size[m];
+
+  for(int p=0; p < lsize; ++p) {
+    cmp->send_displs[p] = (send_disp[p] / nfactors) * record;
+    cmp->recv_displs[p] = (recv_disp[p] / nfactors) * record;
+    cmp->recv_bytes[p] = (recv_ptr[p] / nfactors) * record;
+    if(send_ptr[p] == 0) {
+      cmp->msg_bytes[p] = 0;
+    }
+    rinfo->wire_bytes += cmp->msg_bytes[p];
+  }
+
+  timer_start(&timers[TIMER_MPI_COMM]);
+  switch(cmp->comm) {
+  case SPLATT_COMM_POINT2POINT:
+    p_null_requests(rinfo, m);
+    for(int p=1; p < lsize; ++p) {
+      int const porig = (p + lrank) % lsize;
+      if(cmp->recv_bytes[porig] > 0) {
+        MPI_Irecv(cmp->recvbuf + cmp->recv_displs[porig],
+            cmp->recv_bytes[porig], MPI_BYTE, porig, 0, rinfo->layer_comm[m],
+            rinfo->recv_reqs + porig);
+      }
+    }
+    for(int p=1; p < lsize; ++p) {
+      int const pdest = (p + lrank) % lsize;
+      if(send_ptr[pdest] > 0) {
+        MPI_Isend(cmp->sendbuf + cmp->send_displs[pdest],
+            cmp->msg_bytes[pdest], MPI_BYTE, pdest, 0, rinfo->layer_comm[m],
+            rinfo->send_reqs + pdest);
+      }
+    }
+    break;
+
+  case SPLATT_COMM_ALL2ALL:
+    if(varying) {
+      MPI_Alltoall(cmp->msg_bytes, 1, MPI_INT, cmp->recv_bytes, 1, MPI_INT,
+          rinfo->layer_comm[m]);
+    }
+    MPI_Ialltoallv(cmp->sendbuf, cmp->msg_bytes, cmp->send_displs, MPI_BYTE,
+        cmp->recvbuf, cmp->recv_bytes, cmp->recv_displs, MPI_BYTE,
+        rinfo->layer_comm[m], &(cmp->req));
+    break;
+
+  case SPLATT_COMM_NEIGHBOR:
+    assert(rinfo->nbr_comm[m] != MPI_COMM_NULL);
+    p_fill_nbr_counts(rinfo, m);
+    if(varying) {
+      MPI_Neighbor_alltoall(cmp->nbr_send_bytes, 1, MPI_INT,
+          cmp->nbr_recv_bytes, 1, MPI_INT, rinfo->nbr_comm[m]);
+    }
+    MPI_Ineighbor_alltoallv(
+        cmp->sendbuf, cmp->nbr_send_bytes, cmp->nbr_send_displs, MPI_BYTE,
+        cmp->recvbuf, cmp->nbr_recv_bytes, cmp->nbr_recv_displs, MPI_BYTE,
+        rinfo->nbr_comm[m], &(cmp->req));
+    break;
+  }
+  timer_stop(&timers[TIMER_MPI_COMM]);
+}
+
+
+/**
+* @brief Complete an exchange started by p_exchange_begin(). Afterwards
+*        cmp->recv_bytes holds the length of each incoming block.
+*
+* @param rinfo MPI rank information.
+* @param m The mode of the layer.
+*/
+static void p_exchange_finish(
+  rank_info * const rinfo,
+  idx_t const m)
+{
+  mpi_compress * const cmp = rinfo->compress;
+  int const lsize = rinfo->layer_size[m];
+
+  timer_start(&timers[TIMER_MPI_IDLE]);
+  switch(cmp->comm) {
+  case SPLATT_COMM_POINT2POINT:
+    MPI_Waitall(lsize, rinfo->recv_reqs, rinfo->stats);
+    for(int p=0; p < lsize; ++p) {
+      if(cmp->recv_bytes[p] > 0) {
+        MPI_Get_count(&(rinfo->stats[p]), MPI_BYTE, &(cmp->recv_bytes[p]));
+      }
+    }
+    /* the send buffer may be reused after this */
+    MPI_Waitall(lsize, rinfo->send_reqs, MPI_STATUSES_IGNORE);
+    break;
+
+  case SPLATT_COMM_ALL2ALL:
+    MPI_Wait(&(cmp->req), MPI_STATUS_IGNORE);
+    break;
+
+  case SPLATT_COMM_NEIGHBOR:
+    MPI_Wait(&(cmp->req), MPI_STATUS_IGNORE);
+    for(int n=0; n < rinfo->nnbrs[m]; ++n) {
+      cmp->recv_bytes[cmp->nbr_peers[n]] = cmp->nbr_recv_bytes[n];
+    }
+    break;
+  }
+  timer_stop(&timers[TIMER_MPI_IDLE]);
+}
+
+
+/**
+* @brief Pack the rows destined to one peer. With a threshold, only rows with
+*        a version which this peer has not received are packed. Rows must
+*        already be prepared with mpi_compress_prepare().
+*
+* @param globalmat Global factor matrix (owned by me).
+* @param rinfo MPI rank information.
+* @param m The mode to exchange along.
+* @param pdest The receiving layer rank.
+*
+* @return The number of bytes packed.
+*/
+static int p_pack_update(
+  matrix_t const * const globalmat,
+  rank_info const * const rinfo,
+  idx_t const m,
+  int const pdest)
+{
+  mpi_compress * const cmp = rinfo->compress;
+  idx_t const nfactors = cmp->nfactors;
+  splatt_precision_type const prec = cmp->precision;
+  size_t const wsize = p_word_size(prec);
+  bool const tagged = cmp->threshold > 0;
+  size_t const record = p_record_size(cmp, tagged);
+
+  idx_t const mat_start = rinfo->mat_start[m];
+  idx_t const * const nbr2globs_inds = rinfo->nbr2globs_inds[m];
+  int const nsends = rinfo->nbr2globs_ptr[m][pdest] / nfactors;
+  int const disp = rinfo->nbr2globs_disp[m][pdest] / nfactors;
+
+  char * out = cmp->sendbuf + (disp * record);
+  for(int s=disp; s < disp + nsends; ++s) {
+    idx_t const row = nbr2globs_inds[s] - mat_start;
+    val_t const * const vals = globalmat->vals + (row * nfactors);
+
+    char * words = out;
+    if(tagged) {
+      uint32_t const version = cmp->version[m][cmp->slot_shared[m][s]];
+      if(cmp->sent_version[m][s] == version) {
+        continue;
+      }
+      cmp->sent_version[m][s] = version;
+      uint32_t const tag[2] = { (uint32_t) (s - disp), version };
+      memcpy(out, tag, COMPRESS_TAG_BYTES);
+      words += COMPRESS_TAG_BYTES;
+    }
+    for(idx_t f=0; f < nfactors; ++f) {
+      p_encode_word(vals[f], prec, words + (f * wsize));
+    }
+    out += record;
+  }
+
+  return (int) (out - (cmp->sendbuf + (disp * record)));
+}
+
+
+/**
+* @brief Unpack the rows received from one peer. Untagged rows are written
+*        straight to localmat. Tagged rows update the receiver's copy, unless
+*        they are older than what it already holds.
+*
+* @param localmat Local factor matrix which receives updated values.
+* @param rinfo MPI rank information.
+* @param m The mode to exchange along.
+* @param porig The sending layer rank.
+* @param nbytes The length of the message.
+*/
+static void p_unpack_update(
+  matrix_t * const localmat,
+  rank_info const * const rinfo,
+  idx_t const m,
+  int const porig,
+  int const nbytes)
+{
+  mpi_compress * const cmp = rinfo->compress;
+  idx_t const nfactors = cmp->nfactors;
+  splatt_precision_type const prec = cmp->precision;
+  size_t const wsize = p_word_size(prec);
+  bool const tagged = cmp->threshold > 0;
+  size_t const record = p_record_size(cmp, tagged);
+
+  idx_t const * const local2nbr_inds = rinfo->local2nbr_inds[m];
+  int const disp = rinfo->local2nbr_disp[m][porig] / nfactors;
+  char const * const in = cmp->recvbuf + (disp * record);
+  int const nrecs = nbytes / record;
+
+  #pragma omp parallel for schedule(static)
+  for(int r=0; r < nrecs; ++r) {
+    char const * words = in + (r * record);
+    val_t * vals;
+    if(tagged) {
+      uint32_t tag[2];
+      memcpy(tag, words, COMPRESS_TAG_BYTES);
+      words += COMPRESS_TAG_BYTES;
+
+      idx_t const slot = disp + tag[0];
+      if(tag[1] <= cmp->recvd_version[m][slot]) {
+        continue;
+      }
+      cmp->recvd_version[m][slot] = tag[1];
+      vals = cmp->recvd[m] + (slot * nfactors);
+    } else {
+      vals = localmat->vals + (local2nbr_inds[disp + r] * nfactors);
+    }
+
+    for(idx_t f=0; f < nfactors; ++f) {
+      vals[f] = p_decode_word(words + (f * wsize), prec);
+    }
+  }
+}
+
+
+/**
+* @brief Pack my partial products of all rows owned by neighbors.
+*
+* @param localmat My local matrix containing partial products.
+* @param rinfo MPI rank information.
+* @param m The mode to operate on.
+*/
+static void p_pack_reduce(
+  matrix_t const * const localmat,
+  rank_info const * const rinfo,
+  idx_t const m)
+{
+  mpi_compress * const cmp = rinfo->compress;
+  idx_t const nfactors = cmp->nfactors;
+  splatt_precision_type const prec = cmp->precision;
+  size_t const wsize = p_word_size(prec);
+  size_t const record = p_record_size(cmp, false);
+
+  idx_t const * const local2nbr_inds = rinfo->local2nbr_inds[m];
+
+  #pragma omp parallel for schedule(static)
+  for(idx_t s=0; s < rinfo->nlocal2nbr[m]; ++s) {
+    val_t const * const vals = localmat->vals + (local2nbr_inds[s] * nfactors);
+    char * const words = cmp->sendbuf + (s * record);
+    for(idx_t f=0; f < nfactors; ++f) {
+      p_encode_word(vals[f], prec, words + (f * wsize));
+    }
+  }
+
+  for(int p=0; p < rinfo->layer_size[m]; ++p) {
+    cmp->msg_bytes[p] = (rinfo->local2nbr_ptr[m][p] / nfactors) * record;
+  }
+}
+
+
+/**
+* @brief Add the partial products received from one peer to globalmat. The
+*        lost low-order bits of each sum are kept in cmp->comp and subtracted
+*        from the next partial product of the same value.
+*
+* @param globalmat The global factor matrix to update.
+* @param rinfo MPI rank information.
+* @param m The mode to operate on.
+* @param porig The sending layer rank.
+*/
+static void p_unpack_reduce(
+  matrix_t * const globalmat,
+  rank_info const * const rinfo,
+  idx_t const m,
+  int const porig)
+{
+  mpi_compress * const cmp = rinfo->compress;
+  idx_t const nfactors = cmp->nfactors;
+  splatt_precision_type const prec = cmp->precision;
+  size_t const wsize = p_word_size(prec);
+  size_t const record = p_record_size(cmp, false);
+
+  idx_t const mat_start = rinfo->mat_start[m];
+  idx_t const * const nbr2globs_inds = rinfo->nbr2globs_inds[m];
+  int const nrecvs = rinfo->nbr2globs_ptr[m][porig] / nfactors;
+  int const disp = rinfo->nbr2globs_disp[m][porig] / nfactors;
+
+  /* rows are unique within one peer's block */
+  #pragma omp parallel for schedule(static)
+  for(int r=disp; r < disp + nrecvs; ++r) {
+    idx_t const row = nbr2globs_inds[r] - mat_start;
+    val_t * const vals = globalmat->vals + (row * nfactors);
+    val_t * const comp = cmp->comp + (row * nfactors);
+    char const * const words = cmp->recvbuf + (r * record);
+    for(idx_t f=0; f < nfactors; ++f) {
+      val_t const y = p_decode_word(words + (f * wsize), prec) - comp[f];
+      val_t const t = vals[f] + y;
+      comp[f] = (t - vals[f]) - y;
+      vals[f] = t;
+    }
+  }
+}
+
+
+/**
+* @brief Find the owned rows which any neighbor receives, and the position of
+*        each send slot's row among them.
+*
+* @param cmp The compression state to fill.
+* @param rinfo MPI rank information.
+* @param m The mode to process.
+*/
+static void p_find_shared(
+  mpi_compress * const cmp,
+  rank_info const * const rinfo,
+  idx_t const m)
+{
+  idx_t const nsend = rinfo->nnbr2globs[m];
+  idx_t const nowned = rinfo->mat_end[m] - rinfo->mat_start[m];
+  idx_t const mat_start = rinfo->mat_start[m];
+  idx_t const * const nbr2globs_inds = rinfo->nbr2globs_inds[m];
+
+  /* mark, then number the marked rows in order */
+  idx_t * pos = splatt_malloc((nowned + 1) * sizeof(*pos));
+  for(idx_t i=0; i < nowned; ++i) {
+    pos[i] = 0;
+  }
+  for(idx_t s=0; s < nsend; ++s) {
+    pos[nbr2globs_inds[s] - mat_start] = 1;
+  }
+  idx_t nshared = 0;
+  for(idx_t i=0; i < nowned; ++i) {
+    nshared += pos[i];
+  }
+
+  idx_t * shared = splatt_malloc((nshared + 1) * sizeof(*shared));
+  nshared = 0;
+  for(idx_t i=0; i < nowned; ++i) {
+    if(pos[i]) {
+      pos[i] = nshared;
+      shared[nshared++] = i;
+    }
+  }
+
+  idx_t * slot_shared = splatt_malloc((nsend + 1) * sizeof(*slot_shared));
+  for(idx_t s=0; s < nsend; ++s) {
+    slot_shared[s] = pos[nbr2globs_inds[s] - mat_start];
+  }
+  splatt_free(pos);
+
+  cmp->nshared[m] = nshared;
+  cmp->shared[m] = shared;
+  cmp->slot_shared[m] = slot_shared;
+}
+
+
+
+/******************************************************************************
+ * PUBLIC FUNCTIONS
+ *****************************************************************************/
+
+void mpi_compress_init(
+  rank_info * const rinfo,
+  idx_t const nfactors,
+  double const * const opts)
+{
+  rinfo->compress = NULL;
+
+  splatt_precision_type const precision =
+      (splatt_precision_type) opts[SPLATT_OPTION_COMM_PRECISION];
+  double const threshold = opts[SPLATT_OPTION_COMM_DELTA];
+  if(precision == SPLATT_PRECISION_FULL && threshold <= 0) {
+    return;
+  }
+
+  mpi_compress * cmp = splatt_malloc(sizeof(*cmp));
+  cmp->precision = precision;
+  cmp->threshold = SS_MAX(threshold, 0.);
+  cmp->nfactors = nfactors;
+  cmp->comm = (splatt_comm_type) opts[SPLATT_OPTION_COMM];
+  cmp->req = MPI_REQUEST_NULL;
+
+  idx_t maxslots = 1;
+  idx_t maxowned = 1;
+  for(idx_t m=0; m < MAX_NMODES; ++m) {
+    cmp->nshared[m] = 0;
+    cmp->shared[m] = NULL;
+    cmp->slot_shared[m] = NULL;
+    cmp->last[m] = NULL;
+    cmp->version[m] = NULL;
+    cmp->sent_version[m] = NULL;
+    cmp->recvd[m] = NULL;
+    cmp->recvd_version[m] = NULL;
+    if(m >= rinfo->nmodes) {
+      continue;
+    }
+
+    idx_t const nsend = rinfo->nnbr2globs[m];
+    idx_t const nrecv = rinfo->nlocal2nbr[m];
+    idx_t const nowned = rinfo->mat_end[m] - rinfo->mat_start[m];
+    maxslots = SS_MAX(maxslots, SS_MAX(nsend, nrecv));
+    maxowned = SS_MAX(maxowned, nowned);
+
+    p_find_shared(cmp, rinfo, m);
+
+    /* zeros on both sides are the first 'last' values */
+    if(cmp->threshold > 0) {
+      idx_t const nshared = cmp->nshared[m];
+      cmp->last[m] = p_zalloc((nshared * nfactors + 1) * sizeof(val_t));
+      cmp->version[m] = p_zalloc((nshared + 1) * sizeof(uint32_t));
+      cmp->sent_version[m] = p_zalloc((nsend + 1) * sizeof(uint32_t));
+      cmp->recvd[m] = p_zalloc((nrecv * nfactors + 1) * sizeof(val_t));
+      cmp->recvd_version[m] = p_zalloc((nrecv + 1) * sizeof(uint32_t));
+    }
+  }
+  cmp->comp = splatt_malloc(maxowned * nfactors * sizeof(val_t));
+
+  size_t const record = p_record_size(cmp, cmp->threshold > 0);
+  cmp->sendbuf = splatt_malloc(maxslots * record);
+  cmp->recvbuf = splatt_malloc(maxslots * record);
+  size_t const nints = rinfo->npes * sizeof(int);
+  cmp->msg_bytes = splatt_malloc(nints);
+  cmp->recv_bytes = splatt_malloc(nints);
+  cmp->send_displs = splatt_malloc(nints);
+  cmp->recv_displs = splatt_malloc(nints);
+  cmp->nbr_peers = splatt_malloc(nints);
+  cmp->nbr_send_bytes = splatt_malloc(nints);
+  cmp->nbr_send_displs = splatt_malloc(nints);
+  cmp->nbr_recv_bytes = splatt_malloc(nints);
+  cmp->nbr_recv_displs = splatt_malloc(nints);
+  for(int p=0; p < rinfo->npes; ++p) {
+    cmp->msg_bytes[p] = 0;
+  }
+
+  rinfo->compress = cmp;
+}
+
+
+void mpi_compress_free(
+  rank_info * const rinfo)
+{
+  mpi_compress * const cmp = rinfo->compress;
+  if(cmp == NULL) {
+    return;
+  }
+
+  for(idx_t m=0; m < MAX_NMODES; ++m) {
+    splatt_free(cmp->shared[m]);
+    splatt_free(cmp->slot_shared[m]);
+    splatt_free(cmp->last[m]);
+    splatt_free(cmp->version[m]);
+    splatt_free(cmp->sent_version[m]);
+    splatt_free(cmp->recvd[m]);
+    splatt_free(cmp->recvd_version[m]);
+  }
+  splatt_free(cmp->comp);
+  splatt_free(cmp->sendbuf);
+  splatt_free(cmp->recvbuf);
+  splatt_free(cmp->msg_bytes);
+  splatt_free(cmp->recv_bytes);
+  splatt_free(cmp->send_displs);
+  splatt_free(cmp->recv_displs);
+  splatt_free(cmp->nbr_peers);
+  splatt_free(cmp->nbr_send_bytes);
+  splatt_free(cmp->nbr_send_displs);
+  splatt_free(cmp->nbr_recv_bytes);
+  splatt_free(cmp->nbr_recv_displs);
+  splatt_free(cmp);
+
+  rinfo->compress = NULL;
+}
+
+
+void mpi_compress_prepare(
+  matrix_t * const globalmat,
+  rank_info const * const rinfo,
+  idx_t const mode)
+{
+  mpi_compress * const cmp = rinfo->compress;
+  idx_t const m = mode;
+  idx_t const nfactors = cmp->nfactors;
+  splatt_precision_type const prec = cmp->precision;
+  idx_t const * const shared = cmp->shared[m];
+
+  #pragma omp parallel for schedule(static)
+  for(idx_t k=0; k < cmp->nshared[m]; ++k) {
+    val_t * const row = globalmat->vals + (shared[k] * nfactors);
+    for(idx_t f=0; f < nfactors; ++f) {
+      row[f] = p_round_word(row[f], prec);
+    }
+    if(cmp->threshold == 0) {
+      continue;
+    }
+
+    val_t * const last = cmp->last[m] + (k * nfactors);
+    if(p_row_changed(row, last, nfactors, cmp->threshold)) {
+      memcpy(last, row, nfactors * sizeof(*row));
+      ++(cmp->version[m][k]);
+    } else {
+      memcpy(row, last, nfactors * sizeof(*row));
+    }
+  }
+}
+
+
+void mpi_compress_update_begin(
+  matrix_t * const globalmat,
+  rank_info * const rinfo,
+  idx_t const mode)
+{
+  mpi_compress * const cmp = rinfo->compress;
+  idx_t const m = mode;
+  int const lsize = rinfo->layer_size[m];
+  size_t const record = p_record_size(cmp, cmp->threshold > 0);
+
+  mpi_compress_prepare(globalmat, rinfo, m);
+
+  /* each peer's block is packed independently */
+  #pragma omp parallel for schedule(dynamic, 1)
+  for(int p=0; p < lsize; ++p) {
+    cmp->msg_bytes[p] = p_pack_update(globalmat, rinfo, m, p);
+  }
+
+  p_exchange_begin(rinfo->nbr2globs_ptr[m], rinfo->nbr2globs_disp[m],
+      rinfo->local2nbr_ptr[m], rinfo->local2nbr_disp[m], record,
+      cmp->threshold > 0, rinfo, m);
+}
+
+
+void mpi_compress_update_finish(
+  matrix_t * const localmat,
+  rank_info * const rinfo,
+  idx_t const mode)
+{
+  mpi_compress * const cmp = rinfo->compress;
+  idx_t const m = mode;
+  idx_t const nfactors = cmp->nfactors;
+  int const lsize = rinfo->layer_size[m];
+
+  p_exchange_finish(rinfo, m);
+  for(int p=0; p < lsize; ++p) {
+    if(p != rinfo->layer_rank[m] && cmp->recv_bytes[p] > 0) {
+      p_unpack_update(localmat, rinfo, m, p, cmp->recv_bytes[p]);
+    }
+  }
+
+  /* Rows which were not resent keep their last values. All are rewritten
+   * because the caller may rescale localmat after every exchange. */
+  if(cmp->threshold > 0) {
+    idx_t const * const local2nbr_inds = rinfo->local2nbr_inds[m];
+    val_t const * const recvd = cmp->recvd[m];
+    #pragma omp parallel for schedule(static)
+    for(idx_t r=0; r < rinfo->nlocal2nbr[m]; ++r) {
+      val_t * const row = localmat->vals + (local2nbr_inds[r] * nfactors);
+      for(idx_t f=0; f < nfactors; ++f) {
+        row[f] = recvd[f + (r * nfactors)];
+      }
+    }
+  }
+}
+
+
+void mpi_compress_reduce(
+  matrix_t const * const localmat,
+  matrix_t * const globalmat,
+  rank_info * const rinfo,
+  idx_t const mode)
+{
+  idx_t const m = mode;
+  int const lsize = rinfo->layer_size[m];
+  size_t const record = p_record_size(rinfo->compress, false);
+
+  memset(rinfo->compress->comp, 0,
+      globalmat->I * rinfo->compress->nfactors * sizeof(val_t));
+  p_pack_reduce(localmat, rinfo, m);
+  p_exchange_begin(rinfo->local2nbr_ptr[m], rinfo->local2nbr_disp[m],
+      rinfo->nbr2globs_ptr[m], rinfo->nbr2globs_disp[m], record, false,
+      rinfo, m);
+  p_exchange_finish(rinfo, m);
+
+  /* Several peers can contribute to the same row, so peers are added one at
+   * a time, in layer rank order. The sums do not depend on when messages
+   * arrive. */
+  for(int p=0; p < lsize; ++p) {
+    if(p != rinfo->layer_rank[m] && rinfo->nbr2globs_ptr[m][p] > 0) {
+      p_unpack_reduce(globalmat, rinfo, m, p);
+    }
+  }
+}
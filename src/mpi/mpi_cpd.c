@@ -3,11 +3,15 @@
  * INCLUDES
  *****************************************************************************/
 #include "../splatt_mpi.h"
+#include "../cpd.h"
+#include "../csf.h"
 #include "../mttkrp.h"
 #include "../timer.h"
 #include "../thd_info.h"
 #include "../tile.h"
 #include "../util.h"
+#include "../metrics.h"
+#include "../trace.h"
 
 #include <math.h>
 
@@ -30,6 +34,7 @@ static void p_reset_cpd_timers(
   timer_reset(&timers[TIMER_MPI_NORM]);
   timer_reset(&timers[TIMER_MPI_UPDATE]);
   timer_reset(&timers[TIMER_MPI_FIT]);
+  timer_reset(&timers[TIMER_MPI_FUSED]);
   MPI_Barrier(rinfo->comm_3d);
 #endif
 }
@@ -91,7 +96,9 @@ static val_t p_tt_kruskal_inner(
 
 #ifdef SPLATT_USE_MPI
   timer_start(&timers[TIMER_MPI_FIT]);
-  MPI_Allreduce(&myinner, &inner, 1, SPLATT_MPI_VAL, MPI_SUM, rinfo->comm_3d);
+  trace_begin("mpi fit", -1);
+  mpi_node_allreduce(&myinner, &inner, 1, SPLATT_MPI_VAL, MPI_SUM, rinfo);
+  trace_end();
   timer_stop(&timers[TIMER_MPI_FIT]);
 #else
   inner = myinner;
@@ -151,6 +158,35 @@ static val_t p_kruskal_norm(
 }
 
 
+/**
+* @brief Normalize the columns of a local factor whose rows were exchanged
+*        before the fused reduction produced lambda.
+*
+* @param A The local factor, including neighbor rows.
+* @param lambda The column norms of the factor.
+* @param start The first row to normalize.
+* @param end One past the last row to normalize.
+*/
+static void p_normalize_local(
+  matrix_t * const A,
+  val_t const * const restrict lambda,
+  idx_t const start,
+  idx_t const end)
+{
+  idx_t const J = A->J;
+  val_t * const restrict vals = A->vals;
+
+  timer_start(&timers[TIMER_MATNORM]);
+  #pragma omp parallel for schedule(static)
+  for(idx_t i=start; i < end; ++i) {
+    for(idx_t j=0; j < J; ++j) {
+      vals[j+(i*J)] /= lambda[j];
+    }
+  }
+  timer_stop(&timers[TIMER_MATNORM]);
+}
+
+
 /**
 * @brief Compute the fit of a Kruskal tensor, Z, to an input tensor, X. This
 *        is computed via 1 - [sqrt(<X,X> + <Z,Z> - 2<X,Z>) / sqrt(<X,X>)].
@@ -163,6 +199,7 @@ static val_t p_kruskal_norm(
 * @param mats The Kruskal-tensor matrices.
 * @param m1 The result of doing MTTKRP along the last mode.
 * @param aTa An array of matrices (length MAX_NMODES)containing BtB, CtC, etc.
+* @param inner The already reduced <X,Z>, or NULL to compute it here.
 *
 * @return The inner product of the two tensors, computed via:
 *         \lambda^T hadamard(mats[nmodes-1], m1) \lambda.
@@ -175,7 +212,8 @@ static val_t p_calc_fit(
   val_t const * const restrict lambda,
   matrix_t ** mats,
   matrix_t const * const m1,
-  matrix_t ** aTa)
+  matrix_t ** aTa,
+  val_t const * const inner)
 {
   timer_start(&timers[TIMER_FIT]);
 
@@ -183,13 +221,14 @@ static val_t p_calc_fit(
   val_t const norm_mats = p_kruskal_norm(nmodes, lambda, aTa);
 
   /* Compute inner product of tensor with new model */
-  val_t const inner = p_tt_kruskal_inner(nmodes, rinfo, thds, lambda, mats,m1);
+  val_t const xz = (inner != NULL) ? *inner :
+      p_tt_kruskal_inner(nmodes, rinfo, thds, lambda, mats, m1);
 
   /*
    * We actually want sqrt(<X,X> + <Y,Y> - 2<X,Y>), but if the fit is perfect
    * just make it 0.
    */
-  val_t residual = ttnormsq + norm_mats - (2 * inner);
+  val_t residual = ttnormsq + norm_mats - (2 * xz);
   if(residual > 0.) {
     residual = sqrt(residual);
   }
@@ -202,6 +241,100 @@ static val_t p_calc_fit(
  * PRIVATE FUNCTIONS
  *****************************************************************************/
 
+/**
+* @brief Sum every rank's MTTKRP output of a replicated mode into a full-size
+*        matrix. The owned rows of the result are also copied to 'owned' so
+*        that the fit computation sees the same data as the distributed path.
+*
+* @param localmat My MTTKRP output, in local (layer, compressed) rows.
+* @param replmat The full matrix to write to (global_dims[mode] rows).
+* @param owned Output for the rows that I own.
+* @param rinfo MPI rank information.
+* @param nfactors The number of columns in the matrices.
+* @param mode The mode we are operating on.
+*/
+static void p_reduce_replicated(
+  matrix_t const * const localmat,
+  matrix_t * const replmat,
+  matrix_t * const owned,
+  rank_info * const rinfo,
+  idx_t const nfactors,
+  idx_t const mode)
+{
+  idx_t const m = mode;
+  idx_t const * const indmap = rinfo->indmap[m];
+  idx_t const offset = rinfo->layer_starts[m];
+  val_t const * const restrict matv = localmat->vals;
+  val_t * const restrict rvals = replmat->vals;
+
+  timer_start(&timers[TIMER_MPI_REDUCE]);
+  trace_begin("mpi reduce", m);
+
+  replmat->I = rinfo->global_dims[m];
+  memset(rvals, 0, replmat->I * nfactors * sizeof(val_t));
+
+  /* local rows are unique, so no conflicts */
+  #pragma omp parallel for schedule(static)
+  for(idx_t i=0; i < localmat->I; ++i) {
+    idx_t const gi = offset + ((indmap == NULL) ? i : indmap[i]);
+    for(idx_t f=0; f < nfactors; ++f) {
+      rvals[f+(gi*nfactors)] = matv[f+(i*nfactors)];
+    }
+  }
+
+  timer_start(&timers[TIMER_MPI_COMM]);
+  MPI_Allreduce(MPI_IN_PLACE, rvals, replmat->I * nfactors, SPLATT_MPI_VAL,
+      MPI_SUM, rinfo->comm_3d);
+  timer_stop(&timers[TIMER_MPI_COMM]);
+
+  idx_t const ostart = offset + rinfo->mat_start[m];
+  par_memcpy(owned->vals, rvals + (ostart * nfactors),
+      owned->I * nfactors * sizeof(val_t));
+
+  trace_end();
+  timer_stop(&timers[TIMER_MPI_REDUCE]);
+}
+
+
+/**
+* @brief Copy a freshly solved replicated factor into my local and owned
+*        factor matrices. This replaces mpi_update_rows() for replicated modes.
+*
+* @param replmat The full factor matrix.
+* @param localmat My local factor matrix (layer, compressed rows).
+* @param globalmat The factor rows that I own.
+* @param rinfo MPI rank information.
+* @param nfactors The number of columns in the matrices.
+* @param mode The mode we are operating on.
+*/
+static void p_flush_replicated(
+  matrix_t const * const replmat,
+  matrix_t * const localmat,
+  matrix_t * const globalmat,
+  rank_info const * const rinfo,
+  idx_t const nfactors,
+  idx_t const mode)
+{
+  idx_t const m = mode;
+  idx_t const * const indmap = rinfo->indmap[m];
+  idx_t const offset = rinfo->layer_starts[m];
+  val_t const * const restrict rvals = replmat->vals;
+  val_t * const restrict matv = localmat->vals;
+
+  #pragma omp parallel for schedule(static)
+  for(idx_t i=0; i < localmat->I; ++i) {
+    idx_t const gi = offset + ((indmap == NULL) ? i : indmap[i]);
+    for(idx_t f=0; f < nfactors; ++f) {
+      matv[f+(i*nfactors)] = rvals[f+(gi*nfactors)];
+    }
+  }
+
+  idx_t const ostart = offset + rinfo->mat_start[m];
+  par_memcpy(globalmat->vals, rvals + (ostart * nfactors),
+      globalmat->I * nfactors * sizeof(val_t));
+}
+
+
 /**
 * @brief Flush the updated values in globalmat to our local representation.
 *
@@ -222,15 +355,191 @@ static void p_flush_glob_to_local(
   idx_t const m = mode;
 
   idx_t const mat_start = rinfo->mat_start[m];
-  idx_t const mat_end = rinfo->mat_end[m];
   idx_t const start = rinfo->ownstart[m];
   idx_t const nowned = rinfo->nowned[m];
 
   assert(start + nowned <= localmat->I);
 
-  par_memcpy(localmat->vals + (start*nfactors),
-         globalmat->vals,
-         nowned * nfactors * sizeof(val_t));
+  /* owned rows are contiguous locally but may skip global rows which have
+   * no local nonzeros */
+  #pragma omp parallel for schedule(static)
+  for(idx_t i=start; i < start + nowned; ++i) {
+    idx_t const gi = ((indmap == NULL) ? i : indmap[i]) - mat_start;
+    memcpy(localmat->vals + (i * nfactors), globalmat->vals + (gi * nfactors),
+        nfactors * sizeof(val_t));
+  }
+}
+
+
+/**
+* @brief Write my owned rows of a local matrix into the global matrix that I
+*        own, zeroing the global rows that I have no local partials for.
+*
+* @param indmap The local->global mapping of the tensor. May be NULL.
+* @param ownvals The first owned row of the local matrix.
+* @param globmat The global matrix to write to.
+* @param rinfo MPI rank information.
+* @param nfactors The number of columns in the matrices.
+* @param mode The mode to operate on.
+*/
+static void p_scatter_owned(
+  idx_t const * const indmap,
+  val_t const * const ownvals,
+  matrix_t * const globmat,
+  rank_info const * const rinfo,
+  idx_t const nfactors,
+  idx_t const mode)
+{
+  idx_t const mat_start = rinfo->mat_start[mode];
+  idx_t const start = rinfo->ownstart[mode];
+  idx_t const nowned = rinfo->nowned[mode];
+
+  memset(globmat->vals, 0, globmat->I * nfactors * sizeof(val_t));
+
+  #pragma omp parallel for schedule(static)
+  for(idx_t i=0; i < nowned; ++i) {
+    idx_t const gi = ((indmap == NULL) ? start + i : indmap[start + i]) -
+        mat_start;
+    memcpy(globmat->vals + (gi * nfactors), ownvals + (i * nfactors),
+        nfactors * sizeof(val_t));
+  }
+}
+
+
+/**
+* @brief Pack the rows that I own and neighbors need into nbr2globs_buf.
+*
+* @param nbr2globs_buf The send buffer to fill.
+* @param globalmat Global factor matrix (owned by me).
+* @param rinfo MPI rank information.
+* @param nfactors The number of columns in the factor matrices.
+* @param m The mode to operate on.
+*/
+static void p_pack_nbr2globs(
+  val_t * const restrict nbr2globs_buf,
+  matrix_t const * const globalmat,
+  rank_info const * const rinfo,
+  idx_t const nfactors,
+  idx_t const m)
+{
+  idx_t const mat_start = rinfo->mat_start[m];
+  idx_t const * const restrict nbr2globs_inds = rinfo->nbr2globs_inds[m];
+  val_t const * const restrict gmatv = globalmat->vals;
+
+  #pragma omp parallel for
+  for(idx_t s=0; s < rinfo->nnbr2globs[m]; ++s) {
+    idx_t const row = nbr2globs_inds[s] - mat_start;
+    for(idx_t f=0; f < nfactors; ++f) {
+      nbr2globs_buf[f+(s*nfactors)] = gmatv[f+(row*nfactors)];
+    }
+  }
+}
+
+
+/**
+* @brief Write received neighbor rows into my local matrix.
+*
+* @param nbr2local_buf The received rows, in local2nbr order.
+* @param localmat Local factor matrix which receives updated values.
+* @param rinfo MPI rank information.
+* @param nfactors The number of columns in the factor matrices.
+* @param m The mode to operate on.
+*/
+static void p_unpack_nbr2local(
+  val_t const * const restrict nbr2local_buf,
+  matrix_t * const localmat,
+  rank_info const * const rinfo,
+  idx_t const nfactors,
+  idx_t const m)
+{
+  idx_t const * const restrict local2nbr_inds = rinfo->local2nbr_inds[m];
+  val_t * const restrict matv = localmat->vals;
+
+  #pragma omp parallel for
+  for(idx_t r=0; r < rinfo->nlocal2nbr[m]; ++r) {
+    idx_t const row = local2nbr_inds[r];
+    for(idx_t f=0; f < nfactors; ++f) {
+      matv[f+(row*nfactors)] = nbr2local_buf[f+(r*nfactors)];
+    }
+  }
+}
+
+
+/**
+* @brief Do a reduction (sum) of all neighbor partial products which I own.
+*        Updates are written to globalmat.
+*        This version communicates only with the neighbors in
+*        rinfo->nbr_comm[m], using the persistent neighborhood alltoallv from
+*        mpi_nbr_plan_init() when available.
+*
+* @param local2nbr_buf A buffer at least as large as nlocal2nbr. Must be the
+*                      buffer bound to the plan.
+* @param nbr2globs_buf A buffer at least as large as nnbr2globs. Must be the
+*                      buffer bound to the plan.
+* @param localmat My local matrix containing partial products for other ranks.
+* @param globalmat The global factor matrix to update.
+* @param rinfo MPI rank information.
+* @param nfactors The number of columns in the matrices.
+* @param m The mode to operate on.
+*/
+static void p_reduce_rows_neighbor(
+  val_t * const restrict local2nbr_buf,
+  val_t * const restrict nbr2globs_buf,
+  matrix_t const * const localmat,
+  matrix_t * const globalmat,
+  rank_info * const rinfo,
+  idx_t const nfactors,
+  idx_t const m)
+{
+  idx_t const mat_start = rinfo->mat_start[m];
+  idx_t const * const restrict local2nbr_inds = rinfo->local2nbr_inds[m];
+  idx_t const * const restrict nbr2globs_inds = rinfo->nbr2globs_inds[m];
+  val_t const * const restrict matv = localmat->vals;
+  val_t * const restrict gmatv = globalmat->vals;
+
+  /* copy my partial products into the sendbuf */
+  #pragma omp parallel for
+  for(idx_t s=0; s < rinfo->nlocal2nbr[m]; ++s) {
+    idx_t const row = local2nbr_inds[s];
+    for(idx_t f=0; f < nfactors; ++f) {
+      local2nbr_buf[f + (s*nfactors)] = matv[f + (row*nfactors)];
+    }
+  }
+
+  int const * const restrict nbr_ptr = rinfo->nbr_nbr2globs_ptr[m];
+  int const * const restrict nbr_disp = rinfo->nbr_nbr2globs_disp[m];
+
+  /* exchange rows */
+  timer_start(&timers[TIMER_MPI_COMM]);
+  if(rinfo->nbr_reduce_req[m] != MPI_REQUEST_NULL) {
+    assert(local2nbr_buf == rinfo->nbr_local2nbr_buf);
+    assert(nbr2globs_buf == rinfo->nbr_nbr2globs_buf);
+    MPI_Start(&(rinfo->nbr_reduce_req[m]));
+    MPI_Wait(&(rinfo->nbr_reduce_req[m]), MPI_STATUS_IGNORE);
+  } else {
+    MPI_Neighbor_alltoallv(
+        local2nbr_buf, rinfo->nbr_local2nbr_ptr[m],
+        rinfo->nbr_local2nbr_disp[m], SPLATT_MPI_VAL,
+        nbr2globs_buf, nbr_ptr, nbr_disp, SPLATT_MPI_VAL,
+        rinfo->nbr_comm[m]);
+  }
+  timer_stop(&timers[TIMER_MPI_COMM]);
+
+  /* Now add received partial products. Neighbors may send the same row, so
+   * we parallelize the additions from each neighbor. */
+  #pragma omp parallel
+  for(int n=0; n < rinfo->nnbrs[m]; ++n) {
+    int const nrecvs = nbr_ptr[n] / nfactors;
+    int const disp  = nbr_disp[n] / nfactors;
+
+    #pragma omp for
+    for(int r=disp; r < disp + nrecvs; ++r) {
+      idx_t const row = nbr2globs_inds[r] - mat_start;
+      for(idx_t f=0; f < nfactors; ++f) {
+        gmatv[f+(row*nfactors)] += nbr2globs_buf[f+(r*nfactors)];
+      }
+    }
+  } /* end recvs */
 }
 
 
@@ -308,23 +617,16 @@ static void p_reduce_rows_all2all(
 }
 
 /**
-* @brief Do a reduction (sum) of all neighbor partial products which I own.
-*        Updates are written to globalmat.
-*        This version accomplishes the communication with an MPI_{Irecv,Isend}.
+* @brief Post the receives of a point-to-point reduction and reset all other
+*        requests to MPI_REQUEST_NULL.
 *
-* @param local2nbr_buf A buffer at least as large as nlocal2nbr.
 * @param nbr2globs_buf A buffer at least as large as nnbr2globs.
-* @param localmat My local matrix containing partial products for other ranks.
-* @param globalmat The global factor matrix to update.
 * @param rinfo MPI rank information.
 * @param nfactors The number of columns in the matrices.
 * @param m The mode to operate on.
 */
-static void p_reduce_rows_point2point(
-  val_t * const restrict local2nbr_buf,
+static void p_post_reduce_recvs(
   val_t * const restrict nbr2globs_buf,
-  matrix_t const * const localmat,
-  matrix_t * const globalmat,
   rank_info * const rinfo,
   idx_t const nfactors,
   idx_t const m)
@@ -332,13 +634,12 @@ static void p_reduce_rows_point2point(
   int const lrank = rinfo->layer_rank[m];
   int const lsize = rinfo->layer_size[m];
 
-  idx_t const mat_start = rinfo->mat_start[m];
-  idx_t const * const restrict local2nbr_inds = rinfo->local2nbr_inds[m];
-  idx_t const * const restrict nbr2globs_inds = rinfo->nbr2globs_inds[m];
-  val_t const * const restrict matv = localmat->vals;
-  val_t * const restrict gmatv = globalmat->vals;
+  /* peers we do not talk to are left as null requests */
+  for(int p=0; p < lsize; ++p) {
+    rinfo->send_reqs[p] = MPI_REQUEST_NULL;
+    rinfo->recv_reqs[p] = MPI_REQUEST_NULL;
+  }
 
-  /* IRECVS */
   for(int p=1; p < lsize; ++p) {
     int const porig = (p + lrank) % lsize;
     /* The number of rows to recv from porig */
@@ -354,8 +655,43 @@ static void p_reduce_rows_point2point(
         porig, 0, rinfo->layer_comm[m], rinfo->recv_reqs + porig);
     timer_stop(&timers[TIMER_MPI_COMM]);
   }
+}
 
 
+/**
+* @brief Do a reduction (sum) of all neighbor partial products which I own.
+*        Updates are written to globalmat.
+*        This version accomplishes the communication with an MPI_{Irecv,Isend}.
+*
+* @param local2nbr_buf A buffer at least as large as nlocal2nbr.
+* @param nbr2globs_buf A buffer at least as large as nnbr2globs.
+* @param localmat My local matrix containing partial products for other ranks.
+* @param globalmat The global factor matrix to update.
+* @param rinfo MPI rank information.
+* @param nfactors The number of columns in the matrices.
+* @param m The mode to operate on.
+*/
+static void p_reduce_rows_point2point(
+  val_t * const restrict local2nbr_buf,
+  val_t * const restrict nbr2globs_buf,
+  matrix_t const * const localmat,
+  matrix_t * const globalmat,
+  rank_info * const rinfo,
+  idx_t const nfactors,
+  idx_t const m)
+{
+  int const lrank = rinfo->layer_rank[m];
+  int const lsize = rinfo->layer_size[m];
+
+  idx_t const mat_start = rinfo->mat_start[m];
+  idx_t const * const restrict local2nbr_inds = rinfo->local2nbr_inds[m];
+  idx_t const * const restrict nbr2globs_inds = rinfo->nbr2globs_inds[m];
+  val_t const * const restrict matv = localmat->vals;
+  val_t * const restrict gmatv = globalmat->vals;
+
+  /* IRECVS */
+  p_post_reduce_recvs(nbr2globs_buf, rinfo, nfactors, m);
+
   #pragma omp parallel default(shared)
   {
     /* ISENDS */
@@ -420,50 +756,328 @@ static void p_reduce_rows_point2point(
       }
     } /* end recvs */
   } /* end omp parallel */
+
+  /* the send buffer may be reused after this */
+  timer_start(&timers[TIMER_MPI_IDLE]);
+  MPI_Waitall(lsize, rinfo->send_reqs, MPI_STATUSES_IGNORE);
+  timer_stop(&timers[TIMER_MPI_IDLE]);
 }
 
 
 /**
-* @brief Exchange updated factor rows with all MPI ranks in the same layer.
-*        This version accomplishes the communication with individual MPI_Isend
-*        and MPI_Recv.
-*        We send globmats[mode] to the needing ranks and receive other ranks'
-*        globmats entries which we store in mats[mode].
+* @brief Which thread packs, sends, receives, and unpacks the rows of a peer
+*        when threads communicate independently.
 *
-* @param nbr2globs_buf Buffer at least as large as as there are rows to send
-*                      (for each rank).
-* @param nbr2local_buf Buffer at least as large as there are rows to receive.
-* @param localmat Local factor matrix which receives updated values.
-* @param globalmat Global factor matrix (owned by me) which is sent to ranks.
-* @param rinfo MPI rank information.
-* @param nfactors The number of columns in the factor matrices.
-* @param mode The mode to exchange along.
+* @param p The peer's offset from my layer rank (1 ... lsize-1).
+* @param nthreads The number of threads in the team.
+*
+* @return The thread responsible for the peer.
 */
-static void p_update_rows_point2point(
-  val_t * const nbr2globs_buf,
-  val_t * const nbr2local_buf,
-  matrix_t * const localmat,
-  matrix_t * const globalmat,
-  rank_info * const rinfo,
-  idx_t const nfactors,
-  idx_t const mode)
+static inline int p_peer_thread(
+  int const p,
+  int const nthreads)
 {
-  idx_t const m = mode;
-  idx_t const mat_start = rinfo->mat_start[m];
-  idx_t const * const nbr2globs_inds = rinfo->nbr2globs_inds[m];
-  idx_t const * const local2nbr_inds = rinfo->local2nbr_inds[m];
-  val_t const * const gmatv = globalmat->vals;
-  val_t * const matv = localmat->vals;
-
-  int const lrank = rinfo->layer_rank[m];
-  int const lsize = rinfo->layer_size[m];
+  return (p - 1) % nthreads;
+}
 
 
-  /* IRECVS */
-  for(int p=1; p < lsize; ++p) {
-    int const porig = (p + lrank) % lsize;
-    /* The number of rows to recv from porig */
-    int const nrecvs = rinfo->local2nbr_ptr[m][porig] / nfactors;
+/**
+* @brief Group the received partial products by the owned row they are added
+*        to, in the order in which they arrive in nbr2globs_buf.
+*
+* @param rinfo MPI rank information.
+*/
+static void p_reduce_plan_init(
+  rank_info * const rinfo)
+{
+  for(idx_t m=0; m < rinfo->nmodes; ++m) {
+    idx_t const mat_start = rinfo->mat_start[m];
+    idx_t const nowned = rinfo->mat_end[m] - mat_start;
+    idx_t const nrecvs = rinfo->nnbr2globs[m];
+    idx_t const * const nbr2globs_inds = rinfo->nbr2globs_inds[m];
+
+    idx_t * const ptr = splatt_malloc((nowned+1) * sizeof(*ptr));
+    idx_t * const slots = splatt_malloc(SS_MAX(nrecvs, 1) * sizeof(*slots));
+    memset(ptr, 0, (nowned+1) * sizeof(*ptr));
+
+    /* counting sort of the slots by row */
+    for(idx_t r=0; r < nrecvs; ++r) {
+      ++ptr[1 + nbr2globs_inds[r] - mat_start];
+    }
+    for(idx_t i=0; i < nowned; ++i) {
+      ptr[i+1] += ptr[i];
+    }
+    for(idx_t r=0; r < nrecvs; ++r) {
+      slots[ptr[nbr2globs_inds[r] - mat_start]++] = r;
+    }
+    for(idx_t i=nowned; i > 0; --i) {
+      ptr[i] = ptr[i-1];
+    }
+    ptr[0] = 0;
+
+    rinfo->reduce_ptr[m] = ptr;
+    rinfo->reduce_slots[m] = slots;
+  }
+}
+
+
+/**
+* @brief Free the structures created by p_reduce_plan_init().
+*
+* @param rinfo MPI rank information.
+*/
+static void p_reduce_plan_free(
+  rank_info * const rinfo)
+{
+  for(idx_t m=0; m < rinfo->nmodes; ++m) {
+    splatt_free(rinfo->reduce_ptr[m]);
+    splatt_free(rinfo->reduce_slots[m]);
+    rinfo->reduce_ptr[m] = NULL;
+    rinfo->reduce_slots[m] = NULL;
+  }
+}
+
+
+/**
+* @brief Do a reduction (sum) of all neighbor partial products which I own,
+*        with each thread packing, sending, and receiving for its own set of
+*        peers, so a thread's messages go out as soon as it has packed them.
+*        The partials are then summed by row with p_reduce_plan_init()'s
+*        lists. Requires MPI_THREAD_MULTIPLE.
+*
+* @param local2nbr_buf A buffer at least as large as nlocal2nbr.
+* @param nbr2globs_buf A buffer at least as large as nnbr2globs.
+* @param localmat My local matrix containing partial products for other ranks.
+* @param globalmat The global factor matrix to update.
+* @param rinfo MPI rank information.
+* @param nfactors The number of columns in the matrices.
+* @param m The mode to operate on.
+*/
+static void p_reduce_rows_point2point_threaded(
+  val_t * const restrict local2nbr_buf,
+  val_t * const restrict nbr2globs_buf,
+  matrix_t const * const localmat,
+  matrix_t * const globalmat,
+  rank_info * const rinfo,
+  idx_t const nfactors,
+  idx_t const m)
+{
+  int const lrank = rinfo->layer_rank[m];
+  int const lsize = rinfo->layer_size[m];
+
+  idx_t const nowned = rinfo->mat_end[m] - rinfo->mat_start[m];
+  idx_t const * const restrict local2nbr_inds = rinfo->local2nbr_inds[m];
+  idx_t const * const restrict reduce_ptr = rinfo->reduce_ptr[m];
+  idx_t const * const restrict reduce_slots = rinfo->reduce_slots[m];
+  val_t const * const restrict matv = localmat->vals;
+  val_t * const restrict gmatv = globalmat->vals;
+
+  p_post_reduce_recvs(nbr2globs_buf, rinfo, nfactors, m);
+
+  #pragma omp parallel default(shared)
+  {
+    int const tid = splatt_omp_get_thread_num();
+    int const nthreads = splatt_omp_get_num_threads();
+
+    /* pack and send to my peers */
+    for(int p=1; p < lsize; ++p) {
+      if(p_peer_thread(p, nthreads) != tid) {
+        continue;
+      }
+      int const pdest = (p + lrank) % lsize;
+      int const nsends = rinfo->local2nbr_ptr[m][pdest] / nfactors;
+      int const disp  = rinfo->local2nbr_disp[m][pdest] / nfactors;
+      if(nsends == 0) {
+        continue;
+      }
+
+      for(int s=disp; s < disp+nsends; ++s) {
+        idx_t const row = local2nbr_inds[s];
+        for(idx_t f=0; f < nfactors; ++f) {
+          local2nbr_buf[f + (s*nfactors)] = matv[f + (row*nfactors)];
+        }
+      }
+      MPI_Isend(&(local2nbr_buf[disp*nfactors]), nsends*nfactors,
+          SPLATT_MPI_VAL, pdest, 0, rinfo->layer_comm[m],
+          rinfo->send_reqs + pdest);
+    }
+
+    /* wait for my peers' partial products */
+    for(int p=1; p < lsize; ++p) {
+      if(p_peer_thread(p, nthreads) == tid) {
+        int const porig = (p + lrank) % lsize;
+        MPI_Wait(rinfo->recv_reqs + porig, MPI_STATUS_IGNORE);
+      }
+    }
+    #pragma omp barrier
+
+    /* Several peers can contribute to the same row, so each thread sums
+     * whole rows. Partials are added in the order of nbr2globs_buf, which
+     * does not depend on when they arrived. */
+    #pragma omp for schedule(static)
+    for(idx_t i=0; i < nowned; ++i) {
+      for(idx_t j=reduce_ptr[i]; j < reduce_ptr[i+1]; ++j) {
+        idx_t const r = reduce_slots[j];
+        for(idx_t f=0; f < nfactors; ++f) {
+          gmatv[f+(i*nfactors)] += nbr2globs_buf[f+(r*nfactors)];
+        }
+      }
+    }
+  } /* end omp parallel */
+
+  timer_start(&timers[TIMER_MPI_IDLE]);
+  MPI_Waitall(lsize, rinfo->send_reqs, MPI_STATUSES_IGNORE);
+  timer_stop(&timers[TIMER_MPI_IDLE]);
+}
+
+
+/**
+* @brief Pack and send my owned rows, with each thread handling its own peers.
+*        Requires MPI_THREAD_MULTIPLE.
+*
+* @param nbr2globs_buf Buffer at least as large as as there are rows to send.
+* @param globalmat Global factor matrix (owned by me) which is sent to ranks.
+* @param rinfo MPI rank information.
+* @param nfactors The number of columns in the factor matrices.
+* @param m The mode to exchange along.
+*/
+static void p_send_rows_threaded(
+  val_t * const nbr2globs_buf,
+  matrix_t const * const globalmat,
+  rank_info * const rinfo,
+  idx_t const nfactors,
+  idx_t const m)
+{
+  idx_t const mat_start = rinfo->mat_start[m];
+  idx_t const * const nbr2globs_inds = rinfo->nbr2globs_inds[m];
+  val_t const * const gmatv = globalmat->vals;
+
+  int const lrank = rinfo->layer_rank[m];
+  int const lsize = rinfo->layer_size[m];
+
+  #pragma omp parallel default(shared)
+  {
+    int const tid = splatt_omp_get_thread_num();
+    int const nthreads = splatt_omp_get_num_threads();
+    for(int p=1; p < lsize; ++p) {
+      if(p_peer_thread(p, nthreads) != tid) {
+        continue;
+      }
+      int const pdest = (p + lrank) % lsize;
+      int const nsends = rinfo->nbr2globs_ptr[m][pdest] / nfactors;
+      int const disp = rinfo->nbr2globs_disp[m][pdest] / nfactors;
+      if(nsends == 0) {
+        continue;
+      }
+
+      for(int s=disp; s < disp+nsends; ++s) {
+        idx_t const row = nbr2globs_inds[s] - mat_start;
+        for(idx_t f=0; f < nfactors; ++f) {
+          nbr2globs_buf[f+(s*nfactors)] = gmatv[f+(row*nfactors)];
+        }
+      }
+      MPI_Isend(&(nbr2globs_buf[disp*nfactors]), nsends*nfactors,
+          SPLATT_MPI_VAL, pdest, 0, rinfo->layer_comm[m],
+          rinfo->send_reqs + pdest);
+    }
+  } /* end omp parallel */
+}
+
+
+/**
+* @brief Wait for and unpack updated rows, with each thread handling its own
+*        peers. Each row comes from exactly one owner, so no synchronization
+*        is needed. Requires MPI_THREAD_MULTIPLE.
+*
+* @param nbr2local_buf The receive buffer.
+* @param localmat Local factor matrix which receives updated values.
+* @param rinfo MPI rank information.
+* @param nfactors The number of columns in the factor matrices.
+* @param m The mode to exchange along.
+*/
+static void p_recv_rows_threaded(
+  val_t const * const nbr2local_buf,
+  matrix_t * const localmat,
+  rank_info * const rinfo,
+  idx_t const nfactors,
+  idx_t const m)
+{
+  idx_t const * const local2nbr_inds = rinfo->local2nbr_inds[m];
+  val_t * const matv = localmat->vals;
+
+  int const lrank = rinfo->layer_rank[m];
+  int const lsize = rinfo->layer_size[m];
+
+  #pragma omp parallel default(shared)
+  {
+    int const tid = splatt_omp_get_thread_num();
+    int const nthreads = splatt_omp_get_num_threads();
+    for(int p=1; p < lsize; ++p) {
+      if(p_peer_thread(p, nthreads) != tid) {
+        continue;
+      }
+      int const porig = (p + lrank) % lsize;
+      int const nrecvs = rinfo->local2nbr_ptr[m][porig] / nfactors;
+      int const disp = rinfo->local2nbr_disp[m][porig] / nfactors;
+      if(nrecvs == 0) {
+        continue;
+      }
+
+      MPI_Wait(rinfo->recv_reqs + porig, MPI_STATUS_IGNORE);
+      for(int r=disp; r < disp + nrecvs; ++r) {
+        idx_t const row = local2nbr_inds[r];
+        for(idx_t f=0; f < nfactors; ++f) {
+          matv[f+(row*nfactors)] = nbr2local_buf[f+(r*nfactors)];
+        }
+      }
+    }
+  } /* end omp parallel */
+}
+
+
+/**
+* @brief Begin exchanging updated factor rows with all MPI ranks in the same
+*        layer. This version accomplishes the communication with individual
+*        MPI_Isend and MPI_Irecv. We pack and send globmats[mode] to the needing
+*        ranks and post receives for other ranks' globmats entries. The
+*        exchange is completed by p_update_rows_point2point_finish().
+*
+* @param nbr2globs_buf Buffer at least as large as as there are rows to send
+*                      (for each rank). Must not be modified until the exchange
+*                      is finished.
+* @param nbr2local_buf Buffer at least as large as there are rows to receive.
+* @param globalmat Global factor matrix (owned by me) which is sent to ranks.
+* @param rinfo MPI rank information.
+* @param nfactors The number of columns in the factor matrices.
+* @param mode The mode to exchange along.
+*/
+static void p_update_rows_point2point_begin(
+  val_t * const nbr2globs_buf,
+  val_t * const nbr2local_buf,
+  matrix_t const * const globalmat,
+  rank_info * const rinfo,
+  idx_t const nfactors,
+  idx_t const mode)
+{
+  idx_t const m = mode;
+  idx_t const mat_start = rinfo->mat_start[m];
+  idx_t const * const nbr2globs_inds = rinfo->nbr2globs_inds[m];
+  val_t const * const gmatv = globalmat->vals;
+
+  int const lrank = rinfo->layer_rank[m];
+  int const lsize = rinfo->layer_size[m];
+
+  /* peers we do not talk to are left as null requests */
+  for(int p=0; p < lsize; ++p) {
+    rinfo->send_reqs[p] = MPI_REQUEST_NULL;
+    rinfo->recv_reqs[p] = MPI_REQUEST_NULL;
+  }
+
+  /* IRECVS */
+  for(int p=1; p < lsize; ++p) {
+    int const porig = (p + lrank) % lsize;
+    /* The number of rows to recv from porig */
+    int const nrecvs = rinfo->local2nbr_ptr[m][porig] / nfactors;
     int const disp = rinfo->local2nbr_disp[m][porig] / nfactors;
 
     if(nrecvs == 0) {
@@ -477,6 +1091,10 @@ static void p_update_rows_point2point(
     timer_stop(&timers[TIMER_MPI_COMM]);
   }
 
+  if(rinfo->comm_threads) {
+    p_send_rows_threaded(nbr2globs_buf, globalmat, rinfo, nfactors, m);
+    return;
+  }
 
   #pragma omp parallel default(shared)
   {
@@ -488,135 +1106,556 @@ static void p_update_rows_point2point(
       int const nsends = rinfo->nbr2globs_ptr[m][pdest] / nfactors;
       int const disp = rinfo->nbr2globs_disp[m][pdest] / nfactors;
 
-      if(nsends == 0) {
-        continue;
-      }
+      if(nsends == 0) {
+        continue;
+      }
+
+      /* first prepare all rows that I own and need to send */
+      #pragma omp for
+      for(int s=disp; s < disp+nsends; ++s) {
+        idx_t const row = nbr2globs_inds[s] - mat_start;
+        for(idx_t f=0; f < nfactors; ++f) {
+          nbr2globs_buf[f+(s*nfactors)] = gmatv[f+(row*nfactors)];
+        }
+      }
+
+      /* do the actual communication */
+      #pragma omp master
+      {
+        timer_start(&timers[TIMER_MPI_COMM]);
+        MPI_Isend(&(nbr2globs_buf[disp*nfactors]), nsends*nfactors, SPLATT_MPI_VAL,
+            pdest, 0, rinfo->layer_comm[m], rinfo->send_reqs + pdest);
+        timer_stop(&timers[TIMER_MPI_COMM]);
+      }
+    } /* end sends */
+  } /* end omp parallel */
+}
+
+
+/**
+* @brief Complete an exchange started by p_update_rows_point2point_begin().
+*        Incoming rows are written to localmat as they arrive.
+*
+* @param nbr2local_buf The receive buffer given to the matching begin call.
+* @param localmat Local factor matrix which receives updated values.
+* @param rinfo MPI rank information.
+* @param nfactors The number of columns in the factor matrices.
+* @param mode The mode to exchange along.
+*/
+static void p_update_rows_point2point_finish(
+  val_t const * const nbr2local_buf,
+  matrix_t * const localmat,
+  rank_info * const rinfo,
+  idx_t const nfactors,
+  idx_t const mode)
+{
+  idx_t const m = mode;
+  idx_t const * const local2nbr_inds = rinfo->local2nbr_inds[m];
+  val_t * const matv = localmat->vals;
+
+  int const lrank = rinfo->layer_rank[m];
+  int const lsize = rinfo->layer_size[m];
+
+  if(rinfo->comm_threads) {
+    p_recv_rows_threaded(nbr2local_buf, localmat, rinfo, nfactors, m);
+  } else {
+    #pragma omp parallel default(shared)
+    {
+      /* RECVS */
+      for(int p=1; p < lsize; ++p) {
+        int const porig = (p + lrank) % lsize;
+        /* The number of rows to recv from porig */
+        int const nrecvs = rinfo->local2nbr_ptr[m][porig] / nfactors;
+        int const disp = rinfo->local2nbr_disp[m][porig] / nfactors;
+
+        if(nrecvs == 0) {
+          continue;
+        }
+
+        /* wait for the actual communication */
+        #pragma omp master
+        {
+          timer_start(&timers[TIMER_MPI_IDLE]);
+          MPI_Wait(rinfo->recv_reqs + porig, MPI_STATUS_IGNORE);
+          timer_stop(&timers[TIMER_MPI_IDLE]);
+        }
+
+        /* wait until recv is done */
+        #pragma omp barrier
+
+        /* now write incoming nbr2locals to my local matrix */
+        #pragma omp for
+        for(int r=disp; r < disp + nrecvs; ++r) {
+          idx_t const row = local2nbr_inds[r];
+          for(idx_t f=0; f < nfactors; ++f) {
+            matv[f+(row*nfactors)] = nbr2local_buf[f+(r*nfactors)];
+          }
+        }
+      } /* end recvs */
+    } /* end omp parallel */
+  }
+
+  /* the send buffer may be reused after this */
+  timer_start(&timers[TIMER_MPI_IDLE]);
+  MPI_Waitall(lsize, rinfo->send_reqs, MPI_STATUSES_IGNORE);
+  timer_stop(&timers[TIMER_MPI_IDLE]);
+}
+
+
+/**
+* @brief Begin exchanging updated factor rows with all MPI ranks in the same
+*        layer. This version accomplishes the communication with an
+*        MPI_Ialltoallv(). We pack and send globmats[mode] to the needing ranks
+*        and receive other ranks' globmats entries into nbr2local_buf. The
+*        exchange is completed by p_update_rows_all2all_finish().
+*
+* @param nbr2globs_buf Buffer at least as large as as there are rows to send
+*                      (for each rank). Must not be modified until the exchange
+*                      is finished.
+* @param nbr2local_buf Buffer at least as large as there are rows to receive.
+* @param globalmat Global factor matrix (owned by me) which is sent to ranks.
+* @param rinfo MPI rank information.
+* @param nfactors The number of columns in the factor matrices.
+* @param mode The mode to exchange along.
+*/
+static void p_update_rows_all2all_begin(
+  val_t * const nbr2globs_buf,
+  val_t * const nbr2local_buf,
+  matrix_t const * const globalmat,
+  rank_info * const rinfo,
+  idx_t const nfactors,
+  idx_t const mode)
+{
+  idx_t const m = mode;
+
+  /* first prepare all rows that I own and need to send */
+  p_pack_nbr2globs(nbr2globs_buf, globalmat, rinfo, nfactors, m);
+
+  /* grab ptr/disp from rinfo. nbr2local and local2nbr will have the same
+   * structure so we just reuse those */
+  int const * const restrict nbr2globs_ptr = rinfo->nbr2globs_ptr[m];
+  int const * const restrict nbr2local_ptr = rinfo->local2nbr_ptr[m];
+  int const * const restrict nbr2globs_disp = rinfo->nbr2globs_disp[m];
+  int const * const restrict nbr2local_disp = rinfo->local2nbr_disp[m];
+
+  /* exchange rows */
+  timer_start(&timers[TIMER_MPI_COMM]);
+  MPI_Ialltoallv(nbr2globs_buf, nbr2globs_ptr, nbr2globs_disp, SPLATT_MPI_VAL,
+                 nbr2local_buf, nbr2local_ptr, nbr2local_disp, SPLATT_MPI_VAL,
+                 rinfo->layer_comm[m], &(rinfo->update_req));
+  timer_stop(&timers[TIMER_MPI_COMM]);
+}
+
+
+/**
+* @brief Complete an exchange started by p_update_rows_all2all_begin().
+*
+* @param nbr2local_buf The receive buffer given to the matching begin call.
+* @param localmat Local factor matrix which receives updated values.
+* @param rinfo MPI rank information.
+* @param nfactors The number of columns in the factor matrices.
+* @param mode The mode to exchange along.
+*/
+static void p_update_rows_all2all_finish(
+  val_t const * const nbr2local_buf,
+  matrix_t * const localmat,
+  rank_info * const rinfo,
+  idx_t const nfactors,
+  idx_t const mode)
+{
+  /* wait for communication to complete */
+  timer_start(&timers[TIMER_MPI_IDLE]);
+  MPI_Wait(&(rinfo->update_req), MPI_STATUS_IGNORE);
+  timer_stop(&timers[TIMER_MPI_IDLE]);
+
+  /* now write incoming nbr2locals to my local matrix */
+  p_unpack_nbr2local(nbr2local_buf, localmat, rinfo, nfactors, mode);
+}
+
+
+/**
+* @brief Begin exchanging updated factor rows with the neighbors in
+*        rinfo->nbr_comm[mode]. This version uses the persistent neighborhood
+*        alltoallv from mpi_nbr_plan_init() when available, and
+*        MPI_Ineighbor_alltoallv() otherwise.
+*
+* @param nbr2globs_buf Buffer at least as large as as there are rows to send
+*                      (for each rank). Must be the buffer bound to the plan.
+* @param nbr2local_buf Buffer at least as large as there are rows to receive.
+*                      Must be the buffer bound to the plan.
+* @param globalmat Global factor matrix (owned by me) which is sent to ranks.
+* @param rinfo MPI rank information.
+* @param nfactors The number of columns in the factor matrices.
+* @param mode The mode to exchange along.
+*/
+static void p_update_rows_neighbor_begin(
+  val_t * const nbr2globs_buf,
+  val_t * const nbr2local_buf,
+  matrix_t const * const globalmat,
+  rank_info * const rinfo,
+  idx_t const nfactors,
+  idx_t const mode)
+{
+  idx_t const m = mode;
+
+  p_pack_nbr2globs(nbr2globs_buf, globalmat, rinfo, nfactors, m);
+
+  timer_start(&timers[TIMER_MPI_COMM]);
+  if(rinfo->nbr_update_req[m] != MPI_REQUEST_NULL) {
+    assert(nbr2globs_buf == rinfo->nbr_nbr2globs_buf);
+    assert(nbr2local_buf == rinfo->nbr_local2nbr_buf);
+    MPI_Start(&(rinfo->nbr_update_req[m]));
+  } else {
+    MPI_Ineighbor_alltoallv(
+        nbr2globs_buf, rinfo->nbr_nbr2globs_ptr[m],
+        rinfo->nbr_nbr2globs_disp[m], SPLATT_MPI_VAL,
+        nbr2local_buf, rinfo->nbr_local2nbr_ptr[m],
+        rinfo->nbr_local2nbr_disp[m], SPLATT_MPI_VAL,
+        rinfo->nbr_comm[m], &(rinfo->update_req));
+  }
+  timer_stop(&timers[TIMER_MPI_COMM]);
+}
+
+
+/**
+* @brief Complete an exchange started by p_update_rows_neighbor_begin().
+*
+* @param nbr2local_buf The receive buffer given to the matching begin call.
+* @param localmat Local factor matrix which receives updated values.
+* @param rinfo MPI rank information.
+* @param nfactors The number of columns in the factor matrices.
+* @param mode The mode to exchange along.
+*/
+static void p_update_rows_neighbor_finish(
+  val_t const * const nbr2local_buf,
+  matrix_t * const localmat,
+  rank_info * const rinfo,
+  idx_t const nfactors,
+  idx_t const mode)
+{
+  /* persistent requests stay allocated after completion */
+  MPI_Request * req = &(rinfo->update_req);
+  if(rinfo->nbr_update_req[mode] != MPI_REQUEST_NULL) {
+    req = &(rinfo->nbr_update_req[mode]);
+  }
+
+  timer_start(&timers[TIMER_MPI_IDLE]);
+  MPI_Wait(req, MPI_STATUS_IGNORE);
+  timer_stop(&timers[TIMER_MPI_IDLE]);
+
+  p_unpack_nbr2local(nbr2local_buf, localmat, rinfo, nfactors, mode);
+}
+
+
+/**
+* @brief Allocate the send and receive buffers of the row exchanges, sized by
+*        the largest exchange of any mode.
+*/
+static void p_alloc_comm_bufs(
+  rank_info const * const rinfo,
+  idx_t const nfactors,
+  val_t ** local2nbr_buf,
+  val_t ** nbr2globs_buf)
+{
+  idx_t maxlocal2nbr = 0;
+  idx_t maxnbr2globs = 0;
+  for(idx_t m=0; m < rinfo->nmodes; ++m) {
+    maxlocal2nbr = SS_MAX(maxlocal2nbr, rinfo->nlocal2nbr[m]);
+    maxnbr2globs = SS_MAX(maxnbr2globs, rinfo->nnbr2globs[m]);
+  }
+  maxlocal2nbr *= nfactors;
+  maxnbr2globs *= nfactors;
+
+  *local2nbr_buf = (val_t *) splatt_malloc(maxlocal2nbr * sizeof(val_t));
+  *nbr2globs_buf = (val_t *) splatt_malloc(maxnbr2globs * sizeof(val_t));
+}
+
+
+/**
+* @brief Find the modes which are replicated on every rank.
+*
+* @param[out] repl Marks the replicated modes.
+*
+* @return The length of the longest replicated mode, or 0.
+*/
+static idx_t p_find_replicated(
+  rank_info const * const rinfo,
+  double const * const opts,
+  bool * const repl)
+{
+  idx_t maxrepl = 0;
+  for(idx_t m=0; m < rinfo->nmodes; ++m) {
+    repl[m] = mpi_is_replicated(rinfo, m, opts);
+    if(repl[m]) {
+      maxrepl = SS_MAX(maxrepl, rinfo->global_dims[m]);
+    }
+  }
+  return maxrepl;
+}
+
+
+/**
+* @brief The MTTKRP of each mode, split by whether a nonzero reads a row of
+*        the previous mode's factor which I own. Those rows are local as soon
+*        as the previous mode's row exchange begins, so the first pass runs
+*        while neighbor rows are still in flight.
+*/
+typedef struct
+{
+  bool active[MAX_NMODES];   /** whether mode m's MTTKRP is split */
+  bool own_all[MAX_NMODES];  /** every nonzero reads owned rows */
+  splatt_csf own[MAX_NMODES];
+  splatt_csf nbr[MAX_NMODES];
+  splatt_mttkrp_ws * own_ws[MAX_NMODES];
+  splatt_mttkrp_ws * nbr_ws[MAX_NMODES];
+  matrix_t * partial;        /** output of the neighbor pass */
+  double * opts;             /** 'opts' with one CSF per part */
+} mttkrp_split;
+
+
+/**
+* @brief Expand a CSF tensor back into coordinate form.
+*
+* @param csf The tensor to expand.
+*
+* @return The nonzeros of 'csf', in the same coordinates.
+*/
+static sptensor_t * p_csf_to_coord(
+  splatt_csf const * const csf)
+{
+  idx_t const nmodes = csf->nmodes;
+  sptensor_t * tt = tt_alloc(csf->nnz, nmodes);
+  for(idx_t m=0; m < nmodes; ++m) {
+    tt->dims[m] = csf->dims[m];
+  }
+
+  idx_t offset = 0;
+  for(idx_t t=0; t < csf->ntiles; ++t) {
+    csf_sparsity const * const pt = csf->pt + t;
+    idx_t const nleaves = pt->nfibs[nmodes-1];
+    if(nleaves == 0) {
+      continue;
+    }
+
+    /* each node's id is copied to the range of leaves beneath it */
+    for(idx_t d=0; d < nmodes; ++d) {
+      idx_t * const ind = tt->ind[csf->dim_perm[d]] + offset;
+      for(idx_t f=0; f < pt->nfibs[d]; ++f) {
+        idx_t lo = f;
+        idx_t hi = f+1;
+        for(idx_t l=d; l < nmodes-1; ++l) {
+          lo = pt->fptr[l][lo];
+          hi = pt->fptr[l][hi];
+        }
+        idx_t const id = (pt->fids[d] == NULL) ? f : pt->fids[d][f];
+        for(idx_t n=lo; n < hi; ++n) {
+          ind[n] = id;
+        }
+      }
+    }
+    memcpy(tt->vals + offset, pt->vals, nleaves * sizeof(*(tt->vals)));
+    offset += nleaves;
+  }
+  assert(offset == csf->nnz);
+
+  return tt;
+}
+
+
+/**
+* @brief Build the split MTTKRP of every mode whose previous mode has rows in
+*        flight. A part which holds every nonzero reuses 'tensors' instead of
+*        a copy, and modes without any owned nonzeros are not split.
+*
+* @param[out] split The split to build.
+* @param tensors The CSF tensors used by mpi_cpd_als_iterate().
+* @param ws The MTTKRP workspace of 'tensors'.
+* @param repl Marks the replicated modes, which are never in flight.
+* @param rinfo MPI rank information.
+* @param nfactors The rank of the decomposition.
+* @param opts SPLATT options.
+*/
+static void p_split_init(
+  mttkrp_split * const split,
+  splatt_csf const * const tensors,
+  splatt_mttkrp_ws const * const ws,
+  bool const * const repl,
+  rank_info const * const rinfo,
+  idx_t const nfactors,
+  double const * const opts)
+{
+  idx_t const nmodes = tensors[0].nmodes;
+
+  split->opts = splatt_default_opts();
+  memcpy(split->opts, opts, SPLATT_OPTION_NOPTIONS * sizeof(*opts));
+  split->opts[SPLATT_OPTION_CSF_ALLOC] = SPLATT_CSF_ONEMODE;
 
-      /* first prepare all rows that I own and need to send */
-      #pragma omp for
-      for(int s=disp; s < disp+nsends; ++s) {
-        idx_t const row = nbr2globs_inds[s] - mat_start;
-        for(idx_t f=0; f < nfactors; ++f) {
-          nbr2globs_buf[f+(s*nfactors)] = gmatv[f+(row*nfactors)];
-        }
-      }
+  idx_t maxdim = 1;
+  for(idx_t m=0; m < nmodes; ++m) {
+    split->active[m] = false;
+    split->own_all[m] = false;
+    split->own_ws[m] = NULL;
+    split->nbr_ws[m] = NULL;
 
-      /* do the actual communication */
-      #pragma omp master
-      {
-        timer_start(&timers[TIMER_MPI_COMM]);
-        MPI_Isend(&(nbr2globs_buf[disp*nfactors]), nsends*nfactors, SPLATT_MPI_VAL,
-            pdest, 0, rinfo->layer_comm[m], &(rinfo->req));
-        timer_stop(&timers[TIMER_MPI_COMM]);
-      }
-    } /* end sends */
+    idx_t const prev = (m + nmodes - 1) % nmodes;
+    if(repl[prev]) {
+      continue;
+    }
 
-    /* RECVS */
-    for(int p=1; p < lsize; ++p) {
-      int const porig = (p + lrank) % lsize;
-      /* The number of rows to recv from porig */
-      int const nrecvs = rinfo->local2nbr_ptr[m][porig] / nfactors;
-      int const disp = rinfo->local2nbr_disp[m][porig] / nfactors;
+    /* the nonzeros which this mode's MTTKRP actually reads */
+    sptensor_t * tt = p_csf_to_coord(tensors + ws->mode_csf_map[m]);
+    idx_t const start = rinfo->ownstart[prev];
+    idx_t const end = start + rinfo->nowned[prev];
 
-      if(nrecvs == 0) {
-        continue;
+    idx_t nown = 0;
+    for(idx_t n=0; n < tt->nnz; ++n) {
+      if(tt->ind[prev][n] >= start && tt->ind[prev][n] < end) {
+        ++nown;
       }
+    }
 
-      /* wait for the actual communication */
-      #pragma omp master
-      {
-        timer_start(&timers[TIMER_MPI_COMM]);
-        MPI_Wait(rinfo->recv_reqs + porig, MPI_STATUS_IGNORE);
-        timer_stop(&timers[TIMER_MPI_COMM]);
+    if(nown == tt->nnz) {
+      split->active[m] = true;
+      split->own_all[m] = true;
+    } else if(nown > 0) {
+      sptensor_t * own = tt_alloc(nown, nmodes);
+      sptensor_t * nbr = tt_alloc(tt->nnz - nown, nmodes);
+      for(idx_t mm=0; mm < nmodes; ++mm) {
+        own->dims[mm] = tt->dims[mm];
+        nbr->dims[mm] = tt->dims[mm];
       }
-
-      /* wait until recv is done */
-      #pragma omp barrier
-
-      /* now write incoming nbr2locals to my local matrix */
-      #pragma omp for
-      for(int r=disp; r < disp + nrecvs; ++r) {
-        idx_t const row = local2nbr_inds[r];
-        for(idx_t f=0; f < nfactors; ++f) {
-          matv[f+(row*nfactors)] = nbr2local_buf[f+(r*nfactors)];
+      idx_t nextown = 0;
+      idx_t nextnbr = 0;
+      for(idx_t n=0; n < tt->nnz; ++n) {
+        bool const mine = tt->ind[prev][n] >= start && tt->ind[prev][n] < end;
+        sptensor_t * const dest = mine ? own : nbr;
+        idx_t const x = mine ? nextown++ : nextnbr++;
+        for(idx_t mm=0; mm < nmodes; ++mm) {
+          dest->ind[mm][x] = tt->ind[mm][n];
         }
+        dest->vals[x] = tt->vals[n];
       }
-    } /* end recvs */
-  } /* end omp parallel */
+
+      csf_alloc_mode(own, CSF_SORTED_MINUSONE, m, split->own + m,
+          split->opts);
+      csf_alloc_mode(nbr, CSF_SORTED_MINUSONE, m, split->nbr + m,
+          split->opts);
+      split->own_ws[m] = splatt_mttkrp_alloc_ws(split->own + m, nfactors,
+          split->opts);
+      split->nbr_ws[m] = splatt_mttkrp_alloc_ws(split->nbr + m, nfactors,
+          split->opts);
+      split->active[m] = true;
+      maxdim = SS_MAX(maxdim, tt->dims[m]);
+      tt_free(own);
+      tt_free(nbr);
+    }
+    tt_free(tt);
+  }
+
+  split->partial = mat_alloc(maxdim, nfactors);
 }
 
 
 /**
-* @brief Exchange updated factor rows with all MPI ranks in the same layer.
-*        This version accomplishes the communication with an MPI_Alltoallv().
-*        We send globmats[mode] to the needing ranks and receive other ranks'
-*        globmats entries which we store in mats[mode].
+* @brief Free the memory allocated by p_split_init().
 *
-* @param nbr2globs_buf Buffer at least as large as as there are rows to send
-*                      (for each rank).
-* @param nbr2local_buf Buffer at least as large as there are rows to receive.
-* @param localmat Local factor matrix which receives updated values.
-* @param globalmat Global factor matrix (owned by me) which is sent to ranks.
+* @param split The split to free.
+* @param nmodes The number of modes.
+*/
+static void p_split_free(
+  mttkrp_split * const split,
+  idx_t const nmodes)
+{
+  for(idx_t m=0; m < nmodes; ++m) {
+    if(split->own_ws[m] != NULL) {
+      splatt_mttkrp_free_ws(split->own_ws[m]);
+      splatt_mttkrp_free_ws(split->nbr_ws[m]);
+      csf_free_mode(split->own + m);
+      csf_free_mode(split->nbr + m);
+    }
+  }
+  mat_free(split->partial);
+  splatt_free_opts(split->opts);
+}
+
+
+/**
+* @brief Compute the MTTKRP of a mode while the previous mode's rows are in
+*        flight: first over the nonzeros which only read owned rows, then,
+*        once the exchange has finished, over the rest.
+*
+* @param split The split MTTKRP.
+* @param tensors The CSF tensors used by mpi_cpd_als_iterate().
+* @param ws The MTTKRP workspace of 'tensors'.
+* @param mats The local factors. The output is mats[MAX_NMODES].
+* @param mode The output mode.
+* @param inflight The mode whose rows are in flight.
+* @param lambda The column norms to divide the in-flight factor by, or NULL
+*               if its rows were sent normalized.
+* @param nbr2local_buf The buffer which receives neighbor rows.
 * @param rinfo MPI rank information.
-* @param nfactors The number of columns in the factor matrices.
-* @param mode The mode to exchange along.
+* @param nfactors The rank of the decomposition.
+* @param thds Thread structures.
+* @param opts SPLATT options.
 */
-static void p_update_rows_all2all(
-  val_t * const nbr2globs_buf,
-  val_t * const nbr2local_buf,
-  matrix_t * const localmat,
-  matrix_t * const globalmat,
+static void p_mttkrp_overlapped(
+  mttkrp_split const * const split,
+  splatt_csf const * const tensors,
+  splatt_mttkrp_ws * const ws,
+  matrix_t ** mats,
+  idx_t const mode,
+  idx_t const inflight,
+  val_t const * const lambda,
+  val_t const * const nbr2local_buf,
   rank_info * const rinfo,
   idx_t const nfactors,
-  idx_t const mode)
+  thd_info * const thds,
+  double const * const opts)
 {
   idx_t const m = mode;
-  idx_t const mat_start = rinfo->mat_start[m];
-  idx_t const * const nbr2globs_inds = rinfo->nbr2globs_inds[m];
-  idx_t const * const local2nbr_inds = rinfo->local2nbr_inds[m];
-  val_t const * const gmatv = globalmat->vals;
+  matrix_t * const out = mats[MAX_NMODES];
+  matrix_t * const A = mats[inflight];
+  idx_t const ownstart = rinfo->ownstart[inflight];
+  idx_t const ownend = ownstart + rinfo->nowned[inflight];
+
+  /* owned rows were flushed when the exchange began */
+  if(lambda != NULL) {
+    p_normalize_local(A, lambda, ownstart, ownend);
+  }
 
-  #pragma omp parallel
-  {
-    /* first prepare all rows that I own and need to send */
-    #pragma omp for
-    for(idx_t s=0; s < rinfo->nnbr2globs[m]; ++s) {
-      idx_t const row = nbr2globs_inds[s] - mat_start;
-      for(idx_t f=0; f < nfactors; ++f) {
-        nbr2globs_buf[f+(s*nfactors)] = gmatv[f+(row*nfactors)];
-      }
-    }
+  timer_start(&timers[TIMER_MTTKRP]);
+  if(split->own_all[m]) {
+    mttkrp_csf(tensors, mats, m, thds, ws, opts);
+  } else {
+    mttkrp_csf(split->own + m, mats, m, thds, split->own_ws[m], split->opts);
+  }
+  timer_stop(&timers[TIMER_MTTKRP]);
 
-    #pragma omp master
-    {
-      /* grab ptr/disp from rinfo. nbr2local and local2nbr will have the same
-       * structure so we just reuse those */
-      int const * const restrict nbr2globs_ptr = rinfo->nbr2globs_ptr[m];
-      int const * const restrict nbr2local_ptr = rinfo->local2nbr_ptr[m];
-      int const * const restrict nbr2globs_disp = rinfo->nbr2globs_disp[m];
-      int const * const restrict nbr2local_disp = rinfo->local2nbr_disp[m];
-
-      /* exchange rows */
-      timer_start(&timers[TIMER_MPI_COMM]);
-      MPI_Alltoallv(nbr2globs_buf, nbr2globs_ptr, nbr2globs_disp, SPLATT_MPI_VAL,
-                    nbr2local_buf, nbr2local_ptr, nbr2local_disp, SPLATT_MPI_VAL,
-                    rinfo->layer_comm[m]);
-      timer_stop(&timers[TIMER_MPI_COMM]);
-    }
-
-    /* wait for communication to complete */
-    #pragma omp barrier
+  mpi_update_rows_finish(nbr2local_buf, A, rinfo, nfactors, inflight,
+      opts[SPLATT_OPTION_COMM]);
+  if(lambda != NULL) {
+    p_normalize_local(A, lambda, 0, ownstart);
+    p_normalize_local(A, lambda, ownend, A->I);
+  }
 
-    /* now write incoming nbr2locals to my local matrix */
-    val_t * const matv = localmat->vals;
-    #pragma omp for
-    for(idx_t r=0; r < rinfo->nlocal2nbr[m]; ++r) {
-      idx_t const row = local2nbr_inds[r];
-      for(idx_t f=0; f < nfactors; ++f) {
-        matv[f+(row*nfactors)] = nbr2local_buf[f+(r*nfactors)];
-      }
-    }
-  } /* end omp parallel */
+  if(split->own_all[m]) {
+    return;
+  }
+
+  /* the rest goes to a second buffer and is added to the first pass */
+  timer_start(&timers[TIMER_MTTKRP]);
+  mats[MAX_NMODES] = split->partial;
+  mttkrp_csf(split->nbr + m, mats, m, thds, split->nbr_ws[m], split->opts);
+  mats[MAX_NMODES] = out;
+
+  val_t * const restrict outv = out->vals;
+  val_t const * const restrict partv = split->partial->vals;
+  idx_t const nvals = out->I * out->J;
+  #pragma omp parallel for schedule(static)
+  for(idx_t x=0; x < nvals; ++x) {
+    outv[x] += partv[x];
+  }
+  timer_stop(&timers[TIMER_MTTKRP]);
 }
 
 
@@ -625,14 +1664,16 @@ static void p_update_rows_all2all(
  *****************************************************************************/
 
 double mpi_cpd_als_iterate(
-  splatt_csf const * const tensors,
+  splatt_csf const * tensors,
   matrix_t ** mats,
   matrix_t ** globmats,
   val_t * const lambda,
   idx_t const nfactors,
   rank_info * const rinfo,
-  double const * const opts)
+  double const * const opts,
+  mpi_cpd_hook const * const hook)
 {
+  splatt_mem_tag const prev_tag = mem_tag_begin(SPLATT_MEM_MPI);
   idx_t const nmodes = tensors[0].nmodes;
   idx_t const nthreads = (idx_t) opts[SPLATT_OPTION_NTHREADS];
 
@@ -647,20 +1688,42 @@ double mpi_cpd_als_iterate(
 
   /* Extract MPI communication structures */
   idx_t maxdim = 0;
-  idx_t maxlocal2nbr = 0;
-  idx_t maxnbr2globs = 0;
   for(idx_t m=0; m < nmodes; ++m) {
-    maxlocal2nbr = SS_MAX(maxlocal2nbr, rinfo->nlocal2nbr[m]);
-    maxnbr2globs = SS_MAX(maxnbr2globs, rinfo->nnbr2globs[m]);
     maxdim = SS_MAX(globmats[m]->I, maxdim);
   }
-  maxlocal2nbr *= nfactors;
-  maxnbr2globs *= nfactors;
 
-  val_t * local2nbr_buf = (val_t *) splatt_malloc(maxlocal2nbr * sizeof(val_t));
-  val_t * nbr2globs_buf = (val_t *) splatt_malloc(maxnbr2globs * sizeof(val_t));
-  if(rinfo->decomp != SPLATT_DECOMP_COARSE) {
-    m1 = mat_alloc(maxdim, nfactors);
+  val_t * local2nbr_buf;
+  val_t * nbr2globs_buf;
+  p_alloc_comm_bufs(rinfo, nfactors, &local2nbr_buf, &nbr2globs_buf);
+  m1 = mat_alloc(maxdim, nfactors);
+  if(opts[SPLATT_OPTION_COMM] == SPLATT_COMM_NEIGHBOR) {
+    mpi_nbr_plan_init(local2nbr_buf, nbr2globs_buf, rinfo);
+  }
+  if(opts[SPLATT_OPTION_COMM_THREADS] > 0) {
+    if(opts[SPLATT_OPTION_COMM] != SPLATT_COMM_POINT2POINT) {
+      if(rinfo->rank == 0) {
+        fprintf(stderr, "SPLATT: threaded communication needs point-to-point "
+                        "exchanges, only the master thread will "
+                        "communicate.\n");
+      }
+    } else if(rinfo->thread_level == MPI_THREAD_MULTIPLE) {
+      rinfo->comm_threads = true;
+      p_reduce_plan_init(rinfo);
+    } else if(rinfo->rank == 0) {
+      fprintf(stderr, "SPLATT: MPI_THREAD_MULTIPLE is not available, only "
+                      "the master thread will communicate.\n");
+    }
+  }
+
+  mpi_compress_init(rinfo, nfactors, opts);
+
+  bool const fuse = opts[SPLATT_OPTION_FUSE_REDUCE] > 0;
+  if(fuse) {
+    mpi_fused_init(rinfo, nfactors);
+  }
+  if(opts[SPLATT_OPTION_NODE_REDUCE] > 0) {
+    /* the fused buffer is the largest reduction, followed by the Gram */
+    mpi_node_init(rinfo, mpi_fused_size(nfactors));
   }
 
   /* Exchange initial matrices */
@@ -671,6 +1734,14 @@ double mpi_cpd_als_iterate(
 
   matrix_t * m1ptr = m1; /* for restoring m1 */
 
+  /* short modes are replicated and skip the row exchanges entirely */
+  bool repl[MAX_NMODES];
+  idx_t maxrepl = p_find_replicated(rinfo, opts, repl);
+  matrix_t * replmat = NULL;
+  if(maxrepl > 0) {
+    replmat = mat_alloc(maxrepl, nfactors);
+  }
+
   /* Initialize first A^T * A mats. We redundantly do the first because it
    * makes communication easier. */
   matrix_t * aTa[MAX_NMODES+1];
@@ -684,6 +1755,10 @@ double mpi_cpd_als_iterate(
   /* mttkrp workspace */
   splatt_mttkrp_ws * mttkrp_ws = splatt_mttkrp_alloc_ws(tensors,nfactors,opts);
 
+  /* MTTKRPs which start before the previous factor's rows arrive */
+  mttkrp_split split;
+  p_split_init(&split, tensors, mttkrp_ws, repl, rinfo, nfactors, opts);
+
   /* Compute input tensor norm */
   double oldfit = 0;
   double fit = 0;
@@ -694,25 +1769,96 @@ double mpi_cpd_als_iterate(
 
   /* setup timers */
   p_reset_cpd_timers(rinfo);
+  rinfo->wire_bytes = 0;
+  double lastbytes = 0;
+  idx_t nits = 0;
   sp_timer_t itertime;
   sp_timer_t modetime[MAX_NMODES];
   timer_start(&timers[TIMER_CPD]);
+  double const cpd_start = monotonic_seconds();
+
+  /* each rank reports the rows it owns, globally and in distributed order */
+  splatt_cpd_progress progress;
+  progress.rank = nfactors;
+  progress.nmodes = nmodes;
+  progress.lambda = lambda;
+  for(idx_t m=0; m < nmodes; ++m) {
+    progress.dims[m] = globmats[m]->I;
+    progress.row_start[m] = rinfo->layer_starts[m] + rinfo->mat_start[m];
+    progress.factors[m] = globmats[m]->vals;
+  }
+  /* reductions of rounded partial products are not exact */
+  bool const rounded = rinfo->compress != NULL &&
+      rinfo->compress->precision != SPLATT_PRECISION_FULL;
+
+  /* voting to stop costs an allreduce, so only do it if anyone can vote */
+  bool const can_stop = cpd_has_stop_rule(opts);
 
   idx_t const niters = (idx_t) opts[SPLATT_OPTION_NITER];
+  /* The row exchange of each mode is left in flight until the factor is
+   * next read by an MTTKRP. -1 means nothing is outstanding. */
+  idx_t const noupdate = (idx_t) -1;
+  idx_t inflight = noupdate;
+  /* fused modes send their rows before normalization */
+  bool inflight_scaled = false;
+
   for(idx_t it=0; it < niters; ++it) {
     timer_fstart(&itertime);
+    /* set when the last mode's fused reduction already computed <X,Z> */
+    val_t fused_inner = 0;
+    val_t const * inner_ptr = NULL;
+    /* set when m1 was summed from rounded partial products */
+    bool rounded_m1 = false;
     for(idx_t m=0; m < nmodes; ++m) {
       timer_fstart(&modetime[m]);
       mats[MAX_NMODES]->I = tensors[0].dims[m];
 
       /* M1 = X * (C o B) */
-      timer_start(&timers[TIMER_MTTKRP]);
-      mttkrp_csf(tensors, mats, m, thds, mttkrp_ws, opts);
-      timer_stop(&timers[TIMER_MTTKRP]);
+      if(inflight != noupdate && split.active[m]) {
+        /* only the last updated factor is incomplete */
+        assert(inflight == (m + nmodes - 1) % nmodes);
+        p_mttkrp_overlapped(&split, tensors, mttkrp_ws, mats, m, inflight,
+            inflight_scaled ? lambda : NULL, local2nbr_buf, rinfo, nfactors,
+            thds, opts);
+        inflight = noupdate;
+      } else {
+        /* MTTKRP needs every neighbor row of the last updated factor */
+        if(inflight != noupdate) {
+          mpi_update_rows_finish(local2nbr_buf, mats[inflight], rinfo,
+              nfactors, inflight, opts[SPLATT_OPTION_COMM]);
+          if(inflight_scaled) {
+            p_normalize_local(mats[inflight], lambda, 0, mats[inflight]->I);
+          }
+          inflight = noupdate;
+        }
+
+        timer_start(&timers[TIMER_MTTKRP]);
+        mttkrp_csf(tensors, mats, m, thds, mttkrp_ws, opts);
+        timer_stop(&timers[TIMER_MTTKRP]);
+      }
 
       m1->I = globmats[m]->I;
       m1ptr->I = globmats[m]->I;
 
+      if(repl[m]) {
+        /* one allreduce and a redundant solve of the full factor */
+        m1 = m1ptr;
+        /* m1 may have aliased the MTTKRP output and shrunk it to owned rows */
+        mats[MAX_NMODES]->I = tensors[0].dims[m];
+        p_reduce_replicated(mats[MAX_NMODES], replmat, m1, rinfo, nfactors, m);
+        mat_solve_normals(m, nmodes, aTa, replmat,
+            opts[SPLATT_OPTION_REGULARIZE]);
+        if(it == 0) {
+          mat_normalize(replmat, lambda, MAT_NORM_2, NULL, thds, nthreads);
+        } else {
+          mat_normalize(replmat, lambda, MAT_NORM_MAX, NULL, thds, nthreads);
+        }
+        p_flush_replicated(replmat, mats[m], globmats[m], rinfo, nfactors, m);
+        mat_aTa(replmat, aTa[m], NULL, thds, nthreads);
+        timer_stop(&modetime[m]);
+        continue;
+      }
+
       if(rinfo->decomp != SPLATT_DECOMP_COARSE && rinfo->layer_size[m] > 1) {
         m1 = m1ptr;
         /* add my partial multiplications to globmats[m] */
@@ -721,6 +1867,12 @@ double mpi_cpd_als_iterate(
         /* incorporate neighbors' partials */
         mpi_reduce_rows(local2nbr_buf, nbr2globs_buf, mats[MAX_NMODES], m1,
             rinfo, nfactors, m, opts[SPLATT_OPTION_COMM]);
+        rounded_m1 = rounded && (m == nmodes - 1);
+      } else if(rinfo->decomp == SPLATT_DECOMP_COARSE) {
+        /* the MTTKRP only produced the rows of my slab which have nonzeros */
+        m1 = m1ptr;
+        p_scatter_owned(rinfo->indmap[m], mats[MAX_NMODES]->vals, m1, rinfo,
+            nfactors, m);
       } else {
         /* skip the whole process */
         m1 = mats[MAX_NMODES];
@@ -731,24 +1883,99 @@ double mpi_cpd_als_iterate(
       mat_solve_normals(m, nmodes, aTa, globmats[m],
           opts[SPLATT_OPTION_REGULARIZE]);
 
-      /* normalize columns and extract lambda */
-      if(it == 0) {
-        mat_normalize(globmats[m], lambda, MAT_NORM_2, rinfo, thds, nthreads);
-      } else {
-        mat_normalize(globmats[m], lambda, MAT_NORM_MAX, rinfo, thds,nthreads);
+      splatt_mat_norm const which = (it == 0) ? MAT_NORM_2 : MAT_NORM_MAX;
+
+      /* every rank must see the same rows, including the lambda and A^T*A
+       * computed from them */
+      if(rinfo->compress != NULL) {
+        mpi_compress_prepare(globmats[m], rinfo, m);
+      }
+
+      if(fuse) {
+        /* one reduction for lambda, A^T*A, and (last mode) the fit */
+        bool const fitmode = (m == nmodes - 1) && !rounded_m1;
+        mpi_fused_begin(globmats[m], fitmode ? m1 : NULL, aTa[m], which,
+            rinfo, thds, nthreads);
+
+        /* unnormalized rows go out while the reduction is in flight */
+        mpi_update_rows_begin(rinfo->indmap[m], nbr2globs_buf, local2nbr_buf,
+            mats[m], globmats[m], rinfo, nfactors, m,
+            opts[SPLATT_OPTION_COMM]);
+        inflight = m;
+        inflight_scaled = true;
+
+        mpi_fused_finish(globmats[m], aTa[m], lambda,
+            fitmode ? &fused_inner : NULL, rinfo);
+        if(fitmode) {
+          inner_ptr = &fused_inner;
+        }
+        timer_stop(&modetime[m]);
+        continue;
       }
 
-      /* send updated rows to neighbors */
-      mpi_update_rows(rinfo->indmap[m], nbr2globs_buf, local2nbr_buf, mats[m],
-          globmats[m], rinfo, nfactors, m, opts[SPLATT_OPTION_COMM]);
+      if(rinfo->compress != NULL) {
+        /* neighbors keep the rows which were not resent, so they rescale
+         * every row by the new lambda */
+        mpi_update_rows_begin(rinfo->indmap[m], nbr2globs_buf, local2nbr_buf,
+            mats[m], globmats[m], rinfo, nfactors, m,
+            opts[SPLATT_OPTION_COMM]);
+        inflight = m;
+        inflight_scaled = true;
+
+        mat_normalize(globmats[m], lambda, which, rinfo, thds, nthreads);
+      } else {
+        /* normalize columns and extract lambda */
+        mat_normalize(globmats[m], lambda, which, rinfo, thds, nthreads);
+
+        /* send updated rows to neighbors */
+        mpi_update_rows_begin(rinfo->indmap[m], nbr2globs_buf, local2nbr_buf,
+            mats[m], globmats[m], rinfo, nfactors, m,
+            opts[SPLATT_OPTION_COMM]);
+        inflight = m;
+        inflight_scaled = false;
+      }
 
-      /* update A^T*A */
+      /* update A^T*A while rows are in flight -- only owned rows are used */
       mat_aTa(globmats[m], aTa[m], rinfo, thds, nthreads);
       timer_stop(&modetime[m]);
     } /* foreach mode */
 
-    fit = p_calc_fit(nmodes, rinfo, thds, ttnormsq, lambda, globmats, m1, aTa);
+    if(rounded_m1) {
+      /* <X,Z> from my exact partial products and the local factors, which
+       * needs the last mode's rows now */
+      mpi_update_rows_finish(local2nbr_buf, mats[inflight], rinfo, nfactors,
+          inflight, opts[SPLATT_OPTION_COMM]);
+      if(inflight_scaled) {
+        p_normalize_local(mats[inflight], lambda, 0, mats[inflight]->I);
+      }
+      inflight = noupdate;
+      fit = p_calc_fit(nmodes, rinfo, thds, ttnormsq, lambda, mats,
+          mats[MAX_NMODES], aTa, NULL);
+    } else {
+      fit = p_calc_fit(nmodes, rinfo, thds, ttnormsq, lambda, globmats, m1,
+          aTa, inner_ptr);
+    }
     timer_stop(&itertime);
+    ++nits;
+
+    metrics_record("cpd", "fit", it, -1, -1, fit);
+    metrics_record("cpd", "seconds", it, -1, -1, itertime.seconds);
+    for(idx_t m=0; m < nmodes; ++m) {
+      metrics_record("cpd", "mode_seconds", it, m, -1, modetime[m].seconds);
+    }
+
+    /* bytes of factor rows sent this iteration, summed over ranks */
+    double itbytes = 0;
+    if(opts[SPLATT_OPTION_VERBOSITY] > SPLATT_VERBOSITY_LOW ||
+        metrics_enabled()) {
+      double const mybytes = rinfo->wire_bytes - lastbytes;
+      lastbytes = rinfo->wire_bytes;
+      MPI_Reduce(&mybytes, &itbytes, 1, MPI_DOUBLE, MPI_SUM, 0,
+          rinfo->comm_3d);
+      if(rinfo->rank == 0) {
+        metrics_record("mpi", "bytes_sent", it, -1, -1, itbytes);
+      }
+    }
 
     if(rinfo->rank == 0 &&
         opts[SPLATT_OPTION_VERBOSITY] > SPLATT_VERBOSITY_NONE) {
@@ -759,20 +1986,149 @@ double mpi_cpd_als_iterate(
           printf("     mode = %1"SPLATT_PF_IDX" (%0.3fs)\n", m+1,
               modetime[m].seconds);
         }
+        printf("     rows sent = %0.3fMB per rank\n",
+            itbytes / rinfo->npes / (1024. * 1024.));
+      }
+    }
+
+    progress.iteration = it;
+    progress.fit = fit;
+    progress.seconds = itertime.seconds;
+    progress.elapsed = monotonic_seconds() - cpd_start;
+    for(idx_t m=0; m < nmodes; ++m) {
+      progress.mode_seconds[m] = modetime[m].seconds;
+    }
+    /* all ranks stop together if any of them asks to */
+    if(can_stop) {
+      int mystop = cpd_should_stop(&progress, opts);
+      int stop = 0;
+      MPI_Allreduce(&mystop, &stop, 1, MPI_INT, MPI_LOR, rinfo->comm_3d);
+      if(stop) {
+        break;
       }
     }
+
     if(it > 0 && fabs(fit - oldfit) < opts[SPLATT_OPTION_TOLERANCE]) {
       break;
     }
     oldfit = fit;
+
+    if(hook == NULL || it+1 != hook->after_its || it+1 == niters) {
+      continue;
+    }
+
+    /* the hook may rebuild the row exchanges, so none can be in flight */
+    if(inflight != noupdate) {
+      mpi_update_rows_finish(local2nbr_buf, mats[inflight], rinfo, nfactors,
+          inflight, opts[SPLATT_OPTION_COMM]);
+      if(inflight_scaled) {
+        p_normalize_local(mats[inflight], lambda, 0, mats[inflight]->I);
+      }
+      inflight = noupdate;
+    }
+    if(opts[SPLATT_OPTION_COMM] == SPLATT_COMM_NEIGHBOR) {
+      mpi_nbr_plan_free(rinfo);
+    }
+    if(rinfo->comm_threads) {
+      p_reduce_plan_free(rinfo);
+    }
+
+    rinfo->mttkrp_seconds = timers[TIMER_MTTKRP].seconds;
+    splatt_csf const * const newtensors = hook->func(mats, globmats, rinfo,
+        hook->data);
+    if(newtensors != NULL) {
+      tensors = newtensors;
+      /* m1 may alias the old MTTKRP output, and owned rows may have moved */
+      maxdim = 0;
+      for(idx_t m=0; m < nmodes; ++m) {
+        maxdim = SS_MAX(globmats[m]->I, maxdim);
+      }
+      mat_free(m1ptr);
+      m1ptr = mat_alloc(maxdim, nfactors);
+      m1 = m1ptr;
+      splatt_mttkrp_free_ws(mttkrp_ws);
+      mttkrp_ws = splatt_mttkrp_alloc_ws(tensors, nfactors, opts);
+      p_split_free(&split, nmodes);
+
+      splatt_free(local2nbr_buf);
+      splatt_free(nbr2globs_buf);
+      p_alloc_comm_bufs(rinfo, nfactors, &local2nbr_buf, &nbr2globs_buf);
+
+      /* new layers may change which modes are replicated */
+      if(replmat != NULL) {
+        mat_free(replmat);
+        replmat = NULL;
+      }
+      maxrepl = p_find_replicated(rinfo, opts, repl);
+      if(maxrepl > 0) {
+        replmat = mat_alloc(maxrepl, nfactors);
+      }
+      p_split_init(&split, tensors, mttkrp_ws, repl, rinfo, nfactors, opts);
+      for(idx_t m=0; m < nmodes; ++m) {
+        progress.row_start[m] = rinfo->layer_starts[m] + rinfo->mat_start[m];
+      }
+
+      /* the compressed history is per row of the old exchanges */
+      mpi_compress_free(rinfo);
+      mpi_compress_init(rinfo, nfactors, opts);
+    }
+    if(opts[SPLATT_OPTION_COMM] == SPLATT_COMM_NEIGHBOR) {
+      mpi_nbr_plan_init(local2nbr_buf, nbr2globs_buf, rinfo);
+    }
+    if(rinfo->comm_threads) {
+      p_reduce_plan_init(rinfo);
+    }
+
+    /* fill the new local factors, which may round the owned rows again */
+    if(newtensors != NULL) {
+      for(idx_t m=1; m < nmodes; ++m) {
+        mpi_update_rows(rinfo->indmap[m], nbr2globs_buf, local2nbr_buf,
+            mats[m], globmats[m], rinfo, nfactors, m,
+            opts[SPLATT_OPTION_COMM]);
+        if(rinfo->compress != NULL) {
+          mat_aTa(globmats[m], aTa[m], rinfo, thds, nthreads);
+        }
+      }
+    }
+  }
+  /* local factors must be complete for the caller */
+  if(inflight != noupdate) {
+    mpi_update_rows_finish(local2nbr_buf, mats[inflight], rinfo, nfactors,
+        inflight, opts[SPLATT_OPTION_COMM]);
+    if(inflight_scaled) {
+      p_normalize_local(mats[inflight], lambda, 0, mats[inflight]->I);
+    }
   }
   timer_stop(&timers[TIMER_CPD]);
+  record_times();
 
   if(rinfo->rank == 0 &&
       opts[SPLATT_OPTION_VERBOSITY] > SPLATT_VERBOSITY_NONE) {
     printf("Final fit: %0.5f\n", fit);
   }
 
+  /* bytes on the wire, to compare compressed and full-precision exchanges */
+  bool const print_bytes = opts[SPLATT_OPTION_VERBOSITY] > SPLATT_VERBOSITY_LOW ||
+      (rinfo->compress != NULL &&
+       opts[SPLATT_OPTION_VERBOSITY] > SPLATT_VERBOSITY_NONE);
+  if(print_bytes || metrics_enabled()) {
+    double const mybytes = rinfo->wire_bytes / SS_MAX(nits, 1);
+    double avgbytes;
+    double maxbytes;
+    MPI_Reduce(&mybytes, &avgbytes, 1, MPI_DOUBLE, MPI_SUM, 0, rinfo->comm_3d);
+    MPI_Reduce(&mybytes, &maxbytes, 1, MPI_DOUBLE, MPI_MAX, 0, rinfo->comm_3d);
+    if(rinfo->rank == 0) {
+      metrics_set("mpi", "bytes_per_iter_avg", -1, -1, -1,
+          avgbytes / rinfo->npes);
+      metrics_set("mpi", "bytes_per_iter_max", -1, -1, -1, maxbytes);
+    }
+    if(rinfo->rank == 0 && print_bytes) {
+      printf("Rows sent per iteration: %0.3fMB avg, %0.3fMB max\n",
+          avgbytes / rinfo->npes / (1024. * 1024.),
+          maxbytes / (1024. * 1024.));
+    }
+  }
+
   /* POST PROCESSING */
   /* normalize each mat and adjust lambda */
   val_t * tmp = (val_t *) splatt_malloc(nfactors * sizeof(val_t));
@@ -782,28 +2138,59 @@ double mpi_cpd_als_iterate(
       lambda[f] *= tmp[f];
     }
   }
-  free(tmp);
+  splatt_free(tmp);
 
   /* CLEAN UP */
   splatt_mttkrp_free_ws(mttkrp_ws);
+  p_split_free(&split, nmodes);
   for(idx_t m=0; m < nmodes; ++m) {
     mat_free(aTa[m]);
   }
   mat_free(aTa[MAX_NMODES]);
 
   thd_free(thds, nthreads);
-  if(rinfo->decomp != SPLATT_DECOMP_COARSE) {
-    mat_free(m1ptr);
+  mat_free(m1ptr);
+  if(replmat != NULL) {
+    mat_free(replmat);
+  }
+  if(opts[SPLATT_OPTION_COMM] == SPLATT_COMM_NEIGHBOR) {
+    mpi_nbr_plan_free(rinfo);
   }
-  free(local2nbr_buf);
-  free(nbr2globs_buf);
+  mpi_node_free(rinfo);
+  if(rinfo->comm_threads) {
+    p_reduce_plan_free(rinfo);
+  }
+  rinfo->comm_threads = false;
+  mpi_fused_free(rinfo);
+  mpi_compress_free(rinfo);
+  splatt_free(local2nbr_buf);
+  splatt_free(nbr2globs_buf);
 
+  rinfo->mttkrp_seconds = timers[TIMER_MTTKRP].seconds;
   mpi_time_stats(rinfo);
 
+  mem_tag_end(prev_tag);
   return fit;
 }
 
 
+bool mpi_is_replicated(
+  rank_info const * const rinfo,
+  idx_t const mode,
+  double const * const opts)
+{
+  /* other decompositions do not split modes into layers */
+  if(rinfo->decomp != SPLATT_DECOMP_MEDIUM || rinfo->layer_size[mode] == 1) {
+    return false;
+  }
+
+  idx_t const length = rinfo->global_dims[mode];
+  double const thresh = opts[SPLATT_OPTION_REPLTHRESH];
+
+  return (double)(length * rinfo->npes) <= (thresh * (double)rinfo->global_nnz);
+}
+
+
 void mpi_update_rows(
   idx_t const * const indmap,
   val_t * const nbr2globs_buf,
@@ -814,23 +2201,94 @@ void mpi_update_rows(
   idx_t const nfactors,
   idx_t const mode,
   splatt_comm_type const which)
+{
+  mpi_update_rows_begin(indmap, nbr2globs_buf, nbr2local_buf, localmat,
+      globalmat, rinfo, nfactors, mode, which);
+  mpi_update_rows_finish(nbr2local_buf, localmat, rinfo, nfactors, mode,
+      which);
+}
+
+
+void mpi_update_rows_begin(
+  idx_t const * const indmap,
+  val_t * const nbr2globs_buf,
+  val_t * const nbr2local_buf,
+  matrix_t * const localmat,
+  matrix_t * const globalmat,
+  rank_info * const rinfo,
+  idx_t const nfactors,
+  idx_t const mode,
+  splatt_comm_type const which)
+{
+  timer_start(&timers[TIMER_MPI_UPDATE]);
+  trace_begin("mpi update", mode);
+
+  if(rinfo->compress != NULL) {
+    mpi_compress_update_begin(globalmat, rinfo, mode);
+  } else {
+    rinfo->wire_bytes += rinfo->nnbr2globs[mode] * nfactors * sizeof(val_t);
+
+    switch(which) {
+    case SPLATT_COMM_POINT2POINT:
+      p_update_rows_point2point_begin(nbr2globs_buf, nbr2local_buf, globalmat,
+          rinfo, nfactors, mode);
+      break;
+
+    case SPLATT_COMM_ALL2ALL:
+      p_update_rows_all2all_begin(nbr2globs_buf, nbr2local_buf, globalmat,
+          rinfo, nfactors, mode);
+      break;
+
+    case SPLATT_COMM_NEIGHBOR:
+      p_update_rows_neighbor_begin(nbr2globs_buf, nbr2local_buf, globalmat,
+          rinfo, nfactors, mode);
+      break;
+    }
+  }
+
+  /* Owned rows are disjoint from those in flight, so the local matrix can be
+   * brought up to date while we wait. */
+  p_flush_glob_to_local(indmap, localmat, globalmat, rinfo, nfactors, mode);
+  trace_end();
+  timer_stop(&timers[TIMER_MPI_UPDATE]);
+}
+
+
+void mpi_update_rows_finish(
+  val_t const * const nbr2local_buf,
+  matrix_t * const localmat,
+  rank_info * const rinfo,
+  idx_t const nfactors,
+  idx_t const mode,
+  splatt_comm_type const which)
 {
   timer_start(&timers[TIMER_MPI_UPDATE]);
+  trace_begin("mpi update wait", mode);
+
+  if(rinfo->compress != NULL) {
+    mpi_compress_update_finish(localmat, rinfo, mode);
+    trace_end();
+    timer_stop(&timers[TIMER_MPI_UPDATE]);
+    return;
+  }
 
   switch(which) {
   case SPLATT_COMM_POINT2POINT:
-    p_update_rows_point2point(nbr2globs_buf, nbr2local_buf, localmat,
-        globalmat, rinfo, nfactors, mode);
+    p_update_rows_point2point_finish(nbr2local_buf, localmat, rinfo, nfactors,
+        mode);
     break;
 
   case SPLATT_COMM_ALL2ALL:
-    p_update_rows_all2all(nbr2globs_buf, nbr2local_buf, localmat, globalmat,
-        rinfo, nfactors, mode);
+    p_update_rows_all2all_finish(nbr2local_buf, localmat, rinfo, nfactors,
+        mode);
     break;
-  }
 
-  /* ensure the local matrix is up to date too */
-  p_flush_glob_to_local(indmap, localmat, globalmat, rinfo, nfactors, mode);
+  case SPLATT_COMM_NEIGHBOR:
+    p_update_rows_neighbor_finish(nbr2local_buf, localmat, rinfo, nfactors,
+        mode);
+    break;
+  }
+  trace_end();
   timer_stop(&timers[TIMER_MPI_UPDATE]);
 }
 
@@ -846,18 +2304,38 @@ void mpi_reduce_rows(
   splatt_comm_type const which)
 {
   timer_start(&timers[TIMER_MPI_REDUCE]);
+  trace_begin("mpi reduce", mode);
+
+  if(rinfo->compress != NULL) {
+    mpi_compress_reduce(localmat, globalmat, rinfo, mode);
+    trace_end();
+    timer_stop(&timers[TIMER_MPI_REDUCE]);
+    return;
+  }
+  rinfo->wire_bytes += rinfo->nlocal2nbr[mode] * nfactors * sizeof(val_t);
 
   switch(which) {
   case SPLATT_COMM_POINT2POINT:
-    p_reduce_rows_point2point(local2nbr_buf, nbr2globs_buf, localmat,
-        globalmat, rinfo, nfactors, mode);
+    if(rinfo->comm_threads) {
+      p_reduce_rows_point2point_threaded(local2nbr_buf, nbr2globs_buf,
+          localmat, globalmat, rinfo, nfactors, mode);
+    } else {
+      p_reduce_rows_point2point(local2nbr_buf, nbr2globs_buf, localmat,
+          globalmat, rinfo, nfactors, mode);
+    }
     break;
 
   case SPLATT_COMM_ALL2ALL:
     p_reduce_rows_all2all(local2nbr_buf, nbr2globs_buf, localmat, globalmat,
         rinfo, nfactors, mode);
     break;
+
+  case SPLATT_COMM_NEIGHBOR:
+    p_reduce_rows_neighbor(local2nbr_buf, nbr2globs_buf, localmat, globalmat,
+        rinfo, nfactors, mode);
+    break;
   }
+  trace_end();
   timer_stop(&timers[TIMER_MPI_REDUCE]);
 }
 
@@ -871,21 +2349,8 @@ void mpi_add_my_partials(
   idx_t const mode)
 {
   timer_start(&timers[TIMER_MPI_PARTIALS]);
-  idx_t const m = mode;
-
-  idx_t const mat_start = rinfo->mat_start[m];
-  idx_t const mat_end = rinfo->mat_end[m];
-  idx_t const start = rinfo->ownstart[m];
-  idx_t const nowned = rinfo->nowned[m];
-
-  memset(globmat->vals, 0, globmat->I * nfactors * sizeof(val_t));
-
-  idx_t const goffset = (indmap == NULL) ?
-      start - mat_start : indmap[start] - mat_start;
-
-  par_memcpy(globmat->vals + (goffset * nfactors),
-         localmat->vals + (start * nfactors),
-         nowned * nfactors * sizeof(val_t));
+  p_scatter_owned(indmap, localmat->vals + (rinfo->ownstart[mode] * nfactors),
+      globmat, rinfo, nfactors, mode);
   timer_stop(&timers[TIMER_MPI_PARTIALS]);
 }
 
@@ -904,7 +2369,8 @@ void mpi_time_stats(
       + timers[TIMER_MPI_PARTIALS].seconds
       + timers[TIMER_MPI_NORM].seconds
       + timers[TIMER_MPI_UPDATE].seconds
-      + timers[TIMER_MPI_FIT].seconds;
+      + timers[TIMER_MPI_FIT].seconds
+      + timers[TIMER_MPI_FUSED].seconds;
 
   /* get avg times */
   MPI_Reduce(&timers[TIMER_MTTKRP].seconds, &avg_mttkrp, 1, MPI_DOUBLE,
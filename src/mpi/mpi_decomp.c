@@ -0,0 +1,772 @@
+/******************************************************************************
+ * INCLUDES
+ *****************************************************************************/
+#include "../splatt_mpi.h"
+#include "../sort.h"
+#include "../util.h"
+
+#include <math.h>
+
+
+/******************************************************************************
+ * PRIVATE DEFINES
+ *****************************************************************************/
+
+/* Slices beyond this many are sampled with a stride when estimating volume. */
+#define DECOMP_MAX_SAMPLES (1 << 20)
+
+/* Relative cost of communicating one factor row versus processing one
+ * nonzero in one mode's MTTKRP. Both scale with the rank, so this is roughly
+ * the ratio of flop rate to network bandwidth (in values). */
+#define DECOMP_COMM_WEIGHT 8.
+
+
+/******************************************************************************
+ * PRIVATE FUNCTIONS
+ *****************************************************************************/
+
+/**
+* @brief Estimate the number of extra ranks which touch each row of a mode
+*        when the slices are spread over 'q' ranks. A slice with s nonzeros,
+*        each of which lands on 'reps' ranks uniformly at random, touches
+*        q(1 - (1-1/q)^(s*reps)) ranks in expectation. This is the pcount of
+*        p_fill_volume_stats(), minus the owner.
+*
+* @param ssize The number of nonzeros in each slice.
+* @param dim The number of slices.
+* @param q The number of ranks sharing each slice.
+* @param reps The number of ranks each nonzero is stored on.
+*
+* @return Sum over all slices of (expected pcount - 1).
+*/
+static double p_expected_shared_rows(
+  idx_t const * const ssize,
+  idx_t const dim,
+  int const q,
+  idx_t const reps)
+{
+  if(q == 1) {
+    return 0.;
+  }
+
+  idx_t const stride = SS_MAX(1, (dim + DECOMP_MAX_SAMPLES - 1) /
+      DECOMP_MAX_SAMPLES);
+  double const miss = 1. - (1. / (double) q);
+
+  double shared = 0.;
+  #pragma omp parallel for schedule(static) reduction(+:shared)
+  for(idx_t i=0; i < dim; i += stride) {
+    if(ssize[i] > 0) {
+      shared += (q * (1. - pow(miss, (double) (ssize[i] * reps)))) - 1.;
+    }
+  }
+
+  return shared * (double) stride;
+}
+
+
+/**
+* @brief Find the layer that holds a slice, using the same rule as
+*        mpi_determine_med_owner(): the last layer which starts at or before
+*        the slice.
+*
+* @param ptrs The layer boundaries from mpi_find_layer_ptrs().
+* @param nlayers The number of layers.
+* @param idx The slice.
+*
+* @return The layer of slice 'idx'.
+*/
+static int p_find_layer(
+  idx_t const * const ptrs,
+  int const nlayers,
+  idx_t const idx)
+{
+  int lo = 0;
+  int hi = nlayers - 1;
+  while(lo < hi) {
+    int const mid = lo + ((hi - lo + 1) / 2);
+    if(ptrs[mid] <= idx) {
+      lo = mid;
+    } else {
+      hi = mid - 1;
+    }
+  }
+  return lo;
+}
+
+
+/**
+* @brief Per-mode model quantities for every divisor of npes.
+*/
+typedef struct
+{
+  int ndivs;
+  int * divs;
+  double * shared[MAX_NMODES]; /** expected shared rows with npes/divs[d] */
+  idx_t ** ptrs[MAX_NMODES];   /** layer boundaries with divs[d] layers */
+} decomp_tables;
+
+
+/**
+* @brief Evaluate the model for every mode and every divisor of npes. A grid's
+*        prediction is then only a combination of table entries.
+*
+* @param[out] tab The tables to allocate and fill.
+* @param ssizes The global number of nonzeros in each slice of each mode.
+* @param rinfo MPI rank information.
+*/
+static void p_tables_fill(
+  decomp_tables * const tab,
+  idx_t ** const ssizes,
+  rank_info const * const rinfo)
+{
+  int const npes = rinfo->npes;
+
+  tab->ndivs = 0;
+  tab->divs = splatt_malloc(npes * sizeof(*(tab->divs)));
+  for(int d=1; d <= npes; ++d) {
+    if(npes % d == 0) {
+      tab->divs[tab->ndivs++] = d;
+    }
+  }
+
+  for(idx_t m=0; m < rinfo->nmodes; ++m) {
+    idx_t const dim = rinfo->global_dims[m];
+    tab->shared[m] = splatt_malloc(tab->ndivs * sizeof(**(tab->shared)));
+    tab->ptrs[m] = splatt_malloc(tab->ndivs * sizeof(**(tab->ptrs)));
+    for(int d=0; d < tab->ndivs; ++d) {
+      int const nlayers = tab->divs[d];
+      if((idx_t) nlayers > dim) {
+        /* infeasible: more layers than slices */
+        tab->shared[m][d] = HUGE_VAL;
+        tab->ptrs[m][d] = NULL;
+        continue;
+      }
+      tab->shared[m][d] = p_expected_shared_rows(ssizes[m], dim,
+          npes / nlayers, 1);
+
+      idx_t * const ptrs = splatt_malloc((nlayers+1) * sizeof(*ptrs));
+      /* layers which are never placed stay empty */
+      for(int l=0; l <= nlayers; ++l) {
+        ptrs[l] = dim;
+      }
+      mpi_find_layer_ptrs(ssizes[m], dim, rinfo->global_nnz, nlayers, ptrs);
+      tab->ptrs[m][d] = ptrs;
+    }
+  }
+}
+
+
+/**
+* @brief Free the tables allocated by p_tables_fill().
+*
+* @param tab The tables to free.
+* @param nmodes The number of modes.
+*/
+static void p_tables_free(
+  decomp_tables * const tab,
+  idx_t const nmodes)
+{
+  for(idx_t m=0; m < nmodes; ++m) {
+    for(int d=0; d < tab->ndivs; ++d) {
+      splatt_free(tab->ptrs[m][d]);
+    }
+    splatt_free(tab->ptrs[m]);
+    splatt_free(tab->shared[m]);
+  }
+  splatt_free(tab->divs);
+}
+
+
+/**
+* @brief Find the table index of a divisor of npes.
+*
+* @param tab The model tables.
+* @param div The divisor.
+*
+* @return The index into the tables, or -1 if 'div' does not divide npes.
+*/
+static int p_div_index(
+  decomp_tables const * const tab,
+  int const div)
+{
+  for(int d=0; d < tab->ndivs; ++d) {
+    if(tab->divs[d] == div) {
+      return d;
+    }
+  }
+  return -1;
+}
+
+
+/**
+* @brief Combine the modeled compute and communication into one cost. Both
+*        are in units of one nonzero in one mode's MTTKRP. The row exchange
+*        overlaps the MTTKRP, so an iteration takes as long as the slower of
+*        the two.
+*
+* @param pred The prediction, whose cost is set.
+* @param nmodes The number of modes.
+*/
+static void p_set_cost(
+  mpi_decomp_pred * const pred,
+  idx_t const nmodes)
+{
+  double const compute = pred->maxnnz * (double) nmodes;
+  double const comm = DECOMP_COMM_WEIGHT * pred->avgvolume;
+  pred->cost = SS_MAX(compute, comm);
+}
+
+
+/**
+* @brief Sum the per-rank nonzero counts of all ranks and find the largest.
+*        This is collective.
+*
+* @param[out] counts My count of nonzeros for each rank. Overwritten with
+*                    the global counts.
+* @param npes The number of ranks.
+* @param[out] maxnnz The number of nonzeros on the most loaded rank.
+*
+* @return Whether every rank has nonzeros. The rest of the setup cannot
+*         handle an empty rank.
+*/
+static bool p_reduce_loads(
+  idx_t * const counts,
+  int const npes,
+  idx_t * const maxnnz)
+{
+  MPI_Allreduce(MPI_IN_PLACE, counts, npes, SPLATT_MPI_IDX, MPI_SUM,
+      MPI_COMM_WORLD);
+
+  bool nonempty = true;
+  *maxnnz = 0;
+  for(int p=0; p < npes; ++p) {
+    nonempty = nonempty && (counts[p] > 0);
+    *maxnnz = SS_MAX(*maxnnz, counts[p]);
+  }
+  return nonempty;
+}
+
+
+/**
+* @brief Count the nonzeros which each cell of a process grid would receive.
+*        This is collective: every rank counts its part of the tensor.
+*
+* @param tab The per-mode model tables.
+* @param ttbuf My nonzeros, in global coordinates.
+* @param dims The process grid.
+* @param rinfo MPI rank information.
+* @param[out] maxnnz The number of nonzeros on the most loaded rank.
+*
+* @return Whether every cell has nonzeros.
+*/
+static bool p_grid_loads(
+  decomp_tables const * const tab,
+  sptensor_t const * const ttbuf,
+  int const * const dims,
+  rank_info const * const rinfo,
+  idx_t * const maxnnz)
+{
+  int const npes = rinfo->npes;
+  idx_t const * ptrs[MAX_NMODES];
+  for(idx_t m=0; m < ttbuf->nmodes; ++m) {
+    ptrs[m] = tab->ptrs[m][p_div_index(tab, dims[m])];
+  }
+
+  idx_t * counts = splatt_malloc(npes * sizeof(*counts));
+  for(int p=0; p < npes; ++p) {
+    counts[p] = 0;
+  }
+  for(idx_t n=0; n < ttbuf->nnz; ++n) {
+    int cell = 0;
+    for(idx_t m=0; m < ttbuf->nmodes; ++m) {
+      cell = (cell * dims[m]) + p_find_layer(ptrs[m], dims[m],
+          ttbuf->ind[m][n]);
+    }
+    ++counts[cell];
+  }
+
+  bool const nonempty = p_reduce_loads(counts, npes, maxnnz);
+  splatt_free(counts);
+  return nonempty;
+}
+
+
+/**
+* @brief Predict a medium-grained decomposition. The load balance is exact;
+*        the volume is estimated from the slice histograms. This is
+*        collective.
+*
+* @param tab The per-mode model tables.
+* @param ttbuf My nonzeros, in global coordinates.
+* @param dims The process grid.
+* @param rinfo MPI rank information.
+* @param[out] pred The prediction.
+*
+* @return Whether the grid fits the tensor and leaves no rank empty.
+*/
+static bool p_predict_medium(
+  decomp_tables const * const tab,
+  sptensor_t const * const ttbuf,
+  int const * const dims,
+  rank_info const * const rinfo,
+  mpi_decomp_pred * const pred)
+{
+  pred->decomp = SPLATT_DECOMP_MEDIUM;
+  bool feasible = true;
+  double volume = 0.;
+  for(idx_t m=0; m < rinfo->nmodes; ++m) {
+    pred->dims[m] = dims[m];
+    int const d = p_div_index(tab, dims[m]);
+    if(d < 0 || tab->ptrs[m][d] == NULL) {
+      /* not a valid grid for npes ranks and this tensor */
+      feasible = false;
+      continue;
+    }
+    /* each shared row is reduced and then updated, and is counted at both
+     * the sender and the receiver -- just like mpi_rank_stats() */
+    if(dims[m] < rinfo->npes) {
+      volume += 4. * tab->shared[m][d];
+    }
+  }
+
+  if(!feasible) {
+    pred->avgvolume = HUGE_VAL;
+    pred->maxnnz = (double) rinfo->global_nnz;
+    pred->cost = HUGE_VAL;
+    return false;
+  }
+
+  idx_t maxnnz;
+  feasible = p_grid_loads(tab, ttbuf, dims, rinfo, &maxnnz);
+
+  pred->avgvolume = volume / (double) rinfo->npes;
+  pred->maxnnz = (double) maxnnz;
+  p_set_cost(pred, rinfo->nmodes);
+  return feasible;
+}
+
+
+/**
+* @brief Predict a coarse-grained decomposition: one 1D partition per mode,
+*        with the other factors exchanged for each of them.
+*
+* @param tab The per-mode model tables.
+* @param ssizes The global number of nonzeros in each slice of each mode.
+* @param rinfo MPI rank information.
+* @param[out] pred The prediction.
+*
+* @return Whether every rank gets a non-empty slab in every mode. Coarse
+*         decompositions cannot run otherwise.
+*/
+static bool p_predict_coarse(
+  decomp_tables const * const tab,
+  idx_t ** const ssizes,
+  rank_info const * const rinfo,
+  mpi_decomp_pred * const pred)
+{
+  int const npes = rinfo->npes;
+  int const all = p_div_index(tab, npes);
+
+  pred->decomp = SPLATT_DECOMP_COARSE;
+  bool feasible = true;
+  double volume = 0.;
+  double work = 0.;
+  for(idx_t m=0; m < rinfo->nmodes; ++m) {
+    pred->dims[m] = 1;
+    /* a nonzero is stored with each of its slabs of the other modes, and the
+     * owner sends each row once to every other rank which touches it */
+    volume += 2. * p_expected_shared_rows(ssizes[m], rinfo->global_dims[m],
+        npes, rinfo->nmodes - 1);
+
+    idx_t const * const ptrs = tab->ptrs[m][all];
+    if(ptrs == NULL) {
+      feasible = false;
+      work += (double) rinfo->global_nnz;
+      continue;
+    }
+    /* each rank computes one MTTKRP per mode, on its slab of that mode */
+    idx_t maxnnz = 0;
+    for(int l=0; l < npes; ++l) {
+      idx_t lnnz = 0;
+      for(idx_t i=ptrs[l]; i < ptrs[l+1]; ++i) {
+        lnnz += ssizes[m][i];
+      }
+      feasible = feasible && (lnnz > 0);
+      maxnnz = SS_MAX(maxnnz, lnnz);
+    }
+    work += (double) maxnnz;
+  }
+
+  pred->avgvolume = volume / (double) npes;
+  pred->maxnnz = work / (double) rinfo->nmodes;
+  p_set_cost(pred, rinfo->nmodes);
+  return feasible;
+}
+
+
+/**
+* @brief Count, over all rows of one mode, how many parts besides the first
+*        touch each row. Each rank buckets its (row, part) pairs by the row's
+*        home rank (row % npes), which then counts them exactly. This is
+*        collective.
+*
+* @param ttbuf My nonzeros, in global coordinates.
+* @param parts The part of each of my nonzeros.
+* @param mode The mode to count.
+* @param rinfo MPI rank information.
+*
+* @return The global sum of (#parts touching a row - 1).
+*/
+static idx_t p_fine_shared_rows(
+  sptensor_t const * const ttbuf,
+  int const * const parts,
+  idx_t const mode,
+  rank_info const * const rinfo)
+{
+  int const npes = rinfo->npes;
+  idx_t const * const ind = ttbuf->ind[mode];
+
+  int * sendcounts = splatt_malloc(npes * sizeof(*sendcounts));
+  int * sdispls = splatt_malloc((npes+1) * sizeof(*sdispls));
+  int * recvcounts = splatt_malloc(npes * sizeof(*recvcounts));
+  int * rdispls = splatt_malloc((npes+1) * sizeof(*rdispls));
+
+  for(int p=0; p < npes; ++p) {
+    sendcounts[p] = 0;
+  }
+  for(idx_t n=0; n < ttbuf->nnz; ++n) {
+    ++sendcounts[ind[n] % npes];
+  }
+  sdispls[0] = 0;
+  for(int p=0; p < npes; ++p) {
+    sdispls[p+1] = sdispls[p] + sendcounts[p];
+    sendcounts[p] = 0;
+  }
+
+  /* a key identifies a (row, part) pair among the rows of one home rank */
+  idx_t * keys = splatt_malloc(SS_MAX(ttbuf->nnz, 1) * sizeof(*keys));
+  for(idx_t n=0; n < ttbuf->nnz; ++n) {
+    int const home = ind[n] % npes;
+    keys[sdispls[home] + sendcounts[home]++] =
+        ((ind[n] / npes) * npes) + parts[n];
+  }
+
+  /* only send each pair once */
+  for(int p=0; p < npes; ++p) {
+    idx_t * const bucket = keys + sdispls[p];
+    quicksort(bucket, sendcounts[p]);
+    int nuniq = 0;
+    for(int i=0; i < sendcounts[p]; ++i) {
+      if(nuniq == 0 || bucket[i] != bucket[nuniq-1]) {
+        bucket[nuniq++] = bucket[i];
+      }
+    }
+    sendcounts[p] = nuniq;
+  }
+
+  MPI_Alltoall(sendcounts, 1, MPI_INT, recvcounts, 1, MPI_INT,
+      MPI_COMM_WORLD);
+  rdispls[0] = 0;
+  for(int p=0; p < npes; ++p) {
+    rdispls[p+1] = rdispls[p] + recvcounts[p];
+  }
+  idx_t * recv = splatt_malloc(SS_MAX(rdispls[npes], 1) * sizeof(*recv));
+  MPI_Alltoallv(keys, sendcounts, sdispls, SPLATT_MPI_IDX,
+      recv, recvcounts, rdispls, SPLATT_MPI_IDX, MPI_COMM_WORLD);
+
+  /* distinct pairs minus distinct rows */
+  idx_t const nrecv = (idx_t) rdispls[npes];
+  quicksort(recv, nrecv);
+  idx_t shared = 0;
+  for(idx_t i=1; i < nrecv; ++i) {
+    if(recv[i] != recv[i-1] && recv[i] / npes == recv[i-1] / npes) {
+      ++shared;
+    }
+  }
+  MPI_Allreduce(MPI_IN_PLACE, &shared, 1, SPLATT_MPI_IDX, MPI_SUM,
+      MPI_COMM_WORLD);
+
+  splatt_free(recv);
+  splatt_free(keys);
+  splatt_free(sendcounts);
+  splatt_free(sdispls);
+  splatt_free(recvcounts);
+  splatt_free(rdispls);
+  return shared;
+}
+
+
+/**
+* @brief Predict a fine-grained decomposition from its actual partitioning.
+*        Both the load balance and the volume are exact. This is collective.
+*
+* @param ttbuf My nonzeros, in global coordinates.
+* @param parts The part of each of my nonzeros.
+* @param rinfo MPI rank information.
+* @param[out] pred The prediction.
+*
+* @return Whether every part has nonzeros.
+*/
+static bool p_predict_fine(
+  sptensor_t const * const ttbuf,
+  int const * const parts,
+  rank_info const * const rinfo,
+  mpi_decomp_pred * const pred)
+{
+  int const npes = rinfo->npes;
+
+  pred->decomp = SPLATT_DECOMP_FINE;
+  double volume = 0.;
+  for(idx_t m=0; m < ttbuf->nmodes; ++m) {
+    pred->dims[m] = 1;
+    /* reduced and then updated, counted at both ends */
+    volume += 4. * (double) p_fine_shared_rows(ttbuf, parts, m, rinfo);
+  }
+
+  idx_t * counts = splatt_malloc(npes * sizeof(*counts));
+  for(int p=0; p < npes; ++p) {
+    counts[p] = 0;
+  }
+  for(idx_t n=0; n < ttbuf->nnz; ++n) {
+    ++counts[parts[n]];
+  }
+  idx_t maxnnz;
+  bool const feasible = p_reduce_loads(counts, npes, &maxnnz);
+  splatt_free(counts);
+
+  pred->avgvolume = volume / (double) npes;
+  pred->maxnnz = (double) maxnnz;
+  p_set_cost(pred, rinfo->nmodes);
+  return feasible;
+}
+
+
+/**
+* @brief Insert a prediction into the list of the cheapest ones. Ties, such
+*        as two compute-bound grids with the same load, go to the smaller
+*        volume.
+*
+* @param pred The new prediction.
+* @param rinfo MPI rank information, whose pred/npred are updated.
+*/
+static void p_keep_best(
+  mpi_decomp_pred const * const pred,
+  rank_info * const rinfo)
+{
+  int pos = rinfo->npred;
+  while(pos > 0 && (rinfo->pred[pos-1].cost > pred->cost ||
+      (rinfo->pred[pos-1].cost == pred->cost &&
+       rinfo->pred[pos-1].avgvolume > pred->avgvolume))) {
+    --pos;
+  }
+  if(pos == MPI_DECOMP_NPRED) {
+    return;
+  }
+
+  int const last = SS_MIN(rinfo->npred, MPI_DECOMP_NPRED - 1);
+  for(int p=last; p > pos; --p) {
+    rinfo->pred[p] = rinfo->pred[p-1];
+  }
+  rinfo->pred[pos] = *pred;
+  rinfo->npred = SS_MIN(rinfo->npred + 1, MPI_DECOMP_NPRED);
+}
+
+
+/**
+* @brief Recursively enumerate every process grid whose product is npes.
+*        Every rank must enumerate the same grids, because each prediction
+*        is collective.
+*
+* @param tab The per-mode model tables.
+* @param ttbuf My nonzeros, in global coordinates.
+* @param m The mode to assign.
+* @param left The number of ranks left to assign.
+* @param dims The partially assigned grid.
+* @param rinfo MPI rank information.
+*/
+static void p_enumerate_grids(
+  decomp_tables const * const tab,
+  sptensor_t const * const ttbuf,
+  idx_t const m,
+  int const left,
+  int * const dims,
+  rank_info * const rinfo)
+{
+  if(m == rinfo->nmodes - 1) {
+    if((idx_t) left > rinfo->global_dims[m]) {
+      return;
+    }
+    dims[m] = left;
+    mpi_decomp_pred pred;
+    if(p_predict_medium(tab, ttbuf, dims, rinfo, &pred)) {
+      p_keep_best(&pred, rinfo);
+    }
+    return;
+  }
+
+  for(int d=0; d < tab->ndivs; ++d) {
+    int const div = tab->divs[d];
+    if(left % div == 0 && (idx_t) div <= rinfo->global_dims[m]) {
+      dims[m] = div;
+      p_enumerate_grids(tab, ttbuf, m+1, left / div, dims, rinfo);
+    }
+  }
+}
+
+
+/**
+* @brief Print one prediction to STDOUT.
+*
+* @param pred The prediction.
+* @param nmodes The number of modes.
+*/
+static void p_print_pred(
+  mpi_decomp_pred const * const pred,
+  idx_t const nmodes)
+{
+  if(pred->decomp == SPLATT_DECOMP_COARSE) {
+    printf("COARSE");
+  } else if(pred->decomp == SPLATT_DECOMP_FINE) {
+    printf("FINE");
+  } else {
+    printf("DIMS=%d", pred->dims[0]);
+    for(idx_t m=1; m < nmodes; ++m) {
+      printf("x%d", pred->dims[m]);
+    }
+  }
+  printf("  VOL=%0.0f  MAX NNZ=%0.0f  COST=%0.3e\n", pred->avgvolume,
+      pred->maxnnz, pred->cost);
+}
+
+
+/******************************************************************************
+ * PUBLIC FUNCTIONS
+ *****************************************************************************/
+
+void mpi_decomp_model(
+  sptensor_t const * const ttbuf,
+  idx_t ** const ssizes,
+  int const * const parts,
+  rank_info * const rinfo)
+{
+  rinfo->npred = 0;
+
+  if(rinfo->decomp == SPLATT_DECOMP_FINE && parts == NULL) {
+    return;
+  }
+
+  bool const choose = (rinfo->decomp == AUTO_MPI_DISTRIBUTION);
+
+  /* every rank evaluates the model, since the nonzero counts are collective */
+  decomp_tables tab;
+  p_tables_fill(&tab, ssizes, rinfo);
+
+  mpi_decomp_pred pred;
+  if(choose) {
+    int dims[MAX_NMODES];
+    p_enumerate_grids(&tab, ttbuf, 0, rinfo->npes, dims, rinfo);
+    if(p_predict_coarse(&tab, ssizes, rinfo, &pred)) {
+      p_keep_best(&pred, rinfo);
+    }
+    if(parts != NULL && p_predict_fine(ttbuf, parts, rinfo, &pred)) {
+      p_keep_best(&pred, rinfo);
+    }
+  } else if(rinfo->decomp == SPLATT_DECOMP_COARSE) {
+    p_predict_coarse(&tab, ssizes, rinfo, rinfo->pred);
+    rinfo->npred = 1;
+  } else if(rinfo->decomp == SPLATT_DECOMP_FINE) {
+    p_predict_fine(ttbuf, parts, rinfo, rinfo->pred);
+    rinfo->npred = 1;
+  } else {
+    p_predict_medium(&tab, ttbuf, rinfo->dims_3d, rinfo, rinfo->pred);
+    rinfo->npred = 1;
+  }
+
+  p_tables_free(&tab, rinfo->nmodes);
+
+  /* floating-point sums may round differently per rank; use the root's */
+  MPI_Bcast(&(rinfo->npred), 1, MPI_INT, 0, MPI_COMM_WORLD);
+  MPI_Bcast(rinfo->pred, rinfo->npred * sizeof(*(rinfo->pred)), MPI_BYTE, 0,
+      MPI_COMM_WORLD);
+
+  if(choose) {
+    if(rinfo->npred == 0) {
+      if(rinfo->rank == 0) {
+        fprintf(stderr, "SPLATT: no decomposition fits the tensor "
+                        "dimensions. Using the default.\n");
+      }
+      rinfo->decomp = DEFAULT_MPI_DISTRIBUTION;
+      return;
+    }
+    rinfo->decomp = rinfo->pred[0].decomp;
+    for(idx_t m=0; m < rinfo->nmodes; ++m) {
+      rinfo->dims_3d[m] = rinfo->pred[0].dims[m];
+    }
+  }
+}
+
+
+void mpi_decomp_report(
+  sptensor_t const * const tt,
+  rank_info const * const rinfo)
+{
+  /* same measurements as mpi_rank_stats() */
+  idx_t volume = 0;
+  for(idx_t m=0; m < tt->nmodes; ++m) {
+    if(rinfo->decomp != SPLATT_DECOMP_COARSE && rinfo->layer_size[m] > 1) {
+      volume += 2 * (rinfo->nlocal2nbr[m] + rinfo->nnbr2globs[m]);
+    } else {
+      volume += rinfo->nlocal2nbr[m] + rinfo->nnbr2globs[m];
+    }
+  }
+  idx_t totvolume = 0;
+  idx_t maxnnz = 0;
+  MPI_Reduce(&volume, &totvolume, 1, SPLATT_MPI_IDX, MPI_SUM, 0,
+      rinfo->comm_3d);
+  if(rinfo->decomp == SPLATT_DECOMP_COARSE) {
+    /* coarse ranks work on one slab of tt per mode, not on all of it */
+    idx_t work = 0;
+    for(idx_t m=0; m < tt->nmodes; ++m) {
+      idx_t slabnnz = 0;
+      for(idx_t n=0; n < tt->nnz; ++n) {
+        idx_t const gi = (tt->indmap[m] == NULL) ?
+            tt->ind[m][n] : tt->indmap[m][tt->ind[m][n]];
+        if(gi >= rinfo->mat_start[m] && gi < rinfo->mat_end[m]) {
+          ++slabnnz;
+        }
+      }
+      MPI_Allreduce(MPI_IN_PLACE, &slabnnz, 1, SPLATT_MPI_IDX, MPI_MAX,
+          rinfo->comm_3d);
+      work += slabnnz;
+    }
+    maxnnz = work / tt->nmodes;
+  } else {
+    MPI_Reduce(&tt->nnz, &maxnnz, 1, SPLATT_MPI_IDX, MPI_MAX, 0,
+        rinfo->comm_3d);
+  }
+
+  if(rinfo->rank != 0) {
+    return;
+  }
+
+  printf("Decomposition model --------------------------------------------\n");
+  if(rinfo->npred == 0) {
+    printf("no prediction for this decomposition\n\n");
+    return;
+  }
+
+  for(int p=0; p < rinfo->npred; ++p) {
+    printf("%s ", (p == 0) ? "*" : " ");
+    p_print_pred(rinfo->pred + p, rinfo->nmodes);
+  }
+
+  double const avgvolume = (double) totvolume / (double) rinfo->npes;
+  mpi_decomp_pred const * const used = rinfo->pred;
+  printf("MEASURED  VOL=%0.0f (%+0.1f%%)  MAX NNZ=%"SPLATT_PF_IDX" (%+0.1f%%)\n",
+      avgvolume,
+      100. * (used->avgvolume - avgvolume) / SS_MAX(avgvolume, 1.),
+      maxnnz,
+      100. * (used->maxnnz - (double) maxnnz) / SS_MAX((double) maxnnz, 1.));
+  printf("\n");
+}
@@ -0,0 +1,269 @@
+/******************************************************************************
+ * INCLUDES
+ *****************************************************************************/
+#include "../splatt_mpi.h"
+#include "../matrix.h"
+#include "../thd_info.h"
+#include "../timer.h"
+#include "../trace.h"
+
+#include <math.h>
+
+
+/******************************************************************************
+ * PRIVATE DEFINES
+ *****************************************************************************/
+
+/*
+ * The fused buffer of a rank-F factorization is laid out as:
+ *
+ *   [ nmax | Gram (F*F) | fit (1) | column norms (F) ]
+ *
+ * 'nmax' is the number of trailing entries which are combined with a max
+ * instead of a sum: F when max-norms are used, otherwise 0. The whole buffer
+ * is a single element of a contiguous datatype so that MPI never splits it
+ * and the custom op always sees the header.
+ */
+#define FUSED_HEADER 0
+#define FUSED_GRAM 1
+#define FUSED_FIT(F) (FUSED_GRAM + ((F)*(F)))
+#define FUSED_NORMS(F) (FUSED_FIT(F) + 1)
+#define FUSED_SIZE(F) (FUSED_NORMS(F) + (F))
+
+
+/******************************************************************************
+ * PRIVATE FUNCTIONS
+ *****************************************************************************/
+
+/**
+* @brief The custom MPI reduction for fused buffers. Everything is summed
+*        except for the last 'nmax' entries, which take the maximum.
+*
+* @param invec The incoming buffers.
+* @param inoutvec The buffers to combine into.
+* @param len The number of fused buffers.
+* @param type The fused datatype.
+*/
+static void p_fused_op(
+  void * invec,
+  void * inoutvec,
+  int * len,
+  MPI_Datatype * type)
+{
+  int bytes;
+  MPI_Type_size(*type, &bytes);
+  idx_t const size = bytes / sizeof(val_t);
+
+  for(int l=0; l < *len; ++l) {
+    val_t const * const restrict in = ((val_t const *) invec) + (l * size);
+    val_t * const restrict inout = ((val_t *) inoutvec) + (l * size);
+
+    idx_t const nmax = (idx_t) inout[FUSED_HEADER];
+    idx_t const nsum = size - nmax;
+    for(idx_t i=FUSED_GRAM; i < nsum; ++i) {
+      inout[i] += in[i];
+    }
+    for(idx_t i=nsum; i < size; ++i) {
+      inout[i] = SS_MAX(inout[i], in[i]);
+    }
+  }
+}
+
+
+/**
+* @brief Compute my contribution to the column norms of A.
+*
+* @param A The (unnormalized) matrix.
+* @param norms The output partial norms (sum of squares or max).
+* @param which Which norm to use.
+* @param thds Thread scratch space (scratch[0] must hold A->J values).
+* @param nthreads The number of threads to use.
+*/
+static void p_local_norms(
+  matrix_t const * const A,
+  val_t * const restrict norms,
+  splatt_mat_norm const which,
+  thd_info * const thds,
+  idx_t const nthreads)
+{
+  idx_t const I = A->I;
+  idx_t const J = A->J;
+  val_t const * const restrict vals = A->vals;
+
+  splatt_omp_set_num_threads(nthreads);
+  #pragma omp parallel
+  {
+    int const tid = splatt_omp_get_thread_num();
+    val_t * const mynorms = (val_t *) thds[tid].scratch[0];
+    for(idx_t j=0; j < J; ++j) {
+      mynorms[j] = 0;
+    }
+
+    if(which == MAT_NORM_2) {
+      #pragma omp for schedule(static)
+      for(idx_t i=0; i < I; ++i) {
+        for(idx_t j=0; j < J; ++j) {
+          mynorms[j] += vals[j + (i*J)] * vals[j + (i*J)];
+        }
+      }
+      thd_reduce(thds, 0, J, REDUCE_SUM);
+    } else {
+      #pragma omp for schedule(static)
+      for(idx_t i=0; i < I; ++i) {
+        for(idx_t j=0; j < J; ++j) {
+          mynorms[j] = SS_MAX(mynorms[j], vals[j + (i*J)]);
+        }
+      }
+      thd_reduce(thds, 0, J, REDUCE_MAX);
+    }
+  }
+
+  memcpy(norms, thds[0].scratch[0], J * sizeof(val_t));
+}
+
+
+
+/******************************************************************************
+ * PUBLIC FUNCTIONS
+ *****************************************************************************/
+
+idx_t mpi_fused_size(
+  idx_t const nfactors)
+{
+  return FUSED_SIZE(nfactors);
+}
+
+
+void mpi_fused_init(
+  rank_info * const rinfo,
+  idx_t const nfactors)
+{
+  rinfo->fused_nfactors = nfactors;
+  rinfo->fused_buf = splatt_malloc(FUSED_SIZE(nfactors) * sizeof(val_t));
+  rinfo->fused_req = MPI_REQUEST_NULL;
+
+  MPI_Type_contiguous(FUSED_SIZE(nfactors), SPLATT_MPI_VAL,
+      &(rinfo->fused_type));
+  MPI_Type_commit(&(rinfo->fused_type));
+  MPI_Op_create(p_fused_op, 1, &(rinfo->fused_op));
+}
+
+
+void mpi_fused_free(
+  rank_info * const rinfo)
+{
+  if(rinfo->fused_buf == NULL) {
+    return;
+  }
+
+  MPI_Op_free(&(rinfo->fused_op));
+  MPI_Type_free(&(rinfo->fused_type));
+  splatt_free(rinfo->fused_buf);
+  rinfo->fused_buf = NULL;
+}
+
+
+void mpi_fused_begin(
+  matrix_t const * const A,
+  matrix_t const * const m1,
+  matrix_t * const aTa,
+  splatt_mat_norm const which,
+  rank_info * const rinfo,
+  thd_info * const thds,
+  idx_t const nthreads)
+{
+  idx_t const F = rinfo->fused_nfactors;
+  val_t * const buf = rinfo->fused_buf;
+  assert(A->J == F);
+
+  /* local Gram matrix of the unnormalized factor */
+  mat_aTa(A, aTa, NULL, thds, nthreads);
+
+  timer_start(&timers[TIMER_MATNORM]);
+  buf[FUSED_HEADER] = (which == MAT_NORM_MAX) ? F : 0;
+  memcpy(buf + FUSED_GRAM, aTa->vals, F * F * sizeof(val_t));
+  p_local_norms(A, buf + FUSED_NORMS(F), which, thds, nthreads);
+  timer_stop(&timers[TIMER_MATNORM]);
+
+  /* <X, Z> = 1^T (A .* m1) 1, because normalizing A and scaling by lambda
+   * cancel out */
+  val_t myinner = 0;
+  if(m1 != NULL) {
+    timer_start(&timers[TIMER_FIT]);
+    val_t const * const restrict av = A->vals;
+    val_t const * const restrict mv = m1->vals;
+    idx_t const nvals = m1->I * F;
+    #pragma omp parallel for schedule(static) reduction(+:myinner)
+    for(idx_t x=0; x < nvals; ++x) {
+      myinner += av[x] * mv[x];
+    }
+    timer_stop(&timers[TIMER_FIT]);
+  }
+  buf[FUSED_FIT(F)] = myinner;
+
+  timer_start(&timers[TIMER_MPI_FUSED]);
+  timer_start(&timers[TIMER_MPI_COMM]);
+  trace_begin("mpi fused", -1);
+  if(mpi_node_shared(rinfo, FUSED_SIZE(F) * sizeof(val_t))) {
+    /* node-aware reductions are blocking */
+    mpi_node_allreduce(buf, buf, 1, rinfo->fused_type, rinfo->fused_op,
+        rinfo);
+  } else {
+    MPI_Iallreduce(MPI_IN_PLACE, buf, 1, rinfo->fused_type, rinfo->fused_op,
+        rinfo->comm_3d, &(rinfo->fused_req));
+  }
+  trace_end();
+  timer_stop(&timers[TIMER_MPI_COMM]);
+  timer_stop(&timers[TIMER_MPI_FUSED]);
+}
+
+
+void mpi_fused_finish(
+  matrix_t * const A,
+  matrix_t * const aTa,
+  val_t * const restrict lambda,
+  val_t * const inner,
+  rank_info * const rinfo)
+{
+  idx_t const F = rinfo->fused_nfactors;
+  val_t const * const buf = rinfo->fused_buf;
+
+  timer_start(&timers[TIMER_MPI_FUSED]);
+  timer_start(&timers[TIMER_MPI_IDLE]);
+  trace_begin("mpi fused wait", -1);
+  MPI_Wait(&(rinfo->fused_req), MPI_STATUS_IGNORE);
+  trace_end();
+  timer_stop(&timers[TIMER_MPI_IDLE]);
+  timer_stop(&timers[TIMER_MPI_FUSED]);
+
+  timer_start(&timers[TIMER_MATNORM]);
+  /* lambda follows the same rules as mat_normalize() */
+  val_t const * const norms = buf + FUSED_NORMS(F);
+  bool const maxnorm = buf[FUSED_HEADER] > 0;
+  for(idx_t f=0; f < F; ++f) {
+    lambda[f] = maxnorm ? SS_MAX(norms[f], 1.) : sqrt(norms[f]);
+  }
+
+  /* normalize my owned rows */
+  val_t * const restrict vals = A->vals;
+  #pragma omp parallel for schedule(static)
+  for(idx_t i=0; i < A->I; ++i) {
+    for(idx_t f=0; f < F; ++f) {
+      vals[f+(i*F)] /= lambda[f];
+    }
+  }
+  timer_stop(&timers[TIMER_MATNORM]);
+
+  /* Gram of the normalized factor is D^-1 (A^T A) D^-1 */
+  val_t const * const restrict gram = buf + FUSED_GRAM;
+  val_t * const restrict av = aTa->vals;
+  for(idx_t i=0; i < F; ++i) {
+    for(idx_t j=0; j < F; ++j) {
+      av[j+(i*F)] = gram[j+(i*F)] / (lambda[i] * lambda[j]);
+    }
+  }
+
+  if(inner != NULL) {
+    *inner = buf[FUSED_FIT(F)];
+  }
+}
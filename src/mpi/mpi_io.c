@@ -59,7 +59,7 @@ int splatt_mpi_coord_load(
     (*inds)[m] = tt->ind[m];
   }
 
-  free(tt);
+  splatt_free(tt);
 
   return SPLATT_SUCCESS;
 }
@@ -69,6 +69,34 @@ int splatt_mpi_coord_load(
  * PRIVATE FUNCTONS
  *****************************************************************************/
 
+/**
+* @brief Find the first position of a sorted array whose value is >= 'val'.
+*
+* @param arr The sorted array.
+* @param len The length of 'arr'.
+* @param val The value to search for.
+*
+* @return The first index i with arr[i] >= val, or 'len' if there is none.
+*/
+static idx_t p_lower_bound(
+  idx_t const * const arr,
+  idx_t const len,
+  idx_t const val)
+{
+  idx_t lo = 0;
+  idx_t hi = len;
+  while(lo < hi) {
+    idx_t const mid = lo + ((hi - lo) / 2);
+    if(arr[mid] < val) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return lo;
+}
+
+
 /**
 * @brief Fill buf with the next 'nnz_to_read' tensor values.
 *
@@ -128,7 +156,7 @@ static int * p_distribute_parts(
           exit(1);
         }
       }
-      MPI_Send(parts, target_nnz, MPI_INT, p, 0, rinfo->comm_3d);
+      MPI_Send(parts, target_nnz, MPI_INT, p, 0, MPI_COMM_WORLD);
     }
 
     /* now read my own part info */
@@ -142,7 +170,7 @@ static int * p_distribute_parts(
     fclose(fin);
   } else {
     /* receive part info */
-    MPI_Recv(parts, ttbuf->nnz, MPI_INT, 0, 0, rinfo->comm_3d,
+    MPI_Recv(parts, ttbuf->nnz, MPI_INT, 0, 0, MPI_COMM_WORLD,
         &(rinfo->status));
   }
   return parts;
@@ -368,62 +396,17 @@ static void p_find_layer_boundaries(
   rank_info * const rinfo)
 {
   idx_t const * const dims = rinfo->global_dims;
-  idx_t const nnz = rinfo->global_nnz;
   idx_t const m = mode;
 
   /* find start/end slices for my partition */
   int const layer_dim = rinfo->dims_3d[m];
-  idx_t pnnz = nnz / layer_dim; /* nnz in a layer */
-
-  /* current processor */
-  int currp  = 0;
-  idx_t lastn = 0;
-  idx_t nnzcnt = ssizes[m][0];
 
   /* initialize layer_ptrs */
   rinfo->layer_ptrs[m]
       = splatt_malloc((layer_dim+1) * sizeof(**(rinfo->layer_ptrs)));
-  rinfo->layer_ptrs[m][currp++] = 0;
-  rinfo->layer_ptrs[m][layer_dim] = dims[m];
-
-  if(layer_dim == 1) {
-    goto CLEANUP;
-    return;
-  }
-
-  /* foreach slice */
-  for(idx_t s=1; s < dims[m]; ++s) {
-    /* if we have passed the next layer boundary */
-    if(nnzcnt >= lastn + pnnz) {
+  mpi_find_layer_ptrs(ssizes[m], dims[m], rinfo->global_nnz, layer_dim,
+      rinfo->layer_ptrs[m]);
 
-      /* choose this slice or the previous, whichever is closer */
-      idx_t const thisdist = nnzcnt - (lastn + pnnz);
-      idx_t const prevdist = (lastn + pnnz) - (nnzcnt - ssizes[m][s-1]);
-      if(prevdist < thisdist) {
-        lastn = nnzcnt - ssizes[m][s-1];
-        /* see below comment */
-        //rinfo->layer_ptrs[m][currp++] = s-1;
-      } else {
-        lastn = nnzcnt;
-        //rinfo->layer_ptrs[m][currp++] = s;
-      }
-
-      /* Always choosing s but marking lastn with s-1 leads to better balance
-       * and communication volume. This is totally a heuristic. */
-      rinfo->layer_ptrs[m][currp++] = s;
-
-      /* exit early if we placed the last rank */
-      if(currp == layer_dim) {
-        break;
-      }
-
-      /* adjust target nnz based on what is left */
-      pnnz = (nnz - lastn) / SS_MAX(1, layer_dim - (currp-1));
-    }
-    nnzcnt += ssizes[m][s];
-  }
-
-  CLEANUP:
   /* store layer bounderies in layer_{starts, ends} */
   rinfo->layer_starts[m] = rinfo->layer_ptrs[m][rinfo->coords_3d[m]];
   rinfo->layer_ends[m] = rinfo->layer_ptrs[m][rinfo->coords_3d[m] + 1];
@@ -474,27 +457,22 @@ static sptensor_t * p_rearrange_medium(
 
 
 /**
-* @brief Rearrange nonzeros according to a medium-grained decomposition.
+* @brief Rearrange nonzeros according to a fine-grained decomposition.
 *
 * @param ttbuf The tensor to rearrange.
-* @param pfname The filename containing the partitioning information.
-* @param ssizes The number of nonzeros found in each index.
+* @param parts The part of each nonzero in ttbuf. This is freed.
 * @param rinfo MPI rank information.
 *
 * @return My owned tensor nonzeros.
 */
 static sptensor_t * p_rearrange_fine(
   sptensor_t * const ttbuf,
-  char const * const pfname,
-  idx_t * * ssizes,
+  int * const parts,
   rank_info * const rinfo)
 {
-  /* first distribute partitioning information */
-  int * parts = p_distribute_parts(ttbuf, pfname, rinfo);
-
   sptensor_t * tt = mpi_rearrange_by_part(ttbuf, parts, rinfo->comm_3d);
 
-  free(parts);
+  splatt_free(parts);
   return tt;
 }
 
@@ -507,11 +485,13 @@ static sptensor_t * p_rearrange_fine(
 * @param tt My subtensor.
 * @param ssizes A 2D array for counting slice 'sizes'.
 * @param rinfo MPI information (containing global dims, nnz, etc.).
+* @param comm The communicator holding all of the nonzeros.
 */
 static void p_fill_ssizes(
   sptensor_t const * const tt,
   idx_t ** const ssizes,
-  rank_info const * const rinfo)
+  rank_info const * const rinfo,
+  MPI_Comm comm)
 {
   for(idx_t m=0; m < tt->nmodes; ++m) {
     idx_t const * const ind = tt->ind[m];
@@ -521,7 +501,7 @@ static void p_fill_ssizes(
 
     /* reduce to get total slice counts */
     MPI_Allreduce(MPI_IN_PLACE, ssizes[m], (int) rinfo->global_dims[m],
-        SPLATT_MPI_IDX, MPI_SUM, rinfo->comm_3d);
+        SPLATT_MPI_IDX, MPI_SUM, comm);
   }
 }
 
@@ -753,6 +733,61 @@ static sptensor_t * p_tt_mpi_read_binary_file(
  * PUBLIC FUNCTONS
  *****************************************************************************/
 
+void mpi_find_layer_ptrs(
+  idx_t const * const ssize,
+  idx_t const dim,
+  idx_t const nnz,
+  int const nlayers,
+  idx_t * const layer_ptrs)
+{
+  idx_t pnnz = nnz / nlayers; /* nnz in a layer */
+
+  /* current processor */
+  int currp  = 0;
+  idx_t lastn = 0;
+  idx_t nnzcnt = ssize[0];
+
+  layer_ptrs[currp++] = 0;
+  layer_ptrs[nlayers] = dim;
+
+  if(nlayers == 1) {
+    return;
+  }
+
+  /* foreach slice */
+  for(idx_t s=1; s < dim; ++s) {
+    /* if we have passed the next layer boundary */
+    if(nnzcnt >= lastn + pnnz) {
+
+      /* choose this slice or the previous, whichever is closer */
+      idx_t const thisdist = nnzcnt - (lastn + pnnz);
+      idx_t const prevdist = (lastn + pnnz) - (nnzcnt - ssize[s-1]);
+      if(prevdist < thisdist) {
+        lastn = nnzcnt - ssize[s-1];
+        /* see below comment */
+        //layer_ptrs[currp++] = s-1;
+      } else {
+        lastn = nnzcnt;
+        //layer_ptrs[currp++] = s;
+      }
+
+      /* Always choosing s but marking lastn with s-1 leads to better balance
+       * and communication volume. This is totally a heuristic. */
+      layer_ptrs[currp++] = s;
+
+      /* exit early if we placed the last rank */
+      if(currp == nlayers) {
+        break;
+      }
+
+      /* adjust target nnz based on what is left */
+      pnnz = (nnz - lastn) / SS_MAX(1, nlayers - (currp-1));
+    }
+    nnzcnt += ssize[s];
+  }
+}
+
+
 sptensor_t * mpi_tt_read(
   char const * const ifname,
   char const * const pfname,
@@ -770,6 +805,8 @@ sptensor_t * mpi_tt_read(
   }
   fclose(fin);
 
+  splatt_mem_tag const prev_tag = mem_tag_begin(SPLATT_MEM_MPI);
+
   /* first naively distribute tensor nonzeros for analysis */
   sptensor_t * ttbuf = mpi_simple_distribute(ifname, MPI_COMM_WORLD);
 
@@ -780,20 +817,47 @@ sptensor_t * mpi_tt_read(
       SPLATT_MPI_IDX, MPI_MAX, MPI_COMM_WORLD);
 
 
+  /* count # nonzeros found in each index */
+  idx_t * ssizes[MAX_NMODES];
+  for(idx_t m=0; m < ttbuf->nmodes; ++m) {
+    ssizes[m] = (idx_t *) calloc(rinfo->global_dims[m], sizeof(idx_t));
+  }
+  p_fill_ssizes(ttbuf, ssizes, rinfo, MPI_COMM_WORLD);
+
+  /* a fine-grained decomposition is modeled on its actual partitioning, which
+   * is then kept for the rearrangement */
+  int * parts = NULL;
+  if(rinfo->decomp == AUTO_MPI_DISTRIBUTION ||
+      rinfo->decomp == SPLATT_DECOMP_FINE) {
+    if(pfname != NULL) {
+      parts = p_distribute_parts(ttbuf, pfname, rinfo);
+    } else {
+      parts = mpi_stream_partition(ttbuf, rinfo);
+    }
+  }
+
+  /* let the cost model choose the decomposition */
+  rinfo->npred = 0;
+  if(rinfo->decomp == AUTO_MPI_DISTRIBUTION) {
+    mpi_decomp_model(ttbuf, ssizes, parts, rinfo);
+  }
+
   /* first compute MPI dimension if not specified by the user */
   if(rinfo->decomp == DEFAULT_MPI_DISTRIBUTION) {
     rinfo->decomp = SPLATT_DECOMP_MEDIUM;
     p_get_best_mpi_dim(rinfo);
   }
 
-  mpi_setup_comms(rinfo);
-
-  /* count # nonzeros found in each index */
-  idx_t * ssizes[MAX_NMODES];
-  for(idx_t m=0; m < ttbuf->nmodes; ++m) {
-    ssizes[m] = (idx_t *) calloc(rinfo->global_dims[m], sizeof(idx_t));
+  /* otherwise, just predict the cost of the decomposition we were given */
+  if(rinfo->npred == 0) {
+    mpi_decomp_model(ttbuf, ssizes, parts, rinfo);
+  }
+  if(rinfo->decomp != SPLATT_DECOMP_FINE) {
+    splatt_free(parts);
+    parts = NULL;
   }
-  p_fill_ssizes(ttbuf, ssizes, rinfo);
+
+  mpi_setup_comms(rinfo);
 
   /* actually parse tensor */
   sptensor_t * tt = NULL;
@@ -825,7 +889,7 @@ sptensor_t * mpi_tt_read(
     break;
 
   case SPLATT_DECOMP_FINE:
-    tt = p_rearrange_fine(ttbuf, pfname, ssizes, rinfo);
+    tt = p_rearrange_fine(ttbuf, parts, rinfo);
     /* now fix tt->dims */
     for(idx_t m=0; m < tt->nmodes; ++m) {
       tt->dims[m] = rinfo->global_dims[m];
@@ -839,6 +903,7 @@ sptensor_t * mpi_tt_read(
   }
 
   tt_free(ttbuf);
+  mem_tag_end(prev_tag);
   timer_stop(&timers[TIMER_IO]);
   return tt;
 }
@@ -857,21 +922,13 @@ void mpi_filter_tt_1d(
     ftt->dims[m] = tt->dims[m];
   }
 
-  idx_t const olds = start;
-  idx_t const olde = end;
-  /* Adjust start and end if tt has been compressed. */
+  /* Adjust start and end if tt has been compressed. The first and last
+   * slices of my range may be missing locally, so search for the first
+   * local slices at or beyond them. */
   assert(start != end);
   if(tt->indmap[mode] != NULL) {
-    /* TODO: change this linear search into a binary one */
-    for(idx_t i=0; i < tt->dims[mode]; ++i) {
-      if(tt->indmap[mode][i] == start) {
-        start = i;
-      }
-      if(tt->indmap[mode][i]+1 == end) {
-        end = i+1;
-        break;
-      }
-    }
+    start = p_lower_bound(tt->indmap[mode], tt->dims[mode], start);
+    end = p_lower_bound(tt->indmap[mode], tt->dims[mode], end);
   }
 
   idx_t nnz = 0;
@@ -901,8 +958,9 @@ void mpi_filter_tt_1d(
     if(tt->indmap[m] == NULL) {
       break;
     }
-    ftt->indmap[m] = (idx_t *) realloc(ftt->indmap[m],
-        ftt->dims[m] * sizeof(idx_t));
+    /* indmap is overwritten below, so there is nothing to copy */
+    splatt_free(ftt->indmap[m]);
+    ftt->indmap[m] = splatt_malloc(ftt->dims[m] * sizeof(idx_t));
 
     /* mode indices are shifted. otherwise just copy */
     if(m == mode) {
@@ -1014,8 +1072,8 @@ void mpi_write_mats(
 
   if(rinfo->rank == 0) {
     mat_free(matbuf);
-    free(vbuf);
-    free(loc_iperm);
+    splatt_free(vbuf);
+    splatt_free(loc_iperm);
   }
 }
 
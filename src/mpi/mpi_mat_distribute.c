@@ -222,6 +222,8 @@ static idx_t p_tryclaim_rows(
 * @param localdim The size of 'inds'.
 * @param rinfo MPI rank information.
 * @param claimed An array marking which rows have been claimed.
+* @param pcount How many ranks have a nonzero in each row. Empty rows are
+*               never claimed.
 * @param layerdim The dimension of the layer.
 * @param newclaims An array of newly claimed rows.
 *
@@ -233,6 +235,7 @@ static idx_t p_mustclaim_rows(
   idx_t const localdim,
   rank_info const * const rinfo,
   char * const claimed,
+  int const * const pcount,
   idx_t const layerdim,
   idx_t * const newclaims)
 {
@@ -246,7 +249,7 @@ static idx_t p_mustclaim_rows(
 
   /* just grab the first amt unclaimed rows */
   for(idx_t i=0; i < layerdim; ++i) {
-    if(claimed[i] == 0) {
+    if(claimed[i] == 0 && pcount[i] > 0) {
       newclaims[newrows++] = i;
       claimed[i] = 1;
       if(newrows == amt) {
@@ -323,8 +326,8 @@ static void p_distribute_u3_rows(
         nclaimed = p_tryclaim_rows(amt, inds, localdim, rinfo, claimed, dim,
             myclaims);
       } else {
-        nclaimed = p_mustclaim_rows(amt, inds, localdim, rinfo, claimed, dim,
-            myclaims);
+        nclaimed = p_mustclaim_rows(amt, inds, localdim, rinfo, claimed,
+            pcount, dim, myclaims);
       }
 
       /* send new claims to root process */
@@ -358,8 +361,8 @@ static void p_distribute_u3_rows(
     }
   }
 
-  free(bufclaims);
-  free(myclaims);
+  splatt_free(bufclaims);
+  splatt_free(myclaims);
   free(claimed);
 
   MPI_Barrier(comm);
@@ -528,23 +531,42 @@ static void p_greedy_mat_distribution(
     MPI_Allreduce(MPI_IN_PLACE, newlabels, layerdim, SPLATT_MPI_IDX, MPI_SUM,
         rinfo->layer_comm[m]);
 
+    idx_t nclaimed;
+    MPI_Allreduce(&nrows, &nclaimed, 1, SPLATT_MPI_IDX, MPI_SUM,
+        rinfo->layer_comm[m]);
+
     /* fill perm: inewlabels[oldlayerindex] = newlayerindex */
     for(idx_t i=0; i < layerdim; ++i) {
+      inewlabels[i] = layerdim;
+    }
+    for(idx_t i=0; i < nclaimed; ++i) {
       assert(newlabels[i] < layerdim);
       inewlabels[newlabels[i]] = i;
     }
 
+    /* Empty slices are never claimed. Label them after all claimed rows
+     * instead of leaving them at 0, which would clobber the row whose old
+     * index is 0. */
+    idx_t next = nclaimed;
+    for(idx_t i=0; i < layerdim; ++i) {
+      if(inewlabels[i] == layerdim) {
+        newlabels[next] = i;
+        inewlabels[i] = next++;
+      }
+    }
+    assert(next == layerdim);
+
     /* store matrix info */
     rinfo->mat_start[m] = rowoffset;
     rinfo->mat_end[m] = SS_MIN(rinfo->mat_start[m] + nrows, layerdim);
 
-    free(inds);
-    free(pvols);
+    splatt_free(inds);
+    splatt_free(pvols);
     MPI_Barrier(rinfo->layer_comm[m]);
   } /* foreach mode */
 
-  free(pcount);
-  free(mine);
+  splatt_free(pcount);
+  splatt_free(mine);
 }
 
 
@@ -567,8 +589,9 @@ static void p_setup_mat_ptrs(
   MPI_Comm_rank(comm, &rank);
 
   /* allocate space for start/end idxs */
-  rinfo->mat_ptrs[mode] = (idx_t *) calloc(npes + 1, sizeof(idx_t));
+  rinfo->mat_ptrs[mode] = (idx_t *) splatt_malloc((npes+1) * sizeof(idx_t));
   idx_t * const mat_ptrs = rinfo->mat_ptrs[mode];
+  memset(mat_ptrs, 0, (npes+1) * sizeof(idx_t));
 
   mat_ptrs[rank] = rinfo->mat_start[mode];
   mat_ptrs[npes] = rinfo->layer_ends[mode] - rinfo->layer_starts[mode];
@@ -592,13 +615,16 @@ permutation_t * mpi_distribute_mats(
   sptensor_t * const tt,
   splatt_decomp_type const distribution)
 {
+  splatt_mem_tag const prev_tag = mem_tag_begin(SPLATT_MEM_MPI);
   permutation_t * perm = perm_identity(tt->dims, tt->nmodes);
   switch(distribution) {
   case SPLATT_DECOMP_COARSE:
     /* assign simple 1D matrix distribution */
     for(idx_t m=0; m < tt->nmodes; ++m) {
       /* allocate space for start/end idxs */
-      rinfo->mat_ptrs[m] = (idx_t *) calloc(rinfo->npes + 1, sizeof(idx_t));
+      rinfo->mat_ptrs[m] = (idx_t *) splatt_malloc((rinfo->npes + 1) *
+          sizeof(idx_t));
+      memset(rinfo->mat_ptrs[m], 0, (rinfo->npes + 1) * sizeof(idx_t));
       rinfo->mat_ptrs[m][rinfo->rank] = rinfo->mat_start[m];
       rinfo->mat_ptrs[m][rinfo->npes] = rinfo->global_dims[m];
 
@@ -621,6 +647,7 @@ permutation_t * mpi_distribute_mats(
     }
     break;
   }
+  mem_tag_end(prev_tag);
   return perm;
 }
 
@@ -653,11 +680,12 @@ void mpi_find_owned(
     rinfo->ownend[m] = 0;
   }
 
-  /* sanity check to ensure owned rows are contiguous */
+  /* sanity check to ensure owned rows are contiguous locally. Their global
+   * rows may have gaps where I have no nonzeros. */
   if(indmap != NULL) {
     for(idx_t i=rinfo->ownstart[m]+1; i < rinfo->ownend[m]; ++i) {
       assert(indmap[i] >= start && indmap[i] < end);
-      assert(indmap[i] == indmap[i-1]+1);
+      assert(indmap[i] > indmap[i-1]);
     }
   }
 }
@@ -0,0 +1,200 @@
+/******************************************************************************
+ * INCLUDES
+ *****************************************************************************/
+#include "../splatt_mpi.h"
+#include "../timer.h"
+
+
+/******************************************************************************
+ * PRIVATE DEFINES
+ *****************************************************************************/
+
+/*
+ * Reductions smaller than this go straight to MPI_Allreduce(). Below it, the
+ * node barriers cost more than the shared window saves: on one node with
+ * four ranks, the flat reduction wins up to 256 doubles and loses from 512.
+ */
+#define NODE_REDUCE_MIN_BYTES 4096
+
+
+/******************************************************************************
+ * PRIVATE FUNCTIONS
+ *****************************************************************************/
+
+/**
+* @brief Make the shared window consistent and wait for all ranks on the node.
+*
+* @param rinfo MPI rank information.
+*/
+static inline void p_node_fence(
+  rank_info const * const rinfo)
+{
+  MPI_Win_sync(rinfo->node_win);
+  MPI_Barrier(rinfo->node_comm);
+  MPI_Win_sync(rinfo->node_win);
+}
+
+
+/**
+* @brief Combine the node ranks' contributions of entries [start, end) into
+*        the result slot.
+*
+* @param slots The shared window. Slot p belongs to node rank p and the
+*              result follows the last slot.
+* @param stride The number of values in each slot.
+* @param nslots The number of ranks on the node.
+* @param start The first entry to combine.
+* @param end One past the last entry to combine.
+* @param op MPI_SUM or MPI_MAX.
+*/
+static void p_node_combine(
+  val_t * const restrict slots,
+  idx_t const stride,
+  int const nslots,
+  idx_t const start,
+  idx_t const end,
+  MPI_Op const op)
+{
+  val_t * const restrict result = slots + (nslots * stride);
+
+  for(idx_t i=start; i < end; ++i) {
+    result[i] = slots[i];
+  }
+  for(int p=1; p < nslots; ++p) {
+    val_t const * const restrict pvals = slots + (p * stride);
+    if(op == MPI_MAX) {
+      for(idx_t i=start; i < end; ++i) {
+        result[i] = SS_MAX(result[i], pvals[i]);
+      }
+    } else {
+      for(idx_t i=start; i < end; ++i) {
+        result[i] += pvals[i];
+      }
+    }
+  }
+}
+
+
+/******************************************************************************
+ * PUBLIC FUNCTIONS
+ *****************************************************************************/
+
+bool mpi_node_shared(
+  rank_info const * const rinfo,
+  size_t const bytes)
+{
+  return rinfo->node_win != MPI_WIN_NULL && bytes >= NODE_REDUCE_MIN_BYTES;
+}
+
+
+void mpi_node_init(
+  rank_info * const rinfo,
+  idx_t const maxcount)
+{
+  /* ranks which can share memory */
+  MPI_Comm_split_type(rinfo->comm_3d, MPI_COMM_TYPE_SHARED, rinfo->rank,
+      MPI_INFO_NULL, &(rinfo->node_comm));
+  MPI_Comm_rank(rinfo->node_comm, &(rinfo->node_rank));
+  MPI_Comm_size(rinfo->node_comm, &(rinfo->node_size));
+
+  /* one leader per node talks across nodes */
+  int const color = (rinfo->node_rank == 0) ? 0 : MPI_UNDEFINED;
+  MPI_Comm_split(rinfo->comm_3d, color, rinfo->rank, &(rinfo->leader_comm));
+
+  /* The leader allocates one slot per node rank plus the result, so the
+   * window is contiguous and every rank addresses it from the same base. */
+  rinfo->node_slot = maxcount;
+  MPI_Aint bytes = 0;
+  if(rinfo->node_rank == 0) {
+    bytes = (rinfo->node_size + 1) * maxcount * sizeof(val_t);
+  }
+  val_t * mybase;
+  MPI_Win_allocate_shared(bytes, sizeof(val_t), MPI_INFO_NULL,
+      rinfo->node_comm, &mybase, &(rinfo->node_win));
+
+  MPI_Aint qbytes;
+  int disp_unit;
+  MPI_Win_shared_query(rinfo->node_win, 0, &qbytes, &disp_unit,
+      &(rinfo->node_buf));
+
+  MPI_Win_lock_all(MPI_MODE_NOCHECK, rinfo->node_win);
+}
+
+
+void mpi_node_free(
+  rank_info * const rinfo)
+{
+  if(rinfo->node_win == MPI_WIN_NULL) {
+    return;
+  }
+
+  MPI_Win_unlock_all(rinfo->node_win);
+  MPI_Win_free(&(rinfo->node_win));
+  if(rinfo->leader_comm != MPI_COMM_NULL) {
+    MPI_Comm_free(&(rinfo->leader_comm));
+  }
+  MPI_Comm_free(&(rinfo->node_comm));
+
+  rinfo->node_win = MPI_WIN_NULL;
+  rinfo->node_buf = NULL;
+}
+
+
+void mpi_node_allreduce(
+  void const * const sendbuf,
+  void * const recvbuf,
+  idx_t const count,
+  MPI_Datatype const type,
+  MPI_Op const op,
+  rank_info * const rinfo)
+{
+  int typebytes;
+  MPI_Type_size(type, &typebytes);
+  size_t const bytes = count * typebytes;
+
+  /* flat reduction if node-aware reductions are not enabled or not worth it */
+  if(!mpi_node_shared(rinfo, bytes)) {
+    void const * const sbuf = (sendbuf == recvbuf) ? MPI_IN_PLACE : sendbuf;
+    MPI_Allreduce(sbuf, recvbuf, count, type, op, rinfo->comm_3d);
+    return;
+  }
+  assert(bytes <= rinfo->node_slot * sizeof(val_t));
+
+  idx_t const stride = rinfo->node_slot;
+  int const nrank = rinfo->node_rank;
+  int const nsize = rinfo->node_size;
+  val_t * const slots = rinfo->node_buf;
+  val_t * const result = slots + (nsize * stride);
+
+  /* publish my contribution */
+  memcpy(slots + (nrank * stride), sendbuf, bytes);
+  p_node_fence(rinfo);
+
+  if(type == SPLATT_MPI_VAL && (op == MPI_SUM || op == MPI_MAX)) {
+    /* each node rank combines a contiguous chunk of the entries */
+    idx_t const chunk = (count + nsize - 1) / nsize;
+    idx_t const start = SS_MIN(count, nrank * chunk);
+    idx_t const end = SS_MIN(count, start + chunk);
+    p_node_combine(slots, stride, nsize, start, end, op);
+  } else if(nrank == 0) {
+    /* arbitrary ops may not be split, so the leader does it alone */
+    memcpy(result, slots, bytes);
+    for(int p=1; p < nsize; ++p) {
+      MPI_Reduce_local(slots + (p * stride), result, count, type, op);
+    }
+  }
+  p_node_fence(rinfo);
+
+  /* only node leaders go across the network, if there is more than one */
+  if(nsize < rinfo->npes) {
+    if(rinfo->leader_comm != MPI_COMM_NULL) {
+      MPI_Allreduce(MPI_IN_PLACE, result, count, type, op,
+          rinfo->leader_comm);
+    }
+    p_node_fence(rinfo);
+  }
+
+  /* The result is not overwritten until after the first fence of the next
+   * reduction, which every rank reaches only after copying. */
+  memcpy(recvbuf, result, bytes);
+}
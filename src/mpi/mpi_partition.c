@@ -0,0 +1,626 @@
+/******************************************************************************
+ * INCLUDES
+ *****************************************************************************/
+#include "../splatt_mpi.h"
+#include "../sort.h"
+
+#include <limits.h>
+#include <math.h>
+
+
+/******************************************************************************
+ * PRIVATE DEFINES
+ *****************************************************************************/
+
+/* Allowed nonzero imbalance of the parts. */
+#define PART_IMBALANCE 1.03
+
+/* How many batches each pass is split into. Row claims and part loads are
+ * synchronized among ranks after every batch. Each row has a home rank
+ * (row % npes) which resolves its claims and forwards the winner to every
+ * rank that touches the row, so no rank stores a whole mode. */
+#define PART_NBATCHES 8
+
+/* A row which has not been claimed by any part. */
+#define PART_NONE INT_MAX
+
+
+/******************************************************************************
+ * PRIVATE STRUCTURES
+ *****************************************************************************/
+
+/**
+* @brief The state shared by the streaming and refinement passes.
+*/
+typedef struct
+{
+  int npes;
+  int rank;
+  idx_t nmodes;
+
+  /* the rows touched by my nonzeros, sorted, and their owning parts */
+  idx_t nrows[MAX_NMODES];
+  idx_t * rows[MAX_NMODES];
+  int * owner[MAX_NMODES];
+  /* lind[m][n] is the index into rows[m] of my nonzero n */
+  idx_t * lind[MAX_NMODES];
+  /* my rows claimed during this batch, as indices into rows[m] */
+  idx_t nclaimed[MAX_NMODES];
+  idx_t * claimed[MAX_NMODES];
+
+  /* rows whose home I am: row r is in slot r / npes */
+  int * home_owner[MAX_NMODES];
+  bool * home_changed[MAX_NMODES];
+  /* which ranks touch my home rows: sub_rows[sub_ptr[p]:sub_ptr[p+1]] */
+  int * sub_ptr[MAX_NMODES];
+  idx_t * sub_rows[MAX_NMODES];
+
+  idx_t capacity;   /** maximum nonzeros in a part */
+  idx_t * load;     /** global nonzeros per part at the start of the batch */
+  idx_t * avail;    /** my share of each part's remaining capacity */
+  int64_t * delta;  /** my changes to 'load' during this batch */
+  int cursor;       /** next part to try for unconnected nonzeros */
+} part_state;
+
+
+/******************************************************************************
+ * PRIVATE FUNCTIONS
+ *****************************************************************************/
+
+/**
+* @brief Split each part's remaining capacity evenly among the ranks, so that
+*        parts cannot overflow while ranks work independently on a batch.
+*
+* @param state The partitioning state.
+*/
+static void p_fill_avail(
+  part_state * const state)
+{
+  for(int p=0; p < state->npes; ++p) {
+    idx_t const left = (state->load[p] < state->capacity) ?
+        state->capacity - state->load[p] : 0;
+    state->avail[p] = left / state->npes;
+    state->delta[p] = 0;
+  }
+}
+
+
+/**
+* @brief Exchange variable-sized blocks of indices among all ranks.
+*
+* @param sbuf The indices to send, grouped by destination.
+* @param scounts The number of indices for each rank.
+* @param[out] rcounts The number of indices from each rank.
+* @param[out] rbuf The received indices, grouped by source. Must be freed.
+* @param npes The number of ranks.
+* @param comm The communicator.
+*
+* @return The number of received indices.
+*/
+static idx_t p_exchange(
+  idx_t const * const sbuf,
+  int const * const scounts,
+  int * const rcounts,
+  idx_t ** rbuf,
+  int const npes,
+  MPI_Comm comm)
+{
+  MPI_Alltoall(scounts, 1, MPI_INT, rcounts, 1, MPI_INT, comm);
+
+  int * sdispls = splatt_malloc(npes * sizeof(*sdispls));
+  int * rdispls = splatt_malloc(npes * sizeof(*rdispls));
+  int stotal = 0;
+  int rtotal = 0;
+  for(int p=0; p < npes; ++p) {
+    sdispls[p] = stotal;
+    rdispls[p] = rtotal;
+    stotal += scounts[p];
+    rtotal += rcounts[p];
+  }
+
+  *rbuf = splatt_malloc(SS_MAX(rtotal, 1) * sizeof(**rbuf));
+  MPI_Alltoallv(sbuf, scounts, sdispls, SPLATT_MPI_IDX, *rbuf, rcounts,
+      rdispls, SPLATT_MPI_IDX, comm);
+
+  splatt_free(sdispls);
+  splatt_free(rdispls);
+  return (idx_t) rtotal;
+}
+
+
+/**
+* @brief Find a row among the rows that my nonzeros touch.
+*
+* @param state The partitioning state.
+* @param m The mode.
+* @param row The global row, which must be one of mine.
+*
+* @return The index of 'row' in state->rows[m].
+*/
+static idx_t p_local_row(
+  part_state const * const state,
+  idx_t const m,
+  idx_t const row)
+{
+  idx_t const * const rows = state->rows[m];
+  idx_t lo = 0;
+  idx_t hi = state->nrows[m];
+  while(lo < hi) {
+    idx_t const mid = lo + ((hi - lo) / 2);
+    if(rows[mid] < row) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  assert(lo < state->nrows[m] && rows[lo] == row);
+  return lo;
+}
+
+
+/**
+* @brief Find the rows of a mode that my nonzeros touch, and subscribe to
+*        their claims at their home ranks.
+*
+* @param tt My nonzeros.
+* @param m The mode.
+* @param dim The global dimension of the mode.
+* @param state The partitioning state.
+* @param comm The communicator to partition among.
+*/
+static void p_init_rows(
+  sptensor_t const * const tt,
+  idx_t const m,
+  idx_t const dim,
+  part_state * const state,
+  MPI_Comm comm)
+{
+  int const npes = state->npes;
+
+  /* sorted unique rows, and the row of each nonzero */
+  idx_t * rows = splatt_malloc(SS_MAX(tt->nnz, 1) * sizeof(*rows));
+  memcpy(rows, tt->ind[m], tt->nnz * sizeof(*rows));
+  quicksort(rows, tt->nnz);
+  idx_t nrows = 0;
+  for(idx_t n=0; n < tt->nnz; ++n) {
+    if(nrows == 0 || rows[nrows-1] != rows[n]) {
+      rows[nrows++] = rows[n];
+    }
+  }
+  state->nrows[m] = nrows;
+  state->rows[m] = rows;
+
+  state->lind[m] = splatt_malloc(SS_MAX(tt->nnz, 1) *
+      sizeof(**(state->lind)));
+  #pragma omp parallel for schedule(static)
+  for(idx_t n=0; n < tt->nnz; ++n) {
+    state->lind[m][n] = p_local_row(state, m, tt->ind[m][n]);
+  }
+
+  state->owner[m] = splatt_malloc(SS_MAX(nrows, 1) *
+      sizeof(**(state->owner)));
+  state->claimed[m] = splatt_malloc(SS_MAX(nrows, 1) *
+      sizeof(**(state->claimed)));
+  for(idx_t i=0; i < nrows; ++i) {
+    state->owner[m][i] = PART_NONE;
+  }
+  state->nclaimed[m] = 0;
+
+  /* my home rows */
+  idx_t const nhome = (dim > (idx_t) state->rank) ?
+      (dim - state->rank + npes - 1) / npes : 0;
+  state->home_owner[m] = splatt_malloc(SS_MAX(nhome, 1) *
+      sizeof(**(state->home_owner)));
+  state->home_changed[m] = splatt_malloc(SS_MAX(nhome, 1) *
+      sizeof(**(state->home_changed)));
+  for(idx_t i=0; i < nhome; ++i) {
+    state->home_owner[m][i] = PART_NONE;
+    state->home_changed[m][i] = false;
+  }
+
+  /* tell each home which of its rows I touch */
+  int * scounts = splatt_malloc(npes * sizeof(*scounts));
+  int * rcounts = splatt_malloc(npes * sizeof(*rcounts));
+  int * sptr = splatt_malloc((npes+1) * sizeof(*sptr));
+  for(int p=0; p < npes; ++p) {
+    scounts[p] = 0;
+  }
+  for(idx_t i=0; i < nrows; ++i) {
+    ++scounts[rows[i] % npes];
+  }
+  sptr[0] = 0;
+  for(int p=0; p < npes; ++p) {
+    sptr[p+1] = sptr[p] + scounts[p];
+  }
+  idx_t * sbuf = splatt_malloc(SS_MAX(nrows, 1) * sizeof(*sbuf));
+  for(idx_t i=0; i < nrows; ++i) {
+    sbuf[sptr[rows[i] % npes]++] = rows[i];
+  }
+
+  p_exchange(sbuf, scounts, rcounts, &(state->sub_rows[m]), npes, comm);
+  state->sub_ptr[m] = sptr;
+  sptr[0] = 0;
+  for(int p=0; p < npes; ++p) {
+    sptr[p+1] = sptr[p] + rcounts[p];
+  }
+
+  splatt_free(sbuf);
+  splatt_free(scounts);
+  splatt_free(rcounts);
+}
+
+
+/**
+* @brief Resolve the rows claimed during a batch. Claims go to the home of
+*        each row, the lowest part wins, and homes forward changed owners to
+*        every rank that touches the row.
+*
+* @param state The partitioning state.
+* @param m The mode.
+* @param comm The communicator to synchronize with.
+*/
+static void p_sync_claims(
+  part_state * const state,
+  idx_t const m,
+  MPI_Comm comm)
+{
+  int const npes = state->npes;
+  idx_t const nclaimed = state->nclaimed[m];
+  int * scounts = splatt_malloc(npes * sizeof(*scounts));
+  int * rcounts = splatt_malloc(npes * sizeof(*rcounts));
+  int * sptr = splatt_malloc(npes * sizeof(*sptr));
+
+  /* (row, part) pairs to the home of each row */
+  for(int p=0; p < npes; ++p) {
+    scounts[p] = 0;
+  }
+  for(idx_t c=0; c < nclaimed; ++c) {
+    scounts[state->rows[m][state->claimed[m][c]] % npes] += 2;
+  }
+  sptr[0] = 0;
+  for(int p=1; p < npes; ++p) {
+    sptr[p] = sptr[p-1] + scounts[p-1];
+  }
+  idx_t * sbuf = splatt_malloc(SS_MAX(2 * nclaimed, 1) * sizeof(*sbuf));
+  for(idx_t c=0; c < nclaimed; ++c) {
+    idx_t const i = state->claimed[m][c];
+    idx_t const row = state->rows[m][i];
+    int const slot = sptr[row % npes];
+    sbuf[slot] = row;
+    sbuf[slot+1] = (idx_t) state->owner[m][i];
+    sptr[row % npes] += 2;
+  }
+  state->nclaimed[m] = 0;
+
+  idx_t * rbuf;
+  idx_t const nrecv = p_exchange(sbuf, scounts, rcounts, &rbuf, npes, comm);
+  splatt_free(sbuf);
+
+  int * const home_owner = state->home_owner[m];
+  bool * const home_changed = state->home_changed[m];
+  for(idx_t x=0; x < nrecv; x += 2) {
+    idx_t const slot = rbuf[x] / npes;
+    int const part = (int) rbuf[x+1];
+    if(part < home_owner[slot]) {
+      home_owner[slot] = part;
+      home_changed[slot] = true;
+    }
+  }
+
+  /* (row, owner) pairs to every rank touching a changed row */
+  int const * const sub_ptr = state->sub_ptr[m];
+  idx_t const * const sub_rows = state->sub_rows[m];
+  idx_t nupdates = 0;
+  for(int p=0; p < npes; ++p) {
+    scounts[p] = 0;
+    for(int x=sub_ptr[p]; x < sub_ptr[p+1]; ++x) {
+      if(home_changed[sub_rows[x] / npes]) {
+        scounts[p] += 2;
+      }
+    }
+    nupdates += scounts[p];
+  }
+  sbuf = splatt_malloc(SS_MAX(nupdates, 1) * sizeof(*sbuf));
+  idx_t ptr = 0;
+  for(int p=0; p < npes; ++p) {
+    for(int x=sub_ptr[p]; x < sub_ptr[p+1]; ++x) {
+      idx_t const slot = sub_rows[x] / npes;
+      if(home_changed[slot]) {
+        sbuf[ptr++] = sub_rows[x];
+        sbuf[ptr++] = (idx_t) home_owner[slot];
+      }
+    }
+  }
+  for(idx_t x=0; x < nrecv; x += 2) {
+    home_changed[rbuf[x] / npes] = false;
+  }
+  splatt_free(rbuf);
+
+  idx_t const nupd = p_exchange(sbuf, scounts, rcounts, &rbuf, npes, comm);
+  for(idx_t x=0; x < nupd; x += 2) {
+    state->owner[m][p_local_row(state, m, rbuf[x])] = (int) rbuf[x+1];
+  }
+
+  splatt_free(rbuf);
+  splatt_free(sbuf);
+  splatt_free(scounts);
+  splatt_free(rcounts);
+  splatt_free(sptr);
+}
+
+
+/**
+* @brief Combine the loads and row claims of all ranks after a batch. When
+*        several parts claimed the same row, the lowest part wins.
+*
+* @param state The partitioning state.
+* @param claims Whether rows may have been claimed during this batch.
+* @param comm The communicator to synchronize with.
+*/
+static void p_sync_batch(
+  part_state * const state,
+  bool const claims,
+  MPI_Comm comm)
+{
+  MPI_Allreduce(MPI_IN_PLACE, state->delta, state->npes, MPI_INT64_T, MPI_SUM,
+      comm);
+  for(int p=0; p < state->npes; ++p) {
+    state->load[p] += state->delta[p];
+  }
+
+  if(claims) {
+    for(idx_t m=0; m < state->nmodes; ++m) {
+      p_sync_claims(state, m, comm);
+    }
+  }
+}
+
+
+/**
+* @brief Count how many of a nonzero's rows are owned by part 'p'.
+*
+* @param tt The tensor.
+* @param n The nonzero.
+* @param p The part.
+* @param state The partitioning state.
+*
+* @return The number of modes whose row belongs to 'p'.
+*/
+static inline idx_t p_connectivity(
+  sptensor_t const * const tt,
+  idx_t const n,
+  int const p,
+  part_state const * const state)
+{
+  idx_t conn = 0;
+  for(idx_t m=0; m < tt->nmodes; ++m) {
+    if(state->owner[m][state->lind[m][n]] == p) {
+      ++conn;
+    }
+  }
+  return conn;
+}
+
+
+/**
+* @brief Find the part, with capacity left, which owns the most rows of a
+*        nonzero. Ties go to the less loaded part.
+*
+* @param tt The tensor.
+* @param n The nonzero.
+* @param state The partitioning state.
+* @param[out] bestconn The connectivity of the chosen part.
+*
+* @return The chosen part, or -1 if no connected part has capacity left.
+*/
+static int p_best_connected(
+  sptensor_t const * const tt,
+  idx_t const n,
+  part_state const * const state,
+  idx_t * const bestconn)
+{
+  int best = -1;
+  *bestconn = 0;
+  for(idx_t m=0; m < tt->nmodes; ++m) {
+    int const p = state->owner[m][state->lind[m][n]];
+    if(p == PART_NONE || p == best || state->avail[p] == 0) {
+      continue;
+    }
+    idx_t const conn = p_connectivity(tt, n, p, state);
+    if(conn > *bestconn || (conn == *bestconn &&
+        state->load[p] + state->delta[p] < state->load[best] +
+        state->delta[best])) {
+      best = p;
+      *bestconn = conn;
+    }
+  }
+  return best;
+}
+
+
+/**
+* @brief Choose a part for a nonzero which is not connected to any part with
+*        capacity left. Each rank starts from its own part so that nonzeros
+*        tend to stay where they were read.
+*
+* @param state The partitioning state.
+*
+* @return The chosen part.
+*/
+static int p_next_open(
+  part_state * const state)
+{
+  for(int tries=0; tries < state->npes; ++tries) {
+    if(state->avail[state->cursor] > 0) {
+      return state->cursor;
+    }
+    state->cursor = (state->cursor + 1) % state->npes;
+  }
+
+  /* every share is used up (rounding) -- take the least loaded part */
+  int best = 0;
+  for(int p=1; p < state->npes; ++p) {
+    if(state->load[p] + state->delta[p] <
+        state->load[best] + state->delta[best]) {
+      best = p;
+    }
+  }
+  return best;
+}
+
+
+/**
+* @brief Move one nonzero's worth of load between parts.
+*
+* @param state The partitioning state.
+* @param from The old part, or -1 if the nonzero was unassigned.
+* @param to The new part.
+*/
+static inline void p_move(
+  part_state * const state,
+  int const from,
+  int const to)
+{
+  if(from >= 0) {
+    state->delta[from] -= 1;
+  }
+  state->delta[to] += 1;
+  if(state->avail[to] > 0) {
+    state->avail[to] -= 1;
+  }
+}
+
+
+/**
+* @brief Streaming pass: each nonzero is placed in the part owning most of
+*        its rows and claims its unowned rows for that part.
+*
+* @param tt My nonzeros.
+* @param parts The output partitioning.
+* @param state The partitioning state.
+* @param comm The communicator to partition among.
+*/
+static void p_stream_pass(
+  sptensor_t const * const tt,
+  int * const parts,
+  part_state * const state,
+  MPI_Comm comm)
+{
+  idx_t const batch = (tt->nnz + PART_NBATCHES - 1) / PART_NBATCHES;
+
+  for(idx_t b=0; b < PART_NBATCHES; ++b) {
+    p_fill_avail(state);
+
+    idx_t const start = SS_MIN(b * batch, tt->nnz);
+    idx_t const end = SS_MIN(start + batch, tt->nnz);
+    for(idx_t n=start; n < end; ++n) {
+      idx_t conn;
+      int p = p_best_connected(tt, n, state, &conn);
+      if(p < 0) {
+        p = p_next_open(state);
+      }
+      parts[n] = p;
+      p_move(state, -1, p);
+
+      for(idx_t m=0; m < tt->nmodes; ++m) {
+        idx_t const row = state->lind[m][n];
+        if(state->owner[m][row] == PART_NONE) {
+          state->owner[m][row] = p;
+          state->claimed[m][state->nclaimed[m]++] = row;
+        }
+      }
+    }
+
+    p_sync_batch(state, true, comm);
+  }
+}
+
+
+/**
+* @brief Refinement pass: with the row owners now fixed, revisit every
+*        nonzero and move it if another part owns more of its rows. Nonzeros
+*        placed early in the stream, before their rows were claimed, benefit
+*        most.
+*
+* @param tt My nonzeros.
+* @param parts The partitioning to refine.
+* @param state The partitioning state.
+* @param comm The communicator to partition among.
+*/
+static void p_refine_pass(
+  sptensor_t const * const tt,
+  int * const parts,
+  part_state * const state,
+  MPI_Comm comm)
+{
+  idx_t const batch = (tt->nnz + PART_NBATCHES - 1) / PART_NBATCHES;
+
+  for(idx_t b=0; b < PART_NBATCHES; ++b) {
+    p_fill_avail(state);
+
+    idx_t const start = SS_MIN(b * batch, tt->nnz);
+    idx_t const end = SS_MIN(start + batch, tt->nnz);
+    for(idx_t n=start; n < end; ++n) {
+      int const curr = parts[n];
+      idx_t conn;
+      int const p = p_best_connected(tt, n, state, &conn);
+      if(p >= 0 && p != curr && conn > p_connectivity(tt, n, curr, state)) {
+        parts[n] = p;
+        p_move(state, curr, p);
+      }
+    }
+
+    p_sync_batch(state, false, comm);
+  }
+}
+
+
+/******************************************************************************
+ * PUBLIC FUNCTIONS
+ *****************************************************************************/
+
+int * mpi_stream_partition(
+  sptensor_t const * const tt,
+  rank_info const * const rinfo)
+{
+  /* this runs before the communicators are set up */
+  MPI_Comm const comm = MPI_COMM_WORLD;
+
+  part_state state;
+  MPI_Comm_size(comm, &(state.npes));
+  MPI_Comm_rank(comm, &(state.rank));
+  state.nmodes = tt->nmodes;
+  state.capacity = (idx_t) ceil(PART_IMBALANCE * (double) rinfo->global_nnz /
+      (double) state.npes);
+  state.load = splatt_malloc(state.npes * sizeof(*(state.load)));
+  state.avail = splatt_malloc(state.npes * sizeof(*(state.avail)));
+  state.delta = splatt_malloc(state.npes * sizeof(*(state.delta)));
+  MPI_Comm_rank(comm, &(state.cursor));
+  for(int p=0; p < state.npes; ++p) {
+    state.load[p] = 0;
+  }
+  for(idx_t m=0; m < tt->nmodes; ++m) {
+    p_init_rows(tt, m, rinfo->global_dims[m], &state, comm);
+  }
+
+  int * parts = splatt_malloc(SS_MAX(tt->nnz, 1) * sizeof(*parts));
+
+  p_stream_pass(tt, parts, &state, comm);
+  p_refine_pass(tt, parts, &state, comm);
+
+  for(idx_t m=0; m < tt->nmodes; ++m) {
+    splatt_free(state.rows[m]);
+    splatt_free(state.owner[m]);
+    splatt_free(state.lind[m]);
+    splatt_free(state.claimed[m]);
+    splatt_free(state.home_owner[m]);
+    splatt_free(state.home_changed[m]);
+    splatt_free(state.sub_ptr[m]);
+    splatt_free(state.sub_rows[m]);
+  }
+  splatt_free(state.load);
+  splatt_free(state.avail);
+  splatt_free(state.delta);
+
+  return parts;
+}
@@ -0,0 +1,777 @@
+/******************************************************************************
+ * INCLUDES
+ *****************************************************************************/
+#include "../splatt_mpi.h"
+#include "../sort.h"
+#include "../timer.h"
+
+
+/******************************************************************************
+ * PRIVATE DEFINES
+ *****************************************************************************/
+
+/* Rebalance only if the slowest rank's MTTKRP time exceeds the average by
+ * this factor. Migration and rebuilding the CSF cost a few iterations. */
+#define REBALANCE_MIN_IMBALANCE 1.05
+
+
+/******************************************************************************
+ * PRIVATE FUNCTIONS
+ *****************************************************************************/
+
+/**
+* @brief Estimate the rate at which each rank processed its nonzeros during
+*        MTTKRP. Ranks without a measurement are assumed to run at the
+*        average rate.
+*
+* @param nnzs The number of nonzeros of each rank.
+* @param secs The MTTKRP time of each rank.
+* @param npes The number of ranks.
+* @param[out] rates The nonzeros per second of each rank.
+*/
+static void p_fill_rates(
+  idx_t const * const nnzs,
+  double const * const secs,
+  int const npes,
+  double * const rates)
+{
+  double avgrate = 0;
+  int nrates = 0;
+  for(int p=0; p < npes; ++p) {
+    rates[p] = 0;
+    if(nnzs[p] > 0 && secs[p] > 0) {
+      rates[p] = (double) nnzs[p] / secs[p];
+      avgrate += rates[p];
+      ++nrates;
+    }
+  }
+  avgrate = (nrates > 0) ? avgrate / nrates : 1.;
+
+  for(int p=0; p < npes; ++p) {
+    if(rates[p] == 0) {
+      rates[p] = avgrate;
+    }
+  }
+}
+
+
+/**
+* @brief Choose how many nonzeros each rank should hold. Targets are
+*        proportional to the rate of each rank.
+*
+* @param rates The nonzeros per second of each rank.
+* @param npes The number of ranks.
+* @param global_nnz The total number of nonzeros.
+* @param[out] targets The number of nonzeros each rank should hold.
+*/
+static void p_fill_targets(
+  double const * const rates,
+  int const npes,
+  idx_t const global_nnz,
+  idx_t * const targets)
+{
+  double totrate = 0;
+  for(int p=0; p < npes; ++p) {
+    totrate += rates[p];
+  }
+
+  idx_t assigned = 0;
+  for(int p=0; p < npes; ++p) {
+    targets[p] = (idx_t) ((double) global_nnz * rates[p] / totrate);
+    assigned += targets[p];
+  }
+  /* hand out what rounding left over */
+  for(int p=0; assigned < global_nnz; p = (p+1) % npes) {
+    ++targets[p];
+    ++assigned;
+  }
+}
+
+
+/**
+* @brief Match ranks with too many nonzeros to ranks with too few. Every rank
+*        computes the same matching, but only keeps its own sends.
+*
+* @param nnzs The number of nonzeros of each rank.
+* @param targets The number of nonzeros each rank should hold.
+* @param npes The number of ranks.
+* @param rank My rank.
+* @param[out] nsends The number of my nonzeros to send to each rank.
+*
+* @return The total number of nonzeros which move.
+*/
+static idx_t p_match_moves(
+  idx_t const * const nnzs,
+  idx_t const * const targets,
+  int const npes,
+  int const rank,
+  idx_t * const nsends)
+{
+  for(int p=0; p < npes; ++p) {
+    nsends[p] = 0;
+  }
+
+  idx_t nmoved = 0;
+  int recv = 0;
+  idx_t recv_left = 0;
+  for(int send=0; send < npes; ++send) {
+    if(nnzs[send] <= targets[send]) {
+      continue;
+    }
+    idx_t surplus = nnzs[send] - targets[send];
+    while(surplus > 0) {
+      /* find the next rank which can take nonzeros */
+      while(recv_left == 0) {
+        if(targets[recv] > nnzs[recv]) {
+          recv_left = targets[recv] - nnzs[recv];
+        } else {
+          ++recv;
+        }
+      }
+
+      idx_t const nmove = SS_MIN(surplus, recv_left);
+      if(send == rank) {
+        nsends[recv] += nmove;
+      }
+      surplus -= nmove;
+      recv_left -= nmove;
+      nmoved += nmove;
+      if(recv_left == 0) {
+        ++recv;
+      }
+    }
+  }
+
+  return nmoved;
+}
+
+
+/**
+* @brief Relabel my tensor with the row coordinates of the factor matrices
+*        (layer_starts + permuted layer index) and drop its indmap.
+*
+* @param tt My local tensor.
+* @param rinfo MPI rank information.
+*/
+static void p_globalize(
+  sptensor_t * const tt,
+  rank_info const * const rinfo)
+{
+  for(idx_t m=0; m < tt->nmodes; ++m) {
+    idx_t const offset = rinfo->layer_starts[m];
+    idx_t const * const indmap = tt->indmap[m];
+    idx_t * const ind = tt->ind[m];
+
+    #pragma omp parallel for schedule(static)
+    for(idx_t n=0; n < tt->nnz; ++n) {
+      ind[n] = offset + ((indmap == NULL) ? ind[n] : indmap[ind[n]]);
+    }
+
+    splatt_free(tt->indmap[m]);
+    tt->indmap[m] = NULL;
+    tt->dims[m] = rinfo->global_dims[m];
+  }
+}
+
+
+/**
+* @brief Compress my new tensor to its own coordinate system, like
+*        tt_remove_empty(). Rows that I own are always kept, even without
+*        nonzeros, because owned rows must be contiguous local rows.
+*
+* @param tt My new tensor, in the row coordinates of my layers.
+* @param rinfo MPI rank information.
+*/
+static void p_localize(
+  sptensor_t * const tt,
+  rank_info const * const rinfo)
+{
+  for(idx_t m=0; m < tt->nmodes; ++m) {
+    idx_t const dim = tt->dims[m];
+    idx_t * labels = splatt_malloc(dim * sizeof(*labels));
+    memset(labels, 0, dim * sizeof(*labels));
+    idx_t * const ind = tt->ind[m];
+
+    for(idx_t n=0; n < tt->nnz; ++n) {
+      labels[ind[n]] = 1;
+    }
+    for(idx_t i=rinfo->mat_start[m]; i < rinfo->mat_end[m]; ++i) {
+      labels[i] = 1;
+    }
+
+    idx_t nlocal = 0;
+    for(idx_t i=0; i < dim; ++i) {
+      nlocal += labels[i];
+    }
+
+    tt->dims[m] = nlocal;
+    if(nlocal == dim) {
+      tt->indmap[m] = NULL;
+      splatt_free(labels);
+      continue;
+    }
+
+    tt->indmap[m] = splatt_malloc(nlocal * sizeof(**(tt->indmap)));
+    idx_t ptr = 0;
+    for(idx_t i=0; i < dim; ++i) {
+      if(labels[i] == 1) {
+        tt->indmap[m][ptr] = i;
+        labels[i] = ptr++;
+      }
+    }
+
+    #pragma omp parallel for schedule(static)
+    for(idx_t n=0; n < tt->nnz; ++n) {
+      ind[n] = labels[ind[n]];
+    }
+
+    splatt_free(labels);
+  }
+}
+
+
+/**
+* @brief Find the range that contains an index.
+*
+* @param ptrs Range p is [ptrs[p], ptrs[p+1]).
+* @param nptrs The number of ranges.
+* @param idx The index to find, which must be in [ptrs[0], ptrs[nptrs]).
+*
+* @return The last range whose start is at most 'idx'.
+*/
+static int p_find_range(
+  idx_t const * const ptrs,
+  int const nptrs,
+  idx_t const idx)
+{
+  int lo = 0;
+  int hi = nptrs;
+  while(hi - lo > 1) {
+    int const mid = lo + ((hi - lo) / 2);
+    if(ptrs[mid] <= idx) {
+      lo = mid;
+    } else {
+      hi = mid;
+    }
+  }
+  return lo;
+}
+
+
+/**
+* @brief Split the slices of a mode into layers whose nonzero counts are
+*        proportional to 'weights', like mpi_find_layer_ptrs() does for equal
+*        weights. Each layer keeps at least one slice if the mode is long
+*        enough.
+*
+* @param ssize The number of nonzeros in each slice.
+* @param dim The number of slices.
+* @param weights The weight of each layer.
+* @param nlayers The number of layers.
+* @param[out] layer_ptrs Layer l is slices [layer_ptrs[l], layer_ptrs[l+1]).
+*/
+static void p_find_weighted_layer_ptrs(
+  idx_t const * const ssize,
+  idx_t const dim,
+  double const * const weights,
+  int const nlayers,
+  idx_t * const layer_ptrs)
+{
+  idx_t nnz = 0;
+  for(idx_t s=0; s < dim; ++s) {
+    nnz += ssize[s];
+  }
+  double totweight = 0;
+  for(int l=0; l < nlayers; ++l) {
+    totweight += weights[l];
+  }
+
+  layer_ptrs[0] = 0;
+  layer_ptrs[nlayers] = dim;
+
+  idx_t s = 0;
+  idx_t count = 0; /* nonzeros in slices [0, s) */
+  double cumweight = 0;
+  for(int l=1; l < nlayers; ++l) {
+    cumweight += weights[l-1];
+    double const target = (double) nnz * cumweight / totweight;
+
+    /* choose the boundary whose prefix count is closest to the target */
+    while(s < dim && (double) (count + ssize[s]) <= target) {
+      count += ssize[s++];
+    }
+    if(s < dim && (double) (count + ssize[s]) - target <
+        target - (double) count) {
+      count += ssize[s++];
+    }
+
+    /* leave a slice for this layer and each one after it */
+    idx_t ptr = SS_MAX(s, layer_ptrs[l-1] + 1);
+    idx_t const nleft = (idx_t) (nlayers - l);
+    ptr = SS_MIN(ptr, (dim > nleft) ? dim - nleft : dim);
+    ptr = SS_MAX(ptr, layer_ptrs[l-1]);
+    while(s < ptr) {
+      count += ssize[s++];
+    }
+    while(s > ptr) {
+      count -= ssize[--s];
+    }
+    layer_ptrs[l] = ptr;
+  }
+}
+
+
+/**
+* @brief Send factor rows, each tagged with an index, to other ranks.
+*
+* @param ids The index of each row.
+* @param vals The rows, row-major.
+* @param dests The rank in 'comm' which receives each row.
+* @param nrows The number of rows to send.
+* @param nfactors The number of columns.
+* @param comm The communicator to send over.
+* @param[out] recv_ids The indices of the rows I receive.
+* @param[out] recv_vals The rows I receive.
+*
+* @return The number of rows I receive.
+*/
+static idx_t p_send_rows(
+  idx_t const * const ids,
+  val_t const * const vals,
+  int const * const dests,
+  idx_t const nrows,
+  idx_t const nfactors,
+  MPI_Comm comm,
+  idx_t ** recv_ids,
+  val_t ** recv_vals)
+{
+  int npes;
+  MPI_Comm_size(comm, &npes);
+
+  int * nsend = splatt_malloc(npes * sizeof(*nsend));
+  int * nrecv = splatt_malloc(npes * sizeof(*nrecv));
+  int * send_disp = splatt_malloc((npes+1) * sizeof(*send_disp));
+  int * recv_disp = splatt_malloc((npes+1) * sizeof(*recv_disp));
+  for(int p=0; p < npes; ++p) {
+    nsend[p] = 0;
+  }
+  for(idx_t i=0; i < nrows; ++i) {
+    ++nsend[dests[i]];
+  }
+  MPI_Alltoall(nsend, 1, MPI_INT, nrecv, 1, MPI_INT, comm);
+
+  send_disp[0] = 0;
+  recv_disp[0] = 0;
+  for(int p=0; p < npes; ++p) {
+    send_disp[p+1] = send_disp[p] + nsend[p];
+    recv_disp[p+1] = recv_disp[p] + nrecv[p];
+  }
+  idx_t const nrecv_rows = (idx_t) recv_disp[npes];
+
+  /* pack by destination, using send_disp[p+1] as the cursor of rank p */
+  idx_t * sbuf_ids = splatt_malloc(SS_MAX(nrows, 1) * sizeof(*sbuf_ids));
+  val_t * sbuf_vals = splatt_malloc(SS_MAX(nrows, 1) * nfactors *
+      sizeof(*sbuf_vals));
+  for(int p=npes; p > 0; --p) {
+    send_disp[p] = send_disp[p-1];
+  }
+  for(idx_t i=0; i < nrows; ++i) {
+    idx_t const slot = send_disp[dests[i]+1]++;
+    sbuf_ids[slot] = ids[i];
+    memcpy(sbuf_vals + (slot * nfactors), vals + (i * nfactors),
+        nfactors * sizeof(*vals));
+  }
+
+  *recv_ids = splatt_malloc(SS_MAX(nrecv_rows, 1) * sizeof(**recv_ids));
+  *recv_vals = splatt_malloc(SS_MAX(nrecv_rows, 1) * nfactors *
+      sizeof(**recv_vals));
+  MPI_Alltoallv(sbuf_ids, nsend, send_disp, SPLATT_MPI_IDX,
+                *recv_ids, nrecv, recv_disp, SPLATT_MPI_IDX, comm);
+
+  for(int p=0; p < npes; ++p) {
+    nsend[p] *= nfactors;
+    nrecv[p] *= nfactors;
+    send_disp[p] *= nfactors;
+    recv_disp[p] *= nfactors;
+  }
+  MPI_Alltoallv(sbuf_vals, nsend, send_disp, SPLATT_MPI_VAL,
+                *recv_vals, nrecv, recv_disp, SPLATT_MPI_VAL, comm);
+
+  splatt_free(sbuf_ids);
+  splatt_free(sbuf_vals);
+  splatt_free(nsend);
+  splatt_free(nrecv);
+  splatt_free(send_disp);
+  splatt_free(recv_disp);
+  return nrecv_rows;
+}
+
+
+/**
+* @brief Send the factor rows that I owned before the layers moved to their
+*        new owners. Rows first travel along my fiber of the grid to the rank
+*        in their new layer, which knows the new permutation of that layer,
+*        and then inside that layer to their owner.
+*
+* @param mode The mode of the factor.
+* @param nold The number of rows that I owned.
+* @param old_ids The original (unpermuted) index of each row that I owned.
+* @param oldmat The rows that I owned.
+* @param perm The new permutation of the factors.
+* @param rinfo MPI rank information, with the new layers and mat_ptrs.
+*
+* @return The rows that I now own.
+*/
+static matrix_t * p_migrate_rows(
+  idx_t const mode,
+  idx_t const nold,
+  idx_t const * const old_ids,
+  matrix_t const * const oldmat,
+  permutation_t const * const perm,
+  rank_info const * const rinfo)
+{
+  idx_t const m = mode;
+  idx_t const nfactors = oldmat->J;
+
+  /* first hop: along my fiber, whose ranks are ordered by layer */
+  int remain[MAX_NMODES];
+  for(idx_t d=0; d < rinfo->nmodes; ++d) {
+    remain[d] = (d == m);
+  }
+  MPI_Comm fiber;
+  MPI_Cart_sub(rinfo->comm_3d, remain, &fiber);
+
+  int * dests = splatt_malloc(SS_MAX(nold, 1) * sizeof(*dests));
+  for(idx_t i=0; i < nold; ++i) {
+    dests[i] = p_find_range(rinfo->layer_ptrs[m], rinfo->dims_3d[m],
+        old_ids[i]);
+  }
+  idx_t * layer_ids;
+  val_t * layer_vals;
+  idx_t const nlayer = p_send_rows(old_ids, oldmat->vals, dests, nold,
+      nfactors, fiber, &layer_ids, &layer_vals);
+  splatt_free(dests);
+  MPI_Comm_free(&fiber);
+
+  /* second hop: inside my new layer, to the owner of the permuted row */
+  dests = splatt_malloc(SS_MAX(nlayer, 1) * sizeof(*dests));
+  for(idx_t i=0; i < nlayer; ++i) {
+    idx_t const local = layer_ids[i] - rinfo->layer_starts[m];
+    layer_ids[i] = perm->perms[m][local];
+    dests[i] = p_find_range(rinfo->mat_ptrs[m], rinfo->layer_size[m],
+        layer_ids[i]);
+  }
+  idx_t * my_ids;
+  val_t * my_vals;
+  idx_t const nmine = p_send_rows(layer_ids, layer_vals, dests, nlayer,
+      nfactors, rinfo->layer_comm[m], &my_ids, &my_vals);
+  splatt_free(dests);
+  splatt_free(layer_ids);
+  splatt_free(layer_vals);
+
+  matrix_t * newmat = mat_alloc(rinfo->mat_end[m] - rinfo->mat_start[m],
+      nfactors);
+  assert(nmine == newmat->I);
+  for(idx_t i=0; i < nmine; ++i) {
+    idx_t const row = my_ids[i] - rinfo->mat_start[m];
+    memcpy(newmat->vals + (row * nfactors), my_vals + (i * nfactors),
+        nfactors * sizeof(*my_vals));
+  }
+
+  splatt_free(my_ids);
+  splatt_free(my_vals);
+  return newmat;
+}
+
+
+/**
+* @brief Rebalance a medium-grained decomposition inside its grid: choose new
+*        layer boundaries so that the nonzeros of each layer are proportional
+*        to the speed of its ranks, move nonzeros to their new blocks, and
+*        redistribute the rows of each layer with mpi_distribute_mats(). The
+*        layer communicators are kept.
+*
+* @param tt My local tensor, as used to build the CSF.
+* @param perm The permutation of the factors, replaced with the new one.
+* @param globmats The factor rows that I own, replaced with my new rows.
+* @param rates The nonzeros per second of each rank.
+* @param rinfo MPI rank information.
+* @param[out] nmoved The total number of nonzeros that changed ranks.
+*
+* @return My new tensor, in the permuted coordinates of my new layers.
+*/
+static sptensor_t * p_relayer(
+  sptensor_t * const tt,
+  permutation_t * const perm,
+  matrix_t ** globmats,
+  double const * const rates,
+  rank_info * const rinfo,
+  idx_t * const nmoved)
+{
+  idx_t const nmodes = tt->nmodes;
+
+  /* remember the original index of each row I own */
+  idx_t nold[MAX_NMODES];
+  idx_t * old_ids[MAX_NMODES];
+  for(idx_t m=0; m < nmodes; ++m) {
+    nold[m] = rinfo->mat_end[m] - rinfo->mat_start[m];
+    old_ids[m] = splatt_malloc(SS_MAX(nold[m], 1) * sizeof(**old_ids));
+    for(idx_t i=0; i < nold[m]; ++i) {
+      old_ids[m][i] = rinfo->layer_starts[m] +
+          perm->iperms[m][rinfo->mat_start[m] + i];
+    }
+  }
+
+  /* back to the original coordinates of the tensor */
+  for(idx_t m=0; m < nmodes; ++m) {
+    idx_t const offset = rinfo->layer_starts[m];
+    idx_t const * const indmap = tt->indmap[m];
+    idx_t const * const iperm = perm->iperms[m];
+    idx_t * const ind = tt->ind[m];
+
+    #pragma omp parallel for schedule(static)
+    for(idx_t n=0; n < tt->nnz; ++n) {
+      ind[n] = offset + iperm[(indmap == NULL) ? ind[n] : indmap[ind[n]]];
+    }
+
+    splatt_free(tt->indmap[m]);
+    tt->indmap[m] = NULL;
+    tt->dims[m] = rinfo->global_dims[m];
+  }
+
+  /* a layer is as fast as the sum of its ranks */
+  double * weights[MAX_NMODES];
+  for(idx_t m=0; m < nmodes; ++m) {
+    weights[m] = splatt_malloc(rinfo->dims_3d[m] * sizeof(**weights));
+    for(int l=0; l < rinfo->dims_3d[m]; ++l) {
+      weights[m][l] = 0;
+    }
+  }
+  for(int p=0; p < rinfo->npes; ++p) {
+    int coords[MAX_NMODES];
+    MPI_Cart_coords(rinfo->comm_3d, p, (int) nmodes, coords);
+    for(idx_t m=0; m < nmodes; ++m) {
+      weights[m][coords[m]] += rates[p];
+    }
+  }
+
+  /* choose the new layers from the global slice counts */
+  for(idx_t m=0; m < nmodes; ++m) {
+    idx_t const dim = rinfo->global_dims[m];
+    idx_t * ssize = splatt_malloc(dim * sizeof(*ssize));
+    memset(ssize, 0, dim * sizeof(*ssize));
+    for(idx_t n=0; n < tt->nnz; ++n) {
+      ++ssize[tt->ind[m][n]];
+    }
+    MPI_Allreduce(MPI_IN_PLACE, ssize, (int) dim, SPLATT_MPI_IDX, MPI_SUM,
+        rinfo->comm_3d);
+
+    p_find_weighted_layer_ptrs(ssize, dim, weights[m], rinfo->dims_3d[m],
+        rinfo->layer_ptrs[m]);
+    rinfo->layer_starts[m] = rinfo->layer_ptrs[m][rinfo->coords_3d[m]];
+    rinfo->layer_ends[m] = rinfo->layer_ptrs[m][rinfo->coords_3d[m] + 1];
+
+    splatt_free(ssize);
+    splatt_free(weights[m]);
+  }
+
+  /* move each nonzero to the rank of its new block */
+  int * parts = splatt_malloc(SS_MAX(tt->nnz, 1) * sizeof(*parts));
+  idx_t mymoved = 0;
+  for(idx_t n=0; n < tt->nnz; ++n) {
+    parts[n] = mpi_determine_med_owner(tt, n, rinfo);
+    if(parts[n] != rinfo->rank_3d) {
+      ++mymoved;
+    }
+  }
+  MPI_Allreduce(&mymoved, nmoved, 1, SPLATT_MPI_IDX, MPI_SUM,
+      rinfo->comm_3d);
+  sptensor_t * newtt = mpi_rearrange_by_part(tt, parts, rinfo->comm_3d);
+  splatt_free(parts);
+
+  for(idx_t m=0; m < nmodes; ++m) {
+    idx_t const offset = rinfo->layer_starts[m];
+    idx_t * const ind = newtt->ind[m];
+    newtt->dims[m] = rinfo->layer_ends[m] - offset;
+    #pragma omp parallel for schedule(static)
+    for(idx_t n=0; n < newtt->nnz; ++n) {
+      ind[n] -= offset;
+    }
+  }
+
+  /* distribute the rows of the new layers */
+  for(idx_t m=0; m < nmodes; ++m) {
+    splatt_free(rinfo->mat_ptrs[m]);
+  }
+  permutation_t * newperm = mpi_distribute_mats(rinfo, newtt,
+      SPLATT_DECOMP_MEDIUM);
+  for(idx_t m=0; m < nmodes; ++m) {
+    splatt_free(perm->perms[m]);
+    splatt_free(perm->iperms[m]);
+    perm->perms[m] = newperm->perms[m];
+    perm->iperms[m] = newperm->iperms[m];
+    newperm->perms[m] = NULL;
+    newperm->iperms[m] = NULL;
+  }
+  perm_free(newperm);
+
+  for(idx_t m=0; m < nmodes; ++m) {
+    matrix_t * newmat = p_migrate_rows(m, nold[m], old_ids[m], globmats[m],
+        perm, rinfo);
+    mat_free(globmats[m]);
+    globmats[m] = newmat;
+    splatt_free(old_ids[m]);
+  }
+
+  return newtt;
+}
+
+
+/**
+* @brief Free the row exchange structures built by mpi_compute_ineed() and
+*        the indmap copied by mpi_cpy_indmap().
+*
+* @param rinfo MPI rank information.
+* @param m The mode to free.
+*/
+static void p_free_plan(
+  rank_info * const rinfo,
+  idx_t const m)
+{
+  splatt_free(rinfo->nbr2globs_inds[m]);
+  splatt_free(rinfo->local2nbr_inds[m]);
+  splatt_free(rinfo->nbr2local_inds[m]);
+  splatt_free(rinfo->local2nbr_ptr[m]);
+  splatt_free(rinfo->nbr2globs_ptr[m]);
+  splatt_free(rinfo->local2nbr_disp[m]);
+  splatt_free(rinfo->nbr2globs_disp[m]);
+  splatt_free(rinfo->indmap[m]);
+  rinfo->nbr2local_inds[m] = NULL;
+  rinfo->indmap[m] = NULL;
+
+  if(rinfo->nbr_comm[m] != MPI_COMM_NULL) {
+    MPI_Comm_free(&(rinfo->nbr_comm[m]));
+  }
+  splatt_free(rinfo->nbr_local2nbr_ptr[m]);
+  splatt_free(rinfo->nbr_local2nbr_disp[m]);
+  splatt_free(rinfo->nbr_nbr2globs_ptr[m]);
+  splatt_free(rinfo->nbr_nbr2globs_disp[m]);
+  rinfo->nbr_local2nbr_ptr[m] = NULL;
+  rinfo->nbr_local2nbr_disp[m] = NULL;
+  rinfo->nbr_nbr2globs_ptr[m] = NULL;
+  rinfo->nbr_nbr2globs_disp[m] = NULL;
+}
+
+
+
+/******************************************************************************
+ * PUBLIC FUNCTIONS
+ *****************************************************************************/
+
+sptensor_t * mpi_rebalance(
+  sptensor_t * const tt,
+  permutation_t * const perm,
+  matrix_t ** globmats,
+  rank_info * const rinfo,
+  idx_t const nfactors,
+  double const * const opts)
+{
+  int const npes = rinfo->npes;
+  int const rank = rinfo->rank_3d;
+  MPI_Comm const comm = rinfo->comm_3d;
+
+  timer_start(&timers[TIMER_MPI_REBALANCE]);
+  splatt_mem_tag const prev_tag = mem_tag_begin(SPLATT_MEM_MPI);
+
+  /* everyone learns everyone's load and speed */
+  idx_t * nnzs = splatt_malloc(npes * sizeof(*nnzs));
+  double * secs = splatt_malloc(npes * sizeof(*secs));
+  MPI_Allgather(&(tt->nnz), 1, SPLATT_MPI_IDX, nnzs, 1, SPLATT_MPI_IDX, comm);
+  MPI_Allgather(&(rinfo->mttkrp_seconds), 1, MPI_DOUBLE, secs, 1, MPI_DOUBLE,
+      comm);
+
+  double maxsecs = 0;
+  double avgsecs = 0;
+  for(int p=0; p < npes; ++p) {
+    maxsecs = SS_MAX(maxsecs, secs[p]);
+    avgsecs += secs[p];
+  }
+  avgsecs /= npes;
+  double const imbalance = (avgsecs > 0) ? maxsecs / avgsecs : 1.;
+
+  bool const verbose = rinfo->rank == 0 &&
+      opts[SPLATT_OPTION_VERBOSITY] > SPLATT_VERBOSITY_NONE;
+  if(imbalance < REBALANCE_MIN_IMBALANCE) {
+    if(verbose) {
+      printf("MTTKRP imbalance %0.3f is below %0.2f, not rebalancing.\n\n",
+          imbalance, REBALANCE_MIN_IMBALANCE);
+    }
+    splatt_free(nnzs);
+    splatt_free(secs);
+    mem_tag_end(prev_tag);
+    timer_stop(&timers[TIMER_MPI_REBALANCE]);
+    return NULL;
+  }
+
+  double * rates = splatt_malloc(npes * sizeof(*rates));
+  p_fill_rates(nnzs, secs, npes, rates);
+
+  idx_t nmoved;
+  sptensor_t * newtt;
+  if(rinfo->decomp == SPLATT_DECOMP_MEDIUM) {
+    /* nonzeros may not leave their layers, so the layers move instead */
+    newtt = p_relayer(tt, perm, globmats, rates, rinfo, &nmoved);
+
+  } else {
+    /* Every rank can reach every row, so nonzeros move freely and row
+     * ownership is unchanged. Move whole slices when possible: sort by the
+     * first mode and send the tail of my nonzeros. */
+    idx_t * targets = splatt_malloc(npes * sizeof(*targets));
+    idx_t * nsends = splatt_malloc(npes * sizeof(*nsends));
+    p_fill_targets(rates, npes, rinfo->global_nnz, targets);
+    nmoved = p_match_moves(nnzs, targets, npes, rank, nsends);
+
+    p_globalize(tt, rinfo);
+    tt_sort(tt, 0, NULL);
+    int * parts = splatt_malloc(SS_MAX(tt->nnz, 1) * sizeof(*parts));
+    idx_t n = tt->nnz;
+    for(int p=npes-1; p >= 0; --p) {
+      for(idx_t x=0; x < nsends[p]; ++x) {
+        parts[--n] = p;
+      }
+    }
+    for(idx_t x=0; x < n; ++x) {
+      parts[x] = rank;
+    }
+
+    newtt = mpi_rearrange_by_part(tt, parts, comm);
+    for(idx_t m=0; m < newtt->nmodes; ++m) {
+      newtt->dims[m] = rinfo->global_dims[m];
+    }
+    splatt_free(parts);
+    splatt_free(targets);
+    splatt_free(nsends);
+  }
+
+  p_localize(newtt, rinfo);
+  for(idx_t m=0; m < newtt->nmodes; ++m) {
+    p_free_plan(rinfo, m);
+    mpi_cpy_indmap(newtt, rinfo, m);
+    mpi_find_owned(newtt, m, rinfo);
+    mpi_compute_ineed(rinfo, newtt, m, nfactors, 3);
+  }
+
+  if(verbose) {
+    printf("MTTKRP imbalance %0.3f, moved %"SPLATT_PF_IDX" nonzeros "
+           "(%0.2f%%).\n\n", imbalance, nmoved,
+           100. * (double) nmoved / (double) rinfo->global_nnz);
+  }
+
+  splatt_free(nnzs);
+  splatt_free(secs);
+  splatt_free(rates);
+
+  mem_tag_end(prev_tag);
+  timer_stop(&timers[TIMER_MPI_REBALANCE]);
+  return newtt;
+}
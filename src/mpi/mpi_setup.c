@@ -5,6 +5,17 @@
 #include "../splatt_mpi.h"
 #include "../util.h"
 
+/* persistent collectives are MPI-4, but Open MPI offers them earlier */
+#ifdef OPEN_MPI
+#include <mpi-ext.h>
+#endif
+
+#if MPI_VERSION >= 4
+#define SPLATT_NBR_ALLTOALLV_INIT MPI_Neighbor_alltoallv_init
+#elif defined(OMPI_HAVE_MPI_EXT_PCOLLREQ) && OMPI_HAVE_MPI_EXT_PCOLLREQ
+#define SPLATT_NBR_ALLTOALLV_INIT MPIX_Neighbor_alltoallv_init
+#endif
+
 
 /******************************************************************************
  * PRIVATE FUNCTIONS
@@ -23,8 +34,9 @@ static void p_fill_ineed_ptrs(
   MPI_Comm_rank(comm, &rank);
 
   rinfo->nlocal2nbr[m] = 0;
-  rinfo->local2nbr_ptr[m] = (int *) calloc((size+1),  sizeof(int));
+  rinfo->local2nbr_ptr[m] = (int *) splatt_malloc((size+1) * sizeof(int));
   rinfo->nbr2globs_ptr[m] = (int *) splatt_malloc((size+1) * sizeof(int));
+  memset(rinfo->local2nbr_ptr[m], 0, (size+1) * sizeof(int));
 
   int * const local2nbr_ptr = rinfo->local2nbr_ptr[m];
   int * const nbr2globs_ptr = rinfo->nbr2globs_ptr[m];
@@ -131,7 +143,7 @@ static void p_fill_ineed_inds(
                 comm);
 
   /* we don't need nbr2local_inds anymore */
-  free(rinfo->nbr2local_inds[m]);
+  splatt_free(rinfo->nbr2local_inds[m]);
   rinfo->nbr2local_inds[m] = NULL;
 
   /* sanity check on nbr2globs_inds */
@@ -155,6 +167,73 @@ static void p_fill_ineed_inds(
 }
 
 
+/**
+* @brief Build a distributed graph communicator over only the layer ranks that
+*        I exchange rows with, and restrict the ptr/disp arrays to those
+*        neighbors. Must be called after ptrs/disps are scaled by nfactors.
+*
+* @param mode The mode to build the graph for.
+* @param rinfo MPI rank information.
+* @param comm The layer communicator of the mode.
+*/
+static void p_setup_nbr_graph(
+  idx_t const mode,
+  rank_info * const rinfo,
+  MPI_Comm const comm)
+{
+  idx_t const m = mode;
+  int size;
+  MPI_Comm_size(comm, &size);
+
+  int const * const local2nbr_ptr = rinfo->local2nbr_ptr[m];
+  int const * const nbr2globs_ptr = rinfo->nbr2globs_ptr[m];
+
+  /* Sources and destinations are the same list, so a rank with traffic in
+   * only one direction simply gets a zero count in the other. */
+  int nnbrs = 0;
+  int * nbrs = splatt_malloc(size * sizeof(*nbrs));
+  for(int p=0; p < size; ++p) {
+    if(local2nbr_ptr[p] > 0 || nbr2globs_ptr[p] > 0) {
+      nbrs[nnbrs++] = p;
+    }
+  }
+
+  int * l2n_ptr  = splatt_malloc((nnbrs+1) * sizeof(*l2n_ptr));
+  int * l2n_disp = splatt_malloc((nnbrs+1) * sizeof(*l2n_disp));
+  int * n2g_ptr  = splatt_malloc((nnbrs+1) * sizeof(*n2g_ptr));
+  int * n2g_disp = splatt_malloc((nnbrs+1) * sizeof(*n2g_disp));
+  for(int n=0; n < nnbrs; ++n) {
+    int const p = nbrs[n];
+    l2n_ptr[n]  = local2nbr_ptr[p];
+    l2n_disp[n] = rinfo->local2nbr_disp[m][p];
+    n2g_ptr[n]  = nbr2globs_ptr[p];
+    n2g_disp[n] = rinfo->nbr2globs_disp[m][p];
+  }
+
+  /* MPI_UNWEIGHTED is a sentinel pointer, which GCC takes for an empty array
+   * when the MPI header declares the weights as arrays. */
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wstringop-overread"
+#endif
+  MPI_Dist_graph_create_adjacent(comm,
+      nnbrs, nbrs, MPI_UNWEIGHTED,
+      nnbrs, nbrs, MPI_UNWEIGHTED,
+      MPI_INFO_NULL, 0, &(rinfo->nbr_comm[m]));
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic pop
+#endif
+
+  rinfo->nnbrs[m] = nnbrs;
+  rinfo->nbr_local2nbr_ptr[m]  = l2n_ptr;
+  rinfo->nbr_local2nbr_disp[m] = l2n_disp;
+  rinfo->nbr_nbr2globs_ptr[m]  = n2g_ptr;
+  rinfo->nbr_nbr2globs_disp[m] = n2g_disp;
+
+  splatt_free(nbrs);
+}
+
+
 /**
 * @brief Setup communicator info for a 1D distribution.
 *
@@ -255,11 +334,15 @@ void mpi_compute_ineed(
   idx_t const nfactors,
   splatt_decomp_type const distribution)
 {
+  splatt_mem_tag const prev_tag = mem_tag_begin(SPLATT_MEM_MPI);
+
   /* fill local2nbr and nbr2globs ptrs */
   p_fill_ineed_ptrs(tt, mode, rinfo, rinfo->layer_comm[mode]);
 
   /* fill indices */
   p_fill_ineed_inds(tt, mode, nfactors, rinfo, rinfo->layer_comm[mode]);
+
+  mem_tag_end(prev_tag);
 }
 
 
@@ -270,6 +353,48 @@ void mpi_setup_comms(
   rinfo->send_reqs = splatt_malloc(rinfo->npes * sizeof(MPI_Request));
   rinfo->recv_reqs = splatt_malloc(rinfo->npes * sizeof(MPI_Request));
 
+  MPI_Query_thread(&(rinfo->thread_level));
+  rinfo->comm_threads = false;
+  for(idx_t m=0; m < MAX_NMODES; ++m) {
+    rinfo->reduce_ptr[m] = NULL;
+    rinfo->reduce_slots[m] = NULL;
+  }
+
+  /* uncompressed until mpi_compress_init() */
+  rinfo->compress = NULL;
+  rinfo->wire_bytes = 0;
+  rinfo->mttkrp_seconds = 0;
+
+  /* neighborhood graphs are built by mpi_nbr_plan_init() */
+  for(idx_t m=0; m < MAX_NMODES; ++m) {
+    rinfo->nbr_comm[m] = MPI_COMM_NULL;
+    rinfo->nnbrs[m] = 0;
+    rinfo->nbr_local2nbr_ptr[m] = NULL;
+    rinfo->nbr_local2nbr_disp[m] = NULL;
+    rinfo->nbr_nbr2globs_ptr[m] = NULL;
+    rinfo->nbr_nbr2globs_disp[m] = NULL;
+    rinfo->nbr_update_req[m] = MPI_REQUEST_NULL;
+    rinfo->nbr_reduce_req[m] = MPI_REQUEST_NULL;
+  }
+  rinfo->nbr_local2nbr_buf = NULL;
+  rinfo->nbr_nbr2globs_buf = NULL;
+
+  /* flat reductions until mpi_node_init() */
+  rinfo->node_comm = MPI_COMM_NULL;
+  rinfo->leader_comm = MPI_COMM_NULL;
+  rinfo->node_rank = 0;
+  rinfo->node_size = 1;
+  rinfo->node_win = MPI_WIN_NULL;
+  rinfo->node_buf = NULL;
+  rinfo->node_slot = 0;
+
+  /* unfused until mpi_fused_init() */
+  rinfo->fused_type = MPI_DATATYPE_NULL;
+  rinfo->fused_op = MPI_OP_NULL;
+  rinfo->fused_req = MPI_REQUEST_NULL;
+  rinfo->fused_buf = NULL;
+  rinfo->fused_nfactors = 0;
+
   switch(rinfo->decomp) {
   case SPLATT_DECOMP_COARSE:
     p_setup_1d(rinfo);
@@ -288,13 +413,88 @@ void mpi_setup_comms(
 }
 
 
+void mpi_nbr_plan_init(
+  val_t * const local2nbr_buf,
+  val_t * const nbr2globs_buf,
+  rank_info * const rinfo)
+{
+  splatt_mem_tag const prev_tag = mem_tag_begin(SPLATT_MEM_MPI);
+  for(idx_t m=0; m < rinfo->nmodes; ++m) {
+    p_setup_nbr_graph(m, rinfo, rinfo->layer_comm[m]);
+  }
+  mem_tag_end(prev_tag);
+
+  rinfo->nbr_local2nbr_buf = local2nbr_buf;
+  rinfo->nbr_nbr2globs_buf = nbr2globs_buf;
+
+#ifdef SPLATT_NBR_ALLTOALLV_INIT
+  for(idx_t m=0; m < rinfo->nmodes; ++m) {
+    /* updates: my owned rows out, neighbors' rows in */
+    SPLATT_NBR_ALLTOALLV_INIT(
+        nbr2globs_buf, rinfo->nbr_nbr2globs_ptr[m],
+        rinfo->nbr_nbr2globs_disp[m], SPLATT_MPI_VAL,
+        local2nbr_buf, rinfo->nbr_local2nbr_ptr[m],
+        rinfo->nbr_local2nbr_disp[m], SPLATT_MPI_VAL,
+        rinfo->nbr_comm[m], MPI_INFO_NULL, &(rinfo->nbr_update_req[m]));
+
+    /* reductions: my partials out, neighbors' partials in */
+    SPLATT_NBR_ALLTOALLV_INIT(
+        local2nbr_buf, rinfo->nbr_local2nbr_ptr[m],
+        rinfo->nbr_local2nbr_disp[m], SPLATT_MPI_VAL,
+        nbr2globs_buf, rinfo->nbr_nbr2globs_ptr[m],
+        rinfo->nbr_nbr2globs_disp[m], SPLATT_MPI_VAL,
+        rinfo->nbr_comm[m], MPI_INFO_NULL, &(rinfo->nbr_reduce_req[m]));
+  }
+#endif
+}
+
+
+void mpi_nbr_plan_free(
+  rank_info * const rinfo)
+{
+  for(idx_t m=0; m < rinfo->nmodes; ++m) {
+    if(rinfo->nbr_update_req[m] != MPI_REQUEST_NULL) {
+      MPI_Request_free(&(rinfo->nbr_update_req[m]));
+    }
+    if(rinfo->nbr_reduce_req[m] != MPI_REQUEST_NULL) {
+      MPI_Request_free(&(rinfo->nbr_reduce_req[m]));
+    }
+
+    if(rinfo->nbr_comm[m] != MPI_COMM_NULL) {
+      MPI_Comm_free(&(rinfo->nbr_comm[m]));
+    }
+    splatt_free(rinfo->nbr_local2nbr_ptr[m]);
+    splatt_free(rinfo->nbr_local2nbr_disp[m]);
+    splatt_free(rinfo->nbr_nbr2globs_ptr[m]);
+    splatt_free(rinfo->nbr_nbr2globs_disp[m]);
+    rinfo->nnbrs[m] = 0;
+    rinfo->nbr_local2nbr_ptr[m] = NULL;
+    rinfo->nbr_local2nbr_disp[m] = NULL;
+    rinfo->nbr_nbr2globs_ptr[m] = NULL;
+    rinfo->nbr_nbr2globs_disp[m] = NULL;
+  }
+  rinfo->nbr_local2nbr_buf = NULL;
+  rinfo->nbr_nbr2globs_buf = NULL;
+}
+
+
 void rank_free(
   rank_info rinfo,
   idx_t const nmodes)
 {
-  free(rinfo.stats);
-  free(rinfo.send_reqs);
-  free(rinfo.recv_reqs);
+  splatt_free(rinfo.stats);
+  splatt_free(rinfo.send_reqs);
+  splatt_free(rinfo.recv_reqs);
+
+  for(idx_t m=0; m < nmodes; ++m) {
+    if(rinfo.nbr_comm[m] != MPI_COMM_NULL) {
+      MPI_Comm_free(&rinfo.nbr_comm[m]);
+    }
+    splatt_free(rinfo.nbr_local2nbr_ptr[m]);
+    splatt_free(rinfo.nbr_local2nbr_disp[m]);
+    splatt_free(rinfo.nbr_nbr2globs_ptr[m]);
+    splatt_free(rinfo.nbr_nbr2globs_disp[m]);
+  }
 
   switch(rinfo.decomp) {
   case SPLATT_DECOMP_COARSE:
@@ -303,18 +503,18 @@ void rank_free(
     MPI_Comm_free(&rinfo.comm_3d);
     for(idx_t m=0; m < nmodes; ++m) {
       MPI_Comm_free(&rinfo.layer_comm[m]);
-      free(rinfo.mat_ptrs[m]);
-      free(rinfo.layer_ptrs[m]);
+      splatt_free(rinfo.mat_ptrs[m]);
+      splatt_free(rinfo.layer_ptrs[m]);
 
       /* send/recv structures */
-      free(rinfo.nbr2globs_inds[m]);
-      free(rinfo.local2nbr_inds[m]);
-      free(rinfo.nbr2local_inds[m]);
-      free(rinfo.local2nbr_ptr[m]);
-      free(rinfo.nbr2globs_ptr[m]);
-      free(rinfo.local2nbr_disp[m]);
-      free(rinfo.nbr2globs_disp[m]);
-      free(rinfo.indmap[m]);
+      splatt_free(rinfo.nbr2globs_inds[m]);
+      splatt_free(rinfo.local2nbr_inds[m]);
+      splatt_free(rinfo.nbr2local_inds[m]);
+      splatt_free(rinfo.local2nbr_ptr[m]);
+      splatt_free(rinfo.nbr2globs_ptr[m]);
+      splatt_free(rinfo.local2nbr_disp[m]);
+      splatt_free(rinfo.nbr2globs_disp[m]);
+      splatt_free(rinfo.indmap[m]);
     }
     break;
   case SPLATT_DECOMP_FINE:
@@ -9,6 +9,10 @@
 #include "util.h"
 
 #include "mutex_pool.h"
+#include "perfctr.h"
+#include "metrics.h"
+#include "trace.h"
+#include "steal.h"
 
 
 /* XXX: this is a memory leak until cpd_ws is added/freed. */
@@ -24,10 +28,8 @@ static mutex_pool * pool = NULL;
 * @param mats The matrices.
 * @param mode The output mode.
 * @param thds Thread structures.
-* @param partition A partitioning of the slices in the tensor, to distribute
-*                  to threads. Use the thread ID to decide which slices to
-*                  process. This may be NULL, in that case simply process all
-*                  slices.
+* @param range The slices [range[0], range[1]) of the tile to process. This
+*              may be NULL, in that case simply process all slices.
 */
 typedef void (* csf_mttkrp_func)(
     splatt_csf const * const ct,
@@ -35,7 +37,7 @@ typedef void (* csf_mttkrp_func)(
     matrix_t ** mats,
     idx_t const mode,
     thd_info * const thds,
-    idx_t const * const partition);
+    idx_t const * const range);
 
 
 
@@ -46,51 +48,71 @@ typedef void (* csf_mttkrp_func)(
 
 
 /**
-* @brief Perform a reduction on thread-local MTTKRP outputs.
+* @brief Run MTTKRP functions on units of work taken from a work-stealing
+*        scheduler until no thread has any left. This must be called by every
+*        thread of a parallel region and there is no barrier at the end.
 *
-* @param ws MTTKRP workspace containing thread-local outputs.
-* @param global_output The global MTTKRP output we are reducing into.
-* @param nrows The number of rows in the MTTKRP.
-* @param ncols The number of columns in the MTTKRP.
+* @param csf The CSF tensor to process.
+* @param sched The scheduler of this mode, built for 'csf'.
+* @param atomic_func An MTTKRP function which atomically updates the output.
+* @param nosync_func An MTTKRP function which does not atomically update.
+* @param mats The matrices, with the output stored in mats[MAX_NMODES].
+* @param mode Which mode of 'csf' is the output (not CSF depth).
+* @param thds Thread structures.
 */
-static void p_reduce_privatized(
-    splatt_mttkrp_ws * const ws,
-    val_t * const restrict global_output,
-    idx_t const nrows,
-    idx_t const ncols)
+static void p_schedule_steal(
+    splatt_csf const * const csf,
+    steal_sched * const sched,
+    csf_mttkrp_func atomic_func,
+    csf_mttkrp_func nosync_func,
+    matrix_t ** mats,
+    idx_t const mode,
+    thd_info * const thds)
 {
-  /* Ensure everyone has completed their local MTTKRP. */
-  #pragma omp barrier
-
-  sp_timer_t reduction_timer;
-  timer_fstart(&reduction_timer);
-
+  idx_t const nmodes = csf->nmodes;
   int const tid = splatt_omp_get_thread_num();
 
-  idx_t const num_threads = splatt_omp_get_num_threads();
-  idx_t const elem_per_thread = (nrows * ncols) / num_threads;
-  idx_t const start = tid * elem_per_thread;
-  idx_t const stop  = ((idx_t)tid == num_threads-1) ?
-     (nrows * ncols) : (tid + 1) * elem_per_thread;
+  steal_unit unit;
+  while(steal_next(sched, tid, &unit)) {
+    switch(sched->type) {
+    case STEAL_SLICES: {
+      idx_t const range[2] = { unit.begin, unit.end };
+      atomic_func(csf, 0, mats, mode, thds, range);
+      break;
+    }
 
-  /* reduction */
-  for(idx_t t=0; t < num_threads; ++t){
-    val_t const * const restrict thread_buf = ws->privatize_buffer[t];
-    for(idx_t x=start; x < stop; ++x) {
-      global_output[x] += thread_buf[x];
+    case STEAL_TILES:
+      for(idx_t tile_id = unit.begin; tile_id < unit.end; ++tile_id) {
+        trace_begin("tile", tile_id);
+        atomic_func(csf, tile_id, mats, mode, thds, NULL);
+        trace_end();
+      }
+      break;
+
+    /* a layer is only ever processed by one thread, so no atomics */
+    case STEAL_LAYERS:
+      for(idx_t t = unit.begin; t < unit.end; ++t) {
+        idx_t tile_id =
+            get_next_tileid(TILE_BEGIN, csf->tile_dims, nmodes, mode, t);
+        while(tile_id != TILE_END) {
+          trace_begin("tile", tile_id);
+          nosync_func(csf, tile_id, mats, mode, thds, NULL);
+          trace_end();
+          tile_id =
+            get_next_tileid(tile_id, csf->tile_dims, nmodes, mode, t);
+        }
+      }
+      break;
     }
   }
-
-  timer_stop(&reduction_timer);
-  #pragma omp master
-  ws->reduction_time = reduction_timer.seconds;
 }
 
 
-
 /**
 * @brief Map MTTKRP functions onto a (possibly tiled) CSF tensor. This function
 *        will handle any scheduling required with a partially tiled tensor.
+*        This must be called by every thread of a parallel region and there
+*        is no barrier at the end.
 *
 * @param tensors An array of CSF representations. tensors[csf_id] is processed.
 * @param csf_id Which tensor are we processing?
@@ -113,130 +135,104 @@ static void p_schedule_tiles(
 {
   splatt_csf const * const csf = &(tensors[csf_id]);
   idx_t const nmodes = csf->nmodes;
-  idx_t const depth = nmodes - 1;
 
-  idx_t const nrows = mats[mode]->I;
+  /* the output has one row per slice of this CSF, which can be fewer than the
+   * rows of the factor (e.g., one slab of a coarse MPI decomposition) */
+  idx_t const nrows = csf->dims[mode];
   idx_t const ncols = mats[mode]->J;
 
-  /* Store old pointer */
-  val_t * const restrict global_output = mats[MAX_NMODES]->vals;
-
-  #pragma omp parallel
-  {
-    int const tid = splatt_omp_get_thread_num();
-    timer_start(&thds[tid].ttime);
-    idx_t const * const tile_partition = ws->tile_partition[csf_id];
-    idx_t const * const tree_partition = ws->tree_partition[csf_id];
-
-    /*
-     * We may need to edit mats[MAX_NMODES]->vals, so create a private copy of
-     * the pointers to edit. (NOT actual factors).
-     */
-    matrix_t * mats_priv[MAX_NMODES+1];
-    for(idx_t m=0; m < MAX_NMODES; ++m) {
-      mats_priv[m] = mats[m];
-    }
-    /* each thread gets separate structure, but do a shallow copy */
-    mats_priv[MAX_NMODES] = splatt_malloc(sizeof(**mats_priv));
-    *(mats_priv[MAX_NMODES]) = *(mats[MAX_NMODES]);
-
-    /* Give each thread its own private buffer and overwrite atomic
-     * function. */
-    if(ws->is_privatized[mode]) {
-      /* change (thread-private!) output structure */
-      memset(ws->privatize_buffer[tid], 0,
-          nrows * ncols * sizeof(**(ws->privatize_buffer)));
-      mats_priv[MAX_NMODES]->vals = ws->privatize_buffer[tid];
-
-      /* Don't use atomics if we privatized. */
-      atomic_func = nosync_func;
-    }
-
-
-    /*
-     * Distribute tiles to threads in some fashion.
-     */
-    if(csf->ntiles > 1) {
-      /* We parallelize across tiles, and thus should not distribute within a
-       * tree. This may change if we instead 'split' tiles across a few
-       * threads. */
-      assert(tree_partition == NULL);
+  int const tid = splatt_omp_get_thread_num();
+  timer_start(&thds[tid].ttime);
+  trace_begin("mttkrp", mode);
+  idx_t const * const tile_partition = ws->tile_partition[csf_id];
+  idx_t const * const tree_partition = ws->tree_partition[csf_id];
+
+  /*
+   * We may need to edit mats[MAX_NMODES]->vals, so create a private copy of
+   * the pointers to edit. (NOT actual factors).
+   */
+  matrix_t * mats_priv[MAX_NMODES+1];
+  for(idx_t m=0; m < MAX_NMODES; ++m) {
+    mats_priv[m] = mats[m];
+  }
+  /* each thread gets separate structure, but do a shallow copy */
+  matrix_t output_priv = *(mats[MAX_NMODES]);
+  mats_priv[MAX_NMODES] = &output_priv;
+
+  /* Give each thread its own private buffer and overwrite atomic
+   * function. */
+  if(ws->is_privatized[mode]) {
+    /* change (thread-private!) output structure */
+    memset(ws->privatize_buffer[tid], 0,
+        nrows * ncols * sizeof(**(ws->privatize_buffer)));
+    output_priv.vals = ws->privatize_buffer[tid];
+
+    /* Don't use atomics if we privatized. */
+    atomic_func = nosync_func;
+  }
 
-      /* mode is actually tiled -- avoid synchronization */
-      if(csf->tile_dims[mode] > 1) {
-        idx_t tile_id = 0;
 
-        /* foreach layer of tiles */
-        #pragma omp for schedule(dynamic, 1) nowait
-        for(idx_t t=0; t < csf->tile_dims[mode]; ++t) {
+  /*
+   * Distribute tiles to threads in some fashion.
+   */
+  if(ws->steal[mode] != NULL) {
+    p_schedule_steal(csf, ws->steal[mode], atomic_func, nosync_func,
+        mats_priv, mode, thds);
+
+  } else if(csf->ntiles > 1) {
+    /* We parallelize across tiles, and thus should not distribute within a
+     * tree. This may change if we instead 'split' tiles across a few
+     * threads. */
+    assert(tree_partition == NULL);
+
+    /* mode is actually tiled -- avoid synchronization */
+    if(csf->tile_dims[mode] > 1) {
+      idx_t tile_id = 0;
+
+      /* foreach layer of tiles */
+      #pragma omp for schedule(dynamic, 1) nowait
+      for(idx_t t=0; t < csf->tile_dims[mode]; ++t) {
+        tile_id =
+            get_next_tileid(TILE_BEGIN, csf->tile_dims, nmodes, mode, t);
+        while(tile_id != TILE_END) {
+          trace_begin("tile", tile_id);
+          nosync_func(csf, tile_id, mats_priv, mode, thds, NULL);
+          trace_end();
           tile_id =
-              get_next_tileid(TILE_BEGIN, csf->tile_dims, nmodes, mode, t);
-          while(tile_id != TILE_END) {
-            nosync_func(csf, tile_id, mats_priv, mode, thds, tree_partition);
-            tile_id =
-              get_next_tileid(tile_id, csf->tile_dims, nmodes, mode, t);
-          }
-        }
-
-      /* tiled, but not this mode. Atomics are still necessary. */
-      } else {
-        for(idx_t tile_id = tile_partition[tid];
-                  tile_id < tile_partition[tid+1]; ++tile_id) {
-          atomic_func(csf, tile_id, mats_priv, mode, thds, tree_partition);
+            get_next_tileid(tile_id, csf->tile_dims, nmodes, mode, t);
         }
       }
 
-    /*
-     * Untiled, parallelize within kernel.
-     */
+    /* tiled, but not this mode. Atomics are still necessary. */
     } else {
-      assert(tree_partition != NULL);
-      atomic_func(csf, 0, mats_priv, mode, thds, tree_partition);
-    }
-    timer_stop(&thds[tid].ttime);
-
-
-    /* If we used privatization, perform a reduction. */
-    if(ws->is_privatized[mode]) {
-      p_reduce_privatized(ws, global_output, nrows, ncols);
+      for(idx_t tile_id = tile_partition[tid];
+                tile_id < tile_partition[tid+1]; ++tile_id) {
+        trace_begin("tile", tile_id);
+        atomic_func(csf, tile_id, mats_priv, mode, thds, NULL);
+        trace_end();
+      }
     }
 
-    splatt_free(mats_priv[MAX_NMODES]);
-  } /* end omp parallel */
-
-  /* restore pointer */
-  mats[MAX_NMODES]->vals = global_output;
-}
+  /*
+   * Untiled, parallelize within kernel.
+   */
+  } else {
+    assert(tree_partition != NULL);
+    atomic_func(csf, 0, mats_priv, mode, thds, tree_partition + tid);
+  }
+  trace_end();
+  timer_stop(&thds[tid].ttime);
 
 
-/**
-* @brief Should a certain mode should be privatized to avoid locks?
-*
-* @param csf The tensor (just used for dimensions).
-* @param mode The mode we are processing.
-* @param opts Options, storing the # threads and the threshold.
-*
-* @return true, if we should privatize.
-*/
-static bool p_is_privatized(
-    splatt_csf const * const csf,
-    idx_t const mode,
-    double const * const opts)
-{
-  idx_t const length = csf->dims[mode];
-  idx_t const nthreads = (idx_t) opts[SPLATT_OPTION_NTHREADS];
-  double const thresh = opts[SPLATT_OPTION_PRIVTHRESH];
-
-  /* don't bother if it is not multithreaded. */
-  if(nthreads == 1) {
-    return false;
+  /* If we used privatization, perform a reduction. */
+  if(ws->is_privatized[mode]) {
+    trace_begin("privatized reduce", mode);
+    mttkrp_reduce_privatized(ws, mats[MAX_NMODES]->vals, nrows, ncols);
+    trace_end();
   }
-
-  return (double)(length * nthreads) <= (thresh * (double)csf->nnz);
 }
 
 
-
 static inline void p_add_hada_clear(
   val_t * const restrict out,
   val_t * const restrict a,
@@ -393,7 +389,7 @@ static void p_csf_mttkrp_root3_nolock(
   matrix_t ** mats,
   idx_t const mode,
   thd_info * const thds,
-  idx_t const * const restrict partition)
+  idx_t const * const restrict range)
 {
   assert(ct->nmodes == 3);
   val_t const * const vals = ct->pt[tile_id].vals;
@@ -420,10 +416,10 @@ static void p_csf_mttkrp_root3_nolock(
   }
 
 
-  /* break up loop by partition */
+  /* only process the given slices */
   idx_t const nslices = ct->pt[tile_id].nfibs[0];
-  idx_t const start = (partition != NULL) ? partition[tid]   : 0;
-  idx_t const stop  = (partition != NULL) ? partition[tid+1] : nslices;
+  idx_t const start = (range != NULL) ? range[0] : 0;
+  idx_t const stop  = (range != NULL) ? range[1] : nslices;
   for(idx_t s=start; s < stop; ++s) {
     idx_t const fid = (sids == NULL) ? s : sids[s];
 
@@ -470,7 +466,7 @@ static void p_csf_mttkrp_root3_locked(
   matrix_t ** mats,
   idx_t const mode,
   thd_info * const thds,
-  idx_t const * const restrict partition)
+  idx_t const * const restrict range)
 {
   assert(ct->nmodes == 3);
   val_t const * const vals = ct->pt[tile_id].vals;
@@ -498,8 +494,8 @@ static void p_csf_mttkrp_root3_locked(
   }
 
   idx_t const nslices = ct->pt[tile_id].nfibs[0];
-  idx_t const start = (partition != NULL) ? partition[tid]   : 0;
-  idx_t const stop  = (partition != NULL) ? partition[tid+1] : nslices;
+  idx_t const start = (range != NULL) ? range[0] : 0;
+  idx_t const stop  = (range != NULL) ? range[1] : nslices;
   for(idx_t s=start; s < stop; ++s) {
     /* foreach fiber in slice */
     for(idx_t f=sptr[s]; f < sptr[s+1]; ++f) {
@@ -547,7 +543,7 @@ static void p_csf_mttkrp_intl3_locked(
   matrix_t ** mats,
   idx_t const mode,
   thd_info * const thds,
-  idx_t const * const restrict partition)
+  idx_t const * const restrict range)
 {
   assert(ct->nmodes == 3);
   val_t const * const vals = ct->pt[tile_id].vals;
@@ -568,8 +564,8 @@ static void p_csf_mttkrp_intl3_locked(
   val_t * const restrict accumF = (val_t *) thds[tid].scratch[0];
 
   idx_t const nslices = ct->pt[tile_id].nfibs[0];
-  idx_t const start = (partition != NULL) ? partition[tid]   : 0;
-  idx_t const stop  = (partition != NULL) ? partition[tid+1] : nslices;
+  idx_t const start = (range != NULL) ? range[0] : 0;
+  idx_t const stop  = (range != NULL) ? range[1] : nslices;
   for(idx_t s=start; s < stop; ++s) {
     idx_t const fid = (sids == NULL) ? s : sids[s];
 
@@ -613,7 +609,7 @@ static void p_csf_mttkrp_leaf3_locked(
   matrix_t ** mats,
   idx_t const mode,
   thd_info * const thds,
-  idx_t const * const restrict partition)
+  idx_t const * const restrict range)
 {
   assert(ct->nmodes == 3);
   val_t const * const vals = ct->pt[tile_id].vals;
@@ -634,8 +630,8 @@ static void p_csf_mttkrp_leaf3_locked(
   val_t * const restrict accumF = (val_t *) thds[tid].scratch[0];
 
   idx_t const nslices = ct->pt[tile_id].nfibs[0];
-  idx_t const start = (partition != NULL) ? partition[tid]   : 0;
-  idx_t const stop  = (partition != NULL) ? partition[tid+1] : nslices;
+  idx_t const start = (range != NULL) ? range[0] : 0;
+  idx_t const stop  = (range != NULL) ? range[1] : nslices;
   for(idx_t s=start; s < stop; ++s) {
     idx_t const fid = (sids == NULL) ? s : sids[s];
 
@@ -671,7 +667,7 @@ static void p_csf_mttkrp_root_nolock(
   matrix_t ** mats,
   idx_t const mode,
   thd_info * const thds,
-  idx_t const * const restrict partition)
+  idx_t const * const restrict range)
 {
   /* extract tensor structures */
   idx_t const nmodes = ct->nmodes;
@@ -683,7 +679,7 @@ static void p_csf_mttkrp_root_nolock(
   }
 
   if(nmodes == 3) {
-    p_csf_mttkrp_root3_nolock(ct, tile_id, mats, mode, thds, partition);
+    p_csf_mttkrp_root3_nolock(ct, tile_id, mats, mode, thds, range);
     return;
   }
 
@@ -710,9 +706,9 @@ static void p_csf_mttkrp_root_nolock(
   idx_t const nfibs = ct->pt[tile_id].nfibs[0];
   assert(nfibs <= mats[MAX_NMODES]->I);
 
-  /* break up loop by partition */
-  idx_t const start = (partition != NULL) ? partition[tid]   : 0;
-  idx_t const stop  = (partition != NULL) ? partition[tid+1] : nfibs;
+  /* only process the given slices */
+  idx_t const start = (range != NULL) ? range[0] : 0;
+  idx_t const stop  = (range != NULL) ? range[1] : nfibs;
   for(idx_t s=start; s < stop; ++s) {
     idx_t const fid = (fids[0] == NULL) ? s : fids[0][s];
 
@@ -739,7 +735,7 @@ static void p_csf_mttkrp_root_locked(
   matrix_t ** mats,
   idx_t const mode,
   thd_info * const thds,
-  idx_t const * const restrict partition)
+  idx_t const * const restrict range)
 {
   /* extract tensor structures */
   idx_t const nmodes = ct->nmodes;
@@ -751,7 +747,7 @@ static void p_csf_mttkrp_root_locked(
   }
 
   if(nmodes == 3) {
-    p_csf_mttkrp_root3_locked(ct, tile_id, mats, mode, thds, partition);
+    p_csf_mttkrp_root3_locked(ct, tile_id, mats, mode, thds, range);
     return;
   }
 
@@ -778,8 +774,8 @@ static void p_csf_mttkrp_root_locked(
   idx_t const nfibs = ct->pt[tile_id].nfibs[0];
   assert(nfibs <= mats[MAX_NMODES]->I);
 
-  idx_t const start = (partition != NULL) ? partition[tid]   : 0;
-  idx_t const stop  = (partition != NULL) ? partition[tid+1] : nfibs;
+  idx_t const start = (range != NULL) ? range[0] : 0;
+  idx_t const stop  = (range != NULL) ? range[1] : nfibs;
   for(idx_t s=start; s < stop; ++s) {
     idx_t const fid = (fids[0] == NULL) ? s : fids[0][s];
 
@@ -805,7 +801,7 @@ static void p_csf_mttkrp_leaf3_nolock(
   matrix_t ** mats,
   idx_t const mode,
   thd_info * const thds,
-  idx_t const * const partition)
+  idx_t const * const range)
 {
   assert(ct->nmodes == 3);
   val_t const * const vals = ct->pt[tile_id].vals;
@@ -826,8 +822,8 @@ static void p_csf_mttkrp_leaf3_nolock(
   val_t * const restrict accumF = (val_t *) thds[tid].scratch[0];
 
   idx_t const nslices = ct->pt[tile_id].nfibs[0];
-  idx_t const start = (partition != NULL) ? partition[tid]   : 0;
-  idx_t const stop  = (partition != NULL) ? partition[tid+1] : nslices;
+  idx_t const start = (range != NULL) ? range[0] : 0;
+  idx_t const stop  = (range != NULL) ? range[1] : nslices;
   for(idx_t s=start; s < stop; ++s) {
     idx_t const fid = (sids == NULL) ? s : sids[s];
 
@@ -863,7 +859,7 @@ static void p_csf_mttkrp_leaf_nolock(
   matrix_t ** mats,
   idx_t const mode,
   thd_info * const thds,
-  idx_t const * const partition)
+  idx_t const * const range)
 {
   val_t const * const vals = ct->pt[tile_id].vals;
   idx_t const nmodes = ct->nmodes;
@@ -872,7 +868,7 @@ static void p_csf_mttkrp_leaf_nolock(
     return;
   }
   if(nmodes == 3) {
-    p_csf_mttkrp_leaf3_nolock(ct, tile_id, mats, mode, thds, partition);
+    p_csf_mttkrp_leaf3_nolock(ct, tile_id, mats, mode, thds, range);
     return;
   }
 
@@ -897,8 +893,8 @@ static void p_csf_mttkrp_leaf_nolock(
 
   /* foreach outer slice */
   idx_t const nouter = ct->pt[tile_id].nfibs[0];
-  idx_t const start = (partition != NULL) ? partition[tid]   : 0;
-  idx_t const stop  = (partition != NULL) ? partition[tid+1] : nouter;
+  idx_t const start = (range != NULL) ? range[0] : 0;
+  idx_t const stop  = (range != NULL) ? range[1] : nouter;
   for(idx_t s=start; s < stop; ++s) {
     idx_t const fid = (fids[0] == NULL) ? s : fids[0][s];
     idxstack[0] = s;
@@ -949,7 +945,7 @@ static void p_csf_mttkrp_leaf_locked(
   matrix_t ** mats,
   idx_t const mode,
   thd_info * const thds,
-  idx_t const * const restrict partition)
+  idx_t const * const restrict range)
 {
   /* extract tensor structures */
   val_t const * const vals = ct->pt[tile_id].vals;
@@ -959,7 +955,7 @@ static void p_csf_mttkrp_leaf_locked(
     return;
   }
   if(nmodes == 3) {
-    p_csf_mttkrp_leaf3_locked(ct, tile_id, mats, mode, thds, partition);
+    p_csf_mttkrp_leaf3_locked(ct, tile_id, mats, mode, thds, range);
     return;
   }
 
@@ -983,8 +979,8 @@ static void p_csf_mttkrp_leaf_locked(
 
   /* foreach outer slice */
   idx_t const nslices = ct->pt[tile_id].nfibs[0];
-  idx_t const start = (partition != NULL) ? partition[tid]   : 0;
-  idx_t const stop  = (partition != NULL) ? partition[tid+1] : nslices;
+  idx_t const start = (range != NULL) ? range[0] : 0;
+  idx_t const stop  = (range != NULL) ? range[1] : nslices;
   for(idx_t s=start; s < stop; ++s) {
     idx_t const fid = (fids[0] == NULL) ? s : fids[0][s];
     idxstack[0] = s;
@@ -1035,7 +1031,7 @@ static void p_csf_mttkrp_intl3_nolock(
   matrix_t ** mats,
   idx_t const mode,
   thd_info * const thds,
-  idx_t const * const partition)
+  idx_t const * const range)
 {
   assert(ct->nmodes == 3);
   val_t const * const vals = ct->pt[tile_id].vals;
@@ -1056,8 +1052,8 @@ static void p_csf_mttkrp_intl3_nolock(
   val_t * const restrict accumF = (val_t *) thds[tid].scratch[0];
 
   idx_t const nslices = ct->pt[tile_id].nfibs[0];
-  idx_t const start = (partition != NULL) ? partition[tid]   : 0;
-  idx_t const stop  = (partition != NULL) ? partition[tid+1] : nslices;
+  idx_t const start = (range != NULL) ? range[0] : 0;
+  idx_t const stop  = (range != NULL) ? range[1] : nslices;
   for(idx_t s=start; s < stop; ++s) {
     idx_t const fid = (sids == NULL) ? s : sids[s];
 
@@ -1099,7 +1095,7 @@ static void p_csf_mttkrp_intl_nolock(
   matrix_t ** mats,
   idx_t const mode,
   thd_info * const thds,
-  idx_t const * const partition)
+  idx_t const * const range)
 {
   /* extract tensor structures */
   idx_t const nmodes = ct->nmodes;
@@ -1109,7 +1105,7 @@ static void p_csf_mttkrp_intl_nolock(
     return;
   }
   if(nmodes == 3) {
-    p_csf_mttkrp_intl3_nolock(ct, tile_id, mats, mode, thds, partition);
+    p_csf_mttkrp_intl3_nolock(ct, tile_id, mats, mode, thds, range);
     return;
   }
 
@@ -1138,8 +1134,8 @@ static void p_csf_mttkrp_intl_nolock(
 
   /* foreach outer slice */
   idx_t const nslices = ct->pt[tile_id].nfibs[0];
-  idx_t const start = (partition != NULL) ? partition[tid]   : 0;
-  idx_t const stop  = (partition != NULL) ? partition[tid+1] : nslices;
+  idx_t const start = (range != NULL) ? range[0] : 0;
+  idx_t const stop  = (range != NULL) ? range[1] : nslices;
   for(idx_t s=start; s < stop; ++s) {
     idx_t const fid = (fids[0] == NULL) ? s : fids[0][s];
 
@@ -1191,7 +1187,7 @@ static void p_csf_mttkrp_intl_locked(
   matrix_t ** mats,
   idx_t const mode,
   thd_info * const thds,
-  idx_t const * const partition)
+  idx_t const * const range)
 {
   /* extract tensor structures */
   idx_t const nmodes = ct->nmodes;
@@ -1201,7 +1197,7 @@ static void p_csf_mttkrp_intl_locked(
     return;
   }
   if(nmodes == 3) {
-    p_csf_mttkrp_intl3_locked(ct, tile_id, mats, mode, thds, partition);
+    p_csf_mttkrp_intl3_locked(ct, tile_id, mats, mode, thds, range);
     return;
   }
 
@@ -1229,8 +1225,8 @@ static void p_csf_mttkrp_intl_locked(
 
   /* foreach outer slice */
   idx_t const nslices = ct->pt[tile_id].nfibs[0];
-  idx_t const start = (partition != NULL) ? partition[tid]   : 0;
-  idx_t const stop  = (partition != NULL) ? partition[tid+1] : nslices;
+  idx_t const start = (range != NULL) ? range[0] : 0;
+  idx_t const stop  = (range != NULL) ? range[1] : nslices;
   for(idx_t s=start; s < stop; ++s) {
     idx_t const fid = (fids[0] == NULL) ? s : fids[0][s];
 
@@ -1280,35 +1276,26 @@ static void p_csf_mttkrp_intl_locked(
 
 
 
-/******************************************************************************
- * PUBLIC FUNCTIONS
- *****************************************************************************/
-
-void mttkrp_csf(
-  splatt_csf const * const tensors,
-  matrix_t ** mats,
-  idx_t const mode,
-  thd_info * const thds,
-  splatt_mttkrp_ws * const ws,
-  double const * const opts)
+/**
+* @brief Choose the MTTKRP kernels for the depth of 'mode' in its CSF tensor
+*        and run them. This must be called by every thread of a parallel
+*        region and there is no barrier at the end.
+*
+* @param tensors An array of CSF representations.
+* @param mats The matrices, with the output stored in mats[MAX_NMODES].
+* @param mode The output mode.
+* @param thds Thread structures.
+* @param ws MTTKRP workspace.
+*/
+static void p_mttkrp_dispatch(
+    splatt_csf const * const tensors,
+    matrix_t ** mats,
+    idx_t const mode,
+    thd_info * const thds,
+    splatt_mttkrp_ws * const ws)
 {
-  /* ensure we use as many threads as our partitioning supports */
-  splatt_omp_set_num_threads(ws->num_threads);
-
-  if(pool == NULL) {
-    pool = mutex_alloc();
-  }
-
-  /* clear output matrix */
-  matrix_t * const M = mats[MAX_NMODES];
-  M->I = tensors[0].dims[mode];
-  memset(M->vals, 0, M->I * M->J * sizeof(val_t));
-
   idx_t const nmodes = tensors[0].nmodes;
 
-  /* reset thread times */
-  thd_reset(thds, splatt_omp_get_max_threads());
-
   /* choose which MTTKRP function to use */
   idx_t const which_csf = ws->mode_csf_map[mode];
   idx_t const outdepth = csf_mode_to_depth(&(tensors[which_csf]), mode);
@@ -1328,16 +1315,142 @@ void mttkrp_csf(
         p_csf_mttkrp_intl_locked, p_csf_mttkrp_intl_nolock,
         mats, mode, thds, ws);
   }
+}
+
+
+/**
+* @brief Record and print the per-thread times of an MTTKRP, then reset them.
+*
+* @param mode The output mode.
+* @param thds Thread structures.
+* @param nthreads The number of threads.
+* @param ws MTTKRP workspace.
+* @param opts SPLATT options.
+*/
+static void p_mttkrp_report(
+    idx_t const mode,
+    thd_info * const thds,
+    int const nthreads,
+    splatt_mttkrp_ws const * const ws,
+    double const * const opts)
+{
+  if(metrics_enabled()) {
+    for(int t=0; t < nthreads; ++t) {
+      metrics_accum("mttkrp", "thread_seconds", -1, mode, t,
+          thds[t].ttime.seconds);
+    }
+    if(ws->is_privatized[mode]) {
+      metrics_accum("mttkrp", "reduction_seconds", -1, mode, -1,
+          ws->reduction_time);
+    }
+    if(ws->steal[mode] != NULL) {
+      metrics_accum("mttkrp", "steals", -1, mode, -1,
+          (double) steal_count(ws->steal[mode]));
+    }
+  }
 
   /* print thread times, if requested */
   if((int)opts[SPLATT_OPTION_VERBOSITY] == SPLATT_VERBOSITY_MAX) {
     printf("MTTKRP mode %"SPLATT_PF_IDX": ", mode+1);
-    thd_time_stats(thds, splatt_omp_get_max_threads());
+    thd_time_stats(thds, nthreads);
     if(ws->is_privatized[mode]) {
       printf("  reduction-time: %0.3fs\n", ws->reduction_time);
     }
+    if(ws->steal[mode] != NULL) {
+      printf("  steals: %"SPLATT_PF_IDX" of %"SPLATT_PF_IDX" units\n",
+          steal_count(ws->steal[mode]), ws->steal[mode]->nunits);
+    }
   }
+  thd_reset(thds, nthreads);
+}
+
+
+/******************************************************************************
+ * PUBLIC FUNCTIONS
+ *****************************************************************************/
+
+void mttkrp_csf(
+  splatt_csf const * const tensors,
+  matrix_t ** mats,
+  idx_t const mode,
+  thd_info * const thds,
+  splatt_mttkrp_ws * const ws,
+  double const * const opts)
+{
+  /* ensure we use as many threads as our partitioning supports */
+  splatt_omp_set_num_threads(ws->num_threads);
+
+  if(pool == NULL) {
+    splatt_mem_tag const prev_tag = mem_tag_begin(SPLATT_MEM_MTTKRP_WS);
+    pool = mutex_alloc();
+    mem_tag_end(prev_tag);
+  }
+
+  /* clear output matrix */
+  matrix_t * const M = mats[MAX_NMODES];
+  M->I = tensors[0].dims[mode];
+  memset(M->vals, 0, M->I * M->J * sizeof(val_t));
+
+  /* reset thread times and give back stolen work */
   thd_reset(thds, splatt_omp_get_max_threads());
+  if(ws->steal[mode] != NULL) {
+    steal_reset(ws->steal[mode]);
+  }
+
+  perfctr_start(PERFCTR_MTTKRP + mode);
+
+  #pragma omp parallel
+  p_mttkrp_dispatch(tensors, mats, mode, thds, ws);
+
+  perfctr_stop(PERFCTR_MTTKRP + mode);
+
+  p_mttkrp_report(mode, thds, splatt_omp_get_max_threads(), ws, opts);
+}
+
+
+void mttkrp_csf_team(
+  splatt_csf const * const tensors,
+  matrix_t ** mats,
+  idx_t const mode,
+  thd_info * const thds,
+  splatt_mttkrp_ws * const ws,
+  double const * const opts)
+{
+  int const tid = splatt_omp_get_thread_num();
+  int const nthreads = splatt_omp_get_num_threads();
+  assert((idx_t) nthreads == ws->num_threads);
+
+  matrix_t * const M = mats[MAX_NMODES];
+  idx_t const nrows = tensors[0].dims[mode];
+
+  #pragma omp single
+  {
+    if(pool == NULL) {
+      splatt_mem_tag const prev_tag = mem_tag_begin(SPLATT_MEM_MTTKRP_WS);
+      pool = mutex_alloc();
+      mem_tag_end(prev_tag);
+    }
+    M->I = nrows;
+    if(ws->steal[mode] != NULL) {
+      steal_reset(ws->steal[mode]);
+    }
+  }
+
+  /* clear output matrix, in the same rows which each thread solves for */
+  idx_t const start = (nrows * tid) / nthreads;
+  idx_t const stop = (nrows * (tid+1)) / nthreads;
+  memset(M->vals + (start * M->J), 0, (stop - start) * M->J * sizeof(val_t));
+  timer_reset(&thds[tid].ttime);
+  #pragma omp barrier
+
+  perfctr_start_team(PERFCTR_MTTKRP + mode);
+  p_mttkrp_dispatch(tensors, mats, mode, thds, ws);
+  perfctr_stop_team(PERFCTR_MTTKRP + mode);
+
+  /* everyone must finish before the output is used or the times read */
+  #pragma omp barrier
+  #pragma omp master
+  p_mttkrp_report(mode, thds, nthreads, ws, opts);
 }
 
 
@@ -1348,6 +1461,58 @@ void mttkrp_csf(
 
 
 
+bool mttkrp_is_privatized(
+    splatt_csf const * const csf,
+    idx_t const mode,
+    double const * const opts)
+{
+  idx_t const length = csf->dims[mode];
+  idx_t const nthreads = (idx_t) opts[SPLATT_OPTION_NTHREADS];
+  double const thresh = opts[SPLATT_OPTION_PRIVTHRESH];
+
+  /* don't bother if it is not multithreaded. */
+  if(nthreads == 1) {
+    return false;
+  }
+
+  return (double)(length * nthreads) <= (thresh * (double)csf->nnz);
+}
+
+
+void mttkrp_reduce_privatized(
+    splatt_mttkrp_ws * const ws,
+    val_t * const restrict global_output,
+    idx_t const nrows,
+    idx_t const ncols)
+{
+  /* Ensure everyone has completed their local MTTKRP. */
+  #pragma omp barrier
+
+  sp_timer_t reduction_timer;
+  timer_fstart(&reduction_timer);
+
+  int const tid = splatt_omp_get_thread_num();
+
+  idx_t const num_threads = splatt_omp_get_num_threads();
+  idx_t const elem_per_thread = (nrows * ncols) / num_threads;
+  idx_t const start = tid * elem_per_thread;
+  idx_t const stop  = ((idx_t)tid == num_threads-1) ?
+     (nrows * ncols) : (tid + 1) * elem_per_thread;
+
+  /* reduction */
+  for(idx_t t=0; t < num_threads; ++t){
+    val_t const * const restrict thread_buf = ws->privatize_buffer[t];
+    for(idx_t x=start; x < stop; ++x) {
+      global_output[x] += thread_buf[x];
+    }
+  }
+
+  timer_stop(&reduction_timer);
+  #pragma omp master
+  ws->reduction_time = reduction_timer.seconds;
+}
+
+
 /******************************************************************************
  * DEPRECATED FUNCTIONS
  *****************************************************************************/
@@ -1700,7 +1865,9 @@ void mttkrp_stream(
   idx_t const mode)
 {
   if(pool == NULL) {
+    splatt_mem_tag const prev_tag = mem_tag_begin(SPLATT_MEM_MTTKRP_WS);
     pool = mutex_alloc();
+    mem_tag_end(prev_tag);
   }
 
   matrix_t * const M = mats[MAX_NMODES];
@@ -1803,9 +1970,9 @@ int splatt_mttkrp(
   /* cleanup */
   thd_free(thds, nthreads);
   for(idx_t m=0; m < nmodes; ++m) {
-    free(mats[m]);
+    splatt_free(mats[m]);
   }
-  free(mats[MAX_NMODES]);
+  splatt_free(mats[MAX_NMODES]);
 
   return SPLATT_SUCCESS;
 }
@@ -1816,6 +1983,7 @@ splatt_mttkrp_ws * splatt_mttkrp_alloc_ws(
     splatt_idx_t const ncolumns,
     double const * const opts)
 {
+  splatt_mem_tag const prev_tag = mem_tag_begin(SPLATT_MEM_MTTKRP_WS);
   splatt_mttkrp_ws * ws = splatt_malloc(sizeof(*ws));
 
   idx_t num_csf = 0;
@@ -1877,13 +2045,25 @@ splatt_mttkrp_ws * splatt_mttkrp_alloc_ws(
     }
   }
 
+  /* work stealing replaces the static partitions */
+  for(idx_t m=0; m < MAX_NMODES; ++m) {
+    ws->steal[m] = NULL;
+  }
+  for(idx_t m=0; m < tensors->nmodes; ++m) {
+    if(opts[SPLATT_OPTION_STEAL] && num_threads > 1) {
+      ws->steal[m] = steal_alloc(&(tensors[ws->mode_csf_map[m]]), m,
+          (int) num_threads);
+    }
+  }
+
 
   /* allocate privatization buffer */
   idx_t largest_priv_dim = 0;
   ws->privatize_buffer =
       splatt_malloc(num_threads * sizeof(*(ws->privatize_buffer)));
   for(idx_t m=0; m < tensors->nmodes; ++m) {
-    ws->is_privatized[m] = p_is_privatized(tensors, m, opts);
+    ws->is_privatized[m] = mttkrp_is_privatized(tensors, m, opts);
+    metrics_set("mttkrp", "privatized", -1, m, -1, ws->is_privatized[m]);
 
     if(ws->is_privatized[m]) {
       largest_priv_dim = SS_MAX(largest_priv_dim, tensors->dims[m]);
@@ -1892,22 +2072,25 @@ splatt_mttkrp_ws * splatt_mttkrp_alloc_ws(
       }
     }
   }
+  /* owner threads first touch their buffers to place them on their node */
+  size_t const priv_bytes = largest_priv_dim * ncolumns *
+      sizeof(**(ws->privatize_buffer));
+  #pragma omp parallel for schedule(static, 1) num_threads(num_threads)
   for(idx_t t=0; t < num_threads; ++t) {
-    ws->privatize_buffer[t] = splatt_malloc(largest_priv_dim * ncolumns *
-        sizeof(**(ws->privatize_buffer)));
+    ws->privatize_buffer[t] = splatt_malloc(priv_bytes);
+    memset(ws->privatize_buffer[t], 0, priv_bytes);
   }
   if(largest_priv_dim > 0 &&
         (int)opts[SPLATT_OPTION_VERBOSITY] == SPLATT_VERBOSITY_MAX) {
 
-    size_t bytes = num_threads * largest_priv_dim * ncolumns *
-        sizeof(**(ws->privatize_buffer));
-    char * bstr = bytes_str(bytes);
+    char * bstr = bytes_str(num_threads * priv_bytes);
 
     printf("PRIVATIZATION-BUF: %s\n", bstr);
     printf("\n");
     free(bstr);
   }
 
+  mem_tag_end(prev_tag);
   return ws;
 }
 
@@ -1924,6 +2107,9 @@ void splatt_mttkrp_free_ws(
     splatt_free(ws->tile_partition[c]);
     splatt_free(ws->tree_partition[c]);
   }
+  for(idx_t m=0; m < MAX_NMODES; ++m) {
+    steal_free(ws->steal[m]);
+  }
   splatt_free(ws);
 }
 
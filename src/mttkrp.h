@@ -41,6 +41,63 @@ void mttkrp_csf(
   double const * const opts);
 
 
+#define mttkrp_csf_team splatt_mttkrp_csf_team
+/**
+* @brief Like mttkrp_csf(), but inside a parallel region whose team has as
+*        many threads as 'ws' was allocated for. The output is complete when
+*        this returns.
+*
+*        NOTE: this must be called by every thread of the team.
+*
+* @param tensors The CSF tensor(s) to factor.
+* @param mats The output and input matrices.
+* @param mode Which mode we are computing for.
+* @param thds Thread structures.
+* @param ws MTTKRP workspace.
+* @param opts SPLATT options.
+*/
+void mttkrp_csf_team(
+  splatt_csf const * const tensors,
+  matrix_t ** mats,
+  idx_t const mode,
+  thd_info * const thds,
+  splatt_mttkrp_ws * const ws,
+  double const * const opts);
+
+
+#define mttkrp_is_privatized splatt_mttkrp_is_privatized
+/**
+* @brief Should a certain mode should be privatized to avoid locks?
+*
+* @param csf The tensor (just used for dimensions).
+* @param mode The mode we are processing.
+* @param opts Options, storing the # threads and the threshold.
+*
+* @return true, if we should privatize.
+*/
+bool mttkrp_is_privatized(
+    splatt_csf const * const csf,
+    idx_t const mode,
+    double const * const opts);
+
+
+#define mttkrp_reduce_privatized splatt_mttkrp_reduce_privatized
+/**
+* @brief Sum the thread-local outputs of a privatized MTTKRP into the global
+*        output. This must be called by every thread of a parallel region.
+*
+* @param ws MTTKRP workspace containing thread-local outputs.
+* @param global_output The global MTTKRP output we are reducing into.
+* @param nrows The number of rows in the MTTKRP.
+* @param ncols The number of columns in the MTTKRP.
+*/
+void mttkrp_reduce_privatized(
+    splatt_mttkrp_ws * const ws,
+    val_t * const restrict global_output,
+    idx_t const nrows,
+    idx_t const ncols);
+
+
 /******************************************************************************
  * DEPRECATED FUNCTIONS
  *****************************************************************************/
@@ -30,6 +30,18 @@ double * splatt_default_opts(void)
 
   opts[SPLATT_OPTION_DECOMP] = SPLATT_DECOMP_MEDIUM;
   opts[SPLATT_OPTION_COMM]   = SPLATT_COMM_ALL2ALL;
+  opts[SPLATT_OPTION_REPLTHRESH] = 0;
+  opts[SPLATT_OPTION_NODE_REDUCE] = 0;
+  opts[SPLATT_OPTION_FUSE_REDUCE] = 0;
+  opts[SPLATT_OPTION_COMM_THREADS] = 0;
+  opts[SPLATT_OPTION_COMM_PRECISION] = SPLATT_PRECISION_FULL;
+  opts[SPLATT_OPTION_COMM_DELTA] = 0;
+  opts[SPLATT_OPTION_REBALANCE] = 0;
+  opts[SPLATT_OPTION_TIMELIMIT] = 0;
+  opts[SPLATT_OPTION_NUMA] = SPLATT_NUMA_OFF;
+  opts[SPLATT_OPTION_TEAM] = 0;
+  opts[SPLATT_OPTION_AFFINITY] = SPLATT_AFFINITY_NONE;
+  opts[SPLATT_OPTION_STEAL] = 0;
 
   opts[SPLATT_OPTION_RANDSEED] = time(NULL);
 
@@ -49,6 +61,6 @@ double * splatt_default_opts(void)
 void splatt_free_opts(
   double * opts)
 {
-  free(opts);
+  splatt_free(opts);
 }
 
@@ -0,0 +1,423 @@
+
+
+/******************************************************************************
+ * INCLUDES
+ *****************************************************************************/
+#include "perfctr.h"
+#include "thd_info.h"
+
+#include <stdint.h>
+#include <errno.h>
+
+#ifdef SPLATT_USE_PERFCTR
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+
+/******************************************************************************
+ * PRIVATE STRUCTURES
+ *****************************************************************************/
+
+/* bytes moved per last-level cache miss, used to estimate DRAM traffic */
+#define PERFCTR_LINE_BYTES 64
+
+/**
+* @brief Counter state owned by a single thread.
+*/
+typedef struct
+{
+  bool opened;
+  int fds[PERFCTR_NEVENTS];
+  uint64_t start[PERFCTR_NEVENTS];
+  uint64_t counts[PERFCTR_NREGIONS][PERFCTR_NEVENTS];
+} perfctr_thd;
+
+
+static char const * const region_names[] = {
+  [PERFCTR_INV]     = "INVERSE",
+  [PERFCTR_ATA]     = "MAT A^TA",
+  [PERFCTR_MATNORM] = "MAT NORM",
+};
+
+static bool is_enabled = false;
+static bool event_ok[PERFCTR_NEVENTS];
+static idx_t ncalls[PERFCTR_NREGIONS];
+
+static perfctr_thd * thd_ctrs = NULL;
+static int nthd_ctrs = 0;
+static int nthd_used = 0;
+
+
+
+/******************************************************************************
+ * PRIVATE FUNCTIONS
+ *****************************************************************************/
+
+#ifdef SPLATT_USE_PERFCTR
+
+/**
+* @brief Open one counter for the calling thread on any CPU.
+*
+* @param event Which event to count.
+*
+* @return A file descriptor, or -1 if the event is not available.
+*/
+static int p_open_event(
+    perfctr_event const event)
+{
+  struct perf_event_attr attr;
+  memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED |
+                     PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+  switch(event) {
+  case PERFCTR_CYCLES:
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = PERF_COUNT_HW_CPU_CYCLES;
+    break;
+  case PERFCTR_INSTRUCTIONS:
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+    break;
+  case PERFCTR_LLC_REFS:
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = PERF_COUNT_HW_CACHE_REFERENCES;
+    break;
+  case PERFCTR_LLC_MISSES:
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = PERF_COUNT_HW_CACHE_MISSES;
+    break;
+  default:
+    return -1;
+  }
+
+  /* pid=0, cpu=-1: this thread, wherever it runs */
+  return (int) syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+
+/**
+* @brief Read a counter, scaled up if the kernel had to multiplex it.
+*/
+static uint64_t p_read_event(
+    int const fd)
+{
+  uint64_t buf[3];
+  if(read(fd, buf, sizeof(buf)) != sizeof(buf)) {
+    return 0;
+  }
+  if(buf[2] > 0 && buf[2] < buf[1]) {
+    return (uint64_t) ((double) buf[0] * ((double) buf[1] / (double) buf[2]));
+  }
+  return buf[0];
+}
+
+#endif
+
+
+/**
+* @brief Read all counters of the calling thread into 'vals'. Counters are
+*        opened on first use.
+*/
+static void p_read_thread(
+    perfctr_thd * const thd,
+    uint64_t * const vals)
+{
+#ifdef SPLATT_USE_PERFCTR
+  if(!thd->opened) {
+    for(int e=0; e < PERFCTR_NEVENTS; ++e) {
+      thd->fds[e] = event_ok[e] ? p_open_event(e) : -1;
+    }
+    thd->opened = true;
+  }
+  for(int e=0; e < PERFCTR_NEVENTS; ++e) {
+    vals[e] = (thd->fds[e] >= 0) ? p_read_event(thd->fds[e]) : 0;
+  }
+#else
+  for(int e=0; e < PERFCTR_NEVENTS; ++e) {
+    vals[e] = 0;
+  }
+#endif
+}
+
+
+/**
+* @brief Make sure there is counter state for every thread we may launch.
+*/
+static void p_grow_threads(
+    int const nthreads)
+{
+  if(nthreads <= nthd_ctrs) {
+    return;
+  }
+
+  thd_ctrs = realloc(thd_ctrs, nthreads * sizeof(*thd_ctrs));
+  for(int t=nthd_ctrs; t < nthreads; ++t) {
+    memset(&(thd_ctrs[t]), 0, sizeof(thd_ctrs[t]));
+    for(int e=0; e < PERFCTR_NEVENTS; ++e) {
+      thd_ctrs[t].fds[e] = -1;
+    }
+  }
+  nthd_ctrs = nthreads;
+}
+
+
+static void p_print_count(
+    bool const ok,
+    double const val)
+{
+  if(ok) {
+    printf(" %10.3e", val);
+  } else {
+    printf(" %10s", "n/a");
+  }
+}
+
+
+static void p_print_row(
+    char const * const name,
+    uint64_t const * const counts,
+    double const imbalance)
+{
+  printf("  %-12s", name);
+  p_print_count(event_ok[PERFCTR_CYCLES], counts[PERFCTR_CYCLES]);
+  p_print_count(event_ok[PERFCTR_INSTRUCTIONS], counts[PERFCTR_INSTRUCTIONS]);
+
+  if(event_ok[PERFCTR_CYCLES] && event_ok[PERFCTR_INSTRUCTIONS] &&
+      counts[PERFCTR_CYCLES] > 0) {
+    printf(" %5.2f", (double) counts[PERFCTR_INSTRUCTIONS] /
+        (double) counts[PERFCTR_CYCLES]);
+  } else {
+    printf(" %5s", "n/a");
+  }
+
+  p_print_count(event_ok[PERFCTR_LLC_MISSES], counts[PERFCTR_LLC_MISSES]);
+  if(event_ok[PERFCTR_LLC_REFS] && event_ok[PERFCTR_LLC_MISSES] &&
+      counts[PERFCTR_LLC_REFS] > 0) {
+    printf(" %5.1f%%", 100. * (double) counts[PERFCTR_LLC_MISSES] /
+        (double) counts[PERFCTR_LLC_REFS]);
+  } else {
+    printf(" %6s", "n/a");
+  }
+
+  if(event_ok[PERFCTR_LLC_MISSES]) {
+    printf(" %8.3f", (double) counts[PERFCTR_LLC_MISSES] *
+        PERFCTR_LINE_BYTES / 1e9);
+  } else {
+    printf(" %8s", "n/a");
+  }
+
+  if(imbalance > 0.) {
+    printf(" %5.2f", imbalance);
+  }
+  printf("\n");
+}
+
+
+
+/******************************************************************************
+ * PUBLIC FUNCTIONS
+ *****************************************************************************/
+
+bool perfctr_init(void)
+{
+  if(is_enabled) {
+    return true;
+  }
+
+#ifdef SPLATT_USE_PERFCTR
+  /* probe each event on the calling thread so the others do not retry */
+  bool any = false;
+  int err = 0;
+  for(int e=0; e < PERFCTR_NEVENTS; ++e) {
+    int const fd = p_open_event(e);
+    event_ok[e] = (fd >= 0);
+    if(fd >= 0) {
+      close(fd);
+      any = true;
+    } else if(err == 0) {
+      err = errno;
+    }
+  }
+
+  if(!any) {
+    fprintf(stderr, "SPLATT: hardware counters unavailable (%s). "
+                    "Continuing without them.\n", strerror(err));
+    return false;
+  }
+
+  memset(ncalls, 0, sizeof(ncalls));
+  is_enabled = true;
+  return true;
+#else
+  fprintf(stderr, "SPLATT: hardware counters are not supported in this "
+                  "build. Continuing without them.\n");
+  return false;
+#endif
+}
+
+
+bool perfctr_enabled(void)
+{
+  return is_enabled;
+}
+
+
+void perfctr_start(
+    perfctr_region const region)
+{
+  if(!is_enabled) {
+    return;
+  }
+
+  int const nthreads = splatt_omp_get_max_threads();
+  p_grow_threads(nthreads);
+  nthd_used = SS_MAX(nthd_used, nthreads);
+
+  #pragma omp parallel
+  {
+    perfctr_thd * const thd = &(thd_ctrs[splatt_omp_get_thread_num()]);
+    p_read_thread(thd, thd->start);
+  }
+}
+
+
+void perfctr_stop(
+    perfctr_region const region)
+{
+  if(!is_enabled) {
+    return;
+  }
+
+  ++ncalls[region];
+
+  #pragma omp parallel
+  {
+    perfctr_thd * const thd = &(thd_ctrs[splatt_omp_get_thread_num()]);
+    uint64_t now[PERFCTR_NEVENTS];
+    p_read_thread(thd, now);
+    for(int e=0; e < PERFCTR_NEVENTS; ++e) {
+      thd->counts[region][e] += now[e] - thd->start[e];
+    }
+  }
+}
+
+
+void perfctr_start_team(
+    perfctr_region const region)
+{
+  if(!is_enabled) {
+    return;
+  }
+
+  #pragma omp single
+  {
+    int const nthreads = splatt_omp_get_num_threads();
+    p_grow_threads(nthreads);
+    nthd_used = SS_MAX(nthd_used, nthreads);
+  }
+
+  perfctr_thd * const thd = &(thd_ctrs[splatt_omp_get_thread_num()]);
+  p_read_thread(thd, thd->start);
+}
+
+
+void perfctr_stop_team(
+    perfctr_region const region)
+{
+  if(!is_enabled) {
+    return;
+  }
+
+  perfctr_thd * const thd = &(thd_ctrs[splatt_omp_get_thread_num()]);
+  uint64_t now[PERFCTR_NEVENTS];
+  p_read_thread(thd, now);
+  for(int e=0; e < PERFCTR_NEVENTS; ++e) {
+    thd->counts[region][e] += now[e] - thd->start[e];
+  }
+
+  #pragma omp master
+  ++ncalls[region];
+}
+
+
+void perfctr_report(
+    bool const verbose)
+{
+  if(!is_enabled) {
+    return;
+  }
+
+  printf("\n");
+  printf("Hardware counters ----------------------------------------------\n");
+  printf("  %-12s %10s %10s %5s %10s %6s %8s %5s\n", "REGION", "CYCLES",
+      "INSTR", "IPC", "LLC-MISS", "MISS", "~DRAM-GB", "IMBAL");
+
+  for(int r=0; r < PERFCTR_NREGIONS; ++r) {
+    if(ncalls[r] == 0) {
+      continue;
+    }
+
+    char name[32];
+    if(r < PERFCTR_INV) {
+      sprintf(name, "MTTKRP %d", r - PERFCTR_MTTKRP + 1);
+    } else {
+      sprintf(name, "%s", region_names[r]);
+    }
+
+    /* sum over threads, and compare the busiest thread to the average */
+    uint64_t total[PERFCTR_NEVENTS];
+    memset(total, 0, sizeof(total));
+    uint64_t maxcyc = 0;
+    int active = 0;
+    for(int t=0; t < nthd_used; ++t) {
+      uint64_t const * const counts = thd_ctrs[t].counts[r];
+      for(int e=0; e < PERFCTR_NEVENTS; ++e) {
+        total[e] += counts[e];
+      }
+      if(counts[PERFCTR_CYCLES] > 0) {
+        maxcyc = SS_MAX(maxcyc, counts[PERFCTR_CYCLES]);
+        ++active;
+      }
+    }
+
+    double imbalance = 0.;
+    if(active > 0 && total[PERFCTR_CYCLES] > 0) {
+      imbalance = (double) maxcyc /
+          ((double) total[PERFCTR_CYCLES] / (double) active);
+    }
+    p_print_row(name, total, imbalance);
+
+    if(verbose) {
+      for(int t=0; t < nthd_used; ++t) {
+        sprintf(name, "  thd %d", t);
+        p_print_row(name, thd_ctrs[t].counts[r], 0.);
+      }
+    }
+  }
+}
+
+
+void perfctr_finalize(void)
+{
+#ifdef SPLATT_USE_PERFCTR
+  for(int t=0; t < nthd_ctrs; ++t) {
+    for(int e=0; e < PERFCTR_NEVENTS; ++e) {
+      if(thd_ctrs[t].fds[e] >= 0) {
+        close(thd_ctrs[t].fds[e]);
+      }
+    }
+  }
+#endif
+  free(thd_ctrs);
+  thd_ctrs = NULL;
+  nthd_ctrs = 0;
+  nthd_used = 0;
+  is_enabled = false;
+}
@@ -0,0 +1,126 @@
+#ifndef SPLATT_PERFCTR_H
+#define SPLATT_PERFCTR_H
+
+
+/******************************************************************************
+ * INCLUDES
+ *****************************************************************************/
+#include "base.h"
+
+
+/******************************************************************************
+ * STRUCTURES
+ *****************************************************************************/
+
+/**
+* @brief The hardware events sampled around each instrumented region.
+*/
+typedef enum
+{
+  PERFCTR_CYCLES,
+  PERFCTR_INSTRUCTIONS,
+  PERFCTR_LLC_REFS,
+  PERFCTR_LLC_MISSES,
+  PERFCTR_NEVENTS
+} perfctr_event;
+
+
+/**
+* @brief Instrumented kernels. MTTKRP is counted separately for each mode,
+*        starting at PERFCTR_MTTKRP.
+*/
+typedef enum
+{
+  PERFCTR_MTTKRP,
+  PERFCTR_INV = PERFCTR_MTTKRP + MAX_NMODES,
+  PERFCTR_ATA,
+  PERFCTR_MATNORM,
+  PERFCTR_NREGIONS
+} perfctr_region;
+
+
+/******************************************************************************
+ * PUBLIC FUNCTIONS
+ *****************************************************************************/
+
+#define perfctr_init splatt_perfctr_init
+/**
+* @brief Turn on hardware counter sampling. Counters are opened lazily by each
+*        thread the first time it enters an instrumented region. If the
+*        platform or kernel does not expose counters, a notice is printed and
+*        sampling stays off.
+*
+* @return Whether sampling was enabled.
+*/
+bool perfctr_init(void);
+
+
+#define perfctr_enabled splatt_perfctr_enabled
+/**
+* @brief Return whether hardware counters are being sampled.
+*/
+bool perfctr_enabled(void);
+
+
+#define perfctr_start splatt_perfctr_start
+/**
+* @brief Snapshot the counters of every thread in the current team. This must
+*        be called from serial code, after the number of threads for the
+*        region has been set.
+*
+* @param region The region that is starting.
+*/
+void perfctr_start(perfctr_region const region);
+
+
+#define perfctr_stop splatt_perfctr_stop
+/**
+* @brief Read the counters of every thread again and accumulate the
+*        difference into 'region'.
+*
+* @param region The region that is ending.
+*/
+void perfctr_stop(perfctr_region const region);
+
+
+#define perfctr_start_team splatt_perfctr_start_team
+/**
+* @brief Like perfctr_start(), but from inside a parallel region. Each thread
+*        snapshots its own counters.
+*
+*        NOTE: this must be called by every thread of the team.
+*
+* @param region The region that is starting.
+*/
+void perfctr_start_team(perfctr_region const region);
+
+
+#define perfctr_stop_team splatt_perfctr_stop_team
+/**
+* @brief Like perfctr_stop(), but from inside a parallel region.
+*
+*        NOTE: this must be called by every thread of the team.
+*
+* @param region The region that is ending.
+*/
+void perfctr_stop_team(perfctr_region const region);
+
+
+#define perfctr_report splatt_perfctr_report
+/**
+* @brief Output a summary of the counters gathered in each region. Per-thread
+*        counts are shown if 'verbose' is set. Nothing is printed if sampling
+*        is off.
+*
+* @param verbose Also print per-thread counts.
+*/
+void perfctr_report(bool const verbose);
+
+
+#define perfctr_finalize splatt_perfctr_finalize
+/**
+* @brief Close all counters and free their storage.
+*/
+void perfctr_finalize(void);
+
+#endif
@@ -0,0 +1,367 @@
+/******************************************************************************
+ * INCLUDES
+ *****************************************************************************/
+#include "placement.h"
+#include "metrics.h"
+
+#include <stdint.h>
+
+#ifdef SPLATT_USE_NUMA
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/mempolicy.h>
+#endif
+
+
+/******************************************************************************
+ * PRIVATE STRUCTURES
+ *****************************************************************************/
+
+/* pages queried with a single move_pages() call */
+#define NUMA_QUERY_BATCH 1024
+
+#define NUMA_MASK_BITS (8 * sizeof(unsigned long))
+#define NUMA_MASK_LEN ((NUMA_MAX_NODES + NUMA_MASK_BITS - 1) / NUMA_MASK_BITS)
+
+/* 0 until the nodes of the machine have been read */
+static int nnodes = 0;
+static unsigned long online_mask[NUMA_MASK_LEN];
+
+
+
+/******************************************************************************
+ * PRIVATE FUNCTIONS
+ *****************************************************************************/
+
+/**
+* @brief Read the online NUMA nodes, e.g., "0-1,3", from sysfs into
+*        'online_mask' and 'nnodes'.
+*/
+static void p_read_nodes(void)
+{
+  memset(online_mask, 0, sizeof(online_mask));
+  nnodes = 0;
+
+  FILE * fin = fopen("/sys/devices/system/node/online", "r");
+  if(fin != NULL) {
+    int lo;
+    int hi;
+    char sep;
+    while(fscanf(fin, "%d", &lo) == 1) {
+      hi = lo;
+      sep = (char) fgetc(fin);
+      if(sep == '-') {
+        if(fscanf(fin, "%d", &hi) != 1) {
+          break;
+        }
+        sep = (char) fgetc(fin);
+      }
+      for(int n=lo; n <= hi && n < NUMA_MAX_NODES; ++n) {
+        online_mask[n / NUMA_MASK_BITS] |= 1UL << (n % NUMA_MASK_BITS);
+        ++nnodes;
+      }
+      if(sep != ',') {
+        break;
+      }
+    }
+    fclose(fin);
+  }
+
+  /* no sysfs: treat the machine as one node */
+  if(nnodes == 0) {
+    online_mask[0] = 1UL;
+    nnodes = 1;
+  }
+}
+
+
+#ifdef SPLATT_USE_NUMA
+
+static size_t p_page_size(void)
+{
+  long const bytes = sysconf(_SC_PAGESIZE);
+  return (bytes > 0) ? (size_t) bytes : 4096;
+}
+
+
+/**
+* @brief Return the NUMA node of the CPU running the calling thread, or -1.
+*/
+static int p_my_node(void)
+{
+  unsigned cpu;
+  unsigned node;
+  if(syscall(SYS_getcpu, &cpu, &node, NULL) != 0) {
+    return -1;
+  }
+  return (int) node;
+}
+
+
+/**
+* @brief Count the nodes of 'npages' pages starting at the page-aligned
+*        'first'.
+*
+* @param first The first page.
+* @param npages The number of pages.
+* @param node The node of the owner of the pages, or -1 if they have none.
+* @param[out] placement The summary to add to.
+*/
+static void p_count_pages(
+    char const * const first,
+    size_t const npages,
+    int const node,
+    numa_placement * const placement)
+{
+  size_t const pagesize = p_page_size();
+  void * pages[NUMA_QUERY_BATCH];
+  int status[NUMA_QUERY_BATCH];
+
+  for(size_t p=0; p < npages; p += NUMA_QUERY_BATCH) {
+    size_t const nbatch = SS_MIN(npages - p, NUMA_QUERY_BATCH);
+    for(size_t i=0; i < nbatch; ++i) {
+      pages[i] = (void *) (first + ((p + i) * pagesize));
+    }
+
+    /* with no target nodes, move_pages() only reports where pages are */
+    if(syscall(SYS_move_pages, 0, nbatch, pages, NULL, status, 0) != 0) {
+      placement->unmapped += nbatch;
+      continue;
+    }
+
+    for(size_t i=0; i < nbatch; ++i) {
+      if(status[i] < 0 || status[i] >= NUMA_MAX_NODES) {
+        ++placement->unmapped;
+        continue;
+      }
+      ++placement->pages[status[i]];
+      if(node >= 0) {
+        ++placement->owned;
+        if(status[i] == node) {
+          ++placement->local;
+        }
+      }
+    }
+  }
+}
+
+#endif
+
+
+
+/******************************************************************************
+ * PUBLIC FUNCTIONS
+ *****************************************************************************/
+
+int numa_nnodes(void)
+{
+  if(nnodes == 0) {
+    p_read_nodes();
+  }
+  return nnodes;
+}
+
+
+bool numa_should_place(
+    double const * const opts)
+{
+  switch((splatt_numa_type) opts[SPLATT_OPTION_NUMA]) {
+  case SPLATT_NUMA_ON:
+    return true;
+  case SPLATT_NUMA_AUTO:
+    return numa_nnodes() > 1 && opts[SPLATT_OPTION_NTHREADS] > 1;
+  default:
+    return false;
+  }
+}
+
+
+bool numa_can_query(void)
+{
+#ifdef SPLATT_USE_NUMA
+  return true;
+#else
+  return false;
+#endif
+}
+
+
+void * numa_place_owned(
+    void * ptr,
+    size_t const * const offsets,
+    int const nthreads)
+{
+  size_t const bytes = offsets[nthreads];
+  if(ptr == NULL || bytes == 0) {
+    return ptr;
+  }
+
+  splatt_mem_tag const tag = mem_tag_of(ptr);
+  char * const placed = splatt_malloc(bytes);
+  char const * const src = ptr;
+
+  /* the first touch of a page decides its node */
+  #pragma omp parallel for schedule(static, 1) num_threads(nthreads)
+  for(int t=0; t < nthreads; ++t) {
+    memcpy(placed + offsets[t], src + offsets[t], offsets[t+1] - offsets[t]);
+  }
+
+  mem_retag(placed, tag);
+  splatt_free(ptr);
+  return placed;
+}
+
+
+void * numa_place_interleaved(
+    void * ptr,
+    size_t const bytes,
+    int const nthreads)
+{
+  if(ptr == NULL || bytes == 0) {
+    return ptr;
+  }
+
+#ifdef SPLATT_USE_NUMA
+  /* only whole pages can be given a policy */
+  size_t const pagesize = p_page_size();
+  uintptr_t const start = ((uintptr_t) ptr + pagesize - 1) & ~(pagesize - 1);
+  uintptr_t const end = ((uintptr_t) ptr + bytes) & ~(pagesize - 1);
+  if(end <= start) {
+    return ptr;
+  }
+
+  numa_nnodes();
+  if(syscall(SYS_mbind, (void *) start, end - start, MPOL_INTERLEAVE,
+        online_mask, NUMA_MAX_NODES + 1, MPOL_MF_MOVE) == 0) {
+    return ptr;
+  }
+#endif
+
+  /* fall back to even blocks by first touch */
+  size_t * offsets = splatt_malloc((nthreads+1) * sizeof(*offsets));
+  for(int t=0; t <= nthreads; ++t) {
+    offsets[t] = (bytes * (size_t) t) / (size_t) nthreads;
+  }
+  void * placed = numa_place_owned(ptr, offsets, nthreads);
+  splatt_free(offsets);
+  return placed;
+}
+
+
+void numa_count(
+    void const * const ptr,
+    size_t const bytes,
+    numa_placement * const placement)
+{
+#ifdef SPLATT_USE_NUMA
+  if(ptr == NULL || bytes == 0) {
+    return;
+  }
+  size_t const pagesize = p_page_size();
+  uintptr_t const first = (uintptr_t) ptr & ~(pagesize - 1);
+  uintptr_t const last = ((uintptr_t) ptr + bytes - 1) & ~(pagesize - 1);
+  p_count_pages((char const *) first, ((last - first) / pagesize) + 1, -1,
+      placement);
+#endif
+}
+
+
+void numa_count_owned(
+    void const * const ptr,
+    size_t const * const offsets,
+    int const nthreads,
+    numa_placement * const placement)
+{
+#ifdef SPLATT_USE_NUMA
+  if(ptr == NULL || offsets[nthreads] == 0) {
+    return;
+  }
+  size_t const pagesize = p_page_size();
+  uintptr_t const base = (uintptr_t) ptr;
+
+  #pragma omp parallel for schedule(static, 1) num_threads(nthreads)
+  for(int t=0; t < nthreads; ++t) {
+    if(offsets[t] == offsets[t+1]) {
+      continue;
+    }
+
+    /* pages whose first byte is in this thread's range */
+    uintptr_t first = (base + offsets[t] + pagesize - 1) & ~(pagesize - 1);
+    if(offsets[t] == 0) {
+      first = base & ~(pagesize - 1);
+    }
+    uintptr_t const end = base + offsets[t+1];
+    if(first >= end) {
+      continue;
+    }
+
+    numa_placement mine;
+    memset(&mine, 0, sizeof(mine));
+    p_count_pages((char const *) first, ((end - 1 - first) / pagesize) + 1,
+        p_my_node(), &mine);
+
+    #pragma omp critical
+    {
+      for(int n=0; n < NUMA_MAX_NODES; ++n) {
+        placement->pages[n] += mine.pages[n];
+      }
+      placement->unmapped += mine.unmapped;
+      placement->owned += mine.owned;
+      placement->local += mine.local;
+    }
+  }
+#endif
+}
+
+
+void numa_count_thread(
+    void const * const ptr,
+    size_t const bytes,
+    int const tid,
+    int const nthreads,
+    numa_placement * const placement)
+{
+  size_t * offsets = splatt_malloc((nthreads+1) * sizeof(*offsets));
+  for(int t=0; t <= nthreads; ++t) {
+    offsets[t] = (t <= tid) ? 0 : bytes;
+  }
+  numa_count_owned(ptr, offsets, nthreads, placement);
+  splatt_free(offsets);
+}
+
+
+void numa_print_placement(
+    char const * const name,
+    char const * const group,
+    numa_placement const * const placement)
+{
+  size_t resident = 0;
+  size_t fullest = 0;
+  for(int n=0; n < NUMA_MAX_NODES; ++n) {
+    resident += placement->pages[n];
+    fullest = SS_MAX(fullest, placement->pages[n]);
+  }
+
+  printf("  %-8s %10zu pages ", name, resident + placement->unmapped);
+  for(int n=0; n < NUMA_MAX_NODES; ++n) {
+    if(placement->pages[n] > 0) {
+      printf(" N%d=%0.1f%%", n,
+          100. * (double) placement->pages[n] / (double) resident);
+    }
+  }
+  if(placement->owned > 0) {
+    printf("  LOCAL=%0.1f%%",
+        100. * (double) placement->local / (double) placement->owned);
+    metrics_set(group, "numa_local_pct", -1, -1, -1,
+        100. * (double) placement->local / (double) placement->owned);
+  }
+  if(placement->unmapped > 0) {
+    printf("  UNTOUCHED=%zu", placement->unmapped);
+  }
+  printf("\n");
+
+  if(resident > 0) {
+    metrics_set(group, "numa_fullest_pct", -1, -1, -1,
+        100. * (double) fullest / (double) resident);
+  }
+}
@@ -0,0 +1,172 @@
+#ifndef SPLATT_PLACEMENT_H
+#define SPLATT_PLACEMENT_H
+
+
+/******************************************************************************
+ * INCLUDES
+ *****************************************************************************/
+#include "base.h"
+
+
+/******************************************************************************
+ * STRUCTURES
+ *****************************************************************************/
+
+/* the most NUMA nodes which are tracked separately */
+#define NUMA_MAX_NODES 64
+
+
+/**
+* @brief Where the pages of some allocations reside.
+*/
+typedef struct
+{
+  size_t pages[NUMA_MAX_NODES]; /** Resident pages on each node. */
+  size_t unmapped;              /** Pages which have never been touched. */
+  size_t owned;                 /** Resident pages with an owner thread. */
+  size_t local;                 /** Owned pages on the node of their owner. */
+} numa_placement;
+
+
+
+/******************************************************************************
+ * PUBLIC FUNCTIONS
+ *****************************************************************************/
+
+#define numa_nnodes splatt_numa_nnodes
+/**
+* @brief Return the number of NUMA nodes of the machine, or 1 if they cannot
+*        be determined.
+*/
+int numa_nnodes(void);
+
+
+#define numa_should_place splatt_numa_should_place
+/**
+* @brief Decide from SPLATT_OPTION_NUMA whether memory should be placed.
+*
+* @param opts SPLATT options.
+*
+* @return Whether to place memory.
+*/
+bool numa_should_place(
+    double const * const opts);
+
+
+#define numa_can_query splatt_numa_can_query
+/**
+* @brief Return whether the node of a page can be queried on this platform.
+*        If not, the numa_count functions leave summaries unchanged.
+*/
+bool numa_can_query(void);
+
+
+#define numa_place_owned splatt_numa_place_owned
+/**
+* @brief Copy an allocation into a new one whose pages are first touched by
+*        the threads which will use them. Thread 't' owns bytes
+*        [offsets[t], offsets[t+1]). The new allocation is charged to the same
+*        subsystem and the old one is freed.
+*
+*        NOTE: this must be called outside of a parallel region.
+*
+* @param ptr An allocation from splatt_malloc().
+* @param offsets The byte ranges of each thread, of length 'nthreads+1'.
+* @param nthreads The number of threads.
+*
+* @return The new allocation.
+*/
+void * numa_place_owned(
+    void * ptr,
+    size_t const * const offsets,
+    int const nthreads);
+
+
+#define numa_place_interleaved splatt_numa_place_interleaved
+/**
+* @brief Interleave the pages of an allocation across all NUMA nodes. This is
+*        best for data which every thread reads, such as factor rows. If the
+*        platform does not support memory policies, the allocation is instead
+*        split into 'nthreads' even blocks placed by numa_place_owned().
+*
+* @param ptr An allocation from splatt_malloc().
+* @param bytes The size of the allocation.
+* @param nthreads The number of threads.
+*
+* @return The allocation, which may have moved.
+*/
+void * numa_place_interleaved(
+    void * ptr,
+    size_t const bytes,
+    int const nthreads);
+
+
+#define numa_count splatt_numa_count
+/**
+* @brief Add the pages of an allocation to a placement summary.
+*
+* @param ptr The memory to query.
+* @param bytes The size of the memory.
+* @param[out] placement The summary to add to.
+*/
+void numa_count(
+    void const * const ptr,
+    size_t const bytes,
+    numa_placement * const placement);
+
+
+#define numa_count_owned splatt_numa_count_owned
+/**
+* @brief Add the pages of an allocation to a placement summary, noting which
+*        of them reside on the node of the thread which owns them. Pages are
+*        owned by the thread whose range holds their first byte.
+*
+*        NOTE: this must be called outside of a parallel region.
+*
+* @param ptr The memory to query.
+* @param offsets The byte ranges of each thread, as in numa_place_owned().
+* @param nthreads The number of threads.
+* @param[out] placement The summary to add to.
+*/
+void numa_count_owned(
+    void const * const ptr,
+    size_t const * const offsets,
+    int const nthreads,
+    numa_placement * const placement);
+
+
+#define numa_count_thread splatt_numa_count_thread
+/**
+* @brief Add the pages of an allocation which is used by a single thread to a
+*        placement summary.
+*
+*        NOTE: this must be called outside of a parallel region.
+*
+* @param ptr The memory to query.
+* @param bytes The size of the memory.
+* @param tid The thread which owns the memory.
+* @param nthreads The number of threads.
+* @param[out] placement The summary to add to.
+*/
+void numa_count_thread(
+    void const * const ptr,
+    size_t const bytes,
+    int const tid,
+    int const nthreads,
+    numa_placement * const placement);
+
+
+#define numa_print_placement splatt_numa_print_placement
+/**
+* @brief Print one line of a placement report and record it as metrics.
+*
+* @param name What the pages hold, e.g., "CSF".
+* @param group The group of the metrics, e.g., "csf".
+* @param placement The summary to print.
+*/
+void numa_print_placement(
+    char const * const name,
+    char const * const group,
+    numa_placement const * const placement);
+
+#endif
@@ -92,8 +92,8 @@ static void p_reorder_slices(
   assert(sliceptr == nslices);
 
   free(pptr);
-  free(plookup);
-  free(slice);
+  splatt_free(plookup);
+  splatt_free(slice);
 }
 
 static void p_reorder_fibs(
@@ -173,7 +173,7 @@ static void p_reorder_fibs(
   assert(fidptr == nfids);
 
   free(pptr);
-  free(plookup);
+  splatt_free(plookup);
 }
 
 static void p_reorder_inds(
@@ -260,7 +260,7 @@ static void p_reorder_inds(
   assert(indptr == ninds);
 
   free(pptr);
-  free(plookup);
+  splatt_free(plookup);
 }
 
 
@@ -309,7 +309,7 @@ permutation_t * tt_perm(
     break;
   }
 
-  free(parts);
+  splatt_free(parts);
   timer_stop(&timers[TIMER_REORDER]);
   return perm;
 }
@@ -405,7 +405,7 @@ permutation_t * perm_hgraph(
   /* actually apply permutation */
   perm_apply(tt, perm->perms);
 
-  free(uncuts);
+  splatt_free(uncuts);
   return perm;
 }
 
@@ -457,7 +457,7 @@ permutation_t * perm_graph(
   perm_apply(tt, perm->perms);
 
   free(pptr);
-  free(plookup);
+  splatt_free(plookup);
   return perm;
 }
 
@@ -544,10 +544,10 @@ void perm_free(
   permutation_t * perm)
 {
   for(idx_t m=0; m < MAX_NMODES; ++m) {
-    free(perm->perms[m]);
-    free(perm->iperms[m]);
+    splatt_free(perm->perms[m]);
+    splatt_free(perm->iperms[m]);
   }
-  free(perm);
+  splatt_free(perm);
 }
 
 
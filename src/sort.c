@@ -850,14 +850,19 @@ static void p_counting_sort_hybrid(
     }
   } /* omp parallel */
 
+  /* the new arrays now hold the tensor, so charge them to its owner */
   for(idx_t i = 0; i < tt->nmodes; ++i) {
     if(i != m) {
+      splatt_mem_tag const owner = mem_tag_of(tt->ind[i]);
       splatt_free(tt->ind[i]);
       tt->ind[i] = new_ind[i];
+      mem_retag(tt->ind[i], owner);
     }
   }
+  splatt_mem_tag const owner = mem_tag_of(tt->vals);
   splatt_free(tt->vals);
   tt->vals = new_vals;
+  mem_retag(tt->vals, owner);
 
 
   histogram_array[nslices] = tt->nnz;
@@ -925,6 +930,7 @@ void tt_sort_range(
   idx_t const start,
   idx_t const end)
 {
+  splatt_mem_tag const prev_tag = mem_tag_begin(SPLATT_MEM_SORT);
   idx_t * cmplt;
   if(dim_perm == NULL) {
     cmplt = (idx_t*) splatt_malloc(tt->nmodes * sizeof(idx_t));
@@ -955,9 +961,10 @@ void tt_sort_range(
 
 
   if(dim_perm == NULL) {
-    free(cmplt);
+    splatt_free(cmplt);
   }
   timer_stop(&timers[TIMER_SORT]);
+  mem_tag_end(prev_tag);
 }
 
 
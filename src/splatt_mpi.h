@@ -26,6 +26,77 @@ typedef struct
  * PUBLIC STRUCTURES
  *****************************************************************************/
 
+/* How many candidate decompositions are remembered for reporting. */
+#define MPI_DECOMP_NPRED 5
+
+/**
+* @brief The communication/imbalance model's prediction for one decomposition.
+*/
+typedef struct
+{
+  splatt_decomp_type decomp;
+  int dims[MAX_NMODES];  /** process grid (MEDIUM only) */
+  double avgvolume;      /** rows sent + received per rank, per iteration */
+  double maxnnz;         /** nonzeros on the most loaded rank */
+  double cost;           /** modeled per-iteration cost, lower is better */
+} mpi_decomp_pred;
+
+
+/**
+* @brief State of compressed row exchanges (SPLATT_OPTION_COMM_PRECISION and
+*        SPLATT_OPTION_COMM_DELTA). Slots follow the nbr2globs/local2nbr
+*        layouts of rank_info.
+*/
+typedef struct
+{
+  splatt_precision_type precision;
+  double threshold; /** relative change needed to resend a row; 0 sends all */
+  idx_t nfactors;
+
+  /* Owner side of updates. shared[m] lists my owned rows (offsets from
+   * mat_start) which any neighbor receives, and slot_shared[m] maps each
+   * nbr2globs slot to its position in shared[m]. Shared rows are rounded in
+   * place, so that I compute with the values my neighbors receive. */
+  idx_t nshared[MAX_NMODES];
+  idx_t * shared[MAX_NMODES];
+  idx_t * slot_shared[MAX_NMODES];
+
+  /* With a threshold: the value of each shared row which my neighbors hold
+   * and its version, and the version last sent on each slot. Rows which did
+   * not change enough are restored to their last value instead of being
+   * sent. */
+  val_t * last[MAX_NMODES];
+  uint32_t * version[MAX_NMODES];
+  uint32_t * sent_version[MAX_NMODES];
+
+  /* Receiver side of updates: the last received values and their versions.
+   * Only used when threshold > 0. */
+  val_t * recvd[MAX_NMODES];
+  uint32_t * recvd_version[MAX_NMODES];
+
+  /* Receiver side of reductions: the compensation of each owned value while
+   * the neighbors' partial products are summed (Kahan summation). */
+  val_t * comp;
+
+  /* Byte buffers holding one record per slot, exchanged with the pattern of
+   * SPLATT_OPTION_COMM. Counts and displacements are in bytes, per layer rank
+   * and (nbr_*) per neighbor of rank_info's nbr_comm. */
+  splatt_comm_type comm;
+  MPI_Request req; /** outstanding collective exchange */
+  char * sendbuf;
+  char * recvbuf;
+  int * msg_bytes; /** bytes packed for each layer rank */
+  int * recv_bytes;
+  int * send_displs;
+  int * recv_displs;
+  int * nbr_peers;
+  int * nbr_send_bytes;
+  int * nbr_send_displs;
+  int * nbr_recv_bytes;
+  int * nbr_recv_displs;
+} mpi_compress;
+
+
 /**
 * @brief A structure for MPI rank structures (communicators, etc.).
 */
@@ -55,6 +126,11 @@ typedef struct
   /* same as cpd_args distribution. */
   splatt_decomp_type decomp;
 
+  /* Model predictions from mpi_decomp_model(). pred[0] is the decomposition
+   * in use and the rest are the best alternatives that were considered. */
+  mpi_decomp_pred pred[MPI_DECOMP_NPRED];
+  int npred;
+
 
   /* Send/Recv Structures
    * nlocal2nbr: This is the number of rows that I have in my tensor but do not
@@ -89,6 +165,50 @@ typedef struct
   MPI_Comm comm_3d;
   MPI_Comm layer_comm[MAX_NMODES];
 
+  /* Neighborhood collectives (SPLATT_COMM_NEIGHBOR), from
+   * mpi_nbr_plan_init().
+   * nbr_comm: A distributed graph over only the layer ranks that I exchange
+   *           rows with. Neighbors are ordered by layer rank.
+   * nbr_*_ptr/disp: local2nbr/nbr2globs ptr and disp, restricted to the
+   *                 neighbors of nbr_comm. Buffer layout is unchanged.
+   * nbr_*_req: Persistent requests, bound by mpi_nbr_plan_init() if the MPI
+   *            library supports persistent collectives.
+   */
+  MPI_Comm nbr_comm[MAX_NMODES];
+  int     nnbrs[MAX_NMODES];
+  int   * nbr_local2nbr_ptr[MAX_NMODES];
+  int   * nbr_local2nbr_disp[MAX_NMODES];
+  int   * nbr_nbr2globs_ptr[MAX_NMODES];
+  int   * nbr_nbr2globs_disp[MAX_NMODES];
+  MPI_Request nbr_update_req[MAX_NMODES];
+  MPI_Request nbr_reduce_req[MAX_NMODES];
+  val_t * nbr_local2nbr_buf; /** buffers bound to nbr_*_req */
+  val_t * nbr_nbr2globs_buf;
+
+  /* Node-aware reductions (SPLATT_OPTION_NODE_REDUCE).
+   * node_comm: The ranks of comm_3d which share memory with me.
+   * leader_comm: One rank per node. MPI_COMM_NULL if I am not a leader.
+   * node_win: A shared window with a slot of node_slot values for each node
+   *           rank, followed by the result. MPI_WIN_NULL when disabled.
+   */
+  MPI_Comm node_comm;
+  MPI_Comm leader_comm;
+  int node_rank;
+  int node_size;
+  MPI_Win node_win;
+  val_t * node_buf;
+  idx_t node_slot;
+
+  /* Fused reductions (SPLATT_OPTION_FUSE_REDUCE).
+   * fused_buf: The Gram matrix, fit, and column norms of one mode, reduced
+   *            as a single element of fused_type with the custom fused_op.
+   */
+  MPI_Datatype fused_type;
+  MPI_Op fused_op;
+  MPI_Request fused_req;
+  val_t * fused_buf;
+  idx_t fused_nfactors;
+
   /* Rank information */
   int rank;
   int npes;
@@ -104,6 +224,28 @@ typedef struct
   MPI_Status * stats;
   MPI_Request * send_reqs;
   MPI_Request * recv_reqs;
+  MPI_Request update_req; /** outstanding mpi_update_rows_begin() */
+
+  /* Threading. thread_level is what MPI provided. If comm_threads is set,
+   * OpenMP threads make MPI calls for their own share of the peers, and
+   * reduce_ptr/reduce_slots list the received partial products of each of my
+   * owned rows (CSR), so that threads sum whole rows without atomics. */
+  int thread_level;
+  bool comm_threads;
+  idx_t * reduce_ptr[MAX_NMODES];
+  idx_t * reduce_slots[MAX_NMODES];
+
+  /* Row exchanges. compress is NULL unless mpi_compress_init() enabled
+   * compressed messages. wire_bytes counts the bytes of factor rows that I
+   * have sent since the CPD timers were reset. */
+  mpi_compress * compress;
+  double wire_bytes;
+
+  /* My own MTTKRP time so far in mpi_cpd_als_iterate(), set before its
+   * hook runs and again when it returns. mpi_rebalance() uses it.
+   * mpi_time_stats() replaces the timer itself with the average across
+   * ranks. */
+  double mttkrp_seconds;
 
   idx_t worksize;
 } rank_info;
@@ -115,6 +257,38 @@ typedef struct
  *****************************************************************************/
 #include "sptensor.h"
 #include "reorder.h"
+#include "thd_info.h"
+
+
+
+/******************************************************************************
+ * TYPES
+ *****************************************************************************/
+
+/**
+* @brief A step that mpi_cpd_als_iterate() runs once between two iterations,
+*        which may redistribute the local tensor (e.g., mpi_rebalance()).
+*/
+typedef struct
+{
+  /** The hook runs after this many iterations. */
+  idx_t after_its;
+
+  /**
+  * Called by all ranks with no row exchange in flight. If the hook replaces
+  * the local tensor, it must also reallocate the local factors and the
+  * MTTKRP output in 'mats' to fit it, and return the new tensor. Otherwise
+  * it returns NULL. It may also move the owned rows in 'globmats'.
+  */
+  splatt_csf const * (* func)(
+      matrix_t ** mats,
+      matrix_t ** globmats,
+      rank_info * const rinfo,
+      void * data);
+
+  /** Passed to func. */
+  void * data;
+} mpi_cpd_hook;
 
 
 
@@ -123,13 +297,51 @@ typedef struct
  *****************************************************************************/
 
 #define mpi_cpd_als_iterate splatt_mpi_cpd_als_iterate
+/**
+* @brief Compute a CPD with distributed ALS. Each factor's row exchange is
+*        left in flight while the next mode's MTTKRP processes the nonzeros
+*        which only read my own rows of that factor. This keeps a second
+*        copy of the local tensor, split by those rows.
+*
+* @param tensors My local tensor.
+* @param mats The local factors, and the MTTKRP output at mats[MAX_NMODES].
+* @param globmats The factor rows that I own.
+* @param[out] lambda The column norms of the factors.
+* @param nfactors The rank of the decomposition.
+* @param rinfo MPI rank information.
+* @param opts SPLATT options.
+* @param hook An optional step between iterations, or NULL. The row exchanges
+*             are rebuilt if it replaces the local tensor.
+*
+* @return The final fit.
+*/
 double mpi_cpd_als_iterate(
-  splatt_csf const * const tensors,
+  splatt_csf const * tensors,
   matrix_t ** mats,
   matrix_t ** globmats,
   val_t * const lambda,
   idx_t const nfactors,
   rank_info * const rinfo,
+  double const * const opts,
+  mpi_cpd_hook const * const hook);
+
+
+#define mpi_is_replicated splatt_mpi_is_replicated
+/**
+* @brief Should a mode be fully replicated on every rank instead of being
+*        distributed? This is the MPI analogue of privatizing a mode during
+*        MTTKRP: short modes are cheaper to allreduce in full than to reduce
+*        and exchange row by row.
+*
+* @param rinfo MPI rank information.
+* @param mode The mode we are processing.
+* @param opts Options, storing the replication threshold (0 disables it).
+*
+* @return true, if we should replicate.
+*/
+bool mpi_is_replicated(
+  rank_info const * const rinfo,
+  idx_t const mode,
   double const * const opts);
 
 
@@ -163,6 +375,58 @@ void mpi_update_rows(
   splatt_comm_type const which);
 
 
+#define mpi_update_rows_begin splatt_mpi_update_rows_begin
+/**
+* @brief Start a nonblocking mpi_update_rows(). Owned rows are flushed to
+*        localmat immediately, but rows received from neighbors are not
+*        present until mpi_update_rows_finish() is called. Neither buffer may
+*        be touched in between.
+*
+* @param indmap The local->global mapping of the tensor. May be NULL if the
+*               mapping is identity.
+* @param nbr2globs_buf Buffer at least as large as as there are rows to send
+*                      (for each rank).
+* @param nbr2local_buf Buffer at least as large as there are rows to receive.
+* @param localmat Local factor matrix which receives updated values.
+* @param globalmat Global factor matrix (owned by me) which is sent to ranks.
+* @param rinfo MPI rank information.
+* @param nfactors The number of columns in the factor matrices.
+* @param mode The mode to exchange along.
+* @param which Which communication pattern to use.
+*/
+void mpi_update_rows_begin(
+  idx_t const * const indmap,
+  val_t * const restrict nbr2globs_buf,
+  val_t * const restrict nbr2local_buf,
+  matrix_t * const localmat,
+  matrix_t * const globalmat,
+  rank_info * const rinfo,
+  idx_t const nfactors,
+  idx_t const mode,
+  splatt_comm_type const which);
+
+
+#define mpi_update_rows_finish splatt_mpi_update_rows_finish
+/**
+* @brief Complete an exchange started with mpi_update_rows_begin(). Time spent
+*        blocked on communication is charged to TIMER_MPI_IDLE.
+*
+* @param nbr2local_buf The receive buffer given to mpi_update_rows_begin().
+* @param localmat Local factor matrix which receives updated values.
+* @param rinfo MPI rank information.
+* @param nfactors The number of columns in the factor matrices.
+* @param mode The mode to exchange along.
+* @param which Which communication pattern to use.
+*/
+void mpi_update_rows_finish(
+  val_t const * const restrict nbr2local_buf,
+  matrix_t * const localmat,
+  rank_info * const rinfo,
+  idx_t const nfactors,
+  idx_t const mode,
+  splatt_comm_type const which);
+
+
 #define mpi_reduce_rows splatt_mpi_reduce_rows
 /**
 * @brief Do a reduction (sum) of all neighbor partial products which I own.
@@ -293,6 +557,26 @@ sptensor_t * mpi_simple_distribute(
 
 
 
+#define mpi_stream_partition splatt_mpi_stream_partition
+/**
+* @brief Partition the nonzeros for a fine-grained decomposition without an
+*        external partitioner. Nonzeros are streamed in batches and placed in
+*        the part which already owns most of their rows (a greedy hypergraph
+*        heuristic with a capacity constraint), and a refinement pass then
+*        moves nonzeros whose rows ended up owned by another part.
+*
+* @param tt My nonzeros, in global coordinates.
+* @param rinfo MPI rank information (uses global dims/nnz). The nonzeros are
+*              spread over MPI_COMM_WORLD.
+*
+* @return The part of each of my nonzeros, suitable for
+*         mpi_rearrange_by_part(). Must be freed.
+*/
+int * mpi_stream_partition(
+  sptensor_t const * const tt,
+  rank_info const * const rinfo);
+
+
 #define mpi_rearrange_by_part splatt_mpi_rearrange_by_part
 /**
 * @brief Rearrange nonzeros based on an nonzero partitioning. This allocates
@@ -310,6 +594,101 @@ sptensor_t * mpi_rearrange_by_part(
   MPI_Comm comm);
 
 
+#define mpi_rebalance splatt_mpi_rebalance
+/**
+* @brief Move nonzeros from slow ranks to fast ranks, based on the MTTKRP time
+*        measured so far by mpi_cpd_als_iterate(). Targets are proportional
+*        to each rank's nonzeros per second.
+*
+*        A medium-grained decomposition keeps its grid and layer
+*        communicators: the layer boundaries are chosen again, weighted by the
+*        speed of the ranks in each layer, and the rows of each layer are
+*        distributed again, moving the owned factor rows with them. A
+*        fine-grained decomposition moves blocks of whole slices and factor
+*        rows keep their owners. Coarse-grained decompositions are not
+*        supported.
+*
+* @param tt My local tensor, as used to build the CSF. Its indices are
+*           converted to global coordinates.
+* @param perm The permutation of the factor matrices, replaced if the layers
+*             move.
+* @param globmats The factor rows that I own, replaced if the layers move.
+* @param rinfo MPI rank information. The row exchanges are rebuilt with
+*              mpi_compute_ineed().
+* @param nfactors The rank of the decomposition.
+* @param opts SPLATT options.
+*
+* @return My new local tensor, or NULL if the ranks were balanced enough and
+*         nothing was moved.
+*/
+sptensor_t * mpi_rebalance(
+  sptensor_t * const tt,
+  permutation_t * const perm,
+  matrix_t ** globmats,
+  rank_info * const rinfo,
+  idx_t const nfactors,
+  double const * const opts);
+
+
+#define mpi_find_layer_ptrs splatt_mpi_find_layer_ptrs
+/**
+* @brief Split the slices of a mode into layers with balanced nonzero counts.
+*
+* @param ssize The number of nonzeros in each slice.
+* @param dim The number of slices.
+* @param nnz The total number of nonzeros.
+* @param nlayers The number of layers to create.
+* @param[out] layer_ptrs Layer l is slices [layer_ptrs[l], layer_ptrs[l+1]).
+*                        Must have space for nlayers+1 values.
+*/
+void mpi_find_layer_ptrs(
+  idx_t const * const ssize,
+  idx_t const dim,
+  idx_t const nnz,
+  int const nlayers,
+  idx_t * const layer_ptrs);
+
+
+#define mpi_decomp_model splatt_mpi_decomp_model
+/**
+* @brief Predict the per-iteration communication volume and load imbalance of
+*        a decomposition. Medium-grained loads are counted exactly from the
+*        nonzeros and their volume is estimated from the global slice
+*        histograms. Coarse-grained decompositions are predicted from the
+*        histograms. Fine-grained ones are measured exactly on their
+*        partitioning. The modeled cost is the slower of compute and
+*        communication, which overlap.
+*
+*        If rinfo->decomp is AUTO_MPI_DISTRIBUTION, every medium-grained grid,
+*        the coarse-grained decomposition, and (if 'parts' is given) the
+*        fine-grained one are evaluated, and the cheapest is stored in
+*        rinfo->decomp and rinfo->dims_3d. This is collective.
+*
+* @param ttbuf My nonzeros, in global coordinates.
+* @param ssizes The global number of nonzeros in each slice of each mode.
+* @param parts The fine-grained part of each of my nonzeros, or NULL.
+* @param rinfo MPI rank information. rinfo->pred is filled.
+*/
+void mpi_decomp_model(
+  sptensor_t const * const ttbuf,
+  idx_t ** const ssizes,
+  int const * const parts,
+  rank_info * const rinfo);
+
+
+#define mpi_decomp_report splatt_mpi_decomp_report
+/**
+* @brief Print the model's predictions next to the measured communication
+*        volume and nonzero balance of the distributed tensor.
+*
+* @param tt My part of the distributed tensor.
+* @param rinfo MPI rank information. Assumes mpi_compute_ineed() was called.
+*/
+void mpi_decomp_report(
+  sptensor_t const * const tt,
+  rank_info const * const rinfo);
+
+
 #define mpi_determine_med_owner splatt_mpi_determine_med_owner
 /**
 * @brief Map a nonzero to an MPI rank based on the medium-grained layer
@@ -427,6 +806,282 @@ void mpi_setup_comms(
   rank_info * const rinfo);
 
 
+#define mpi_nbr_plan_init splatt_mpi_nbr_plan_init
+/**
+* @brief Build the neighborhood graph of every mode and create persistent
+*        neighborhood alltoallv requests for the row reductions and updates.
+*        Only SPLATT_COMM_NEIGHBOR needs this, and it must be called after
+*        mpi_compute_ineed() and again whenever the exchanges change.
+*        Persistent collectives bind their buffers, so these exact buffers
+*        must be given to mpi_reduce_rows() and mpi_update_rows() until
+*        mpi_nbr_plan_free(). If the MPI library lacks persistent collectives
+*        the buffers are only recorded and nonblocking neighborhood
+*        collectives are used instead.
+*
+* @param local2nbr_buf A buffer at least as large as max(nlocal2nbr).
+* @param nbr2globs_buf A buffer at least as large as max(nnbr2globs).
+* @param rinfo MPI rank information.
+*/
+void mpi_nbr_plan_init(
+  val_t * const local2nbr_buf,
+  val_t * const nbr2globs_buf,
+  rank_info * const rinfo);
+
+
+#define mpi_nbr_plan_free splatt_mpi_nbr_plan_free
+/**
+* @brief Free the graphs and persistent requests created by
+*        mpi_nbr_plan_init().
+*
+* @param rinfo MPI rank information.
+*/
+void mpi_nbr_plan_free(
+  rank_info * const rinfo);
+
+
+#define mpi_node_init splatt_mpi_node_init
+/**
+* @brief Enable node-aware reductions. Ranks which share memory reduce
+*        through a shared window and only one leader per node communicates
+*        across the network.
+*
+* @param rinfo MPI rank information.
+* @param maxcount The largest number of values which will be reduced at once.
+*/
+void mpi_node_init(
+  rank_info * const rinfo,
+  idx_t const maxcount);
+
+
+#define mpi_node_free splatt_mpi_node_free
+/**
+* @brief Free the structures created by mpi_node_init(). Reductions fall back
+*        to a flat MPI_Allreduce() on comm_3d afterwards.
+*
+* @param rinfo MPI rank information.
+*/
+void mpi_node_free(
+  rank_info * const rinfo);
+
+
+#define mpi_node_shared splatt_mpi_node_shared
+/**
+* @brief Return whether mpi_node_allreduce() would reduce 'bytes' through
+*        shared memory. Smaller reductions are cheaper with a flat
+*        MPI_Allreduce(), because the shared window needs node barriers.
+*
+* @param rinfo MPI rank information.
+* @param bytes The size of the reduction.
+*
+* @return Whether node-aware reductions are enabled and 'bytes' is large
+*         enough to use them.
+*/
+bool mpi_node_shared(
+  rank_info const * const rinfo,
+  size_t const bytes);
+
+
+#define mpi_node_allreduce splatt_mpi_node_allreduce
+/**
+* @brief Allreduce values over comm_3d. If mpi_node_shared() holds, this
+*        reduces hierarchically through shared memory. Otherwise this is just
+*        MPI_Allreduce().
+*
+* @param sendbuf My contribution. May be the same as recvbuf.
+* @param recvbuf The reduced values.
+* @param count The number of elements of 'type'.
+* @param type The datatype, which must be built from SPLATT_MPI_VAL.
+* @param op The reduction operation. MPI_SUM and MPI_MAX on SPLATT_MPI_VAL
+*           are split among the node's ranks.
+* @param rinfo MPI rank information.
+*/
+void mpi_node_allreduce(
+  void const * const sendbuf,
+  void * const recvbuf,
+  idx_t const count,
+  MPI_Datatype const type,
+  MPI_Op const op,
+  rank_info * const rinfo);
+
+
+#define mpi_fused_size splatt_mpi_fused_size
+/**
+* @brief Return the number of values in a fused reduction buffer.
+*
+* @param nfactors The rank of the decomposition.
+*
+* @return The buffer length.
+*/
+idx_t mpi_fused_size(
+  idx_t const nfactors);
+
+
+#define mpi_fused_init splatt_mpi_fused_init
+/**
+* @brief Allocate the buffer, datatype, and MPI_Op used by fused reductions.
+*
+* @param rinfo MPI rank information.
+* @param nfactors The rank of the decomposition.
+*/
+void mpi_fused_init(
+  rank_info * const rinfo,
+  idx_t const nfactors);
+
+
+#define mpi_fused_free splatt_mpi_fused_free
+/**
+* @brief Free the structures created by mpi_fused_init().
+*
+* @param rinfo MPI rank information.
+*/
+void mpi_fused_free(
+  rank_info * const rinfo);
+
+
+#define mpi_fused_begin splatt_mpi_fused_begin
+/**
+* @brief Start one reduction of the Gram matrix, column norms, and (optionally)
+*        the fit inner product of a freshly solved factor. This replaces the
+*        separate allreduces in mat_normalize(), mat_aTa(), and the fit.
+*
+* @param A My owned rows of the factor, not yet normalized.
+* @param m1 The MTTKRP output for the fit, or NULL if not needed.
+* @param aTa Scratch space, later holding the Gram matrix.
+* @param which Which norm to normalize with.
+* @param rinfo MPI rank information.
+* @param thds Thread scratch space.
+* @param nthreads The number of threads to use.
+*/
+void mpi_fused_begin(
+  matrix_t const * const A,
+  matrix_t const * const m1,
+  matrix_t * const aTa,
+  splatt_mat_norm const which,
+  rank_info * const rinfo,
+  thd_info * const thds,
+  idx_t const nthreads);
+
+
+#define mpi_fused_finish splatt_mpi_fused_finish
+/**
+* @brief Complete a reduction started by mpi_fused_begin(). The columns of A
+*        are normalized, lambda is filled, and aTa holds the Gram matrix of
+*        the normalized factor.
+*
+* @param A My owned rows of the factor.
+* @param aTa The Gram matrix of the normalized factor.
+* @param lambda The column norms.
+* @param[out] inner The fit inner product <X, Z>, if not NULL.
+* @param rinfo MPI rank information.
+*/
+void mpi_fused_finish(
+  matrix_t * const A,
+  matrix_t * const aTa,
+  val_t * const restrict lambda,
+  val_t * const inner,
+  rank_info * const rinfo);
+
+
+#define mpi_compress_init splatt_mpi_compress_init
+/**
+* @brief Enable compressed row exchanges if options ask for reduced precision
+*        or for only sending changed rows. Compressed messages replace the
+*        communication pattern of mpi_update_rows() and mpi_reduce_rows() with
+*        point-to-point messages, because their lengths vary.
+*
+* @param rinfo MPI rank information. rinfo->compress is left NULL if the
+*              options do not ask for compression.
+* @param nfactors The rank of the decomposition.
+* @param opts SPLATT options.
+*/
+void mpi_compress_init(
+  rank_info * const rinfo,
+  idx_t const nfactors,
+  double const * const opts);
+
+
+#define mpi_compress_free splatt_mpi_compress_free
+/**
+* @brief Free the structures created by mpi_compress_init().
+*
+* @param rinfo MPI rank information.
+*/
+void mpi_compress_free(
+  rank_info * const rinfo);
+
+
+#define mpi_compress_prepare splatt_mpi_compress_prepare
+/**
+* @brief Prepare my owned rows for a compressed update. Rows which neighbors
+*        receive are rounded to the configured precision. With a threshold,
+*        rows which did not change enough since they were last sent are
+*        restored to their last values, and the others get a new version.
+*        Afterwards every rank computes with the same values of each row.
+*        Rows must be prepared before normalization, because neighbors
+*        rescale the rows that they keep by the new lambda. This is
+*        idempotent, and called by mpi_compress_update_begin().
+*
+* @param globalmat Global factor matrix (owned by me).
+* @param rinfo MPI rank information.
+* @param mode The mode of the factor.
+*/
+void mpi_compress_prepare(
+  matrix_t * const globalmat,
+  rank_info const * const rinfo,
+  idx_t const mode);
+
+
+#define mpi_compress_update_begin splatt_mpi_compress_update_begin
+/**
+* @brief Begin sending my owned rows to the ranks which need them, encoded
+*        with the configured precision. When a threshold is set, only rows
+*        with a version which a neighbor has not seen are included, each
+*        tagged with its slot and version.
+*
+* @param globalmat Global factor matrix (owned by me). Rows are prepared with
+*                  mpi_compress_prepare() first.
+* @param rinfo MPI rank information.
+* @param mode The mode to exchange along.
+*/
+void mpi_compress_update_begin(
+  matrix_t * const globalmat,
+  rank_info * const rinfo,
+  idx_t const mode);
+
+
+#define mpi_compress_update_finish splatt_mpi_compress_update_finish
+/**
+* @brief Complete an exchange started by mpi_compress_update_begin() and write
+*        the neighbors' rows into localmat.
+*
+* @param localmat Local factor matrix which receives updated values.
+* @param rinfo MPI rank information.
+* @param mode The mode to exchange along.
+*/
+void mpi_compress_update_finish(
+  matrix_t * const localmat,
+  rank_info * const rinfo,
+  idx_t const mode);
+
+
+#define mpi_compress_reduce splatt_mpi_compress_reduce
+/**
+* @brief Sum the neighbors' partial products of my owned rows into globalmat.
+*        Partial products are encoded with the configured precision and
+*        added with compensated (Kahan) summation.
+*
+* @param localmat My local matrix containing partial products for other ranks.
+* @param globalmat The global factor matrix to update.
+* @param rinfo MPI rank information.
+* @param mode The mode to operate on.
+*/
+void mpi_compress_reduce(
+  matrix_t const * const localmat,
+  matrix_t * const globalmat,
+  rank_info * const rinfo,
+  idx_t const mode);
+
+
 #define rank_free splatt_rank_free
 /**
 * @brief Free structures allocated inside rank_info.
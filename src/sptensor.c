@@ -241,6 +241,7 @@ sptensor_t * tt_alloc(
   idx_t const nnz,
   idx_t const nmodes)
 {
+  splatt_mem_tag const prev_tag = mem_tag_begin(SPLATT_MEM_IO);
   sptensor_t * tt = (sptensor_t*) splatt_malloc(sizeof(*tt));
   tt->tiled = SPLATT_NOTILE;
 
@@ -257,6 +258,7 @@ sptensor_t * tt_alloc(
     tt->indmap[m] = NULL;
   }
 
+  mem_tag_end(prev_tag);
   return tt;
 }
 
@@ -10,6 +10,7 @@
 #include "io.h"
 #include "reorder.h"
 #include "util.h"
+#include "metrics.h"
 
 
 /******************************************************************************
@@ -17,6 +18,65 @@
  *****************************************************************************/
 
 
+/**
+* @brief Print a table of memory usage by subsystem.
+*
+* @param usage The usage to print.
+* @param estimate If true, only peaks are printed.
+*/
+static void p_print_mem(
+  splatt_mem_usage const * const usage,
+  bool const estimate)
+{
+  if(estimate) {
+    printf("%-12s %12s\n", "SUBSYSTEM", "PEAK");
+  } else {
+    printf("%-12s %12s %12s %10s\n", "SUBSYSTEM", "LIVE", "PEAK", "ALLOCS");
+  }
+  for(int t=0; t < SPLATT_MEM_NTAGS; ++t) {
+    if(usage->peak[t] == 0) {
+      continue;
+    }
+    char * pstr = bytes_str(usage->peak[t]);
+    if(estimate) {
+      printf("%-12s %12s\n", splatt_mem_tag_name(t), pstr);
+    } else {
+      char * lstr = bytes_str(usage->live[t]);
+      printf("%-12s %12s %12s %10"PRIu64"\n", splatt_mem_tag_name(t), lstr,
+          pstr, usage->nallocs[t]);
+      free(lstr);
+    }
+    free(pstr);
+  }
+
+  char * pstr = bytes_str(usage->total_peak);
+  if(estimate) {
+    printf("%-12s %12s\n", "TOTAL", pstr);
+  } else {
+    char * lstr = bytes_str(usage->total_live);
+    printf("%-12s %12s %12s\n", "TOTAL", lstr, pstr);
+    free(lstr);
+  }
+  free(pstr);
+  printf("\n");
+}
+
+
+/**
+* @brief Record the peak of each subsystem as a metric.
+*/
+static void p_record_mem(
+  splatt_mem_usage const * const usage)
+{
+  for(int t=0; t < SPLATT_MEM_NTAGS; ++t) {
+    metrics_set("memory", splatt_mem_tag_name(t), -1, -1, -1,
+        (double) usage->peak[t]);
+  }
+  metrics_set("memory", "total", -1, -1, -1, (double) usage->total_peak);
+}
+
+
+
 /**
 * @brief Output basic statistics about tt to STDOUT.
 *
@@ -159,14 +219,44 @@ static void p_stats_hparts(
 
 
   for(idx_t m=0; m < ft.nmodes; ++m) {
-    free(unique[m]);
+    splatt_free(unique[m]);
   }
-  free(parts);
-  free(plookup);
+  splatt_free(parts);
+  splatt_free(plookup);
   free(pptr);
   ften_free(&ft);
 }
 
+/**
+* @brief Print and record how much memory was mapped with huge pages, if any.
+*
+* @param usage The memory usage to report.
+*/
+static void p_print_huge(
+  splatt_mem_usage const * const usage)
+{
+  if(usage->huge_mapped == 0 && usage->huge_fallbacks == 0) {
+    return;
+  }
+
+  char * mstr = bytes_str(usage->huge_mapped);
+  char * bstr = bytes_str(usage->huge_backed);
+  double const pct = (usage->huge_mapped > 0) ?
+      100. * (double) usage->huge_backed / (double) usage->huge_mapped : 0.;
+  printf("HUGE-PAGES: %s MAPPED, %s BACKED (%0.1f%%), %"PRIu64
+      " FALLBACKS\n\n", mstr, bstr, pct, usage->huge_fallbacks);
+  free(mstr);
+  free(bstr);
+
+  metrics_set("memory", "huge_mapped", -1, -1, -1,
+      (double) usage->huge_mapped);
+  metrics_set("memory", "huge_backed", -1, -1, -1,
+      (double) usage->huge_backed);
+  metrics_set("memory", "huge_fallbacks", -1, -1, -1,
+      (double) usage->huge_fallbacks);
+}
+
+
 /******************************************************************************
  * PUBLIC FUNCTIONS
  *****************************************************************************/
@@ -220,6 +310,9 @@ void stats_csf(
 
   printf("  empty: %"SPLATT_PF_IDX" (%0.1f%%)\n", empty,
       100. * (double)empty/ (double)ct->ntiles);
+
+  metrics_set("csf", "ntiles", -1, -1, -1, ct->ntiles);
+  metrics_set("csf", "empty_tiles", -1, -1, -1, empty);
 }
 
 
@@ -247,6 +340,12 @@ void cpd_stats(
   printf("SEED=%d ", (int) opts[SPLATT_OPTION_RANDSEED]);
 
   printf("THREADS=%"SPLATT_PF_IDX" ", (idx_t) opts[SPLATT_OPTION_NTHREADS]);
+  if(opts[SPLATT_OPTION_TEAM]) {
+    printf("TEAM=PERSISTENT ");
+  }
+  if(opts[SPLATT_OPTION_STEAL]) {
+    printf("SCHEDULE=STEAL ");
+  }
   printf("\n");
 
   /* CSF allocation */
@@ -291,6 +390,81 @@ void cpd_stats(
   free(fstorage);
   free(mstorage);
   printf("\n\n");
+
+  metrics_set("cpd", "csf_bytes", -1, -1, -1, fbytes);
+  metrics_set("cpd", "factor_bytes", -1, -1, -1, mbytes);
+}
+
+
+void stats_mem(void)
+{
+  splatt_mem_usage usage;
+  splatt_mem_query(&usage);
+
+  printf("Memory ---------------------------------------------------------\n");
+  p_print_mem(&usage, false);
+  p_record_mem(&usage);
+
+  p_print_huge(&usage);
+}
+
+
+void stats_mem_estimate(
+  splatt_mem_usage const * const est)
+{
+  printf("Estimated memory (upper bound) ---------------------------------\n");
+  p_print_mem(est, true);
+}
+
+
+void stats_model(
+  splatt_csf const * const csf,
+  idx_t const nfactors,
+  double const * const opts,
+  model_machine const * const machine,
+  idx_t const run)
+{
+  idx_t const nmodes = csf->nmodes;
+  model_mode models[MAX_NMODES];
+  model_mttkrp(csf, nfactors, opts, machine, models);
+
+  printf("THREADS=%"SPLATT_PF_IDX"\n", (idx_t) opts[SPLATT_OPTION_NTHREADS]);
+  printf("%-5s %3s %5s %-10s %8s %8s %6s %9s %9s %9s %9s\n", "MODE", "CSF",
+      "DEPTH", "SYNC", "GFLOP", "GB", "IMBAL", "COMPUTE", "MEMORY", "SYNC",
+      "TIME");
+
+  model_mode total;
+  total.cost.flops = 0.;
+  total.cost.bytes = 0.;
+  total.compute_sec = 0.;
+  total.memory_sec = 0.;
+  total.sync_sec = 0.;
+  total.seconds = 0.;
+  for(idx_t m=0; m < nmodes; ++m) {
+    model_mode const * const model = models + m;
+    double const bytes = model->cost.bytes + model->sync_bytes;
+    printf("%-5"SPLATT_PF_IDX" %3"SPLATT_PF_IDX" %5"SPLATT_PF_IDX
+        " %-10s %8.3f %8.3f %6.2f %8.4fs %8.4fs %8.4fs %8.4fs\n",
+        m+1, model->csf_id+1, model->depth, model_sync_name(model->sync),
+        model->cost.flops / 1e9, bytes / 1e9, model->imbalance,
+        model->compute_sec, model->memory_sec, model->sync_sec,
+        model->seconds);
+
+    total.cost.flops += model->cost.flops;
+    total.cost.bytes += bytes;
+    total.compute_sec += model->compute_sec;
+    total.memory_sec += model->memory_sec;
+    total.sync_sec += model->sync_sec;
+    total.seconds += model->seconds;
+
+    metrics_record("model", "seconds", run, m, -1, model->seconds);
+    metrics_record("model", "gbytes", run, m, -1, bytes / 1e9);
+    metrics_record("model", "imbalance", run, m, -1, model->imbalance);
+  }
+  printf("%-5s %3s %5s %-10s %8.3f %8.3f %6s %8.4fs %8.4fs %8.4fs %8.4fs\n",
+      "SWEEP", "", "", "", total.cost.flops / 1e9, total.cost.bytes / 1e9, "",
+      total.compute_sec, total.memory_sec, total.sync_sec, total.seconds);
+  printf("\n");
 }
 
 
@@ -323,6 +497,9 @@ void mpi_cpd_stats(
     return;
   }
 
+  metrics_set("cpd", "csf_bytes", -1, -1, -1, fbytes);
+  metrics_set("cpd", "factor_bytes", -1, -1, -1, mbytes);
+
   /* header */
   printf("Factoring "
          "------------------------------------------------------\n");
@@ -376,6 +553,15 @@ void mpi_cpd_stats(
   printf("CSF-STORAGE=%s FACTOR-STORAGE=%s", fstorage, mstorage);
   free(fstorage);
   free(mstorage);
+
+  /* modes which skip the row exchanges */
+  bool first = true;
+  for(idx_t m=0; m < csf[0].nmodes; ++m) {
+    if(mpi_is_replicated(rinfo, m, opts)) {
+      printf("%s%"SPLATT_PF_IDX, first ? "\nREPLICATED-MODES=" : ",", m+1);
+      first = false;
+    }
+  }
   printf("\n\n");
 }
 
@@ -450,7 +636,55 @@ void mpi_rank_stats(
     printf("AVG COMMUNICATION VOL=%"SPLATT_PF_IDX"\nMAX COMMUNICATION VOL=%"SPLATT_PF_IDX"  "
         "(%0.2f%% diff)\n", avgvolume, maxvolume, volimbalance);
     printf("\n");
+
+    /* volumes are in factor rows */
+    metrics_set("mpi", "nnz_avg", -1, -1, -1, avgnnz);
+    metrics_set("mpi", "nnz_max", -1, -1, -1, maxnnz);
+    metrics_set("mpi", "comm_volume_avg", -1, -1, -1, avgvolume);
+    metrics_set("mpi", "comm_volume_max", -1, -1, -1, maxvolume);
+  }
+}
+
+
+void mpi_mem_stats(
+  rank_info const * const rinfo)
+{
+  splatt_mem_usage usage;
+  splatt_mem_query(&usage);
+
+  /* the busiest rank determines how large a job fits */
+  uint64_t buf[(3 * SPLATT_MEM_NTAGS) + 5];
+  memcpy(buf, usage.live, sizeof(usage.live));
+  memcpy(buf + SPLATT_MEM_NTAGS, usage.peak, sizeof(usage.peak));
+  memcpy(buf + (2 * SPLATT_MEM_NTAGS), usage.nallocs, sizeof(usage.nallocs));
+  buf[(3 * SPLATT_MEM_NTAGS) + 0] = usage.total_live;
+  buf[(3 * SPLATT_MEM_NTAGS) + 1] = usage.total_peak;
+  buf[(3 * SPLATT_MEM_NTAGS) + 2] = usage.huge_mapped;
+  buf[(3 * SPLATT_MEM_NTAGS) + 3] = usage.huge_backed;
+  buf[(3 * SPLATT_MEM_NTAGS) + 4] = usage.huge_fallbacks;
+
+  int const count = (3 * SPLATT_MEM_NTAGS) + 5;
+  if(rinfo->rank == 0) {
+    MPI_Reduce(MPI_IN_PLACE, buf, count, MPI_UINT64_T, MPI_MAX, 0,
+        MPI_COMM_WORLD);
+  } else {
+    MPI_Reduce(buf, NULL, count, MPI_UINT64_T, MPI_MAX, 0, MPI_COMM_WORLD);
+    return;
   }
+
+  memcpy(usage.live, buf, sizeof(usage.live));
+  memcpy(usage.peak, buf + SPLATT_MEM_NTAGS, sizeof(usage.peak));
+  memcpy(usage.nallocs, buf + (2 * SPLATT_MEM_NTAGS), sizeof(usage.nallocs));
+  usage.total_live = buf[(3 * SPLATT_MEM_NTAGS) + 0];
+  usage.total_peak = buf[(3 * SPLATT_MEM_NTAGS) + 1];
+  usage.huge_mapped = buf[(3 * SPLATT_MEM_NTAGS) + 2];
+  usage.huge_backed = buf[(3 * SPLATT_MEM_NTAGS) + 3];
+  usage.huge_fallbacks = buf[(3 * SPLATT_MEM_NTAGS) + 4];
+
+  printf("Memory (max over ranks) ----------------------------------------\n");
+  p_print_mem(&usage, false);
+  p_record_mem(&usage);
+  p_print_huge(&usage);
 }
 #endif
 
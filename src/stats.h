@@ -26,6 +26,7 @@ typedef enum
 #include "sptensor.h"
 #include "csf.h"
 #include "cpd.h"
+#include "model.h"
 #include "splatt_mpi.h"
 
 
@@ -75,6 +76,43 @@ void cpd_stats(
   double const * const opts);
 
 
+#define stats_mem splatt_stats_mem
+/**
+* @brief Output the memory allocated by each subsystem: currently, at its
+*        peak, and how many allocations it made.
+*/
+void stats_mem(void);
+
+
+#define stats_mem_estimate splatt_stats_mem_estimate
+/**
+* @brief Output an estimate of peak memory, such as from cpd_mem_estimate().
+*
+* @param est The estimated peaks.
+*/
+void stats_mem_estimate(
+  splatt_mem_usage const * const est);
+
+
+#define stats_model splatt_stats_model
+/**
+* @brief Output the cost of MTTKRP predicted by model_mttkrp(): per-mode work,
+*        memory traffic, synchronization, load imbalance, and time.
+*
+* @param csf The CSF tensor(s), allocated with 'opts'.
+* @param nfactors The rank of the decomposition.
+* @param opts SPLATT options, including the number of threads.
+* @param machine The machine to model.
+* @param run Which configuration this is, used to index recorded metrics.
+*/
+void stats_model(
+  splatt_csf const * const csf,
+  idx_t const nfactors,
+  double const * const opts,
+  model_machine const * const machine,
+  idx_t const run);
+
+
 /******************************************************************************
  * MPI FUNCTIONS
  *****************************************************************************/
@@ -123,6 +161,17 @@ void mpi_rank_stats(
   sptensor_t const * const tt,
   rank_info const * const rinfo);
 
+
+#define mpi_mem_stats splatt_mpi_mem_stats
+/**
+* @brief Output the memory allocated by each subsystem, taking the maximum
+*        over all ranks. Must be called by all ranks.
+*
+* @param rinfo MPI rank information.
+*/
+void mpi_mem_stats(
+  rank_info const * const rinfo);
+
 #endif /* endif SPLATT_USE_MPI */
 
 #endif
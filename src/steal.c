@@ -0,0 +1,295 @@
+/******************************************************************************
+ * INCLUDES
+ *****************************************************************************/
+#include "steal.h"
+#include "tile.h"
+
+
+
+/******************************************************************************
+ * PRIVATE FUNCTIONS
+ *****************************************************************************/
+
+static inline void p_lock(
+    steal_deque * const deque)
+{
+#ifdef _OPENMP
+  omp_set_lock(&(deque->lock));
+#endif
+}
+
+
+static inline void p_unlock(
+    steal_deque * const deque)
+{
+#ifdef _OPENMP
+  omp_unset_lock(&(deque->lock));
+#endif
+}
+
+
+/**
+* @brief Fill 'weights' with the nonzeros of each root slice of an untiled
+*        CSF tensor.
+*
+* @return The number of slices.
+*/
+static idx_t p_slice_weights(
+    splatt_csf const * const csf,
+    idx_t ** weights)
+{
+  csf_sparsity const * const pt = csf->pt;
+  idx_t const nslices = pt->nfibs[0];
+  idx_t * w = splatt_malloc(SS_MAX(nslices, 1) * sizeof(*w));
+
+  #pragma omp parallel for schedule(static)
+  for(idx_t s=0; s < nslices; ++s) {
+    /* follow the first and last child down to the nonzeros */
+    idx_t left = s;
+    idx_t right = s+1;
+    for(idx_t d=0; d < csf->nmodes-1; ++d) {
+      left = pt->fptr[d][left];
+      right = pt->fptr[d][right];
+    }
+    w[s] = right - left;
+  }
+
+  *weights = w;
+  return nslices;
+}
+
+
+/**
+* @brief Fill 'weights' with the nonzeros of each tile, or of each layer of
+*        tiles along 'mode' if 'layers' is true.
+*
+* @return The number of tiles or layers.
+*/
+static idx_t p_tile_weights(
+    splatt_csf const * const csf,
+    idx_t const mode,
+    bool const layers,
+    idx_t ** weights)
+{
+  idx_t const nmodes = csf->nmodes;
+  idx_t const nitems = layers ? csf->tile_dims[mode] : csf->ntiles;
+  idx_t * w = splatt_malloc(SS_MAX(nitems, 1) * sizeof(*w));
+
+  if(!layers) {
+    for(idx_t t=0; t < nitems; ++t) {
+      w[t] = csf->pt[t].nfibs[nmodes-1];
+    }
+  } else {
+    for(idx_t l=0; l < nitems; ++l) {
+      w[l] = 0;
+      idx_t tile_id = get_next_tileid(TILE_BEGIN, csf->tile_dims, nmodes,
+          mode, l);
+      while(tile_id != TILE_END) {
+        w[l] += csf->pt[tile_id].nfibs[nmodes-1];
+        tile_id = get_next_tileid(tile_id, csf->tile_dims, nmodes, mode, l);
+      }
+    }
+  }
+
+  *weights = w;
+  return nitems;
+}
+
+
+/**
+* @brief Group consecutive items into units of about 'target' nonzeros and
+*        deal contiguous runs of units to threads by their share of the
+*        nonzeros.
+*
+* @param sched The scheduler to fill.
+* @param weights The nonzeros of each item.
+* @param nitems The number of items.
+*/
+static void p_make_units(
+    steal_sched * const sched,
+    idx_t const * const weights,
+    idx_t const nitems)
+{
+  int const nthreads = sched->nthreads;
+
+  idx_t total = 0;
+  for(idx_t i=0; i < nitems; ++i) {
+    total += weights[i];
+  }
+  idx_t const target =
+      SS_MAX(total / (idx_t) (nthreads * STEAL_UNITS_PER_THREAD), 1);
+
+  /* there are at most as many units as items */
+  sched->units = splatt_malloc(SS_MAX(nitems, 1) * sizeof(*sched->units));
+  idx_t * unit_nnz = splatt_malloc(SS_MAX(nitems, 1) * sizeof(*unit_nnz));
+  sched->nunits = 0;
+  idx_t begin = 0;
+  while(begin < nitems) {
+    idx_t end = begin;
+    idx_t nnz = 0;
+    while(end < nitems && (end == begin || nnz + weights[end] <= target)) {
+      nnz += weights[end++];
+    }
+    sched->units[sched->nunits].begin = begin;
+    sched->units[sched->nunits].end = end;
+    unit_nnz[sched->nunits] = nnz;
+    ++sched->nunits;
+    begin = end;
+  }
+
+  /* the owner of a unit is the thread whose share holds its midpoint */
+  for(int t=0; t < nthreads; ++t) {
+    sched->deques[t].first = sched->nunits;
+    sched->deques[t].last = sched->nunits;
+  }
+  idx_t prefix = 0;
+  for(idx_t u=0; u < sched->nunits; ++u) {
+    int owner = 0;
+    if(total > 0) {
+      double const mid = (double) prefix + ((double) unit_nnz[u] / 2.);
+      owner = SS_MIN((int) (mid * nthreads / (double) total), nthreads-1);
+    }
+    prefix += unit_nnz[u];
+
+    /* owners never decrease, so each thread's units are contiguous */
+    if(sched->deques[owner].first == sched->nunits) {
+      sched->deques[owner].first = u;
+    }
+    sched->deques[owner].last = u+1;
+  }
+
+  splatt_free(unit_nnz);
+}
+
+
+/**
+* @brief Take the tail unit of thread 'victim', if it has one.
+*/
+static bool p_steal_from(
+    steal_sched * const sched,
+    int const victim,
+    idx_t * const u)
+{
+  steal_deque * const deque = &(sched->deques[victim]);
+  bool found = false;
+  p_lock(deque);
+  if(deque->head < deque->tail) {
+    *u = --deque->tail;
+    found = true;
+  }
+  p_unlock(deque);
+  return found;
+}
+
+
+
+/******************************************************************************
+ * PUBLIC FUNCTIONS
+ *****************************************************************************/
+
+steal_sched * steal_alloc(
+    splatt_csf const * const csf,
+    idx_t const mode,
+    int const nthreads)
+{
+  steal_sched * sched = splatt_malloc(sizeof(*sched));
+  sched->nthreads = nthreads;
+  sched->deques = splatt_malloc(nthreads * sizeof(*sched->deques));
+  for(int t=0; t < nthreads; ++t) {
+#ifdef _OPENMP
+    omp_init_lock(&(sched->deques[t].lock));
+#endif
+  }
+
+  idx_t * weights = NULL;
+  idx_t nitems = 0;
+  if(csf->ntiles > 1) {
+    bool const layers = csf->tile_dims[mode] > 1;
+    sched->type = layers ? STEAL_LAYERS : STEAL_TILES;
+    nitems = p_tile_weights(csf, mode, layers, &weights);
+  } else {
+    sched->type = STEAL_SLICES;
+    nitems = p_slice_weights(csf, &weights);
+  }
+
+  p_make_units(sched, weights, nitems);
+  splatt_free(weights);
+
+  steal_reset(sched);
+  return sched;
+}
+
+
+void steal_free(
+    steal_sched * sched)
+{
+  if(sched == NULL) {
+    return;
+  }
+  for(int t=0; t < sched->nthreads; ++t) {
+#ifdef _OPENMP
+    omp_destroy_lock(&(sched->deques[t].lock));
+#endif
+  }
+  splatt_free(sched->deques);
+  splatt_free(sched->units);
+  splatt_free(sched);
+}
+
+
+void steal_reset(
+    steal_sched * const sched)
+{
+  for(int t=0; t < sched->nthreads; ++t) {
+    sched->deques[t].head = sched->deques[t].first;
+    sched->deques[t].tail = sched->deques[t].last;
+    sched->deques[t].nstolen = 0;
+  }
+}
+
+
+bool steal_next(
+    steal_sched * const sched,
+    int const tid,
+    steal_unit * const unit)
+{
+  steal_deque * const mine = &(sched->deques[tid]);
+  idx_t u = 0;
+
+  bool found = false;
+  p_lock(mine);
+  if(mine->head < mine->tail) {
+    u = mine->head++;
+    found = true;
+  }
+  p_unlock(mine);
+
+  /* nearest threads first: they own the neighbouring units */
+  int const nthreads = sched->nthreads;
+  for(int dist=1; !found && dist < nthreads; ++dist) {
+    if(tid + dist < nthreads && p_steal_from(sched, tid + dist, &u)) {
+      found = true;
+    } else if(tid - dist >= 0 && p_steal_from(sched, tid - dist, &u)) {
+      found = true;
+    }
+    if(found) {
+      ++mine->nstolen;
+    }
+  }
+
+  if(found) {
+    *unit = sched->units[u];
+  }
+  return found;
+}
+
+
+idx_t steal_count(
+    steal_sched const * const sched)
+{
+  idx_t count = 0;
+  for(int t=0; t < sched->nthreads; ++t) {
+    count += sched->deques[t].nstolen;
+  }
+  return count;
+}
@@ -0,0 +1,153 @@
+#ifndef SPLATT_STEAL_H
+#define SPLATT_STEAL_H
+
+
+/******************************************************************************
+ * INCLUDES
+ *****************************************************************************/
+#include "base.h"
+#include "csf.h"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+
+/******************************************************************************
+ * STRUCTURES
+ *****************************************************************************/
+
+/* how many units of work each thread starts with, if the tensor allows */
+#ifndef STEAL_UNITS_PER_THREAD
+#define STEAL_UNITS_PER_THREAD 8
+#endif
+
+
+/**
+* @brief What a unit of work refers to.
+*/
+typedef enum
+{
+  STEAL_SLICES, /** A range of root slices of an untiled CSF. */
+  STEAL_TILES,  /** A range of tiles, when the output mode is not tiled. */
+  STEAL_LAYERS  /** A range of layers of tiles along the output mode. */
+} steal_unit_type;
+
+
+/**
+* @brief A contiguous range of slices, tiles, or layers.
+*/
+typedef struct
+{
+  idx_t begin;
+  idx_t end;
+} steal_unit;
+
+
+/**
+* @brief The units which one thread owns. The owner takes units from the head
+*        and thieves take them from the tail, furthest from the owner's work.
+*/
+typedef struct
+{
+#ifdef _OPENMP
+  omp_lock_t lock;
+#endif
+  idx_t head;    /** The next unit for the owner. */
+  idx_t tail;    /** One past the last unit which is left. */
+  idx_t first;   /** The first unit given to this thread. */
+  idx_t last;    /** One past the last unit given to this thread. */
+  idx_t nstolen; /** Units this thread stole since the last reset. */
+
+  /* keep the deques of neighbouring threads on separate cache lines */
+  char pad[64];
+} steal_deque;
+
+
+/**
+* @brief Per-thread deques of work for one MTTKRP mode.
+*/
+typedef struct splatt_steal_sched
+{
+  steal_unit_type type;
+  idx_t nunits;
+  steal_unit * units;
+  int nthreads;
+  steal_deque * deques;
+} steal_sched;
+
+
+
+/******************************************************************************
+ * PUBLIC FUNCTIONS
+ *****************************************************************************/
+
+#define steal_alloc splatt_steal_alloc
+/**
+* @brief Split the work of an MTTKRP into units of roughly equal nonzeros and
+*        give each thread a contiguous run of them, so that neighbouring
+*        threads own neighbouring slices or tiles. A slice or tile which is
+*        heavier than a unit is a unit by itself.
+*
+* @param csf The CSF tensor which the MTTKRP of 'mode' uses.
+* @param mode The output mode.
+* @param nthreads The number of threads.
+*
+* @return The scheduler, to be freed with steal_free().
+*/
+steal_sched * steal_alloc(
+    splatt_csf const * const csf,
+    idx_t const mode,
+    int const nthreads);
+
+
+#define steal_free splatt_steal_free
+/**
+* @brief Free a scheduler from steal_alloc().
+*
+* @param sched The scheduler to free.
+*/
+void steal_free(
+    steal_sched * sched);
+
+
+#define steal_reset splatt_steal_reset
+/**
+* @brief Give every thread back its own units and zero its steal count.
+*
+*        NOTE: this must not run while any thread is taking units.
+*
+* @param sched The scheduler.
+*/
+void steal_reset(
+    steal_sched * const sched);
+
+
+#define steal_next splatt_steal_next
+/**
+* @brief Take the next unit of the calling thread. Once its own deque is
+*        empty, steal from the tail of the nearest thread which has work.
+*
+* @param sched The scheduler.
+* @param tid The calling thread.
+* @param[out] unit The unit to process.
+*
+* @return false once no thread has work left.
+*/
+bool steal_next(
+    steal_sched * const sched,
+    int const tid,
+    steal_unit * const unit);
+
+
+#define steal_count splatt_steal_count
+/**
+* @brief Return the number of units stolen by all threads since the last
+*        steal_reset().
+*
+* @param sched The scheduler.
+*/
+idx_t steal_count(
+    steal_sched const * const sched);
+
+#endif
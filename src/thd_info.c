@@ -156,25 +156,32 @@ thd_info * thd_init(
   idx_t const nscratch,
   ...)
 {
+  splatt_mem_tag const prev_tag = mem_tag_begin(SPLATT_MEM_MTTKRP_WS);
   thd_info * thds = (thd_info *) splatt_malloc(nthreads * sizeof(thd_info));
 
+  idx_t * bytes = splatt_malloc(nscratch * sizeof(*bytes));
+  va_list args;
+  va_start(args, nscratch);
+  for(idx_t s=0; s < nscratch; ++s) {
+    bytes[s] = va_arg(args, idx_t);
+  }
+  va_end(args);
+
+  /* each thread allocates and first touches its own scratch so that it
+   * resides on the thread's NUMA node */
+  #pragma omp parallel for schedule(static, 1) num_threads(nthreads)
   for(idx_t t=0; t < nthreads; ++t) {
     timer_reset(&thds[t].ttime);
     thds[t].nscratch = nscratch;
     thds[t].scratch = (void **) splatt_malloc(nscratch * sizeof(void*));
-  }
-
-  va_list args;
-  va_start(args, nscratch);
-  for(idx_t s=0; s < nscratch; ++s) {
-    idx_t const bytes = va_arg(args, idx_t);
-    for(idx_t t=0; t < nthreads; ++t) {
-      thds[t].scratch[s] = (void *) splatt_malloc(bytes);
-      memset(thds[t].scratch[s], 0, bytes);
+    for(idx_t s=0; s < nscratch; ++s) {
+      thds[t].scratch[s] = (void *) splatt_malloc(bytes[s]);
+      memset(thds[t].scratch[s], 0, bytes[s]);
     }
   }
-  va_end(args);
+  splatt_free(bytes);
 
+  mem_tag_end(prev_tag);
   return thds;
 }
 
@@ -222,10 +229,10 @@ void thd_free(
 {
   for(idx_t t=0; t < nthreads; ++t) {
     for(idx_t s=0; s < thds[t].nscratch; ++s) {
-      free(thds[t].scratch[s]);
+      splatt_free(thds[t].scratch[s]);
     }
-    free(thds[t].scratch);
+    splatt_free(thds[t].scratch);
   }
-  free(thds);
+  splatt_free(thds);
 }
 
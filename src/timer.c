@@ -4,6 +4,7 @@
  * INCLUDES
  *****************************************************************************/
 #include "timer.h"
+#include "metrics.h"
 #include <stdio.h>
 
 
@@ -40,6 +41,8 @@ static char const * const timer_names[] = {
   [TIMER_MPI_NORM]      = "MPI NORM",
   [TIMER_MPI_UPDATE]    = "MPI UPD",
   [TIMER_MPI_FIT]       = "MPI FIT",
+  [TIMER_MPI_FUSED]     = "MPI FUSED",
+  [TIMER_MPI_REBALANCE] = "MPI REBAL",
   [TIMER_MTTKRP_MAX]    = "MTTKRP MAX",
   [TIMER_MPI_MAX]       = "MPI MAX",
   [TIMER_MPI_IDLE_MAX]  = "MPI IDLE MAX",
@@ -70,6 +73,15 @@ void report_times(void)
   }
 }
 
+void record_times(void)
+{
+  for(int t=0; t < TIMER_NTIMERS; ++t) {
+    if(timer_names[t] != NULL && timers[t].seconds > 0) {
+      metrics_set("timer", timer_names[t], -1, -1, -1, timers[t].seconds);
+    }
+  }
+}
+
 void timer_inc_verbose(void)
 {
   switch(timer_lvl) {
@@ -60,6 +60,8 @@ typedef enum
   TIMER_MPI_NORM,
   TIMER_MPI_UPDATE,
   TIMER_MPI_FIT,
+  TIMER_MPI_FUSED,
+  TIMER_MPI_REBALANCE,
   /* timer max */
   TIMER_MTTKRP_MAX,
   TIMER_MPI_MAX,
@@ -100,6 +102,13 @@ void init_timers(void);
 void report_times(void);
 
 
+#define record_times splatt_record_times
+/**
+* @brief Record the current value of all used timers as metrics.
+*/
+void record_times(void);
+
+
 #define timer_inc_verbose splatt_timer_inc_verbose
 /**
 * @brief Increment timer verbosity to the next level;
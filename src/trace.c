@@ -0,0 +1,222 @@
+
+
+/******************************************************************************
+ * INCLUDES
+ *****************************************************************************/
+#include "trace.h"
+#include "thd_info.h"
+#include "timer.h"
+
+
+/******************************************************************************
+ * PRIVATE STRUCTURES
+ *****************************************************************************/
+
+#ifdef SPLATT_USE_TRACE
+
+/* events kept per thread -- older ones are overwritten */
+#define TRACE_NEVENTS (1 << 16)
+/* deepest nesting of events on a thread */
+#define TRACE_MAXDEPTH 16
+/* threads beyond this are not traced */
+#define TRACE_MAXTHREADS 1024
+
+typedef struct
+{
+  char const * name;
+  long id;
+  double start;
+  double dur;
+} trace_event;
+
+typedef struct
+{
+  trace_event * events;
+  idx_t nrecorded;
+  int depth;
+  trace_event stack[TRACE_MAXDEPTH];
+} trace_thd;
+
+
+bool trace_active = false;
+
+static char * trace_fname = NULL;
+static double trace_epoch = 0.;
+static trace_thd * trace_thds[TRACE_MAXTHREADS];
+
+
+
+/******************************************************************************
+ * PRIVATE FUNCTIONS
+ *****************************************************************************/
+
+/**
+* @brief Return the calling thread's buffer, allocating it on first use. Only
+*        the calling thread writes its slot, so no locking is needed.
+*/
+static trace_thd * p_get_thd(void)
+{
+  int const tid = splatt_omp_get_thread_num();
+  if(tid >= TRACE_MAXTHREADS) {
+    return NULL;
+  }
+
+  if(trace_thds[tid] == NULL) {
+    trace_thd * thd = splatt_malloc(sizeof(*thd));
+    thd->events = splatt_malloc(TRACE_NEVENTS * sizeof(*thd->events));
+    thd->nrecorded = 0;
+    thd->depth = 0;
+    trace_thds[tid] = thd;
+  }
+  return trace_thds[tid];
+}
+
+
+static void p_write_events(
+    FILE * fout,
+    int const rank,
+    bool * const first)
+{
+  for(int t=0; t < TRACE_MAXTHREADS; ++t) {
+    trace_thd const * const thd = trace_thds[t];
+    if(thd == NULL) {
+      continue;
+    }
+
+    fprintf(fout, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,"
+        "\"tid\":%d,\"args\":{\"name\":\"thread %d\"}}",
+        *first ? "" : ",", rank, t, t);
+    *first = false;
+
+    /* oldest surviving event first */
+    idx_t const nevents = SS_MIN(thd->nrecorded, TRACE_NEVENTS);
+    idx_t const begin = thd->nrecorded - nevents;
+    for(idx_t e=begin; e < thd->nrecorded; ++e) {
+      trace_event const * const ev = thd->events + (e % TRACE_NEVENTS);
+      fprintf(fout, ",\n{\"name\":\"%s\",\"cat\":\"splatt\",\"ph\":\"X\","
+          "\"ts\":%0.3f,\"dur\":%0.3f,\"pid\":%d,\"tid\":%d",
+          ev->name, ev->start * 1e6, ev->dur * 1e6, rank, t);
+      if(ev->id >= 0) {
+        fprintf(fout, ",\"args\":{\"id\":%ld}", ev->id);
+      }
+      fprintf(fout, "}");
+    }
+
+    if(thd->nrecorded > TRACE_NEVENTS) {
+      fprintf(stderr, "SPLATT: trace of thread %d dropped %"SPLATT_PF_IDX
+          " oldest events.\n", t, thd->nrecorded - TRACE_NEVENTS);
+    }
+  }
+}
+
+#endif
+
+
+
+/******************************************************************************
+ * PUBLIC FUNCTIONS
+ *****************************************************************************/
+
+bool trace_init(
+    char const * const fname)
+{
+#ifdef SPLATT_USE_TRACE
+  free(trace_fname);
+  trace_fname = strdup(fname);
+  trace_epoch = monotonic_seconds();
+  trace_active = true;
+  return true;
+#else
+  fprintf(stderr, "SPLATT: tracing is not supported in this build. "
+                  "Reconfigure with --with-trace.\n");
+  return false;
+#endif
+}
+
+
+void trace_finalize(
+    int const rank,
+    int const npes)
+{
+#ifdef SPLATT_USE_TRACE
+  if(trace_fname == NULL) {
+    return;
+  }
+  trace_active = false;
+
+  char * fname = trace_fname;
+  if(npes > 1) {
+    fname = splatt_malloc(strlen(trace_fname) + 16);
+    sprintf(fname, "%s.%d", trace_fname, rank);
+  }
+
+  FILE * fout = fopen(fname, "w");
+  if(fout == NULL) {
+    fprintf(stderr, "SPLATT ERROR: failed to open '%s'\n", fname);
+  } else {
+    bool first = true;
+    fprintf(fout, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+    fprintf(fout, "\n{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,"
+        "\"args\":{\"name\":\"rank %d\"}}", rank, rank);
+    first = false;
+    p_write_events(fout, rank, &first);
+    fprintf(fout, "\n]}\n");
+    fclose(fout);
+  }
+
+  if(fname != trace_fname) {
+    splatt_free(fname);
+  }
+  free(trace_fname);
+  trace_fname = NULL;
+
+  for(int t=0; t < TRACE_MAXTHREADS; ++t) {
+    if(trace_thds[t] != NULL) {
+      splatt_free(trace_thds[t]->events);
+      splatt_free(trace_thds[t]);
+      trace_thds[t] = NULL;
+    }
+  }
+#endif
+}
+
+
+#ifdef SPLATT_USE_TRACE
+
+void trace_push(
+    char const * const name,
+    long const id)
+{
+  trace_thd * const thd = p_get_thd();
+  if(thd == NULL) {
+    return;
+  }
+
+  /* too deep: still count the depth so trace_pop() stays balanced */
+  if(thd->depth < TRACE_MAXDEPTH) {
+    trace_event * const ev = thd->stack + thd->depth;
+    ev->name = name;
+    ev->id = id;
+    ev->start = monotonic_seconds() - trace_epoch;
+  }
+  ++thd->depth;
+}
+
+
+void trace_pop(void)
+{
+  trace_thd * const thd = p_get_thd();
+  if(thd == NULL || thd->depth == 0) {
+    return;
+  }
+
+  --thd->depth;
+  if(thd->depth < TRACE_MAXDEPTH) {
+    trace_event ev = thd->stack[thd->depth];
+    ev.dur = (monotonic_seconds() - trace_epoch) - ev.start;
+    thd->events[thd->nrecorded % TRACE_NEVENTS] = ev;
+    ++thd->nrecorded;
+  }
+}
+
+#endif
@@ -0,0 +1,107 @@
+#ifndef SPLATT_TRACE_H
+#define SPLATT_TRACE_H
+
+
+/******************************************************************************
+ * INCLUDES
+ *****************************************************************************/
+#include "base.h"
+
+
+/*
+ * Timeline tracing. Each thread records complete (begin/end) events into its
+ * own ring buffer, which are written as Chrome trace-event JSON at exit and
+ * can be viewed with Perfetto (ui.perfetto.dev) or chrome://tracing.
+ *
+ * Tracing is only compiled in with SPLATT_USE_TRACE (configure --with-trace).
+ * Otherwise, trace_begin() and trace_end() are empty and cost nothing.
+ *
+ * Events must nest on each thread, and 'name' must point to static storage.
+ */
+
+
+/******************************************************************************
+ * PUBLIC FUNCTIONS
+ *****************************************************************************/
+
+#define trace_init splatt_trace_init
+/**
+* @brief Start recording events.
+*
+* @param fname The file to write the trace to. With several MPI ranks, each
+*              rank writes 'fname.RANK'.
+*
+* @return Whether tracing was started. It fails if not compiled in.
+*/
+bool trace_init(
+    char const * const fname);
+
+
+#define trace_finalize splatt_trace_finalize
+/**
+* @brief Write all recorded events and stop tracing. Nothing happens if
+*        tracing was not started.
+*
+* @param rank The MPI rank of this process (0 without MPI).
+* @param npes The number of MPI ranks (1 without MPI).
+*/
+void trace_finalize(
+    int const rank,
+    int const npes);
+
+
+#ifdef SPLATT_USE_TRACE
+
+#define trace_active splatt_trace_active
+extern bool trace_active;
+
+#define trace_push splatt_trace_push
+void trace_push(
+    char const * const name,
+    long const id);
+
+#define trace_pop splatt_trace_pop
+void trace_pop(void);
+
+
+/**
+* @brief Begin an event on the calling thread.
+*
+* @param name The name of the event.
+* @param id An identifier shown with the event (e.g., a tile or mode), or -1.
+*/
+static inline void trace_begin(
+    char const * const name,
+    long const id)
+{
+  if(trace_active) {
+    trace_push(name, id);
+  }
+}
+
+
+/**
+* @brief End the most recent event on the calling thread.
+*/
+static inline void trace_end(void)
+{
+  if(trace_active) {
+    trace_pop();
+  }
+}
+
+#else
+
+static inline void trace_begin(
+    char const * const name,
+    long const id)
+{
+}
+
+static inline void trace_end(void)
+{
+}
+
+#endif
+
+#endif
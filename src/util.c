@@ -126,16 +126,23 @@ void par_memcpy(
     size_t const bytes)
 {
   #pragma omp parallel
-  {
-    int nthreads = splatt_omp_get_num_threads();
-    int tid = splatt_omp_get_thread_num();
+  par_memcpy_team(dst, src, bytes);
+}
 
-    size_t n_per_thread = (bytes + nthreads - 1)/nthreads;
-    size_t n_begin = SS_MIN(n_per_thread * tid, bytes);
-    size_t n_end = SS_MIN(n_begin + n_per_thread, bytes);
 
-    memcpy((char *)dst + n_begin, (char *)src + n_begin, n_end - n_begin);
-  }
+void par_memcpy_team(
+    void * const restrict dst,
+    void const * const restrict src,
+    size_t const bytes)
+{
+  int nthreads = splatt_omp_get_num_threads();
+  int tid = splatt_omp_get_thread_num();
+
+  size_t n_per_thread = (bytes + nthreads - 1)/nthreads;
+  size_t n_begin = SS_MIN(n_per_thread * tid, bytes);
+  size_t n_end = SS_MIN(n_begin + n_per_thread, bytes);
+
+  memcpy((char *)dst + n_begin, (char *)src + n_begin, n_end - n_begin);
 }
 
 
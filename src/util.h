@@ -121,4 +121,21 @@ void par_memcpy(
     void const * const restrict src,
     size_t const bytes);
 
+
+#define par_memcpy_team splatt_par_memcpy_team
+/**
+* @brief The body of par_memcpy(), for an existing parallel region. Each thread
+*        copies its own block and there is no barrier at the end.
+*
+*        NOTE: this must be called by every thread of the team.
+*
+* @param dst The destination buffer.
+* @param src The source buffer.
+* @param bytes The number of bytes to copy.
+*/
+void par_memcpy_team(
+    void * const restrict dst,
+    void const * const restrict src,
+    size_t const bytes);
+
 #endif
@@ -3,6 +3,8 @@
 #include "splatt_test.h"
 
 #include "../src/sptensor.h"
+#include "../src/metrics.h"
+#include "../src/csf.h"
 
 
 /* API includes */
@@ -90,3 +92,163 @@ CTEST2(api, version_subminor)
   ASSERT_EQUAL(SPLATT_VER_SUBMINOR, splatt_version_subminor());
 }
 
+
+CTEST2(api, metrics)
+{
+  splatt_metrics_clear();
+
+  /* nothing is recorded until enabled */
+  metrics_record("test", "x", -1, -1, -1, 1.);
+  ASSERT_EQUAL(0, splatt_metrics_count());
+
+  splatt_metrics_enable();
+  metrics_record("test", "x", 0, -1, -1, 1.);
+  metrics_record("test", "x", 1, -1, -1, 2.);
+  metrics_accum("test", "y", -1, 2, 3, 1.5);
+  metrics_accum("test", "y", -1, 2, 3, 1.5);
+  metrics_set("test", "x", 1, -1, -1, 5.);
+  splatt_metrics_disable();
+
+  ASSERT_EQUAL(3, splatt_metrics_count());
+  splatt_metric const * const m = splatt_metrics_get();
+  ASSERT_NOT_NULL(m);
+  ASSERT_DBL_NEAR_TOL(1., m[0].value, 0.);
+  ASSERT_DBL_NEAR_TOL(5., m[1].value, 0.);
+  ASSERT_EQUAL(2, m[2].mode);
+  ASSERT_EQUAL(3, m[2].thread);
+  ASSERT_EQUAL(-1, m[2].iteration);
+  ASSERT_DBL_NEAR_TOL(3., m[2].value, 0.);
+
+  splatt_metrics_clear();
+  ASSERT_EQUAL(0, splatt_metrics_count());
+}
+
+
+CTEST2(api, metrics_accum_many)
+{
+  splatt_metrics_clear();
+  splatt_metrics_enable();
+
+  /* interleave per-iteration records with accumulated per-thread values,
+   * enough to grow the storage several times */
+  int const nits = 1000;
+  int const nthreads = 4;
+  for(int it=0; it < nits; ++it) {
+    metrics_record("test", "fit", it, -1, -1, it);
+    for(int t=0; t < nthreads; ++t) {
+      metrics_accum("test", "seconds", -1, it % 3, t, 1.);
+    }
+  }
+  metrics_set("test", "fit", nits / 2, -1, -1, -1.);
+  splatt_metrics_disable();
+
+  ASSERT_EQUAL(nits + (3 * nthreads), splatt_metrics_count());
+  splatt_metric const * const m = splatt_metrics_get();
+  double total = 0;
+  for(splatt_idx_t i=0; i < splatt_metrics_count(); ++i) {
+    if(strcmp(m[i].name, "seconds") == 0) {
+      total += m[i].value;
+    } else if(m[i].iteration == nits / 2) {
+      ASSERT_DBL_NEAR_TOL(-1., m[i].value, 0.);
+    } else {
+      ASSERT_DBL_NEAR_TOL((double) m[i].iteration, m[i].value, 0.);
+    }
+  }
+  ASSERT_DBL_NEAR_TOL((double) (nits * nthreads), total, 0.);
+
+  splatt_metrics_clear();
+}
+
+
+typedef struct
+{
+  splatt_idx_t ncalls;
+  splatt_idx_t stop_after;
+  splatt_idx_t dims[SPLATT_MAX_NMODES];
+} p_cpd_counter;
+
+static int p_stop_cpd(
+    splatt_cpd_progress const * const progress,
+    void * data)
+{
+  p_cpd_counter * const counter = (p_cpd_counter *) data;
+  ASSERT_EQUAL(counter->ncalls, progress->iteration);
+  ASSERT_NOT_NULL(progress->lambda);
+  for(splatt_idx_t m=0; m < progress->nmodes; ++m) {
+    ASSERT_EQUAL(counter->dims[m], progress->dims[m]);
+    ASSERT_EQUAL(0, progress->row_start[m]);
+    ASSERT_NOT_NULL(progress->factors[m]);
+  }
+  ASSERT_TRUE(progress->elapsed >= progress->seconds);
+
+  ++counter->ncalls;
+  return (counter->ncalls == counter->stop_after) ?
+      SPLATT_CPD_STOP : SPLATT_CPD_CONTINUE;
+}
+
+CTEST2(api, cpd_callback)
+{
+  double * opts = splatt_default_opts();
+  opts[SPLATT_OPTION_VERBOSITY] = SPLATT_VERBOSITY_NONE;
+  opts[SPLATT_OPTION_TOLERANCE] = 0.;
+  opts[SPLATT_OPTION_NITER] = 10;
+
+  for(splatt_idx_t i=0; i < data->ntensors; ++i) {
+    splatt_csf * csf = csf_alloc(data->tensors[i], opts);
+
+    p_cpd_counter counter;
+    counter.ncalls = 0;
+    counter.stop_after = 3;
+    for(splatt_idx_t m=0; m < csf->nmodes; ++m) {
+      counter.dims[m] = csf->dims[m];
+    }
+    splatt_cpd_set_callback(p_stop_cpd, &counter);
+
+    splatt_kruskal factored;
+    int const ret = splatt_cpd_als(csf, 5, opts, &factored);
+    splatt_cpd_set_callback(NULL, NULL);
+
+    ASSERT_EQUAL(SPLATT_SUCCESS, ret);
+    ASSERT_EQUAL(counter.stop_after, counter.ncalls);
+
+    splatt_free_kruskal(&factored);
+    csf_free(csf, opts);
+  }
+  splatt_free_opts(opts);
+}
+
+
+CTEST2(api, cpd_team)
+{
+  double * opts = splatt_default_opts();
+  opts[SPLATT_OPTION_VERBOSITY] = SPLATT_VERBOSITY_NONE;
+  opts[SPLATT_OPTION_TOLERANCE] = 0.;
+  opts[SPLATT_OPTION_NITER] = 5;
+  opts[SPLATT_OPTION_NTHREADS] = 3;
+
+  for(splatt_idx_t i=0; i < data->ntensors; ++i) {
+    splatt_csf * csf = csf_alloc(data->tensors[i], opts);
+
+    /* same initial factors, with and without a persistent team */
+    splatt_kruskal forkjoin;
+    srand(1);
+    ASSERT_EQUAL(SPLATT_SUCCESS, splatt_cpd_als(csf, 5, opts, &forkjoin));
+
+    splatt_kruskal team;
+    opts[SPLATT_OPTION_TEAM] = 1;
+    srand(1);
+    ASSERT_EQUAL(SPLATT_SUCCESS, splatt_cpd_als(csf, 5, opts, &team));
+    opts[SPLATT_OPTION_TEAM] = 0;
+
+    /* only the order of floating-point sums differs */
+    ASSERT_DBL_NEAR_TOL(forkjoin.fit, team.fit, 1e-8);
+    for(splatt_idx_t r=0; r < 5; ++r) {
+      ASSERT_DBL_NEAR_TOL(1., team.lambda[r] / forkjoin.lambda[r], 1e-6);
+    }
+
+    splatt_free_kruskal(&forkjoin);
+    splatt_free_kruskal(&team);
+    csf_free(csf, opts);
+  }
+  splatt_free_opts(opts);
+}
@@ -1,5 +1,6 @@
 
 #include "../src/base.h"
+#include "../src/affinity.h"
 #include "ctest/ctest.h"
 #include "splatt_test.h"
 
@@ -11,3 +12,146 @@ CTEST(base, alloc_aligned)
   splatt_free(ptr);
 }
 
+
+
+CTEST(base, mem_accounting)
+{
+  splatt_mem_usage before;
+  splatt_mem_usage after;
+  splatt_mem_query(&before);
+
+  splatt_mem_tag const prev = mem_tag_begin(SPLATT_MEM_CSF);
+  void * ptr = splatt_malloc(1000);
+  mem_tag_end(prev);
+  ASSERT_EQUAL(SPLATT_MEM_CSF, mem_tag_of(ptr));
+
+  splatt_mem_query(&after);
+  ASSERT_EQUAL(before.live[SPLATT_MEM_CSF] + 1000, after.live[SPLATT_MEM_CSF]);
+  ASSERT_EQUAL(before.total_live + 1000, after.total_live);
+  ASSERT_TRUE(after.peak[SPLATT_MEM_CSF] >= after.live[SPLATT_MEM_CSF]);
+  ASSERT_EQUAL(before.nallocs[SPLATT_MEM_CSF] + 1,
+      after.nallocs[SPLATT_MEM_CSF]);
+
+  mem_retag(ptr, SPLATT_MEM_IO);
+  splatt_mem_query(&after);
+  ASSERT_EQUAL(before.live[SPLATT_MEM_CSF], after.live[SPLATT_MEM_CSF]);
+  ASSERT_EQUAL(before.live[SPLATT_MEM_IO] + 1000, after.live[SPLATT_MEM_IO]);
+
+  splatt_free(ptr);
+  splatt_mem_query(&after);
+  ASSERT_EQUAL(before.live[SPLATT_MEM_IO], after.live[SPLATT_MEM_IO]);
+  ASSERT_EQUAL(before.total_live, after.total_live);
+
+  splatt_mem_reset_peak();
+  splatt_mem_query(&after);
+  ASSERT_EQUAL(after.total_live, after.total_peak);
+}
+
+
+CTEST(base, mem_many)
+{
+  /* enough live allocations to force the table to grow */
+  idx_t const N = 5000;
+  splatt_mem_usage before;
+  splatt_mem_usage after;
+  splatt_mem_query(&before);
+
+  void ** ptrs = splatt_malloc(N * sizeof(*ptrs));
+  for(idx_t i=0; i < N; ++i) {
+    ptrs[i] = splatt_malloc(i+1);
+  }
+  /* free in a different order than allocation */
+  for(idx_t i=0; i < N; i += 2) {
+    splatt_free(ptrs[i]);
+  }
+  for(idx_t i=1; i < N; i += 2) {
+    splatt_free(ptrs[i]);
+  }
+  splatt_free(ptrs);
+
+  splatt_mem_query(&after);
+  ASSERT_EQUAL(before.total_live, after.total_live);
+  ASSERT_TRUE(after.total_peak >= before.total_live + (N * (N+1) / 2));
+}
+
+
+CTEST(base, mem_hugepages)
+{
+  size_t const big = 3 * 1024 * 1024;
+  splatt_mem_usage before;
+  splatt_mem_usage after;
+  splatt_mem_query(&before);
+
+  splatt_mem_set_hugepages(SPLATT_HUGEPAGE_THP, big);
+  char * small = splatt_malloc(big - 1);
+  char * large = splatt_malloc(big);
+  splatt_mem_set_hugepages(SPLATT_HUGEPAGE_OFF, big);
+  ASSERT_NOT_NULL(small);
+  ASSERT_NOT_NULL(large);
+
+  /* huge allocations are usable and accounted like any other */
+  memset(small, 1, big - 1);
+  memset(large, 1, big);
+  ASSERT_EQUAL(big, mem_bytes_of(large));
+  splatt_mem_query(&after);
+  ASSERT_EQUAL(before.total_live + big - 1 + big, after.total_live);
+
+  /* only the large one asked for (whole) huge pages */
+  ASSERT_TRUE(after.huge_mapped + after.huge_fallbacks >
+      before.huge_mapped + before.huge_fallbacks);
+  if(after.huge_fallbacks == before.huge_fallbacks) {
+    ASSERT_EQUAL(0, (uintptr_t) large % (2 * 1024 * 1024));
+    ASSERT_EQUAL(before.huge_mapped + (4 * 1024 * 1024), after.huge_mapped);
+  }
+  ASSERT_TRUE(after.huge_backed <= after.huge_mapped);
+
+  splatt_free(small);
+  splatt_free(large);
+  splatt_mem_query(&after);
+  ASSERT_EQUAL(before.total_live, after.total_live);
+}
+
+
+
+CTEST(base, affinity_order)
+{
+  affinity_topology const * const topo = affinity_topo();
+  ASSERT_TRUE(topo->ncpus >= 1);
+  ASSERT_TRUE(topo->ncores >= 1 && topo->ncores <= topo->ncpus);
+  ASSERT_TRUE(topo->npackages >= 1 && topo->npackages <= topo->ncores);
+
+  /* oversubscribe to exercise wrapping */
+  int const nthreads = 2 * topo->ncpus;
+  int * cpus = splatt_malloc(nthreads * sizeof(*cpus));
+
+  splatt_affinity_type const policies[] = {
+    SPLATT_AFFINITY_COMPACT, SPLATT_AFFINITY_SCATTER, SPLATT_AFFINITY_CORES
+  };
+  for(int p=0; p < 3; ++p) {
+    int const shared = affinity_order(policies[p], nthreads, cpus);
+    ASSERT_TRUE(shared >= nthreads - topo->ncores);
+    ASSERT_TRUE(shared <= nthreads);
+
+    /* every thread is given an allowed CPU */
+    for(int t=0; t < nthreads; ++t) {
+      bool found = false;
+      for(int c=0; c < topo->ncpus; ++c) {
+        found = found || (topo->cpus[c].cpu == cpus[t]);
+      }
+      ASSERT_TRUE(found);
+    }
+  }
+
+  /* one thread per CPU never shares a CPU */
+  affinity_order(SPLATT_AFFINITY_COMPACT, topo->ncpus, cpus);
+  for(int t=0; t < topo->ncpus; ++t) {
+    for(int u=0; u < t; ++u) {
+      ASSERT_NOT_EQUAL(cpus[u], cpus[t]);
+    }
+  }
+
+  /* one thread per core never shares a core */
+  ASSERT_EQUAL(0, affinity_order(SPLATT_AFFINITY_CORES, topo->ncores, cpus));
+
+  splatt_free(cpus);
+}
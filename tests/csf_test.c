@@ -201,3 +201,43 @@ CTEST2(csf_one_init, dense_tiled_normsq)
     ASSERT_DBL_NEAR_TOL(gold_norm, mynorm, 1e-5);
   }
 }
+
+
+CTEST2(csf_one_init, numa_place)
+{
+  data->opts[SPLATT_OPTION_NTHREADS] = 3;
+  for(int tile=0; tile < 2; ++tile) {
+    data->opts[SPLATT_OPTION_TILE] = tile ? SPLATT_DENSETILE : SPLATT_NOTILE;
+
+    data->opts[SPLATT_OPTION_NUMA] = SPLATT_NUMA_OFF;
+    splatt_csf * gold = csf_alloc(data->tt, data->opts);
+    data->opts[SPLATT_OPTION_NUMA] = SPLATT_NUMA_ON;
+    splatt_csf * placed = csf_alloc(data->tt, data->opts);
+
+    /* placement moves the arrays but never changes them */
+    ASSERT_EQUAL(gold->ntiles, placed->ntiles);
+    idx_t const nmodes = gold->nmodes;
+    for(idx_t t=0; t < gold->ntiles; ++t) {
+      csf_sparsity const * const gpt = gold->pt + t;
+      csf_sparsity const * const ppt = placed->pt + t;
+      for(idx_t m=0; m < nmodes; ++m) {
+        ASSERT_EQUAL(gpt->nfibs[m], ppt->nfibs[m]);
+        if(gpt->fids[m] != NULL) {
+          ASSERT_EQUAL(0, memcmp(gpt->fids[m], ppt->fids[m],
+              gpt->nfibs[m] * sizeof(idx_t)));
+        }
+        if(m < nmodes-1 && gpt->fptr[m] != NULL) {
+          ASSERT_EQUAL(0, memcmp(gpt->fptr[m], ppt->fptr[m],
+              (gpt->nfibs[m] + 1) * sizeof(idx_t)));
+        }
+      }
+      if(gpt->vals != NULL) {
+        ASSERT_EQUAL(0, memcmp(gpt->vals, ppt->vals,
+            gpt->nfibs[nmodes-1] * sizeof(val_t)));
+      }
+    }
+
+    csf_free(gold, data->opts);
+    csf_free(placed, data->opts);
+  }
+}
@@ -0,0 +1,84 @@
+#include "../src/generate.h"
+#include "../src/sptensor.h"
+#include "../src/thd_info.h"
+
+#include "ctest/ctest.h"
+
+#include "splatt_test.h"
+
+
+static void p_small_opts(
+    gen_opts * const opts)
+{
+  gen_default_opts(opts);
+  opts->nmodes = 3;
+  opts->dims[0] = 50;
+  opts->dims[1] = 80;
+  opts->dims[2] = 30;
+  opts->nnz = 200000;
+  opts->skew[0] = 1.1;
+  opts->skew[1] = 0.5;
+  opts->seed = 7;
+}
+
+
+CTEST(generate, bad_opts)
+{
+  gen_opts opts;
+  p_small_opts(&opts);
+  opts.dims[1] = 0;
+  ASSERT_NULL(tt_generate(&opts));
+}
+
+
+CTEST(generate, valid)
+{
+  gen_opts opts;
+  p_small_opts(&opts);
+  sptensor_t * tt = tt_generate(&opts);
+  ASSERT_NOT_NULL(tt);
+
+  ASSERT_TRUE(tt->nnz > 0);
+  ASSERT_TRUE(tt->nnz <= opts.nnz);
+  for(idx_t m=0; m < tt->nmodes; ++m) {
+    ASSERT_EQUAL(opts.dims[m], tt->dims[m]);
+    for(idx_t n=0; n < tt->nnz; ++n) {
+      ASSERT_TRUE(tt->ind[m][n] < tt->dims[m]);
+    }
+  }
+
+  /* duplicates are merged */
+  ASSERT_EQUAL(0, tt_remove_dups(tt));
+
+  tt_free(tt);
+}
+
+
+CTEST(generate, deterministic)
+{
+  gen_opts opts;
+  p_small_opts(&opts);
+  opts.rank = 3;
+  opts.noise = 0.1;
+
+  int const nthreads = splatt_omp_get_max_threads();
+
+  splatt_omp_set_num_threads(1);
+  sptensor_t * gold = tt_generate(&opts);
+  splatt_omp_set_num_threads(SS_MAX(nthreads, 4));
+  sptensor_t * tt = tt_generate(&opts);
+  splatt_omp_set_num_threads(nthreads);
+
+  ASSERT_EQUAL(gold->nnz, tt->nnz);
+  for(idx_t m=0; m < tt->nmodes; ++m) {
+    for(idx_t n=0; n < tt->nnz; ++n) {
+      ASSERT_EQUAL(gold->ind[m][n], tt->ind[m][n]);
+    }
+  }
+  for(idx_t n=0; n < tt->nnz; ++n) {
+    ASSERT_DBL_NEAR_TOL(gold->vals[n], tt->vals[n], 0.);
+  }
+
+  tt_free(gold);
+  tt_free(tt);
+}
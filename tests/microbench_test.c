@@ -0,0 +1,71 @@
+#include "../src/microbench.h"
+#include "../src/sptensor.h"
+
+#include "ctest/ctest.h"
+
+#include "splatt_test.h"
+
+#include <unistd.h>
+
+
+CTEST(microbench, names)
+{
+  for(int k=0; k < MB_NKERNELS; ++k) {
+    char const * const name = microbench_kernel_name((microbench_kernel) k);
+    ASSERT_NOT_NULL(name);
+    ASSERT_EQUAL(k, microbench_find_kernel(name));
+  }
+  ASSERT_EQUAL(MB_NKERNELS, microbench_find_kernel("bogus"));
+}
+
+
+CTEST(microbench, run_and_compare)
+{
+  gen_opts gen;
+  gen_default_opts(&gen);
+
+  /* every kernel, on generated and dense inputs */
+  microbench_config configs[MB_NKERNELS];
+  for(int k=0; k < MB_NKERNELS; ++k) {
+    configs[k].kernel = (microbench_kernel) k;
+    configs[k].size = 500;
+    configs[k].rank = microbench_uses_rank(configs[k].kernel) ? 4 : 0;
+    configs[k].nthreads = 2;
+  }
+
+  microbench_result results[MB_NKERNELS];
+  microbench_run(NULL, &gen, configs, MB_NKERNELS, 1, 3, results);
+  for(int k=0; k < MB_NKERNELS; ++k) {
+    ASSERT_EQUAL(k, results[k].config.kernel);
+    ASSERT_TRUE(results[k].q1 <= results[k].median);
+    ASSERT_TRUE(results[k].median <= results[k].q3);
+  }
+
+  char fname[] = "microbench_test_XXXXXX";
+  int const fd = mkstemp(fname);
+  ASSERT_TRUE(fd >= 0);
+  close(fd);
+
+  ASSERT_EQUAL(SPLATT_SUCCESS,
+      microbench_write_results(fname, results, MB_NKERNELS));
+  idx_t nbase;
+  microbench_result * base = microbench_read_results(fname, &nbase);
+  ASSERT_NOT_NULL(base);
+  ASSERT_EQUAL(MB_NKERNELS, nbase);
+  for(int k=0; k < MB_NKERNELS; ++k) {
+    ASSERT_EQUAL(results[k].config.size, base[k].config.size);
+    ASSERT_EQUAL(results[k].config.rank, base[k].config.rank);
+  }
+
+  /* a run never regresses against itself */
+  ASSERT_EQUAL(0, microbench_compare(results, MB_NKERNELS, base, nbase, 0.));
+
+  /* twice as slow is a regression */
+  for(idx_t b=0; b < nbase; ++b) {
+    base[b].median /= 2.;
+  }
+  ASSERT_TRUE(microbench_compare(results, MB_NKERNELS, base, nbase, 0.5) > 0);
+
+  free(base);
+  remove(fname);
+}
@@ -0,0 +1,92 @@
+#include "../src/model.h"
+#include "../src/mttkrp.h"
+#include "../src/csf.h"
+#include "../src/io.h"
+
+#include "ctest/ctest.h"
+
+#include "splatt_test.h"
+
+
+CTEST_DATA(model)
+{
+  idx_t ntensors;
+  sptensor_t * tensors[MAX_DSETS];
+  double * opts;
+  model_machine machine;
+};
+
+
+CTEST_SETUP(model)
+{
+  data->ntensors = sizeof(datasets) / sizeof(datasets[0]);
+  for(idx_t i=0; i < data->ntensors; ++i) {
+    data->tensors[i] = tt_read(datasets[i]);
+  }
+  data->opts = splatt_default_opts();
+  model_default_machine(&(data->machine));
+}
+
+CTEST_TEARDOWN(model)
+{
+  for(idx_t i=0; i < data->ntensors; ++i) {
+    tt_free(data->tensors[i]);
+  }
+  splatt_free(data->opts);
+}
+
+
+CTEST2(model, serial)
+{
+  data->opts[SPLATT_OPTION_CSF_ALLOC] = SPLATT_CSF_ONEMODE;
+  data->opts[SPLATT_OPTION_NTHREADS] = 1;
+
+  for(idx_t i=0; i < data->ntensors; ++i) {
+    splatt_csf * cs = csf_alloc(data->tensors[i], data->opts);
+
+    model_mode modes[MAX_NMODES];
+    model_mttkrp(cs, 4, data->opts, &(data->machine), modes);
+    for(idx_t m=0; m < cs->nmodes; ++m) {
+      ASSERT_EQUAL(0, modes[m].csf_id);
+      ASSERT_EQUAL(csf_mode_to_depth(cs, m), modes[m].depth);
+
+      /* one thread is balanced and never privatizes */
+      ASSERT_DBL_NEAR_TOL(1., modes[m].imbalance, 0.);
+      ASSERT_EQUAL(MODEL_SYNC_LOCKED, modes[m].sync);
+      ASSERT_DBL_NEAR_TOL((double) cs->pt[0].nfibs[modes[m].depth],
+          modes[m].nlocks, 0.);
+
+      ASSERT_TRUE(modes[m].cost.flops > 0.);
+      ASSERT_TRUE(modes[m].cost.bytes > 0.);
+      ASSERT_TRUE(modes[m].seconds >= modes[m].compute_sec);
+      ASSERT_TRUE(modes[m].seconds >= modes[m].memory_sec);
+    }
+
+    csf_free(cs, data->opts);
+  }
+}
+
+
+CTEST2(model, matches_ws)
+{
+  data->opts[SPLATT_OPTION_CSF_ALLOC] = SPLATT_CSF_TWOMODE;
+  data->opts[SPLATT_OPTION_NTHREADS] = 7;
+  data->opts[SPLATT_OPTION_PRIVTHRESH] = 0.5;
+
+  for(idx_t i=0; i < data->ntensors; ++i) {
+    splatt_csf * cs = csf_alloc(data->tensors[i], data->opts);
+    splatt_mttkrp_ws * ws = splatt_mttkrp_alloc_ws(cs, 4, data->opts);
+
+    model_mode modes[MAX_NMODES];
+    model_mttkrp(cs, 4, data->opts, &(data->machine), modes);
+    for(idx_t m=0; m < cs->nmodes; ++m) {
+      ASSERT_EQUAL(ws->mode_csf_map[m], modes[m].csf_id);
+      ASSERT_EQUAL(ws->is_privatized[m],
+          modes[m].sync == MODEL_SYNC_PRIVATIZED);
+      ASSERT_TRUE(modes[m].imbalance >= 1.);
+    }
+
+    splatt_mttkrp_free_ws(ws);
+    csf_free(cs, data->opts);
+  }
+}
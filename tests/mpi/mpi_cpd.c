@@ -0,0 +1,287 @@
+
+#include "../ctest/ctest.h"
+#include "../splatt_test.h"
+
+#include "../../src/splatt_mpi.h"
+#include "../../src/csf.h"
+#include "../../src/generate.h"
+#include "../../src/io.h"
+#include "../../src/sptensor.h"
+#include "../../src/util.h"
+
+static char const * const TMP_FILE = "mpi_cpd_tmp.bin";
+
+
+/* what the rebalancing hook saw, checked after the factorization */
+typedef struct
+{
+  sptensor_t * tt;
+  permutation_t * perm;
+  splatt_csf * csf;
+  idx_t nfactors;
+  double const * opts;
+
+  bool moved;
+  bool layers_kept;
+  idx_t nnz_before;
+  idx_t nnz_after;
+  double normsq_before;
+  double normsq_after;
+} rebal_state;
+
+
+static splatt_csf const * p_rebalance_hook(
+  matrix_t ** mats,
+  matrix_t ** globmats,
+  rank_info * const rinfo,
+  void * data)
+{
+  rebal_state * const state = data;
+
+  /* pretend the first rank is slow, so nonzeros always move */
+  rinfo->mttkrp_seconds = (rinfo->rank == 0) ? 2. : 1.;
+
+  val_t mynormsq = csf_frobsq(state->csf);
+  MPI_Allreduce(&mynormsq, &(state->normsq_before), 1, SPLATT_MPI_VAL,
+      MPI_SUM, rinfo->comm_3d);
+  MPI_Allreduce(&(state->tt->nnz), &(state->nnz_before), 1, SPLATT_MPI_IDX,
+      MPI_SUM, rinfo->comm_3d);
+  int layer_size[MAX_NMODES];
+  for(idx_t m=0; m < state->tt->nmodes; ++m) {
+    layer_size[m] = rinfo->layer_size[m];
+  }
+
+  sptensor_t * newtt = mpi_rebalance(state->tt, state->perm, globmats, rinfo,
+      state->nfactors, state->opts);
+  tt_free(state->tt);
+  state->tt = NULL;
+  if(newtt == NULL) {
+    return NULL;
+  }
+  state->moved = true;
+  state->layers_kept = true;
+  for(idx_t m=0; m < newtt->nmodes; ++m) {
+    if(rinfo->layer_size[m] != layer_size[m]) {
+      state->layers_kept = false;
+    }
+  }
+
+  splatt_csf_free(state->csf, state->opts);
+  state->csf = splatt_csf_alloc(newtt, state->opts);
+
+  mynormsq = csf_frobsq(state->csf);
+  MPI_Allreduce(&mynormsq, &(state->normsq_after), 1, SPLATT_MPI_VAL,
+      MPI_SUM, rinfo->comm_3d);
+  MPI_Allreduce(&(newtt->nnz), &(state->nnz_after), 1, SPLATT_MPI_IDX,
+      MPI_SUM, rinfo->comm_3d);
+  tt_free(newtt);
+
+  for(idx_t m=0; m < state->csf->nmodes; ++m) {
+    mat_free(mats[m]);
+    mats[m] = mat_alloc(state->csf->dims[m], state->nfactors);
+  }
+  mat_free(mats[MAX_NMODES]);
+  mats[MAX_NMODES] = mat_alloc(state->csf->dims[argmax_elem(
+      state->csf->dims, state->csf->nmodes)], state->nfactors);
+  return state->csf;
+}
+
+
+/**
+* @brief Factor a tensor with the default (medium-grained) decomposition,
+*        optionally rebalancing after 'rebal_its' iterations.
+*
+* @return The final fit.
+*/
+static double p_mpi_cpd(
+  char const * const fname,
+  idx_t const rebal_its,
+  double const * const opts,
+  rebal_state * const state)
+{
+  idx_t const nfactors = 5;
+
+  rank_info rinfo;
+  MPI_Comm_rank(MPI_COMM_WORLD, &rinfo.rank);
+  MPI_Comm_size(MPI_COMM_WORLD, &rinfo.npes);
+  rinfo.decomp = DEFAULT_MPI_DISTRIBUTION;
+  for(idx_t m=0; m < MAX_NMODES; ++m) {
+    rinfo.dims_3d[m] = 1;
+  }
+
+  sptensor_t * tt = mpi_tt_read(fname, NULL, &rinfo);
+  permutation_t * perm = mpi_distribute_mats(&rinfo, tt, rinfo.decomp);
+  tt_remove_empty(tt);
+  for(idx_t m=0; m < tt->nmodes; ++m) {
+    mpi_cpy_indmap(tt, &rinfo, m);
+  }
+  splatt_csf * csf = splatt_csf_alloc(tt, opts);
+  for(idx_t m=0; m < tt->nmodes; ++m) {
+    mpi_find_owned(tt, m, &rinfo);
+    mpi_compute_ineed(&rinfo, tt, m, nfactors, 3);
+  }
+  idx_t const nmodes = tt->nmodes;
+
+  srand(1);
+  matrix_t * mats[MAX_NMODES+1];
+  matrix_t * globmats[MAX_NMODES];
+  for(idx_t m=0; m < nmodes; ++m) {
+    globmats[m] = mpi_mat_rand(m, nfactors, perm, &rinfo);
+    mats[m] = mat_alloc(csf->dims[m], nfactors);
+  }
+  mats[MAX_NMODES] = mat_alloc(csf->dims[argmax_elem(csf->dims, nmodes)],
+      nfactors);
+  val_t * lambda = splatt_malloc(nfactors * sizeof(*lambda));
+
+  state->tt = tt;
+  state->perm = perm;
+  state->csf = csf;
+  state->nfactors = nfactors;
+  state->opts = opts;
+  state->moved = false;
+
+  mpi_cpd_hook hook;
+  hook.after_its = rebal_its;
+  hook.func = p_rebalance_hook;
+  hook.data = state;
+
+  double const fit = mpi_cpd_als_iterate(csf, mats, globmats, lambda,
+      nfactors, &rinfo, opts, (rebal_its > 0) ? &hook : NULL);
+
+  splatt_csf_free(state->csf, opts);
+  if(state->tt != NULL) {
+    tt_free(state->tt);
+  }
+  for(idx_t m=0; m < nmodes; ++m) {
+    mat_free(mats[m]);
+    mat_free(globmats[m]);
+  }
+  mat_free(mats[MAX_NMODES]);
+  splatt_free(lambda);
+  perm_free(perm);
+  rank_free(rinfo, nmodes);
+  return fit;
+}
+
+
+CTEST(mpi_cpd, rebalance)
+{
+  int npes;
+  MPI_Comm_size(MPI_COMM_WORLD, &npes);
+
+  double * opts = splatt_default_opts();
+  opts[SPLATT_OPTION_NITER] = 10;
+  opts[SPLATT_OPTION_TOLERANCE] = 0;
+  opts[SPLATT_OPTION_VERBOSITY] = SPLATT_VERBOSITY_NONE;
+
+  /* the small tensors do not have enough slices for many ranks */
+  char const * const fnames[] = {
+    DATASET(med.tns),
+    DATASET(med4.tns),
+    DATASET(med5.tns)
+  };
+  idx_t const ntensors = sizeof(fnames) / sizeof(fnames[0]);
+  for(idx_t i=0; i < ntensors; ++i) {
+    rebal_state gold;
+    rebal_state state;
+    double const goldfit = p_mpi_cpd(fnames[i], 0, opts, &gold);
+    double const fit = p_mpi_cpd(fnames[i], 3, opts, &state);
+
+    /* a lone rank is always balanced */
+    if(npes > 1) {
+      ASSERT_TRUE(state.moved);
+    }
+    if(state.moved) {
+      ASSERT_TRUE(state.layers_kept);
+      ASSERT_EQUAL(state.nnz_before, state.nnz_after);
+      ASSERT_DBL_NEAR_TOL(state.normsq_before, state.normsq_after,
+          1e-9 * state.normsq_before);
+    }
+
+    /* only the order of the sums changes */
+    ASSERT_DBL_NEAR_TOL(goldfit, fit, 1e-6);
+  }
+
+  splatt_free_opts(opts);
+}
+
+
+
+CTEST(mpi_cpd, compress)
+{
+  int rank;
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+  /* a planted low-rank tensor, so that the fit is meaningful */
+  if(rank == 0) {
+    gen_opts gopts;
+    gen_default_opts(&gopts);
+    gopts.nmodes = 3;
+    gopts.dims[0] = 400;
+    gopts.dims[1] = 300;
+    gopts.dims[2] = 200;
+    gopts.nnz = 40000;
+    gopts.rank = 3;
+    gopts.noise = 0.05;
+    gopts.seed = 2;
+    sptensor_t * tt = tt_generate(&gopts);
+    tt_write_binary(tt, TMP_FILE);
+    tt_free(tt);
+  }
+  MPI_Barrier(MPI_COMM_WORLD);
+
+  double * opts = splatt_default_opts();
+  opts[SPLATT_OPTION_NITER] = 30;
+  opts[SPLATT_OPTION_VERBOSITY] = SPLATT_VERBOSITY_NONE;
+
+  rebal_state state;
+  double const goldfit = p_mpi_cpd(TMP_FILE, 0, opts, &state);
+  ASSERT_TRUE(goldfit > 0.8);
+
+  /* precision, threshold, fused reductions, and the allowed loss of fit */
+  struct {
+    splatt_precision_type precision;
+    double delta;
+    bool fuse;
+    double tol;
+  } const configs[] = {
+    { SPLATT_PRECISION_FP32, 0.,    true,  1e-4 },
+    { SPLATT_PRECISION_BF16, 0.,    true,  2e-3 },
+    { SPLATT_PRECISION_BF16, 0.,    false, 2e-3 },
+    { SPLATT_PRECISION_FULL, 0.001, true,  2e-3 },
+    { SPLATT_PRECISION_FP32, 0.001, false, 2e-3 },
+    { SPLATT_PRECISION_BF16, 0.001, true,  2e-3 },
+    /* frozen rows cost about as much fit as the threshold allows */
+    { SPLATT_PRECISION_FULL, 0.01,  true,  2e-2 }
+  };
+  idx_t const nconfigs = sizeof(configs) / sizeof(configs[0]);
+  for(idx_t c=0; c < nconfigs; ++c) {
+    opts[SPLATT_OPTION_COMM_PRECISION] = configs[c].precision;
+    opts[SPLATT_OPTION_COMM_DELTA] = configs[c].delta;
+    opts[SPLATT_OPTION_FUSE_REDUCE] = configs[c].fuse;
+    double const fit = p_mpi_cpd(TMP_FILE, 0, opts, &state);
+    ASSERT_DBL_NEAR_TOL(goldfit, fit, configs[c].tol);
+  }
+
+  /* every pattern sums the same records in the same order */
+  opts[SPLATT_OPTION_COMM_PRECISION] = SPLATT_PRECISION_BF16;
+  opts[SPLATT_OPTION_COMM_DELTA] = 0.001;
+  opts[SPLATT_OPTION_FUSE_REDUCE] = 0;
+  opts[SPLATT_OPTION_COMM] = SPLATT_COMM_POINT2POINT;
+  double const p2pfit = p_mpi_cpd(TMP_FILE, 0, opts, &state);
+  splatt_comm_type const comms[] = {
+    SPLATT_COMM_ALL2ALL,
+    SPLATT_COMM_NEIGHBOR
+  };
+  for(idx_t c=0; c < 2; ++c) {
+    opts[SPLATT_OPTION_COMM] = comms[c];
+    double const fit = p_mpi_cpd(TMP_FILE, 0, opts, &state);
+    ASSERT_DBL_NEAR_TOL(p2pfit, fit, 1e-12);
+  }
+
+  splatt_free_opts(opts);
+  MPI_Barrier(MPI_COMM_WORLD);
+  if(rank == 0) {
+    remove(TMP_FILE);
+  }
+}
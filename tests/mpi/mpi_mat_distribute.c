@@ -0,0 +1,146 @@
+
+#include "../ctest/ctest.h"
+#include "../splatt_test.h"
+
+#include "../../src/splatt_mpi.h"
+#include "../../src/io.h"
+#include "../../src/sptensor.h"
+
+static char const * const TMP_FILE = "mpi_distribute_tmp.bin";
+static char const * const TMP_PARTS = "mpi_distribute_tmp.part";
+
+static idx_t const NMODES = 3;
+static idx_t const DIMS[] = {64, 48, 32};
+static idx_t const NNZ = 2000;
+
+
+/**
+* @brief Write a tensor which only uses even slices. Index 0 appears in every
+*        mode, so each layer has empty slices that no rank claims.
+*
+*        If 'parts' is set, also write a fine-grained partitioning in which
+*        rank 0 shares only one slice of the first mode while the other ranks
+*        share many. Rank 0 then runs out of rows to claim and is forced to
+*        take some.
+*
+* @param parts Whether to write TMP_PARTS.
+*/
+static void p_write_tensor(
+  bool const parts)
+{
+  int rank;
+  int npes;
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  MPI_Comm_size(MPI_COMM_WORLD, &npes);
+
+  if(rank == 0) {
+    sptensor_t * tt = tt_alloc(NNZ, NMODES);
+    srand(1);
+    for(idx_t m=0; m < NMODES; ++m) {
+      tt->dims[m] = DIMS[m];
+      tt->ind[m][0] = 0;
+      for(idx_t n=1; n < NNZ; ++n) {
+        tt->ind[m][n] = 2 * (rand() % (DIMS[m] / 2));
+      }
+    }
+    for(idx_t n=0; n < NNZ; ++n) {
+      tt->vals[n] = 1 + (rand() % 10);
+    }
+
+    if(parts) {
+      FILE * fout = open_f(TMP_PARTS, "w");
+      fprintf(fout, "0\n");
+      for(idx_t n=1; n < NNZ; ++n) {
+        int const p = n % npes;
+        /* the top half of the first mode is contested, the bottom is empty */
+        if(p == 0) {
+          tt->ind[0][n] = DIMS[0] - 2;
+        } else {
+          tt->ind[0][n] = (DIMS[0] / 2) + (2 * (rand() % (DIMS[0] / 4)));
+        }
+        fprintf(fout, "%d\n", p);
+      }
+      fclose(fout);
+    }
+
+    tt_write_binary(tt, TMP_FILE);
+    tt_free(tt);
+  }
+  MPI_Barrier(MPI_COMM_WORLD);
+}
+
+
+static void p_check_empty_slices(
+  splatt_decomp_type const decomp,
+  char const * const pfname)
+{
+  int rank;
+  int npes;
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  MPI_Comm_size(MPI_COMM_WORLD, &npes);
+
+  rank_info rinfo;
+  rinfo.rank = rank;
+  rinfo.npes = npes;
+  rinfo.decomp = decomp;
+  for(idx_t m=0; m < MAX_NMODES; ++m) {
+    rinfo.dims_3d[m] = 1;
+  }
+
+  sptensor_t * tt = mpi_tt_read(TMP_FILE, pfname, &rinfo);
+  permutation_t * perm = mpi_distribute_mats(&rinfo, tt, rinfo.decomp);
+
+  for(idx_t m=0; m < NMODES; ++m) {
+    idx_t const layerdim = tt->dims[m];
+    idx_t const * const perms = perm->perms[m];
+    idx_t const * const iperms = perm->iperms[m];
+
+    /* every old layer index gets a unique new label */
+    for(idx_t i=0; i < layerdim; ++i) {
+      ASSERT_TRUE(perms[i] < layerdim);
+      ASSERT_EQUAL(i, iperms[perms[i]]);
+    }
+
+    /* nonzero rows must all be claimed by some rank in the layer */
+    idx_t nclaimed = rinfo.mat_end[m] - rinfo.mat_start[m];
+    MPI_Allreduce(MPI_IN_PLACE, &nclaimed, 1, SPLATT_MPI_IDX, MPI_SUM,
+        rinfo.layer_comm[m]);
+    for(idx_t n=0; n < tt->nnz; ++n) {
+      ASSERT_TRUE(tt->ind[m][n] < nclaimed);
+    }
+  }
+
+  /* the rest of the setup must cope with the new labels too */
+  tt_remove_empty(tt);
+  for(idx_t m=0; m < NMODES; ++m) {
+    mpi_cpy_indmap(tt, &rinfo, m);
+    mpi_find_owned(tt, m, &rinfo);
+    mpi_compute_ineed(&rinfo, tt, m, 1, 3);
+  }
+
+  perm_free(perm);
+  tt_free(tt);
+  rank_free(rinfo, NMODES);
+
+  MPI_Barrier(MPI_COMM_WORLD);
+  if(rank == 0) {
+    remove(TMP_FILE);
+    if(pfname != NULL) {
+      remove(pfname);
+    }
+  }
+}
+
+
+CTEST(mpi_mat_distribute, empty_slices)
+{
+  p_write_tensor(false);
+  p_check_empty_slices(DEFAULT_MPI_DISTRIBUTION, NULL);
+}
+
+
+CTEST(mpi_mat_distribute, fine_forced_claims)
+{
+  p_write_tensor(true);
+  p_check_empty_slices(SPLATT_DECOMP_FINE, TMP_PARTS);
+}
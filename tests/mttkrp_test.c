@@ -258,3 +258,23 @@ CTEST2(mttkrp, csf_two_densetile_alldepth)
   }
 }
 
+
+CTEST2(mttkrp, csf_two_steal)
+{
+  double * opts = splatt_default_opts();
+  opts[SPLATT_OPTION_NTHREADS]   = 7;
+  opts[SPLATT_OPTION_CSF_ALLOC]  = SPLATT_CSF_TWOMODE;
+  opts[SPLATT_OPTION_STEAL]      = 1;
+
+  /* slices when untiled, then tiles and layers of tiles */
+  opts[SPLATT_OPTION_TILE]       = SPLATT_NOTILE;
+  p_csf_mttkrp(opts, data->tensors, data->ntensors, data->mats, data->gold,
+      data->nfactors);
+
+  opts[SPLATT_OPTION_TILE]       = SPLATT_DENSETILE;
+  for(splatt_idx_t i=0; i <= SPLATT_MAX_NMODES; ++i) {
+    opts[SPLATT_OPTION_TILELEVEL]  = i;
+    p_csf_mttkrp(opts, data->tensors, data->ntensors, data->mats, data->gold,
+        data->nfactors);
+  }
+}